@@ -113,6 +113,11 @@ float ClientManager::GetClientFPS(int index)
 	return m_vClients[index]->GetFPSTS();
 }
 
+CompressionStats ClientManager::GetClientCompression(int index)
+{
+	return m_vClients[index]->GetCompressionStatsTS();
+}
+
 std::string ClientManager::GetClientIP(int index)
 {
 	return std::string();
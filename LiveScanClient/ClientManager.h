@@ -18,6 +18,7 @@ public:
 	void SetPreviewMode(bool depth);
 
 	float GetClientFPS(int index);
+	CompressionStats GetClientCompression(int index);
 	std::string GetClientIP(int index);
 	bool GetClientConnected(int index);
 	bool GetAllClientsConnected();
@@ -154,8 +154,8 @@ void UI::Update(bool force)
 
 void UI::ShowPreview()
 {
-	if (m_pCurrentPreviewFrame.picture != NULL)
-		delete[] m_pCurrentPreviewFrame.picture;
+	if (m_pCurrentPreviewFrame.buffer != NULL)
+		m_pCurrentPreviewFrame.buffer->Release();
 
 	if(!m_bShowDepth)
 		m_pCurrentPreviewFrame = m_cClientManager->GetClientColor(m_nTabSelected);
@@ -210,8 +210,13 @@ void UI::ShowPreview()
 void UI::ShowFPS()
 {
 	m_fAverageFPS = m_cClientManager->GetClientFPS(m_nTabSelected);
-	WCHAR szStatusMessage[64];
-	StringCchPrintf(szStatusMessage, _countof(szStatusMessage), L" FPS = %0.0f", m_fAverageFPS);
+	CompressionStats compression = m_cClientManager->GetClientCompression(m_nTabSelected);
+	WCHAR szStatusMessage[128];
+
+	if (compression.level > 0)
+		StringCchPrintf(szStatusMessage, _countof(szStatusMessage), L" FPS = %0.0f   Compression level = %d, workers = %d", m_fAverageFPS, compression.level, compression.workers);
+	else
+		StringCchPrintf(szStatusMessage, _countof(szStatusMessage), L" FPS = %0.0f", m_fAverageFPS);
 	SetStatusMessage(szStatusMessage, 1000, false);
 }
 
@@ -559,6 +564,80 @@ int APIENTRY wWinMain(
 
 		if (wcscmp(LPWSTR(L"-debugall"), (szArgList[1])) == 0 || wcscmp(LPWSTR(L"-debugAll"), (szArgList[1])) == 0)
 			loglevel = Log::LOGLEVEL_ALL;
+
+		//Compares the pointcloud culling kernels on a synthetic 2160p frame, without starting the client
+		if (wcscmp(LPWSTR(L"-benchmarkcull"), (szArgList[1])) == 0)
+		{
+			std::string result = BenchmarkPointcloudCull(3840, 2160, 20);
+			MessageBoxA(NULL, result.c_str(), "LiveScan3D Pointcloud Cull Benchmark", MB_OK);
+			return 0;
+		}
+
+		//Compares the BGRA and YUV color decoding on the images of the virtual device, without starting the client
+		if (wcscmp(LPWSTR(L"-benchmarkdecode"), (szArgList[1])) == 0)
+		{
+			const char* resolutions[] = { "720p", "1080p", "1440p", "2160p", "1536p", "3072p" };
+			std::string result;
+
+			for (const char* resolution : resolutions)
+			{
+				std::string imagePath = "resources/testdata/virtualdevice/virtualdevice0/colorImages/";
+				imagePath += resolution;
+				imagePath += "/Color_1.jpg";
+
+				std::ifstream image(imagePath);
+				if (image.good())
+					result += BenchmarkColorDecode(imagePath, 0.3f, 20) + "\n";
+			}
+
+			if (result.empty())
+				result = "No virtual device images found in resources/testdata/virtualdevice/virtualdevice0/colorImages/";
+
+			MessageBoxA(NULL, result.c_str(), "LiveScan3D Color Decode Benchmark", MB_OK);
+			return 0;
+		}
+
+		//Compares the compressed size and speed of the frame encodings on the pointclouds of the virtual device, without starting the client
+		if (wcscmp(LPWSTR(L"-benchmarkencoding"), (szArgList[1])) == 0)
+		{
+			KinectConfiguration benchmarkConfiguration;
+			AzureKinectCaptureVirtual capture;
+			capture.OpenDevice();
+
+			std::string result;
+			if (capture.StartCamera(benchmarkConfiguration))
+				result = BenchmarkFrameEncoding(&capture, 10, 3);
+			else
+				result = "Could not start the virtual device, are the files in resources/testdata/virtualdevice/ present?";
+
+			MessageBoxA(NULL, result.c_str(), "LiveScan3D Frame Encoding Benchmark", MB_OK);
+			return 0;
+		}
+
+		//Writes the frames of a raw recording (.lsr) as the Color_N.jpg and Depth_N.tiff files next to it, without starting the client
+		if (wcscmp(LPWSTR(L"-extractraw"), (szArgList[1])) == 0)
+		{
+			std::string result;
+
+			if (argCount > 2)
+			{
+				Log extractLog;
+				FrameFileWriterReader extractor(&extractLog);
+				std::string path = std::filesystem::path(szArgList[2]).string();
+				int frames = 0;
+
+				if (extractor.ExtractRawFile(path, frames))
+					result = "Extracted " + std::to_string(frames) + " frames from " + path;
+				else
+					result = "Extracted " + std::to_string(frames) + " frames, could not read all of " + path;
+			}
+
+			else
+				result = "Usage: LiveScanClient.exe -extractraw <path to the .lsr file>";
+
+			MessageBoxA(NULL, result.c_str(), "LiveScan3D Raw Recording Extractor", MB_OK);
+			return 0;
+		}
 	}
 
 	if (argCount > 2)
@@ -4,22 +4,49 @@ using System.Linq;
 using System.Text;
 using System.Threading.Tasks;
 using System.IO;
+using LiveScanServer;
 
 namespace LiveScanPlayer
 {
+    /// <summary>
+    /// Reads the .bin recordings of the clients. Version 2 files end with the offsets of all frames, version 1 files have text lines
+    /// in front of each frame and are scanned once when they are opened. Either way, jumping to a frame is a single seek afterwards.
+    /// Frames can be stored compressed, in the columnar encoding of the client and with the zstd dictionary that follows the file header.
+    /// The layout is described in binFileFormat.h of the client
+    /// </summary>
     class FrameFileReaderBin : IFrameFileReader
     {
+        const uint binFileMagic = 0x4E42534C; //"LSBN"
+        const uint binFileVersion = 2;
+        const uint binFrameMagic = 0x4D52464C; //"LFRM"
+        const int fileHeaderSize = 24;
+        const int frameHeaderSize = 32;
+        const int fileFooterSize = 16;
+
+        const int compressionNone = 0;
+        const int compressionZstdColumnar = 1;
+        const uint flagDictionary = 1;
+
+        const int bytesPerVertexPoint = 3 * sizeof(short);
+        const int bytesPerColorPoint = 4 * sizeof(byte);
+        const int bytesPerPoint = bytesPerVertexPoint + bytesPerColorPoint;
+
         BinaryReader binaryReader;
         int currentFrameIdx = 0;
-        int totalFrameCount = 0;
+        uint fileVersion = 1;
+        List<long> lFrameOffsets = new List<long>();
         string filename;
 
+        //For compressed frames, created once the file turns out to have some
+        IntPtr decompressionContext = IntPtr.Zero;
+        IntPtr dictionary = IntPtr.Zero;
+
 
         public FrameFileReaderBin(string filename)
         {
             this.filename = filename;
             binaryReader = new BinaryReader(File.Open(this.filename, FileMode.Open));
-            GetTotalFrameCount();
+            ReadFrameIndex();
         }
 
         public int frameIdx
@@ -38,26 +65,33 @@ namespace LiveScanPlayer
         {
             get
             {
-                return totalFrameCount;
+                return lFrameOffsets.Count;
             }
         }
 
         public void ReadFrame(List<float> vertices, List<byte> colors)
         {
-            if (binaryReader.BaseStream.Position >= binaryReader.BaseStream.Length)
+            if (currentFrameIdx >= lFrameOffsets.Count)
+                return;
+
+            binaryReader.BaseStream.Seek(lFrameOffsets[currentFrameIdx], SeekOrigin.Begin);
+            currentFrameIdx++;
+
+            int nPoints;
+            int compression;
+            ulong dataSize;
+
+            if (!ReadFrameHeader(out nPoints, out compression, out dataSize))
                 return;
 
-            string[] lineParts = ReadLine().Split(' ');
-            int nPoints = Int32.Parse(lineParts[1]);
-            lineParts = ReadLine().Split(' ');
-            int frameTimestamp = Int32.Parse(lineParts[1]);
+            if (compression == compressionZstdColumnar)
+            {
+                ReadCompressedFrame(nPoints, (int)dataSize, vertices, colors);
+                return;
+            }
 
             short[] tempVertices = new short[3 * nPoints];
             byte[] tempColors = new byte[4 * nPoints];
-
-            int bytesPerVertexPoint = 3 * sizeof(short);
-            int bytesPerColorPoint = 4 * sizeof(byte);
-            int bytesPerPoint = bytesPerVertexPoint + bytesPerColorPoint;
             
             byte[] frameData = binaryReader.ReadBytes(bytesPerPoint * nPoints);
 
@@ -82,89 +116,249 @@ namespace LiveScanPlayer
                 colors.Add(tempColors[4 * i + 1]);
                 colors.Add(tempColors[4 * i + 2]);
             }
+        }
 
-            if(binaryReader.BaseStream.Position < binaryReader.BaseStream.Length)
-                binaryReader.ReadByte();
+        /// <summary>
+        /// Decompresses a frame in the columnar encoding: The X, Y and Z columns hold the difference to the previous point, byte-shuffled
+        /// into all low bytes followed by all high bytes. Then follow the red, green and blue columns.
+        /// The colors are added in the same order as those of the uncompressed frames
+        /// </summary>
+        private void ReadCompressedFrame(int nPoints, int dataSize, List<float> vertices, List<byte> colors)
+        {
+            byte[] compressed = binaryReader.ReadBytes(dataSize);
 
-            currentFrameIdx++;
+            if (compressed.Length < dataSize)
+                return;
+
+            if (decompressionContext == IntPtr.Zero)
+                decompressionContext = ZSTDDecompressor.ZSTD_createDCtx();
+
+            //The number of points, then 9 bytes per point
+            byte[] frameData = ZSTDDecompressor.Decompress(compressed, sizeof(int) + 9 * nPoints, decompressionContext, dictionary);
+
+            if (frameData == null || BitConverter.ToInt32(frameData, 0) != nPoints)
+            {
+                Log.LogWarning("Frame " + (currentFrameIdx - 1) + " of " + filename + " could not be decompressed");
+                return;
+            }
+
+            int columnsStart = sizeof(int);
+            float[] tempVertices = new float[3 * nPoints];
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int lowBytes = columnsStart + 2 * axis * nPoints;
+                int highBytes = lowBytes + nPoints;
+                short value = 0;
+
+                for (int i = 0; i < nPoints; i++)
+                {
+                    value = unchecked((short)(value + (frameData[lowBytes + i] | (frameData[highBytes + i] << 8))));
+                    tempVertices[3 * i + axis] = value / 1000.0f;
+                }
+            }
+
+            int red = columnsStart + 6 * nPoints;
+            int green = red + nPoints;
+            int blue = green + nPoints;
+
+            vertices.AddRange(tempVertices);
+
+            for (int i = 0; i < nPoints; i++)
+            {
+                colors.Add(frameData[blue + i]);
+                colors.Add(frameData[green + i]);
+                colors.Add(frameData[red + i]);
+            }
         }
 
         /// <summary>
-        /// Skips the current frame in the binaryReader. Returns false when end of file has been reached
+        /// Reads the header of the frame at the current position, so that its data follows.
+        /// Returns false if the frame can't be read by this player
         /// </summary>
-        /// <returns></returns>
-        private bool SkipFrame()
+        private bool ReadFrameHeader(out int nPoints, out int compression, out ulong dataSize)
         {
-            if (binaryReader.BaseStream.Position >= binaryReader.BaseStream.Length)
-                return false;
+            nPoints = 0;
+            compression = compressionNone;
+            dataSize = 0;
 
-            string[] lineParts = ReadLine().Split(' ');
-            int nPoints = Int32.Parse(lineParts[1]);
-            lineParts = ReadLine().Split(' ');
+            if (fileVersion < 2)
+            {
+                string[] lineParts = ReadLine().Split(' ');
+                nPoints = Int32.Parse(lineParts[1]);
+                ReadLine(); //The timestamp, which the player doesn't need
 
-            int bytesPerVertexPoint = 3 * sizeof(short);
-            int bytesPerColorPoint = 4 * sizeof(byte);
-            int bytesPerPoint = bytesPerVertexPoint + bytesPerColorPoint;
+                return true;
+            }
 
-            if (binaryReader.BaseStream.Position + (bytesPerPoint * nPoints) > binaryReader.BaseStream.Length)
-                return false;
+            uint magic = binaryReader.ReadUInt32();
+            nPoints = binaryReader.ReadInt32();
+            compression = binaryReader.ReadInt32();
+            binaryReader.ReadUInt32(); //Reserved
+            binaryReader.ReadUInt64(); //Timestamp
+            dataSize = binaryReader.ReadUInt64();
 
-            binaryReader.BaseStream.Seek(bytesPerPoint * nPoints + 1, SeekOrigin.Current);
+            bool readable = magic == binFrameMagic && (compression == compressionZstdColumnar || (compression == compressionNone && dataSize == (ulong)nPoints * bytesPerPoint));
 
-            currentFrameIdx++;
+            if (!readable || nPoints < 0)
+            {
+                Log.LogWarning("Frame " + (currentFrameIdx - 1) + " of " + filename + " has a layout this player can't read");
+                return false;
+            }
 
             return true;
         }
 
-        public void JumpToFrame(int targetFrame)
+        /// <summary>
+        /// Finds out which version the file has and gets the offsets of its frames
+        /// </summary>
+        private void ReadFrameIndex()
         {
-            int skipFrameCount = targetFrame;
+            Stream stream = binaryReader.BaseStream;
+            lFrameOffsets.Clear();
+            fileVersion = 1;
 
-            if (targetFrame == currentFrameIdx)
-                return;
+            if (stream.Length >= fileHeaderSize && binaryReader.ReadUInt32() == binFileMagic)
+            {
+                fileVersion = binaryReader.ReadUInt32();
+                uint headerSize = binaryReader.ReadUInt32();
+                uint fileFrameHeaderSize = binaryReader.ReadUInt32();
+                binaryReader.ReadInt32(); //Device index
+                uint flags = binaryReader.ReadUInt32();
 
-            //Atm we can only jump forward in time, so if the target frame is behind our current frame we need rewind and start from the beginning
-            if (targetFrame < currentFrameIdx)
-                Rewind();
+                if (fileVersion != binFileVersion || fileFrameHeaderSize != frameHeaderSize)
+                {
+                    Log.LogError(filename + " has version " + fileVersion + ", which this player can't read");
+                    return;
+                }
 
-            else
-                skipFrameCount = targetFrame - currentFrameIdx;
+                //The dictionary of the compressed frames fills the rest of the header
+                if ((flags & flagDictionary) != 0 && headerSize > fileHeaderSize)
+                {
+                    byte[] dictionaryData = binaryReader.ReadBytes((int)headerSize - fileHeaderSize);
+                    dictionary = ZSTDDecompressor.ZSTD_createDDict(dictionaryData, (UIntPtr)dictionaryData.Length);
+                }
 
-            for (int i = 0; i < skipFrameCount; i++)
-            {
-                SkipFrame();
+                if (ReadFrameIndexFromFooter())
+                    return;
+
+                Log.LogWarning(filename + " has no frame index, it was probably not closed properly. Rebuilding the index from the frames");
+                stream.Seek(headerSize, SeekOrigin.Begin);
+
+                //Stops at the first header without the magic as well, the file may end in zeros that were reserved for it but never written
+                while (stream.Position + frameHeaderSize <= stream.Length)
+                {
+                    long offset = stream.Position;
+                    uint magic = binaryReader.ReadUInt32();
+                    int nPoints = binaryReader.ReadInt32();
+                    binaryReader.ReadInt32(); //Compression
+                    binaryReader.ReadUInt32(); //Reserved
+                    binaryReader.ReadUInt64(); //Timestamp
+                    long frameEnd = offset + frameHeaderSize + (long)binaryReader.ReadUInt64();
+
+                    if (magic != binFrameMagic || nPoints < 0 || frameEnd > stream.Length)
+                        break;
+
+                    lFrameOffsets.Add(offset);
+                    stream.Seek(frameEnd, SeekOrigin.Begin);
+                }
+
+                return;
             }
 
+            //Version 1 files start right with the text lines of the first frame, the only way to find the frames is to go through all of them
+            stream.Seek(0, SeekOrigin.Begin);
+
+            while (true)
+            {
+                long offset = stream.Position;
+
+                if (!SkipFrame())
+                    break;
+
+                lFrameOffsets.Add(offset);
+            }
         }
 
-        public void Rewind()
+        private bool ReadFrameIndexFromFooter()
         {
-            currentFrameIdx = 0;
-            binaryReader.BaseStream.Seek(0, SeekOrigin.Begin);
+            Stream stream = binaryReader.BaseStream;
+
+            if (stream.Length < fileHeaderSize + fileFooterSize)
+                return false;
+
+            stream.Seek(-fileFooterSize, SeekOrigin.End);
+            ulong indexOffset = binaryReader.ReadUInt64();
+            uint frameCount = binaryReader.ReadUInt32();
+            uint magic = binaryReader.ReadUInt32();
+
+            if (magic != binFileMagic || indexOffset + (ulong)frameCount * sizeof(ulong) + fileFooterSize != (ulong)stream.Length)
+                return false;
+
+            stream.Seek((long)indexOffset, SeekOrigin.Begin);
+
+            for (int i = 0; i < frameCount; i++)
+            {
+                lFrameOffsets.Add((long)binaryReader.ReadUInt64());
+            }
+
+            return true;
         }
 
-        private void GetTotalFrameCount()
+        /// <summary>
+        /// Skips the current frame of a version 1 file in the binaryReader. Returns false when end of file has been reached
+        /// </summary>
+        /// <returns></returns>
+        private bool SkipFrame()
         {
-            long StreamPosition = binaryReader.BaseStream.Position;
+            if (binaryReader.BaseStream.Position >= binaryReader.BaseStream.Length)
+                return false;
 
-            Rewind();
+            int nPoints;
+            int compression;
+            ulong dataSize;
 
-            int count = 0;
+            try
+            {
+                ReadFrameHeader(out nPoints, out compression, out dataSize);
+            }
 
-            while (SkipFrame())
+            catch (Exception ex) when (ex is EndOfStreamException || ex is FormatException || ex is IndexOutOfRangeException)
             {
-                count++;
+                return false;
             }
 
-            totalFrameCount = count;
+            if (binaryReader.BaseStream.Position + (bytesPerPoint * nPoints) > binaryReader.BaseStream.Length)
+                return false;
+
+            binaryReader.BaseStream.Seek(bytesPerPoint * nPoints + 1, SeekOrigin.Current);
+
+            return true;
+        }
+
+        public void JumpToFrame(int targetFrame)
+        {
+            currentFrameIdx = Math.Max(0, Math.Min(targetFrame, lFrameOffsets.Count));
+        }
 
-            binaryReader.BaseStream.Seek(StreamPosition, SeekOrigin.Begin);
+        public void Rewind()
+        {
+            currentFrameIdx = 0;
         }
 
         public void CloseReader()
         {
             binaryReader.Close();
             binaryReader.Dispose();
+
+            if (dictionary != IntPtr.Zero)
+                ZSTDDecompressor.ZSTD_freeDDict(dictionary);
+
+            if (decompressionContext != IntPtr.Zero)
+                ZSTDDecompressor.ZSTD_freeDCtx(decompressionContext);
+
+            dictionary = IntPtr.Zero;
+            decompressionContext = IntPtr.Zero;
         }
 
         public string ReadLine()
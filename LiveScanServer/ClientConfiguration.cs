@@ -12,7 +12,7 @@ namespace LiveScanServer
 
     public class ClientConfiguration
     {
-        public static int bytelength = 42;
+        public static int bytelength = 48;
         static int serialnumberSize = 13;
         static int nicknameSize = 20;
         public enum SyncState { Main = 0, Subordinate = 1, Standalone = 2, Unknown = 3 };
@@ -22,6 +22,12 @@ namespace LiveScanServer
 
         public bool FilterDepthMap;
         public int FilterDepthMapSize;
+        public byte ColorDecodeScale; //The client decodes the color image at 1/ColorDecodeScale of its resolution. Can be 1, 2, 4 or 8
+        public bool DecodeColorToYUV; //In pointcloud mode, the client only converts the colors of the points that survive the culling
+        public bool FilterFlyingPixels; //Removes depth pixels that jump away from a neighbour by more than FlyingPixelThreshold percent of their depth
+        public byte FlyingPixelThreshold;
+        public bool FilterSmallComponents; //Removes regions of continuous depth with less than SmallComponentSize pixels
+        public byte SmallComponentSize;
         public string SerialNumber;
         public string NickName;
         public byte globalDeviceIndex; //Each Client recieves a unique index from the server 
@@ -45,6 +51,12 @@ namespace LiveScanServer
             globalDeviceIndex = 0; // 255 = invalid index
             FilterDepthMap = false;
             FilterDepthMapSize = 0;
+            ColorDecodeScale = 1;
+            DecodeColorToYUV = false;
+            FilterFlyingPixels = false;
+            FlyingPixelThreshold = 5;
+            FilterSmallComponents = false;
+            SmallComponentSize = 50;
         }
 
 
@@ -79,6 +91,18 @@ namespace LiveScanServer
             FilterDepthMap = bytes[i] == 0 ? false : true;
             i++;
             FilterDepthMapSize = bytes[i];
+            i++;
+            ColorDecodeScale = bytes[i];
+            i++;
+            DecodeColorToYUV = bytes[i] == 0 ? false : true;
+            i++;
+            FilterFlyingPixels = bytes[i] == 0 ? false : true;
+            i++;
+            FlyingPixelThreshold = bytes[i];
+            i++;
+            FilterSmallComponents = bytes[i] == 0 ? false : true;
+            i++;
+            SmallComponentSize = bytes[i];
         }
 
         public byte[] ToBytes()
@@ -112,6 +136,18 @@ namespace LiveScanServer
             data[i] = (byte)(FilterDepthMap ? 1 : 0);
             i++;
             data[i] = (byte)FilterDepthMapSize;
+            i++;
+            data[i] = ColorDecodeScale;
+            i++;
+            data[i] = (byte)(DecodeColorToYUV ? 1 : 0);
+            i++;
+            data[i] = (byte)(FilterFlyingPixels ? 1 : 0);
+            i++;
+            data[i] = FlyingPixelThreshold;
+            i++;
+            data[i] = (byte)(FilterSmallComponents ? 1 : 0);
+            i++;
+            data[i] = SmallComponentSize;
             return data;
         }
 
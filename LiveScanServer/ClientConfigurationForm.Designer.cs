@@ -43,7 +43,18 @@ namespace LiveScanServer
             this.pictureBox1 = new System.Windows.Forms.PictureBox();
             this.pictureBox2 = new System.Windows.Forms.PictureBox();
             this.ttInfo = new System.Windows.Forms.ToolTip(this.components);
+            this.lColorDecodeScaleHeader = new System.Windows.Forms.Label();
+            this.cbColorDecodeScale = new System.Windows.Forms.ComboBox();
+            this.chDecodeColorToYUV = new System.Windows.Forms.CheckBox();
+            this.cbFilterFlyingPixels = new System.Windows.Forms.CheckBox();
+            this.nFlyingPixelThreshold = new System.Windows.Forms.NumericUpDown();
+            this.lFlyingPixelThresholdHeader = new System.Windows.Forms.Label();
+            this.cbFilterSmallComponents = new System.Windows.Forms.CheckBox();
+            this.nSmallComponentSize = new System.Windows.Forms.NumericUpDown();
+            this.lSmallComponentSizeHeader = new System.Windows.Forms.Label();
             ((System.ComponentModel.ISupportInitialize)(this.nDepthFilterSize)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nFlyingPixelThreshold)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nSmallComponentSize)).BeginInit();
             ((System.ComponentModel.ISupportInitialize)(this.pInfoRefineCalib)).BeginInit();
             ((System.ComponentModel.ISupportInitialize)(this.pictureBox1)).BeginInit();
             ((System.ComponentModel.ISupportInitialize)(this.pictureBox2)).BeginInit();
@@ -60,7 +71,7 @@ namespace LiveScanServer
             // 
             // btApplyCurrentDevice
             // 
-            this.btApplyCurrentDevice.Location = new System.Drawing.Point(265, 192);
+            this.btApplyCurrentDevice.Location = new System.Drawing.Point(265, 244);
             this.btApplyCurrentDevice.Name = "btApplyCurrentDevice";
             this.btApplyCurrentDevice.Size = new System.Drawing.Size(125, 23);
             this.btApplyCurrentDevice.TabIndex = 1;
@@ -117,7 +128,7 @@ namespace LiveScanServer
             // 
             // btApplyAll
             // 
-            this.btApplyAll.Location = new System.Drawing.Point(139, 192);
+            this.btApplyAll.Location = new System.Drawing.Point(139, 244);
             this.btApplyAll.Name = "btApplyAll";
             this.btApplyAll.Size = new System.Drawing.Size(120, 23);
             this.btApplyAll.TabIndex = 11;
@@ -194,11 +205,143 @@ namespace LiveScanServer
             // 
             this.ttInfo.AutomaticDelay = 0;
             // 
+            // lColorDecodeScaleHeader
+            // 
+            this.lColorDecodeScaleHeader.AutoSize = true;
+            this.lColorDecodeScaleHeader.Location = new System.Drawing.Point(205, 138);
+            this.lColorDecodeScaleHeader.Name = "lColorDecodeScaleHeader";
+            this.lColorDecodeScaleHeader.Size = new System.Drawing.Size(103, 13);
+            this.lColorDecodeScaleHeader.TabIndex = 28;
+            this.lColorDecodeScaleHeader.Text = "Color Decode Scale";
+            this.ttInfo.SetToolTip(this.lColorDecodeScaleHeader, "Decodes the color image at a lower resolution, which is a lot cheaper than a full" +
+        " decode. Useful for high color resolutions in live preview and streaming");
+            // 
+            // cbColorDecodeScale
+            // 
+            this.cbColorDecodeScale.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+            this.cbColorDecodeScale.FormattingEnabled = true;
+            this.cbColorDecodeScale.Location = new System.Drawing.Point(310, 135);
+            this.cbColorDecodeScale.Name = "cbColorDecodeScale";
+            this.cbColorDecodeScale.Size = new System.Drawing.Size(80, 21);
+            this.cbColorDecodeScale.TabIndex = 29;
+            this.cbColorDecodeScale.SelectedIndexChanged += new System.EventHandler(this.cbColorDecodeScale_SelectedIndexChanged);
+            // 
+            // chDecodeColorToYUV
+            // 
+            this.chDecodeColorToYUV.AutoSize = true;
+            this.chDecodeColorToYUV.Location = new System.Drawing.Point(208, 162);
+            this.chDecodeColorToYUV.Name = "chDecodeColorToYUV";
+            this.chDecodeColorToYUV.Size = new System.Drawing.Size(158, 17);
+            this.chDecodeColorToYUV.TabIndex = 30;
+            this.chDecodeColorToYUV.Text = "Sample Color after Culling";
+            this.ttInfo.SetToolTip(this.chDecodeColorToYUV, "Only converts the colors of the points that are inside the bounds, instead of the" +
+        " whole color image. Only applies to pointcloud capture while the color preview i" +
+        "s not shown");
+            this.chDecodeColorToYUV.UseVisualStyleBackColor = true;
+            this.chDecodeColorToYUV.CheckedChanged += new System.EventHandler(this.chDecodeColorToYUV_CheckedChanged);
+            // 
+            // cbFilterFlyingPixels
+            // 
+            this.cbFilterFlyingPixels.AutoSize = true;
+            this.cbFilterFlyingPixels.Location = new System.Drawing.Point(12, 189);
+            this.cbFilterFlyingPixels.Name = "cbFilterFlyingPixels";
+            this.cbFilterFlyingPixels.Size = new System.Drawing.Size(126, 17);
+            this.cbFilterFlyingPixels.TabIndex = 31;
+            this.cbFilterFlyingPixels.Text = "Remove Flying Pixels";
+            this.ttInfo.SetToolTip(this.cbFilterFlyingPixels, "Removes the points that get smeared between foreground and background along depth edges");
+            this.cbFilterFlyingPixels.UseVisualStyleBackColor = true;
+            this.cbFilterFlyingPixels.CheckedChanged += new System.EventHandler(this.cbFilterFlyingPixels_CheckedChanged);
+            // 
+            // nFlyingPixelThreshold
+            // 
+            this.nFlyingPixelThreshold.Location = new System.Drawing.Point(31, 211);
+            this.nFlyingPixelThreshold.Maximum = new decimal(new int[] {
+            99,
+            0,
+            0,
+            0});
+            this.nFlyingPixelThreshold.Minimum = new decimal(new int[] {
+            1,
+            0,
+            0,
+            0});
+            this.nFlyingPixelThreshold.Name = "nFlyingPixelThreshold";
+            this.nFlyingPixelThreshold.Size = new System.Drawing.Size(45, 20);
+            this.nFlyingPixelThreshold.TabIndex = 32;
+            this.nFlyingPixelThreshold.Value = new decimal(new int[] {
+            5,
+            0,
+            0,
+            0});
+            this.nFlyingPixelThreshold.ValueChanged += new System.EventHandler(this.nFlyingPixelThreshold_ValueChanged);
+            // 
+            // lFlyingPixelThresholdHeader
+            // 
+            this.lFlyingPixelThresholdHeader.AutoSize = true;
+            this.lFlyingPixelThresholdHeader.Location = new System.Drawing.Point(80, 214);
+            this.lFlyingPixelThresholdHeader.Name = "lFlyingPixelThresholdHeader";
+            this.lFlyingPixelThresholdHeader.Size = new System.Drawing.Size(109, 13);
+            this.lFlyingPixelThresholdHeader.TabIndex = 33;
+            this.lFlyingPixelThresholdHeader.Text = "Max. Jump (% of depth)";
+            // 
+            // cbFilterSmallComponents
+            // 
+            this.cbFilterSmallComponents.AutoSize = true;
+            this.cbFilterSmallComponents.Location = new System.Drawing.Point(208, 189);
+            this.cbFilterSmallComponents.Name = "cbFilterSmallComponents";
+            this.cbFilterSmallComponents.Size = new System.Drawing.Size(152, 17);
+            this.cbFilterSmallComponents.TabIndex = 34;
+            this.cbFilterSmallComponents.Text = "Remove Small Components";
+            this.ttInfo.SetToolTip(this.cbFilterSmallComponents, "Removes small floating specks of depth. The maximum jump also decides which pixels belong together");
+            this.cbFilterSmallComponents.UseVisualStyleBackColor = true;
+            this.cbFilterSmallComponents.CheckedChanged += new System.EventHandler(this.cbFilterSmallComponents_CheckedChanged);
+            // 
+            // nSmallComponentSize
+            // 
+            this.nSmallComponentSize.Location = new System.Drawing.Point(227, 211);
+            this.nSmallComponentSize.Maximum = new decimal(new int[] {
+            255,
+            0,
+            0,
+            0});
+            this.nSmallComponentSize.Minimum = new decimal(new int[] {
+            1,
+            0,
+            0,
+            0});
+            this.nSmallComponentSize.Name = "nSmallComponentSize";
+            this.nSmallComponentSize.Size = new System.Drawing.Size(45, 20);
+            this.nSmallComponentSize.TabIndex = 35;
+            this.nSmallComponentSize.Value = new decimal(new int[] {
+            50,
+            0,
+            0,
+            0});
+            this.nSmallComponentSize.ValueChanged += new System.EventHandler(this.nSmallComponentSize_ValueChanged);
+            // 
+            // lSmallComponentSizeHeader
+            // 
+            this.lSmallComponentSizeHeader.AutoSize = true;
+            this.lSmallComponentSizeHeader.Location = new System.Drawing.Point(276, 214);
+            this.lSmallComponentSizeHeader.Name = "lSmallComponentSizeHeader";
+            this.lSmallComponentSizeHeader.Size = new System.Drawing.Size(97, 13);
+            this.lSmallComponentSizeHeader.TabIndex = 36;
+            this.lSmallComponentSizeHeader.Text = "Min. Size (Pixels)";
+            // 
             // KinectConfigurationForm
             // 
             this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
             this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
-            this.ClientSize = new System.Drawing.Size(402, 227);
+            this.ClientSize = new System.Drawing.Size(402, 279);
+            this.Controls.Add(this.lSmallComponentSizeHeader);
+            this.Controls.Add(this.nSmallComponentSize);
+            this.Controls.Add(this.cbFilterSmallComponents);
+            this.Controls.Add(this.lFlyingPixelThresholdHeader);
+            this.Controls.Add(this.nFlyingPixelThreshold);
+            this.Controls.Add(this.cbFilterFlyingPixels);
+            this.Controls.Add(this.chDecodeColorToYUV);
+            this.Controls.Add(this.cbColorDecodeScale);
+            this.Controls.Add(this.lColorDecodeScaleHeader);
             this.Controls.Add(this.pictureBox2);
             this.Controls.Add(this.pictureBox1);
             this.Controls.Add(this.pInfoRefineCalib);
@@ -215,6 +358,8 @@ namespace LiveScanServer
             this.Text = "KinectSettingsForm";
             this.FormClosed += new System.Windows.Forms.FormClosedEventHandler(this.KinectSettingsForm_FormClosed);
             ((System.ComponentModel.ISupportInitialize)(this.nDepthFilterSize)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nFlyingPixelThreshold)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nSmallComponentSize)).EndInit();
             ((System.ComponentModel.ISupportInitialize)(this.pInfoRefineCalib)).EndInit();
             ((System.ComponentModel.ISupportInitialize)(this.pictureBox1)).EndInit();
             ((System.ComponentModel.ISupportInitialize)(this.pictureBox2)).EndInit();
@@ -228,6 +373,15 @@ namespace LiveScanServer
         private System.Windows.Forms.ListBox lbDepthRes;
         private System.Windows.Forms.Button btApplyCurrentDevice;
         private System.Windows.Forms.CheckBox cbFilterDepthMap;
+        private System.Windows.Forms.Label lColorDecodeScaleHeader;
+        private System.Windows.Forms.ComboBox cbColorDecodeScale;
+        private System.Windows.Forms.CheckBox chDecodeColorToYUV;
+        private System.Windows.Forms.CheckBox cbFilterFlyingPixels;
+        private System.Windows.Forms.NumericUpDown nFlyingPixelThreshold;
+        private System.Windows.Forms.Label lFlyingPixelThresholdHeader;
+        private System.Windows.Forms.CheckBox cbFilterSmallComponents;
+        private System.Windows.Forms.NumericUpDown nSmallComponentSize;
+        private System.Windows.Forms.Label lSmallComponentSizeHeader;
         private System.Windows.Forms.Label lDepthFilterSizeHeader;
         private System.Windows.Forms.ListBox lbColorRes;
         private System.Windows.Forms.Label lDepthModeHeader;
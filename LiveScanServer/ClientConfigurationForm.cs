@@ -26,6 +26,7 @@ namespace LiveScanServer
 
             CreateDepthResList();
             CreateColorResList();
+            CreateColorDecodeScaleList();
 
             OpenConfig(serialnumber);
 
@@ -54,6 +55,10 @@ namespace LiveScanServer
 
             cbFilterDepthMap.Checked = newConfig.FilterDepthMap;
             nDepthFilterSize.Value = newConfig.FilterDepthMapSize;
+            cbFilterFlyingPixels.Checked = newConfig.FilterFlyingPixels;
+            nFlyingPixelThreshold.Value = Math.Max(nFlyingPixelThreshold.Minimum, Math.Min(nFlyingPixelThreshold.Maximum, newConfig.FlyingPixelThreshold));
+            cbFilterSmallComponents.Checked = newConfig.FilterSmallComponents;
+            nSmallComponentSize.Value = Math.Max(nSmallComponentSize.Minimum, newConfig.SmallComponentSize);
 
             //Disable changing depth map filtering if we are in raw frames mode.
             //Depth filtering only works in point cloud mode.
@@ -69,6 +74,14 @@ namespace LiveScanServer
 
             lbColorRes.SelectedIndex = colorRes - 1;
 
+            //The scales are powers of two, so the list index is the exponent
+            int decodeScaleIndex = 0;
+            while ((1 << decodeScaleIndex) < newConfig.ColorDecodeScale && decodeScaleIndex < 3)
+                decodeScaleIndex++;
+
+            cbColorDecodeScale.SelectedIndex = decodeScaleIndex;
+            chDecodeColorToYUV.Checked = newConfig.DecodeColorToYUV;
+
         }
 
         public ClientConfiguration GetCurrentlyShownConfig()
@@ -107,6 +120,20 @@ namespace LiveScanServer
             lbColorRes.Items.AddRange(colorModes);
         }
 
+        private void CreateColorDecodeScaleList()
+        {
+            string[] decodeScales = new string[]
+            {
+                "Full",
+                "1/2",
+                "1/4",
+                "1/8"
+            };
+
+            cbColorDecodeScale.Items.Clear();
+            cbColorDecodeScale.Items.AddRange(decodeScales);
+        }
+
         private void btApply_Click(object sender, EventArgs e)
         {
             Log.LogDebug("Updating configuration for device: " + displayedConfiguration.SerialNumber);
@@ -149,6 +176,12 @@ namespace LiveScanServer
 
                 configs[i].FilterDepthMap = displayedConfiguration.FilterDepthMap;
                 configs[i].FilterDepthMapSize = displayedConfiguration.FilterDepthMapSize;
+                configs[i].FilterFlyingPixels = displayedConfiguration.FilterFlyingPixels;
+                configs[i].FlyingPixelThreshold = displayedConfiguration.FlyingPixelThreshold;
+                configs[i].FilterSmallComponents = displayedConfiguration.FilterSmallComponents;
+                configs[i].SmallComponentSize = displayedConfiguration.SmallComponentSize;
+                configs[i].ColorDecodeScale = displayedConfiguration.ColorDecodeScale;
+                configs[i].DecodeColorToYUV = displayedConfiguration.DecodeColorToYUV;
                 configs[i].eDepthRes = displayedConfiguration.eDepthRes;
                 configs[i].eColorRes = displayedConfiguration.eColorRes;
             }
@@ -174,6 +207,16 @@ namespace LiveScanServer
             displayedConfiguration.eColorRes = (ClientConfiguration.colorResolution)selected;
         }
 
+        private void cbColorDecodeScale_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            displayedConfiguration.ColorDecodeScale = (byte)(1 << cbColorDecodeScale.SelectedIndex);
+        }
+
+        private void chDecodeColorToYUV_CheckedChanged(object sender, EventArgs e)
+        {
+            displayedConfiguration.DecodeColorToYUV = chDecodeColorToYUV.Checked;
+        }
+
         private void cbFilterDepthMap_CheckedChanged(object sender, EventArgs e)
         {
             displayedConfiguration.FilterDepthMap = cbFilterDepthMap.Checked;
@@ -192,6 +235,26 @@ namespace LiveScanServer
             displayedConfiguration.FilterDepthMapSize = size;
         }
 
+        private void cbFilterFlyingPixels_CheckedChanged(object sender, EventArgs e)
+        {
+            displayedConfiguration.FilterFlyingPixels = cbFilterFlyingPixels.Checked;
+        }
+
+        private void nFlyingPixelThreshold_ValueChanged(object sender, EventArgs e)
+        {
+            displayedConfiguration.FlyingPixelThreshold = (byte)nFlyingPixelThreshold.Value;
+        }
+
+        private void cbFilterSmallComponents_CheckedChanged(object sender, EventArgs e)
+        {
+            displayedConfiguration.FilterSmallComponents = cbFilterSmallComponents.Checked;
+        }
+
+        private void nSmallComponentSize_ValueChanged(object sender, EventArgs e)
+        {
+            displayedConfiguration.SmallComponentSize = (byte)nSmallComponentSize.Value;
+        }
+
         public void SetButtonsInteractive(bool enabled)
         {
             btApplyAll.Enabled = enabled;
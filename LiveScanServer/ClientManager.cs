@@ -43,6 +43,23 @@ namespace LiveScanServer
         object oFrameRequestLock = new object();
         const float networkTimeout = 5f;
 
+        //The live view subscribes to every n-th frame of the clients, and lets that many pushed frames be on their way per client
+        const int liveFrameInterval = 1;
+        const int liveFrameCredits = 2;
+
+        //Temporally synced clients share the clock of their device timestamps, so their live frames are lined up: Once the first client pushed
+        //a frame, we wait a little for the others, and leave out frames that were taken too long before the newest one
+        const int liveFrameAlignmentWaitMs = 30;
+        const ulong liveFrameAlignmentUs = 20000;
+
+        //How many stored frames each client may send ahead of the one being saved. Must not exceed the slots of the shared memory of the clients,
+        //which the client overwrites without waiting
+        const int storedFrameWindow = 4;
+
+        //Frames of the empty scene each client learns its background model from, two seconds at 30 fps
+        const int backgroundLearnFrames = 60;
+        bool bStoredFrameTransferStarted = false;
+
         public ClientManager(LiveScanServer server)
         {
             this.server = server;
@@ -960,6 +977,11 @@ namespace LiveScanServer
             return takePathServer;
         }
 
+        /// <summary>
+        /// Gets the next stored frame of every client. The first call starts a bulk transfer on all clients at once,
+        /// after that they keep streaming their frames while we save the previous ones, instead of waiting for a request for each frame
+        /// </summary>
+        /// <returns>False once any client has no more stored frames</returns>
         public bool GetStoredFrame(List<List<byte>> lFramesRGB, List<List<Single>> lFramesVerts)
         {
             bool bNoMoreStoredFrames;
@@ -968,50 +990,67 @@ namespace LiveScanServer
 
             lock (oFrameRequestLock)
             {
-                //Request frames
-                lock (oClientSocketLock)
+                if (!bStoredFrameTransferStarted)
                 {
-                    for (int i = 0; i < lClientSockets.Count; i++)
-                        lClientSockets[i].RequestStoredFrame();
+                    lock (oClientSocketLock)
+                    {
+                        for (int i = 0; i < lClientSockets.Count; i++)
+                            lClientSockets[i].RequestStoredFrames(0, -1, storedFrameWindow);
+                    }
+
+                    bStoredFrameTransferStarted = true;
                 }
 
-                //Wait till frames received
+                //Wait till every client has its next frame queued, or one of them ran out of frames
                 bool allGathered = false;
                 bNoMoreStoredFrames = false;
-                while (!allGathered)
+
+                while (!allGathered && !bNoMoreStoredFrames)
                 {
                     allGathered = true;
                     lock (oClientSocketLock)
                     {
                         for (int i = 0; i < lClientSockets.Count; i++)
                         {
-                            if (!lClientSockets[i].bStoredFrameReceived)
-                            {
-                                allGathered = false;
-                                break;
-                            }
+                            if (lClientSockets[i].qStoredFrames.Count > 0)
+                                continue;
+
+                            allGathered = false;
 
                             if (lClientSockets[i].bNoMoreStoredFrames)
                                 bNoMoreStoredFrames = true;
                         }
                     }
+
+                    if (!allGathered && !bNoMoreStoredFrames)
+                        Thread.Sleep(1);
                 }
 
-                //Store received frames
+                if (bNoMoreStoredFrames)
+                {
+                    bStoredFrameTransferStarted = false;
+                    return false;
+                }
+
+                //Take the frames, which lets every client send its next one
                 lock (oClientSocketLock)
                 {
                     for (int i = 0; i < lClientSockets.Count; i++)
                     {
-                        lFramesRGB.Add(new List<byte>(lClientSockets[i].lFrameRGB));
-                        lFramesVerts.Add(new List<Single>(lClientSockets[i].lFrameVerts));
+                        List<byte> lRGB;
+                        List<Single> lVerts;
+
+                        //A client that connected while we waited has no part in this transfer
+                        if (lClientSockets[i].TakeStoredFrame(out lRGB, out lVerts))
+                        {
+                            lFramesRGB.Add(lRGB);
+                            lFramesVerts.Add(lVerts);
+                        }
                     }
                 }
             }
 
-            if (bNoMoreStoredFrames)
-                return false;
-            else
-                return true;
+            return true;
         }
 
         /// <summary>
@@ -1121,6 +1160,116 @@ namespace LiveScanServer
             }
         }
 
+        /// <summary>
+        /// Gets the latest frames for the live view without requesting them. The visible clients are subscribed to push their frames,
+        /// so this only waits until any client pushed a new frame, instead of waiting for a round trip to the slowest one.
+        /// Clients that haven't pushed a new frame yet contribute their previous one, unless they are temporally synced and it is too old
+        /// to fit to the new frames (see liveFrameAlignmentUs).
+        /// </summary>
+        /// <param name="timeoutMs">How long to wait for a new frame</param>
+        /// <returns>False if no client pushed a new frame in time, the lists are left empty then</returns>
+        public bool GetPushedLiveFrames(List<List<byte>> lFramesRGB, List<List<Single>> lFramesVerts, int timeoutMs)
+        {
+            lFramesRGB.Clear();
+            lFramesVerts.Clear();
+
+            Stopwatch timer = new Stopwatch();
+            timer.Start();
+            long firstNewFrameMs = -1;
+
+            while (true)
+            {
+                lock (oClientSocketLock)
+                {
+                    bool newFrame = false;
+                    bool allNewFrames = true;
+                    bool synced = true;
+                    ulong newestTimestamp = 0;
+
+                    //Clients can connect or change their visibility at any time, so the subscriptions are kept up to date here
+                    for (int i = 0; i < lClientSockets.Count; i++)
+                    {
+                        if (lClientSockets[i].bVisible)
+                        {
+                            if (!lClientSockets[i].bLiveFramesSubscribed)
+                                lClientSockets[i].SubscribeLiveFrames(liveFrameInterval, liveFrameCredits);
+
+                            newFrame |= lClientSockets[i].bNewLiveFrame;
+                            allNewFrames &= lClientSockets[i].bNewLiveFrame;
+                            synced &= IsTemporallySynced(lClientSockets[i]);
+
+                            if (lClientSockets[i].bNewLiveFrame && lClientSockets[i].oFrameHeader.iTimestamp > newestTimestamp)
+                                newestTimestamp = lClientSockets[i].oFrameHeader.iTimestamp;
+                        }
+
+                        else if (lClientSockets[i].bLiveFramesSubscribed)
+                            lClientSockets[i].UnsubscribeLiveFrames();
+                    }
+
+                    if (newFrame && firstNewFrameMs < 0)
+                        firstNewFrameMs = timer.ElapsedMilliseconds;
+
+                    //Unsynced clients can't be lined up, their timestamps come from clocks that know nothing of each other
+                    bool waitForSynced = synced && !allNewFrames && timer.ElapsedMilliseconds - firstNewFrameMs < liveFrameAlignmentWaitMs &&
+                        timer.ElapsedMilliseconds <= timeoutMs;
+
+                    if (newFrame && !waitForSynced)
+                    {
+                        for (int i = 0; i < lClientSockets.Count; i++)
+                        {
+                            if (lClientSockets[i].bVisible)
+                            {
+                                ulong timestamp = lClientSockets[i].oFrameHeader.iTimestamp;
+                                bool stale = synced && timestamp < newestTimestamp && newestTimestamp - timestamp > liveFrameAlignmentUs;
+
+                                if (!stale)
+                                {
+                                    lFramesRGB.Add(new List<byte>(lClientSockets[i].lFrameRGB));
+                                    lFramesVerts.Add(new List<Single>(lClientSockets[i].lFrameVerts));
+                                }
+
+                                lClientSockets[i].ConsumeLiveFrame();
+                            }
+                        }
+
+                        return true;
+                    }
+                }
+
+                if (timer.ElapsedMilliseconds > timeoutMs)
+                    return false;
+
+                Thread.Sleep(1);
+            }
+        }
+
+        /// <summary>
+        /// The device timestamps of clients that run with temporal sync come from the same clock
+        /// </summary>
+        bool IsTemporallySynced(ClientSocket client)
+        {
+            if (client.configuration == null)
+                return false;
+
+            return client.configuration.eSoftwareSyncState == ClientConfiguration.SyncState.Main ||
+                client.configuration.eSoftwareSyncState == ClientConfiguration.SyncState.Subordinate;
+        }
+
+        /// <summary>
+        /// Stops all clients from pushing live frames, called when the live view closes
+        /// </summary>
+        public void UnsubscribeLiveFrames()
+        {
+            lock (oClientSocketLock)
+            {
+                for (int i = 0; i < lClientSockets.Count; i++)
+                {
+                    if (lClientSockets[i].bLiveFramesSubscribed)
+                        lClientSockets[i].UnsubscribeLiveFrames();
+                }
+            }
+        }
+
         public bool GetTimestampLists()
         {
             Log.LogDebug("Getting timestamp lists from clients");
@@ -1167,6 +1316,8 @@ namespace LiveScanServer
         {
             Log.LogDebug("Clearing stored frame on devices");
 
+            bStoredFrameTransferStarted = false;
+
             lock (oClientSocketLock)
             {
                 for (int i = 0; i < lClientSockets.Count; i++)
@@ -1177,6 +1328,47 @@ namespace LiveScanServer
         }
 
 
+        /// <summary>
+        /// Lets all clients learn the background of the empty scene, which they then remove from all following frames.
+        /// Returns false if there is no client to learn it
+        /// </summary>
+        public bool LearnBackground()
+        {
+            Log.LogInfo("Learning the background on all devices, the scene should be empty for the next " + backgroundLearnFrames + " frames");
+
+            lock (oClientSocketLock)
+            {
+                if (lClientSockets.Count == 0)
+                    return false;
+
+                for (int i = 0; i < lClientSockets.Count; i++)
+                {
+                    lClientSockets[i].LearnBackground(backgroundLearnFrames);
+                }
+            }
+
+            return true;
+        }
+
+        public bool ClearBackground()
+        {
+            Log.LogInfo("Clearing the background on all devices");
+
+            lock (oClientSocketLock)
+            {
+                if (lClientSockets.Count == 0)
+                    return false;
+
+                for (int i = 0; i < lClientSockets.Count; i++)
+                {
+                    lClientSockets[i].ClearBackground();
+                }
+            }
+
+            return true;
+        }
+
+
         public bool CreatePostSyncList()
         {
             Log.LogDebug("Creating Post sync list");
@@ -1451,6 +1643,8 @@ namespace LiveScanServer
         {
             lock (oClientSocketLock)
             {
+                client.CloseSharedFrameRing();
+                client.FreeStoredFrameDictionary();
                 lClientSockets.Remove(client);
             }
 
@@ -1529,8 +1723,7 @@ namespace LiveScanServer
                             //stored frame
                             else if (buffer[0] == (byte)IncomingMessageType.MSG_STORED_FRAME)
                             {
-                                lClientSockets[i].ReceiveFrame();
-                                lClientSockets[i].bStoredFrameReceived = true;
+                                lClientSockets[i].ReceiveStoredFrame();
                             }
                             //last frame
                             else if (buffer[0] == (byte)IncomingMessageType.MSG_LAST_FRAME)
@@ -1538,6 +1731,13 @@ namespace LiveScanServer
                                 lClientSockets[i].ReceiveFrame();
                                 lClientSockets[i].bLatestFrameReceived = true;
                             }
+                            //last frame, pushed by the client on its own
+                            else if (buffer[0] == (byte)IncomingMessageType.MSG_PUSHED_LIVE_FRAME)
+                            {
+                                //Doesn't answer a frame request, the client always answers those with MSG_LAST_FRAME.
+                                //A pushed frame may have been acquired before the request, or dropped
+                                lClientSockets[i].ReceivePushedLiveFrame();
+                            }
 
                             else if (buffer[0] == (byte)IncomingMessageType.MSG_CONFIGURATION)
                             {
@@ -1579,8 +1779,21 @@ namespace LiveScanServer
                                 lClientSockets[i].ReceivePostRecordProcessConfirmation();
                             }
 
+                            else if (buffer[0] == (byte)IncomingMessageType.MSG_SHARED_FRAME_RING)
+                            {
+                                lClientSockets[i].ReceiveSharedFrameRing();
+                            }
+
+                            else if (buffer[0] == (byte)IncomingMessageType.MSG_STORED_FRAME_DICTIONARY)
+                            {
+                                lClientSockets[i].ReceiveStoredFrameDictionary();
+                            }
+
                             buffer = lClientSockets[i].Receive(1);
                         }
+
+                        //Clients on the same host put their frames into shared memory instead
+                        lClientSockets[i].ReceiveSharedFrames();
                     }
                 }
 
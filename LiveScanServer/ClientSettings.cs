@@ -53,6 +53,42 @@ namespace LiveScanServer
 
         public bool bPreviewEnabled = true;
 
+        //Generate the pointclouds at depth camera instead of color camera resolution
+        public bool bDepthNativePointcloud = false;
+
+        //Remove points that have less than nOutlierMinNeighbors other points within nOutlierRadius millimeters
+        public bool bFilterOutliers = false;
+        public int nOutlierRadius = 20;
+        public int nOutlierMinNeighbors = 5;
+
+        //Layout of the frames the clients send, the columnar encoding compresses considerably better
+        public FrameEncoding eFrameEncoding = FrameEncoding.Columnar;
+
+        //The clients adapt the compression level to their link and CPU, starting at iCompressionLevel
+        public bool bAdaptiveCompression = true;
+
+        //Clients on the same host as the server hand over their frames through shared memory instead of the socket
+        public bool bSharedMemoryTransport = false;
+
+        //Points whose depth lies within this many standard deviations of the learned background are removed by the clients
+        public float fBackgroundTolerance = 3.0f;
+
+        //The clients merge their points into voxels of this size in millimeters, and raise it as needed to stay within the point budget.
+        //0 disables either of them
+        public int nVoxelLeafSize = 0;
+        public int nPointBudget = 0;
+
+        //What the clients do with recorded frames when their disk can't keep up: wait for it, or drop the frames
+        public enum RecordingQueuePolicy { Block = 0, Drop = 1 }
+        public RecordingQueuePolicy eRecordingQueuePolicy = RecordingQueuePolicy.Block;
+
+        //The clients write their recordings past the page cache of the OS, and reserve this much space on the disk up front. 0 doesn't reserve anything
+        public bool bUnbufferedRecording = false;
+        public int nRecordingPreallocationMB = 0;
+
+        //The clients store recorded pointclouds compressed, with a dictionary trained on the first frames of each take
+        public bool bCompressRecording = false;
+
         public ClientSettings()
         {
             aMinBounds[0] = -3f;
@@ -132,6 +168,60 @@ namespace LiveScanServer
             bTemp = BitConverter.GetBytes(bPreviewEnabled);
             lData.AddRange(bTemp);
 
+            if (bDepthNativePointcloud)
+                lData.Add(1);
+            else
+                lData.Add(0);
+
+            if (bFilterOutliers)
+                lData.Add(1);
+            else
+                lData.Add(0);
+
+            bTemp = BitConverter.GetBytes(nOutlierRadius);
+            lData.AddRange(bTemp);
+
+            bTemp = BitConverter.GetBytes(nOutlierMinNeighbors);
+            lData.AddRange(bTemp);
+
+            bTemp = BitConverter.GetBytes((int)eFrameEncoding);
+            lData.AddRange(bTemp);
+
+            if (bAdaptiveCompression)
+                lData.Add(1);
+            else
+                lData.Add(0);
+
+            if (bSharedMemoryTransport)
+                lData.Add(1);
+            else
+                lData.Add(0);
+
+            bTemp = BitConverter.GetBytes(fBackgroundTolerance);
+            lData.AddRange(bTemp);
+
+            bTemp = BitConverter.GetBytes(nVoxelLeafSize);
+            lData.AddRange(bTemp);
+
+            bTemp = BitConverter.GetBytes(nPointBudget);
+            lData.AddRange(bTemp);
+
+            bTemp = BitConverter.GetBytes((int)eRecordingQueuePolicy);
+            lData.AddRange(bTemp);
+
+            if (bUnbufferedRecording)
+                lData.Add(1);
+            else
+                lData.Add(0);
+
+            bTemp = BitConverter.GetBytes(nRecordingPreallocationMB);
+            lData.AddRange(bTemp);
+
+            if (bCompressRecording)
+                lData.Add(1);
+            else
+                lData.Add(0);
+
             return lData;
         }
 
@@ -14,7 +14,10 @@
 //    }
 using System;
 using System.Collections.Generic;
+using System.IO;
 using System.Net.Sockets;
+using System.Text;
+using System.Threading.Tasks;
 
 
 namespace LiveScanServer
@@ -24,7 +27,6 @@ namespace LiveScanServer
     public class ClientSocket
     {
         Socket oSocket;
-        byte[] byteToSend = new byte[1];
         public bool bFrameCaptured = false;
         public bool bLatestFrameReceived = false;
         public bool bStoredFrameReceived = false;
@@ -69,9 +71,37 @@ namespace LiveScanServer
 
         public string sSocketState;
 
+        //Live frames the client pushes on its own while subscribed. Every pushed frame used up one of the credits we granted,
+        //they are only given back once the live view took the frames, so the client drops frames instead of piling them up in the socket
+        public bool bLiveFramesSubscribed = false;
+        public bool bNewLiveFrame = false;
+        int iLiveFramesToCredit = 0;
+
+        //Frames of a client on the same host come through shared memory instead of the socket, null otherwise
+        SharedFrameRingReader oSharedFrameRing = null;
+
+        //Stored frames of a bulk transfer that arrived before they were taken. The client sends ahead as many frames as the window of the transfer allows
+        public bool bStreamingStoredFrames = false;
+        public Queue<Tuple<List<byte>, List<Single>>> qStoredFrames = new Queue<Tuple<List<byte>, List<Single>>>();
+        int iLastStoredFrameIndex = -1;
+
+        //For the stored frames the client sends on as they are compressed in its .bin file, with the zstd dictionary of the take.
+        //Both are created once the client sent the dictionary, the dictionary stays Zero if the take has none
+        IntPtr oStoredFrameDictionary = IntPtr.Zero;
+        IntPtr oStoredFrameDecompressionContext = IntPtr.Zero;
+
         public List<byte> lFrameRGB = new List<byte>();
         public List<Single> lFrameVerts = new List<Single>();
 
+        //The header of the frame in lFrameRGB and lFrameVerts
+        public FrameHeader oFrameHeader = new FrameHeader();
+        public int iChecksumMismatches = 0;
+        public int iStaleLiveFrames = 0;
+        int iLastLiveFrameIndex = -1;
+
+        //Of the last frame ReceiveFrame() read from the socket, whether it was accepted or not
+        int iReceivedFrameIndex = -1;
+
         public List<ulong> lTimeStamps = new List<ulong>();
         public List<int> lFrameNumbers = new List<int>();
         public ClientSyncData postSyncedFrames = new ClientSyncData();
@@ -92,8 +122,7 @@ namespace LiveScanServer
         public void CaptureFrame()
         {
             bFrameCaptured = false;
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_CAPTURE_SINGLE_FRAME;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_CAPTURE_SINGLE_FRAME);
         }
         public void Calibrate()
         {
@@ -102,8 +131,7 @@ namespace LiveScanServer
             //Reset the refinement Transform
             oRefinementOffset = new Matrix4x4();
 
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_CALIBRATE;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_CALIBRATE);
 
             UpdateSocketState("");
         }
@@ -111,32 +139,184 @@ namespace LiveScanServer
         public void CancelCalibration()
         {
             //TODO: Implement in Client
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_CALIBRATE_CANCEL;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_CALIBRATE_CANCEL);
         }
 
         public void RequestStoredFrame()
         {
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_REQUEST_STORED_FRAME;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_REQUEST_STORED_FRAME);
             bNoMoreStoredFrames = false;
             bStoredFrameReceived = false;
+            bStreamingStoredFrames = false;
+        }
+
+        /// <summary>
+        /// The client streams its stored frames on its own from now on, with at most window frames that we haven't taken yet
+        /// </summary>
+        /// <param name="frameCount">-1 for all frames from firstFrame on</param>
+        public void RequestStoredFrames(int firstFrame, int frameCount, int window)
+        {
+            List<byte> lData = new List<byte>();
+            lData.AddRange(BitConverter.GetBytes(firstFrame));
+            lData.AddRange(BitConverter.GetBytes(frameCount));
+            lData.AddRange(BitConverter.GetBytes(window));
+
+            qStoredFrames.Clear();
+            iLastStoredFrameIndex = -1;
+            bStreamingStoredFrames = true;
+            bNoMoreStoredFrames = false;
+            bStoredFrameReceived = false;
+
+            SendMessage(OutgoingMessageType.MSG_REQUEST_STORED_FRAMES, lData.ToArray());
+        }
+
+        /// <summary>
+        /// Takes the oldest frame of the bulk transfer and lets the client send the next one
+        /// </summary>
+        /// <returns>False if no frame has arrived yet</returns>
+        public bool TakeStoredFrame(out List<byte> lRGB, out List<Single> lVerts)
+        {
+            lRGB = null;
+            lVerts = null;
+
+            if (qStoredFrames.Count == 0)
+                return false;
+
+            Tuple<List<byte>, List<Single>> frame = qStoredFrames.Dequeue();
+            lRGB = frame.Item1;
+            lVerts = frame.Item2;
+
+            SendMessage(OutgoingMessageType.MSG_ACK_STORED_FRAMES, BitConverter.GetBytes(1));
+            return true;
+        }
+
+        public void ReceiveStoredFrame()
+        {
+            //The client put the frames in the shared memory before it sent this one over the socket, because it didn't fit into a slot
+            //or because it ends the take. They have to be taken first, or they would come after it or be dropped with the end of the take
+            ReceiveSharedFrames();
+
+            ReceiveFrame();
+            StoredFrameReceived(iReceivedFrameIndex);
+        }
+
+        /// <summary>
+        /// The client sends the zstd dictionary of its take before the frames of a bulk transfer
+        /// </summary>
+        public void ReceiveStoredFrameDictionary()
+        {
+            FreeStoredFrameDictionary();
+
+            byte[] buffer = new byte[sizeof(int)];
+
+            if (!ReceiveAll(buffer, sizeof(int)))
+                return;
+
+            int size = BitConverter.ToInt32(buffer, 0);
+
+            if (size <= 0)
+                return;
+
+            buffer = new byte[size];
+
+            if (!ReceiveAll(buffer, size))
+                return;
+
+            oStoredFrameDictionary = ZSTDDecompressor.ZSTD_createDDict(buffer, (UIntPtr)size);
+
+            if (oStoredFrameDictionary == IntPtr.Zero)
+                Log.LogError("Could not load the dictionary of the stored frames of the client, its compressed frames will be dropped");
+        }
+
+        public void FreeStoredFrameDictionary()
+        {
+            if (oStoredFrameDictionary != IntPtr.Zero)
+                ZSTDDecompressor.ZSTD_freeDDict(oStoredFrameDictionary);
+
+            if (oStoredFrameDecompressionContext != IntPtr.Zero)
+                ZSTDDecompressor.ZSTD_freeDCtx(oStoredFrameDecompressionContext);
+
+            oStoredFrameDictionary = IntPtr.Zero;
+            oStoredFrameDecompressionContext = IntPtr.Zero;
+        }
+
+        void StoredFrameReceived(int iFrameIndex)
+        {
+            bStoredFrameReceived = true;
+
+            //The frame is handed over to the queue as it is, and the next one is received into new lists. The end of the take carries no frame
+            if (bStreamingStoredFrames && !bNoMoreStoredFrames)
+            {
+                //The client sends the frames in the order of the file, one that comes after a later one would be played back out of place.
+                //Nobody is going to take it, so it is acknowledged right away
+                if (iFrameIndex <= iLastStoredFrameIndex)
+                {
+                    Log.LogError("Stored frame " + iFrameIndex + " arrived after frame " + iLastStoredFrameIndex + ", dropping it");
+                    lFrameRGB.Clear();
+                    lFrameVerts.Clear();
+                    SendMessage(OutgoingMessageType.MSG_ACK_STORED_FRAMES, BitConverter.GetBytes(1));
+                    return;
+                }
+
+                iLastStoredFrameIndex = iFrameIndex;
+                qStoredFrames.Enqueue(Tuple.Create(lFrameRGB, lFrameVerts));
+                lFrameRGB = new List<byte>();
+                lFrameVerts = new List<Single>();
+            }
         }
 
         public void RequestConfiguration()
         {
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_REQUEST_CONFIGURATION;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_REQUEST_CONFIGURATION);
             bConfigurationReceived = false;
         }
 
         public void RequestLastFrame()
         {
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_REQUEST_LAST_FRAME;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_REQUEST_LAST_FRAME);
             bLatestFrameReceived = false;
         }
 
+        /// <summary>
+        /// From now on, the client pushes every n-th frame it processes without being asked
+        /// </summary>
+        /// <param name="interval">Push every interval-th frame</param>
+        /// <param name="credits">How many frames the client may push before we have to grant it more credits</param>
+        public void SubscribeLiveFrames(int interval, int credits)
+        {
+            List<byte> lData = new List<byte>();
+            lData.AddRange(BitConverter.GetBytes(interval));
+            lData.AddRange(BitConverter.GetBytes(credits));
+
+            SendMessage(OutgoingMessageType.MSG_SUBSCRIBE_LIVE_FRAMES, lData.ToArray());
+
+            bLiveFramesSubscribed = true;
+            bNewLiveFrame = false;
+            iLiveFramesToCredit = 0;
+            iLastLiveFrameIndex = -1;
+        }
+
+        public void UnsubscribeLiveFrames()
+        {
+            SendMessage(OutgoingMessageType.MSG_UNSUBSCRIBE_LIVE_FRAMES);
+
+            bLiveFramesSubscribed = false;
+            bNewLiveFrame = false;
+            iLiveFramesToCredit = 0;
+        }
+
+        /// <summary>
+        /// The live view took the latest pushed frame, so the client gets back the credits of all frames it pushed since the last time
+        /// </summary>
+        public void ConsumeLiveFrame()
+        {
+            if (bLiveFramesSubscribed && iLiveFramesToCredit > 0)
+                SendMessage(OutgoingMessageType.MSG_GRANT_LIVE_CREDITS, BitConverter.GetBytes(iLiveFramesToCredit));
+
+            bNewLiveFrame = false;
+            iLiveFramesToCredit = 0;
+        }
+
         public void RequestTimestamps()
         {
             lTimeStamps.Clear();
@@ -147,8 +327,7 @@ namespace LiveScanServer
             bPostSyncConfirmed = false;
             bPostSyncError = false;
 
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_REQUEST_TIMESTAMP_LIST;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_REQUEST_TIMESTAMP_LIST);
 
         }
 
@@ -158,24 +337,17 @@ namespace LiveScanServer
 
             List<byte> lData = settings.ToByteList();
 
-            //why is this doing this in a backwards order?
-            byte[] bTemp = BitConverter.GetBytes(lData.Count);
-            lData.InsertRange(0, bTemp);
-            lData.Insert(0, (byte)OutgoingMessageType.MSG_RECEIVE_SETTINGS);
-
             if (SocketConnected())
-                oSocket.Send(lData.ToArray());
+                SendMessage(OutgoingMessageType.MSG_RECEIVE_SETTINGS, lData.ToArray());
         }
 
         public void SendConfiguration(ClientConfiguration newConfig)
         {
             byte[] data = newConfig.ToBytes();
-            List<byte> message = new List<byte>() { (byte)OutgoingMessageType.MSG_SET_CONFIGURATION };
-            message.InsertRange(1, data);
 
             if(SocketConnected())
             {
-                oSocket.Send(message.ToArray());
+                SendMessage(OutgoingMessageType.MSG_SET_CONFIGURATION, data);
             }
 
             configuration = newConfig;
@@ -183,18 +355,12 @@ namespace LiveScanServer
 
         public void SendCalibrationData()
         {
-            int size = 1 + (16) * sizeof(float);
-            byte[] data = new byte[size];
-            int i = 0;
-
-            data[i] = (byte)OutgoingMessageType.MSG_RECEIVE_CALIBRATION;//the MSG_ enums are copied from the client for ease. "Receive" is correct but only because of this convenience in keeping the utils classes matching. We may wish to rename the enums more appropriately, like "MSG_CALIBRATION".
-            i++;
-
-            Buffer.BlockCopy(oRefinementOffset.mat, 0, data, i, 16 * sizeof(float));
-            i += 16 * sizeof(float);
+            byte[] data = new byte[16 * sizeof(float)];
+            Buffer.BlockCopy(oRefinementOffset.mat, 0, data, 0, data.Length);
 
+            //the MSG_ enums are copied from the client for ease. "Receive" is correct but only because of this convenience in keeping the utils classes matching. We may wish to rename the enums more appropriately, like "MSG_CALIBRATION".
             if (SocketConnected())
-                oSocket.Send(data);
+                SendMessage(OutgoingMessageType.MSG_RECEIVE_CALIBRATION, data);
         }
 
         /// <summary>
@@ -218,19 +384,16 @@ namespace LiveScanServer
 
             byte[] listLength = BitConverter.GetBytes(byteList.Count);
 
-            //Add our message as the first byte and add the length of this byte array
-            byteList.Insert(0, (byte)OutgoingMessageType.MSG_CREATE_DIR);
-            byteList.InsertRange(1, listLength);
+            //Add the length of this byte array in front of it
+            byteList.InsertRange(0, listLength);
 
-            oSocket.Send(byteList.ToArray());
+            SendMessage(OutgoingMessageType.MSG_CREATE_DIR, byteList.ToArray());
         }
 
         public void SendPostSyncList()
         {
             List<byte> byteList = new List<byte>();
 
-            byteList.Add((byte)OutgoingMessageType.MSG_RECEIVE_POSTSYNC_LIST);
-
             byteList.AddRange(BitConverter.GetBytes(postSyncedFrames.frames.Count));
             
             for (int i = 0; i < postSyncedFrames.frames.Count; i++)
@@ -243,7 +406,7 @@ namespace LiveScanServer
                 byteList.AddRange(BitConverter.GetBytes(postSyncedFrames.frames[i].syncedFrameID));
             }
 
-            oSocket.Send(byteList.ToArray());
+            SendMessage(OutgoingMessageType.MSG_RECEIVE_POSTSYNC_LIST, byteList.ToArray());
         }
 
         /// <summary>
@@ -252,8 +415,7 @@ namespace LiveScanServer
         public void SendPreRecordProcessStart()
         {
             bPreRecordProcessConfirmed = false;
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_PRE_RECORD_PROCESS_START;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_PRE_RECORD_PROCESS_START);
         }
 
         /// <summary>
@@ -262,8 +424,7 @@ namespace LiveScanServer
         public void SendPostRecordProcessStart()
         {
             bPostRecordProcessConfirmed = false;
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_POST_RECORD_PROCESS_START;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_POST_RECORD_PROCESS_START);
         }
 
         /// <summary>
@@ -271,8 +432,7 @@ namespace LiveScanServer
         /// </summary>
         public void SendCaptureFramesStart()
         {
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_START_CAPTURING_FRAMES;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_START_CAPTURING_FRAMES);
         }
 
         /// <summary>
@@ -280,30 +440,41 @@ namespace LiveScanServer
         /// </summary>
         public void SendCaptureFramesStop()
         {
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_STOP_CAPTURING_FRAMES;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_STOP_CAPTURING_FRAMES);
         }
 
         public void ClearStoredFrames()
         {
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_CLEAR_STORED_FRAMES;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_CLEAR_STORED_FRAMES);
+            bStreamingStoredFrames = false;
+            qStoredFrames.Clear();
+        }
+
+        /// <summary>
+        /// The client learns the background from its next frames, so the scene should be empty until they are taken
+        /// </summary>
+        public void LearnBackground(int frames)
+        {
+            SendMessage(OutgoingMessageType.MSG_LEARN_BACKGROUND, BitConverter.GetBytes(frames));
+        }
+
+        public void ClearBackground()
+        {
+            SendMessage(OutgoingMessageType.MSG_CLEAR_BACKGROUND);
         }
 
         public void CloseCameraAndConfirm()
         {
             bCameraClosed = false;
             bCameraError = false;
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_CLOSE_CAMERA;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_CLOSE_CAMERA);
         }
 
         public void InitializeCameraAndConfirm()
         {
             bCameraInitialized = false;
             bCameraError = false;
-            byteToSend[0] = (byte)OutgoingMessageType.MSG_START_CAMERA;
-            SendByte();
+            SendMessage(OutgoingMessageType.MSG_START_CAMERA);
         }
         public void ReceiveCalibrationData()
         {
@@ -359,28 +530,153 @@ namespace LiveScanServer
             configurationUpdated?.Invoke(configuration);
         }
 
-        public void ReceiveFrame()
+        public void ReceivePushedLiveFrame()
         {
-            lFrameRGB.Clear();
-            lFrameVerts.Clear();
+            CountPushedLiveFrame(ReceiveFrame(true));
+        }
 
-            int nToRead;
-            byte[] buffer = new byte[1024];
+        void CountPushedLiveFrame(bool bAccepted)
+        {
+            //Frames that were already on their way when we unsubscribed are still read, but they don't count anymore
+            if (!bLiveFramesSubscribed)
+                return;
 
-            while (oSocket.Available == 0)
+            if (bAccepted)
             {
-                if (!SocketConnected())
-                    return;
+                bNewLiveFrame = true;
+                iLiveFramesToCredit++;
+            }
+
+            //Nobody is going to take a dropped frame, so its credit is given back right away
+            else
+                SendMessage(OutgoingMessageType.MSG_GRANT_LIVE_CREDITS, BitConverter.GetBytes(1));
+        }
+
+        /// <summary>
+        /// The client tells us the name of the shared memory it wants to put its frames into from now on, or that it closed it.
+        /// The client keeps sending its frames over the socket until we confirm that we could open it
+        /// </summary>
+        public void ReceiveSharedFrameRing()
+        {
+            CloseSharedFrameRing();
+
+            byte[] buffer = new byte[sizeof(int)];
+
+            if (!ReceiveAll(buffer, sizeof(int)))
+                return;
+
+            int nameLength = BitConverter.ToInt32(buffer, 0);
+
+            if (nameLength <= 0)
+            {
+                Log.LogInfo("Client closed its shared memory, frames come over the network again");
+                return;
+            }
+
+            buffer = new byte[nameLength];
+
+            if (!ReceiveAll(buffer, nameLength))
+                return;
+
+            string name = Encoding.ASCII.GetString(buffer);
+            SharedFrameRingReader ring = new SharedFrameRingReader();
+            bool opened = ring.Open(name);
+
+            if (opened)
+            {
+                Log.LogInfo("Receiving the frames of the client through the shared memory " + name);
+                oSharedFrameRing = ring;
+            }
+
+            else
+                Log.LogInfo("Could not open the shared memory " + name + " of the client, it's probably running on another host");
+
+            SendMessage(OutgoingMessageType.MSG_CONFIRM_SHARED_FRAME_RING, new byte[] { (byte)(opened ? 1 : 0) });
+        }
+
+        public void CloseSharedFrameRing()
+        {
+            if (oSharedFrameRing == null)
+                return;
+
+            if (oSharedFrameRing.iDroppedFrames > 0)
+                Log.LogWarning("Dropped " + oSharedFrameRing.iDroppedFrames + " frames that the client overwrote in the shared memory before they were read");
+
+            oSharedFrameRing.Dispose();
+            oSharedFrameRing = null;
+        }
+
+        /// <summary>
+        /// Handles the frames the client put into the shared memory since the last call. They are stored just like they
+        /// would have been sent over the socket, but always uncompressed
+        /// </summary>
+        public void ReceiveSharedFrames()
+        {
+            if (oSharedFrameRing == null)
+                return;
+
+            int messageType;
+            byte[] frame;
+
+            while (oSharedFrameRing.Read(out messageType, out frame))
+            {
+                bool bLiveFrame = messageType == (int)IncomingMessageType.MSG_PUSHED_LIVE_FRAME;
+
+                if (!bLiveFrame)
+                {
+                    lFrameRGB.Clear();
+                    lFrameVerts.Clear();
+                }
+
+                //The frame header, followed by the payload
+                FrameHeader header = new FrameHeader(frame, 0);
+                bool bAccepted = false;
+
+                if (header.iPayloadSize > 0 && header.iPayloadSize <= frame.Length - FrameHeader.Size)
+                    bAccepted = AcceptFrame(header, frame, FrameHeader.Size, header.iPayloadSize, bLiveFrame);
+
+                if (messageType == (int)IncomingMessageType.MSG_STORED_FRAME)
+                    StoredFrameReceived(header.iFrameIndex);
+
+                else if (messageType == (int)IncomingMessageType.MSG_LAST_FRAME)
+                    bLatestFrameReceived = true;
+
+                //Only MSG_LAST_FRAME answers a frame request, a pushed frame may have been acquired before it
+                else if (bLiveFrame)
+                    CountPushedLiveFrame(bAccepted);
             }
+        }
 
-            oSocket.Receive(buffer, 8, SocketFlags.None);
-            nToRead = BitConverter.ToInt32(buffer, 0);
-            int iCompressed = BitConverter.ToInt32(buffer, 4);
+        /// <summary>
+        /// Receives the frame that follows a frame message into lFrameRGB and lFrameVerts
+        /// </summary>
+        /// <param name="bLiveFrame">A pushed live frame that is dropped keeps the last one in place, every other frame clears it</param>
+        /// <returns>False if the frame was dropped</returns>
+        public bool ReceiveFrame(bool bLiveFrame = false)
+        {
+            iReceivedFrameIndex = -1;
+
+            if (!bLiveFrame)
+            {
+                lFrameRGB.Clear();
+                lFrameVerts.Clear();
+            }
+
+            int nToRead;
+            byte[] buffer = new byte[FrameHeader.Size];
+
+            if (!ReceiveAll(buffer, FrameHeader.Size))
+                return false;
+
+            FrameHeader header = new FrameHeader(buffer, 0);
+            iReceivedFrameIndex = header.iFrameIndex;
+            nToRead = header.iPayloadSize;
+            int iCompressed = header.iCompression;
 
             if (nToRead == -1)
             {
                 bNoMoreStoredFrames = true;
-                return;
+                return false;
             }
 
             //Sometimes we recieve negative values when the cameras are restarting, I don't know why yet.
@@ -388,30 +684,121 @@ namespace LiveScanServer
 
             if (nToRead <= 0)
             {
-                return;
+                return false;
             }
 
-            buffer = new byte[nToRead];
-            int nAlreadyRead = 0;
+            if (iCompressed == (int)FrameCompression.ZSTDStream)
+            {
+                //nToRead is the uncompressed size, the compressed frame follows in chunks
+                byte[] compressed = ReceiveChunks();
+
+                if (compressed == null)
+                    return false;
+
+                buffer = ZSTDDecompressor.Decompress(compressed, nToRead);
+
+                if (buffer == null)
+                {
+                    Log.LogError("Could not decompress a streamed frame, dropping it");
+                    return false;
+                }
+            }
 
-            while (nAlreadyRead != nToRead)
+            else
             {
-                while (oSocket.Available == 0)
+                buffer = new byte[nToRead];
+
+                if (!ReceiveAll(buffer, nToRead))
+                    return false;
+
+                if (iCompressed == (int)FrameCompression.ZSTD)
+                    buffer = ZSTDDecompressor.Decompress(buffer);
+
+                else if (iCompressed == (int)FrameCompression.ZSTDParallel)
                 {
-                    if (!SocketConnected())
-                        return;
+                    buffer = DecompressSegments(buffer);
+
+                    if (buffer == null)
+                    {
+                        Log.LogError("Could not decompress a segmented frame, dropping it");
+                        return false;
+                    }
                 }
 
-                nAlreadyRead += oSocket.Receive(buffer, nAlreadyRead, nToRead - nAlreadyRead, SocketFlags.None);
-            }            
+                //A stored frame as it is compressed in the .bin file. The columnar encoding takes the number of points, then 9 bytes per point
+                else if (iCompressed == (int)FrameCompression.ZSTDDictionary)
+                {
+                    if (header.iPointCount < 0 || header.iPointCount > (int.MaxValue - sizeof(int)) / 9)
+                        return false;
 
+                    if (oStoredFrameDecompressionContext == IntPtr.Zero)
+                        oStoredFrameDecompressionContext = ZSTDDecompressor.ZSTD_createDCtx();
 
-            if (iCompressed == 1)
-                buffer = ZSTDDecompressor.Decompress(buffer);
+                    buffer = ZSTDDecompressor.Decompress(buffer, sizeof(int) + 9 * header.iPointCount, oStoredFrameDecompressionContext, oStoredFrameDictionary);
 
-            //Receive depth and color data
-            int startIdx = 0;
+                    if (buffer == null)
+                    {
+                        Log.LogError("Could not decompress stored frame " + header.iFrameIndex + " with the dictionary of the take, dropping it");
+                        return false;
+                    }
+                }
+            }
+
+            return AcceptFrame(header, buffer, 0, buffer.Length, bLiveFrame);
+        }
+
+        /// <summary>
+        /// Checks the uncompressed payload of a frame against its header, and decodes it if it passes
+        /// </summary>
+        /// <returns>False if the frame was dropped</returns>
+        bool AcceptFrame(FrameHeader header, byte[] buffer, int startIdx, int length, bool bLiveFrame)
+        {
+            if (!header.VerifyChecksum(buffer, startIdx, length))
+            {
+                iChecksumMismatches++;
+                Log.LogError("Frame " + header.iFrameIndex + " of device " + header.iDeviceIndex + " doesn't match its checksum, dropping it (" +
+                    iChecksumMismatches + " so far)");
+                return false;
+            }
+
+            //Frames that don't fit into the shared memory still come over the socket, so a live frame can overtake an older one.
+            //The older one would only make the view jump back
+            if (bLiveFrame)
+            {
+                if (header.iFrameIndex <= iLastLiveFrameIndex)
+                {
+                    iStaleLiveFrames++;
+                    return false;
+                }
+
+                iLastLiveFrameIndex = header.iFrameIndex;
+                lFrameRGB.Clear();
+                lFrameVerts.Clear();
+            }
+
+            DecodeFrame(buffer, startIdx, header.iEncoding);
+            oFrameHeader = header;
+            return true;
+        }
+
+        /// <summary>
+        /// Reads the points of an uncompressed frame payload that starts at startIdx into lFrameVerts and lFrameRGB
+        /// </summary>
+        void DecodeFrame(byte[] buffer, int startIdx, int iEncoding)
+        {
+            if (iEncoding == (int)FrameEncoding.Columnar)
+            {
+                DecodeColumnarFrame(buffer, startIdx);
+                return;
+            }
 
+            if (iEncoding == (int)FrameEncoding.BinFile)
+            {
+                DecodeBinFileFrame(buffer, startIdx);
+                return;
+            }
+
+            //Receive depth and color data
             int n_vertices = BitConverter.ToInt32(buffer, startIdx);
             startIdx += 4;
 
@@ -440,6 +827,167 @@ namespace LiveScanServer
             //Log.LogInfo("Transmission size for depth mode " + configuration.eDepthRes.ToString() + " color mode: " + configuration.eColorRes.ToString() + " is: " + totalSize + "bytes, " + totalSizeKB + "kb, " + totalSizeMB + "mb");
         }
 
+        /// <summary>
+        /// Reads a frame that the client sent straight from its .bin file: All X, Y and Z shorts, then all colors as blue, green, red and alpha
+        /// </summary>
+        void DecodeBinFileFrame(byte[] buffer, int startIdx)
+        {
+            int n_vertices = BitConverter.ToInt32(buffer, startIdx);
+            int vertsStart = startIdx + 4;
+            int colorsStart = vertsStart + 6 * n_vertices;
+
+            float[] verts = new float[n_vertices * 3];
+            byte[] rgb = new byte[n_vertices * 3];
+
+            for (int i = 0; i < n_vertices * 3; i++)
+            {
+                //converting from milimeters to meters
+                verts[i] = BitConverter.ToInt16(buffer, vertsStart + 2 * i) / 1000.0f;
+            }
+
+            for (int i = 0; i < n_vertices; i++)
+            {
+                rgb[3 * i] = buffer[colorsStart + 4 * i + 2];
+                rgb[3 * i + 1] = buffer[colorsStart + 4 * i + 1];
+                rgb[3 * i + 2] = buffer[colorsStart + 4 * i];
+            }
+
+            lFrameVerts.AddRange(verts);
+            lFrameRGB.AddRange(rgb);
+        }
+
+        /// <summary>
+        /// Reads a frame in the columnar encoding of the client (see FRAME_ENCODING in frameEncoding.h): The X, Y and Z columns hold the
+        /// difference to the previous point, byte-shuffled into all low bytes followed by all high bytes. Then follow the red, green and blue columns
+        /// </summary>
+        void DecodeColumnarFrame(byte[] buffer, int startIdx)
+        {
+            int n_vertices = BitConverter.ToInt32(buffer, startIdx);
+            int columnsStart = startIdx + 4;
+
+            float[] verts = new float[n_vertices * 3];
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int lowBytes = columnsStart + 2 * axis * n_vertices;
+                int highBytes = lowBytes + n_vertices;
+                short value = 0;
+
+                for (int i = 0; i < n_vertices; i++)
+                {
+                    value = unchecked((short)(value + (buffer[lowBytes + i] | (buffer[highBytes + i] << 8))));
+                    //converting from milimeters to meters
+                    verts[3 * i + axis] = value / 1000.0f;
+                }
+            }
+
+            byte[] rgb = new byte[n_vertices * 3];
+            int colorsStart = columnsStart + 6 * n_vertices;
+
+            for (int channel = 0; channel < 3; channel++)
+            {
+                for (int i = 0; i < n_vertices; i++)
+                    rgb[3 * i + channel] = buffer[colorsStart + channel * n_vertices + i];
+            }
+
+            lFrameVerts.AddRange(verts);
+            lFrameRGB.AddRange(rgb);
+        }
+
+        /// <summary>
+        /// Decompresses a frame that the client split into independently compressed segments (see FrameCompressor::CompressParallel()).
+        /// The payload starts with the number of segments, then the uncompressed and compressed size of each. The segments are decompressed in parallel.
+        /// Returns null if any of them could not be decompressed
+        /// </summary>
+        byte[] DecompressSegments(byte[] payload)
+        {
+            int nSegments = BitConverter.ToInt32(payload, 0);
+            int[] uncompressedStarts = new int[nSegments + 1];
+            int[] compressedStarts = new int[nSegments + 1];
+            int[] compressedSizes = new int[nSegments];
+
+            compressedStarts[0] = sizeof(int) * (1 + 2 * nSegments);
+
+            for (int i = 0; i < nSegments; i++)
+            {
+                uncompressedStarts[i + 1] = uncompressedStarts[i] + BitConverter.ToInt32(payload, sizeof(int) * (1 + 2 * i));
+                compressedSizes[i] = BitConverter.ToInt32(payload, sizeof(int) * (2 + 2 * i));
+                compressedStarts[i + 1] = compressedStarts[i] + compressedSizes[i];
+            }
+
+            byte[] frame = new byte[uncompressedStarts[nSegments]];
+            bool failed = false;
+
+            Parallel.For(0, nSegments, i =>
+            {
+                byte[] segment = new byte[compressedSizes[i]];
+                Buffer.BlockCopy(payload, compressedStarts[i], segment, 0, compressedSizes[i]);
+
+                int segmentSize = uncompressedStarts[i + 1] - uncompressedStarts[i];
+                byte[] decompressed = ZSTDDecompressor.Decompress(segment, segmentSize);
+
+                if (decompressed == null)
+                    failed = true;
+                else
+                    Buffer.BlockCopy(decompressed, 0, frame, uncompressedStarts[i], segmentSize);
+            });
+
+            return failed ? null : frame;
+        }
+
+        /// <summary>
+        /// Reads exactly nBytes into the buffer. Returns false if the client disconnected before
+        /// </summary>
+        bool ReceiveAll(byte[] buffer, int nBytes)
+        {
+            int nAlreadyRead = 0;
+
+            while (nAlreadyRead != nBytes)
+            {
+                while (oSocket.Available == 0)
+                {
+                    if (!SocketConnected())
+                        return false;
+                }
+
+                nAlreadyRead += oSocket.Receive(buffer, nAlreadyRead, nBytes - nAlreadyRead, SocketFlags.None);
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Reads the chunks of a streamed frame, each prefixed with its size, until the empty chunk that ends it.
+        /// Returns null if the client disconnected before
+        /// </summary>
+        byte[] ReceiveChunks()
+        {
+            MemoryStream compressed = new MemoryStream();
+            byte[] sizeBuffer = new byte[sizeof(int)];
+            byte[] chunk = new byte[0];
+
+            while (true)
+            {
+                if (!ReceiveAll(sizeBuffer, sizeof(int)))
+                    return null;
+
+                int chunkSize = BitConverter.ToInt32(sizeBuffer, 0);
+
+                if (chunkSize <= 0)
+                    break;
+
+                if (chunk.Length < chunkSize)
+                    chunk = new byte[chunkSize];
+
+                if (!ReceiveAll(chunk, chunkSize))
+                    return null;
+
+                compressed.Write(chunk, 0, chunkSize);
+            }
+
+            return compressed.ToArray();
+        }
+
         public void ReceiveDirConfirmation()
         {
             bDirCreationConfirmed = true;
@@ -526,11 +1074,24 @@ namespace LiveScanServer
             }
         }
 
-        private void SendByte()
+        /// <summary>
+        /// Sends a message to the client. Every message starts with its type and the size of its payload as an int,
+        /// so that the client can tell where it ends, even if it arrives in pieces (see messageFramer.h on the client)
+        /// </summary>
+        private void SendMessage(OutgoingMessageType messageType, byte[] payload = null)
         {
+            int payloadSize = payload == null ? 0 : payload.Length;
+            byte[] message = new byte[1 + sizeof(int) + payloadSize];
+
+            message[0] = (byte)messageType;
+            Buffer.BlockCopy(BitConverter.GetBytes(payloadSize), 0, message, 1, sizeof(int));
+
+            if (payload != null)
+                Buffer.BlockCopy(payload, 0, message, 1 + sizeof(int), payloadSize);
+
             try
             {
-                oSocket.Send(byteToSend);
+                oSocket.Send(message);
             }
 
             catch(SocketException so)
@@ -0,0 +1,139 @@
+﻿using System;
+
+namespace LiveScanServer
+{
+    /// <summary>
+    /// Follows the message type of every frame a client sends, over the socket as well as in the shared memory.
+    /// Copied from frameHeader.h on the client, which describes the fields
+    /// </summary>
+    public class FrameHeader
+    {
+        public const int Size = 40;
+
+        //FRAME_HEADER_FLAGS
+        const uint checksumFlag = 1;
+
+        public int iPayloadSize;
+        public int iCompression;
+        public int iEncoding;
+        public int iPointCount;
+        public ulong iTimestamp; //Device timestamp in microseconds
+        public int iFrameIndex;
+        public int iDeviceIndex;
+        public uint iChecksum;
+        public uint iFlags;
+
+        public FrameHeader()
+        {
+            iFrameIndex = -1;
+        }
+
+        public FrameHeader(byte[] buffer, int startIdx)
+        {
+            iPayloadSize = BitConverter.ToInt32(buffer, startIdx);
+            iCompression = BitConverter.ToInt32(buffer, startIdx + 4);
+            iEncoding = BitConverter.ToInt32(buffer, startIdx + 8);
+            iPointCount = BitConverter.ToInt32(buffer, startIdx + 12);
+            iTimestamp = BitConverter.ToUInt64(buffer, startIdx + 16);
+            iFrameIndex = BitConverter.ToInt32(buffer, startIdx + 24);
+            iDeviceIndex = BitConverter.ToInt32(buffer, startIdx + 28);
+            iChecksum = BitConverter.ToUInt32(buffer, startIdx + 32);
+            iFlags = BitConverter.ToUInt32(buffer, startIdx + 36);
+        }
+
+        public bool HasChecksum()
+        {
+            return (iFlags & checksumFlag) != 0;
+        }
+
+        /// <summary>
+        /// Checks the uncompressed payload against the checksum the client computed before sending it
+        /// </summary>
+        /// <returns>True if it matches, or if the frame came without a checksum</returns>
+        public bool VerifyChecksum(byte[] buffer, int startIdx, int length)
+        {
+            return !HasChecksum() || XXHash32.Hash(buffer, startIdx, length, 0) == iChecksum;
+        }
+    }
+
+    /// <summary>
+    /// The 32 bit variant of xxHash (https://github.com/Cyan4973/xxHash), the same as XXHash32() in frameHeader.cpp on the client
+    /// </summary>
+    public static class XXHash32
+    {
+        const uint prime1 = 2654435761U;
+        const uint prime2 = 2246822519U;
+        const uint prime3 = 3266489917U;
+        const uint prime4 = 668265263U;
+        const uint prime5 = 374761393U;
+
+        static uint RotateLeft(uint value, int bits)
+        {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        static uint Round(uint accumulator, uint input)
+        {
+            accumulator += input * prime2;
+            accumulator = RotateLeft(accumulator, 13);
+            return accumulator * prime1;
+        }
+
+        public static uint Hash(byte[] buffer, int startIdx, int length, uint seed)
+        {
+            unchecked
+            {
+                int current = startIdx;
+                int end = startIdx + length;
+                uint hash;
+
+                if (length >= 16)
+                {
+                    int limit = end - 16;
+                    uint v1 = seed + prime1 + prime2;
+                    uint v2 = seed + prime2;
+                    uint v3 = seed;
+                    uint v4 = seed - prime1;
+
+                    do
+                    {
+                        v1 = Round(v1, BitConverter.ToUInt32(buffer, current));
+                        v2 = Round(v2, BitConverter.ToUInt32(buffer, current + 4));
+                        v3 = Round(v3, BitConverter.ToUInt32(buffer, current + 8));
+                        v4 = Round(v4, BitConverter.ToUInt32(buffer, current + 12));
+                        current += 16;
+                    } while (current <= limit);
+
+                    hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+                }
+
+                else
+                    hash = seed + prime5;
+
+                hash += (uint)length;
+
+                while (current + 4 <= end)
+                {
+                    hash += BitConverter.ToUInt32(buffer, current) * prime3;
+                    hash = RotateLeft(hash, 17) * prime4;
+                    current += 4;
+                }
+
+                while (current < end)
+                {
+                    hash += buffer[current] * prime5;
+                    hash = RotateLeft(hash, 11) * prime1;
+                    current++;
+                }
+
+                hash ^= hash >> 15;
+                hash *= prime2;
+                hash ^= hash >> 13;
+                hash *= prime3;
+                hash ^= hash >> 16;
+
+                return hash;
+            }
+        }
+    }
+}
@@ -490,6 +490,17 @@ namespace LiveScanServer
             QueueUIUpdate();
         }
 
+        public void LearnBackground()
+        {
+            if (!clientManager.LearnBackground())
+                Log.LogInfo("No clients connected, can't learn the background");
+        }
+
+        public void ClearBackground()
+        {
+            clientManager.ClearBackground();
+        }
+
         public void SetVisibility(int index, bool visible)
         {
             state.clients[index].bVisible = visible;
@@ -943,7 +954,7 @@ namespace LiveScanServer
             previewWorker.CancelAsync();
         }
 
-        //Continually requests frames that will be displayed in the live view window.
+        //Continually gets the frames that the clients push for the live view window.
         private void PreviewWorker(object sender, DoWorkEventArgs e)
         {
             List<List<byte>> lFramesRGB = new List<List<byte>>();
@@ -958,7 +969,10 @@ namespace LiveScanServer
 
                 if (clientManager != null)
                 {
-                    clientManager.GetLatestFrame(lFramesRGB, lFramesVerts, false);
+                    //Nothing new to show
+                    if (!clientManager.GetPushedLiveFrames(lFramesRGB, lFramesVerts, 100))
+                        continue;
+
                     Log.LogDebugCapture("Getting latest frame for live view");
 
                     //Update the vertex and color lists that are common between this class and the OpenGLWindow.
@@ -989,6 +1003,8 @@ namespace LiveScanServer
             }
 
             //Thread ended, cleanup
+            clientManager?.UnsubscribeLiveFrames();
+
             lock (lAllVertices)
             {
                 lAllVertices.Clear();
@@ -545,8 +545,8 @@
             this.pInfoRawFrames.SizeMode = System.Windows.Forms.PictureBoxSizeMode.StretchImage;
             this.pInfoRawFrames.TabIndex = 28;
             this.pInfoRawFrames.TabStop = false;
-            this.tooltips.SetToolTip(this.pInfoRawFrames, "Save recording as color (.jpg) and depth (.tiff) frames. Best capture performance" +
-        " and maximum quality, but requires postprocessing");
+            this.tooltips.SetToolTip(this.pInfoRawFrames, "Save recording as color (MJPEG) and depth frames in a single .lsr file per client. Best capture performance" +
+        " and maximum quality, but requires postprocessing. Extract the .jpg/.tiff frames with LiveScanClient.exe -extractraw <file>");
             // 
             // pInfoPointclouds
             // 
@@ -27,7 +27,15 @@ namespace LiveScanServer
 		MSG_START_CAPTURING_FRAMES,
 		MSG_STOP_CAPTURING_FRAMES,
 		MSG_REQUEST_TIMESTAMP_LIST,
-		MSG_RECEIVE_POSTSYNC_LIST
+		MSG_RECEIVE_POSTSYNC_LIST,
+		MSG_SUBSCRIBE_LIVE_FRAMES,
+		MSG_UNSUBSCRIBE_LIVE_FRAMES,
+		MSG_GRANT_LIVE_CREDITS,
+		MSG_CONFIRM_SHARED_FRAME_RING,
+		MSG_REQUEST_STORED_FRAMES,
+		MSG_ACK_STORED_FRAMES,
+		MSG_LEARN_BACKGROUND,
+		MSG_CLEAR_BACKGROUND
 	};
 	//copied from LiveScanClient/utils.h. 
 	//Must match OUTGOING_MESSAGE_TYPE
@@ -44,6 +52,29 @@ namespace LiveScanServer
 		MSG_SEND_TIMESTAMP_LIST,
 		MSG_CONFIRM_POSTSYNCED,
 		MSG_CONFIRM_POST_RECORD_PROCESS,
-		MSG_CONFIRM_PRE_RECORD_PROCESS
-	};	
+		MSG_CONFIRM_PRE_RECORD_PROCESS,
+		MSG_PUSHED_LIVE_FRAME,
+		MSG_SHARED_FRAME_RING,
+		MSG_STORED_FRAME_DICTIONARY
+	};
+
+	//copied from LiveScanClient/utils.h.
+	//Must match FRAME_COMPRESSION
+	public enum FrameCompression
+	{
+		None,
+		ZSTD,
+		ZSTDStream,
+		ZSTDParallel,
+		ZSTDDictionary
+	};
+
+	//copied from LiveScanClient/frameEncoding.h.
+	//Must match FRAME_ENCODING
+	public enum FrameEncoding
+	{
+		Interleaved,
+		Columnar,
+		BinFile
+	};
 }
@@ -80,6 +80,38 @@
             this.lbX = new System.Windows.Forms.Label();
             this.tooltips = new System.Windows.Forms.ToolTip(this.components);
             this.pInfoCompression = new System.Windows.Forms.PictureBox();
+            this.chDepthNative = new System.Windows.Forms.CheckBox();
+            this.grOutliers = new System.Windows.Forms.GroupBox();
+            this.chFilterOutliers = new System.Windows.Forms.CheckBox();
+            this.lbOutlierRadius = new System.Windows.Forms.Label();
+            this.nudOutlierRadius = new System.Windows.Forms.NumericUpDown();
+            this.lbOutlierNeighbors = new System.Windows.Forms.Label();
+            this.nudOutlierNeighbors = new System.Windows.Forms.NumericUpDown();
+            this.pInfoOutliers = new System.Windows.Forms.PictureBox();
+            this.lbBackgroundTolerance = new System.Windows.Forms.Label();
+            this.nudBackgroundTolerance = new System.Windows.Forms.NumericUpDown();
+            this.btLearnBackground = new System.Windows.Forms.Button();
+            this.btClearBackground = new System.Windows.Forms.Button();
+            this.pInfoBackground = new System.Windows.Forms.PictureBox();
+            this.grTransfer = new System.Windows.Forms.GroupBox();
+            this.grDownsampling = new System.Windows.Forms.GroupBox();
+            this.lbVoxelLeafSize = new System.Windows.Forms.Label();
+            this.nudVoxelLeafSize = new System.Windows.Forms.NumericUpDown();
+            this.lbPointBudget = new System.Windows.Forms.Label();
+            this.nudPointBudget = new System.Windows.Forms.NumericUpDown();
+            this.pInfoDownsampling = new System.Windows.Forms.PictureBox();
+            this.grRecording = new System.Windows.Forms.GroupBox();
+            this.lbRecordingQueuePolicy = new System.Windows.Forms.Label();
+            this.cbRecordingQueuePolicy = new System.Windows.Forms.ComboBox();
+            this.lbRecordingPreallocation = new System.Windows.Forms.Label();
+            this.nudRecordingPreallocation = new System.Windows.Forms.NumericUpDown();
+            this.chUnbufferedRecording = new System.Windows.Forms.CheckBox();
+            this.pInfoRecording = new System.Windows.Forms.PictureBox();
+            this.chCompressRecording = new System.Windows.Forms.CheckBox();
+            this.lbFrameEncoding = new System.Windows.Forms.Label();
+            this.cbFrameEncoding = new System.Windows.Forms.ComboBox();
+            this.chAdaptiveCompression = new System.Windows.Forms.CheckBox();
+            this.chSharedMemory = new System.Windows.Forms.CheckBox();
             this.grClient.SuspendLayout();
             this.gbICP.SuspendLayout();
             ((System.ComponentModel.ISupportInitialize)(this.pInfoICP)).BeginInit();
@@ -95,6 +127,20 @@
             ((System.ComponentModel.ISupportInitialize)(this.pInfoMaxBounds)).BeginInit();
             ((System.ComponentModel.ISupportInitialize)(this.PInfoMinBounds)).BeginInit();
             ((System.ComponentModel.ISupportInitialize)(this.pInfoCompression)).BeginInit();
+            this.grOutliers.SuspendLayout();
+            ((System.ComponentModel.ISupportInitialize)(this.nudOutlierRadius)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nudOutlierNeighbors)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoOutliers)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nudBackgroundTolerance)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoBackground)).BeginInit();
+            this.grTransfer.SuspendLayout();
+            this.grDownsampling.SuspendLayout();
+            ((System.ComponentModel.ISupportInitialize)(this.nudVoxelLeafSize)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nudPointBudget)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoDownsampling)).BeginInit();
+            this.grRecording.SuspendLayout();
+            ((System.ComponentModel.ISupportInitialize)(this.nudRecordingPreallocation)).BeginInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoRecording)).BeginInit();
             this.SuspendLayout();
             // 
             // lbICPIters
@@ -116,6 +162,10 @@
             // 
             // grClient
             // 
+            this.grClient.Controls.Add(this.grRecording);
+            this.grClient.Controls.Add(this.grDownsampling);
+            this.grClient.Controls.Add(this.grTransfer);
+            this.grClient.Controls.Add(this.grOutliers);
             this.grClient.Controls.Add(this.gbICP);
             this.grClient.Controls.Add(this.exportGroup);
             this.grClient.Controls.Add(this.grMarkers);
@@ -123,7 +173,7 @@
             this.grClient.Location = new System.Drawing.Point(8, 8);
             this.grClient.Margin = new System.Windows.Forms.Padding(2);
             this.grClient.Name = "grClient";
-            this.grClient.Size = new System.Drawing.Size(661, 251);
+            this.grClient.Size = new System.Drawing.Size(661, 484);
             this.grClient.TabIndex = 43;
             this.grClient.TabStop = false;
             this.grClient.Text = "Extended Settings";
@@ -184,6 +234,7 @@
             // 
             // exportGroup
             // 
+            this.exportGroup.Controls.Add(this.chDepthNative);
             this.exportGroup.Controls.Add(this.pInfoCompression);
             this.exportGroup.Controls.Add(this.nudCompressionLvl);
             this.exportGroup.Controls.Add(this.pInfoExtrinsics);
@@ -632,11 +683,436 @@
             this.pInfoCompression.TabStop = false;
             this.tooltips.SetToolTip(this.pInfoCompression, "2 is recommended, set 0 for no compression");
             // 
+            // chDepthNative
+            // 
+            this.chDepthNative.AutoSize = true;
+            this.chDepthNative.Location = new System.Drawing.Point(172, 101);
+            this.chDepthNative.Name = "chDepthNative";
+            this.chDepthNative.Size = new System.Drawing.Size(75, 17);
+            this.chDepthNative.TabIndex = 65;
+            this.chDepthNative.Text = "Depth Res.";
+            this.tooltips.SetToolTip(this.chDepthNative, "Generates the pointclouds at depth camera resolution instead of color camera resol" +
+        "ution. Much less points for the same geometric detail");
+            this.chDepthNative.UseVisualStyleBackColor = true;
+            this.chDepthNative.CheckedChanged += new System.EventHandler(this.chDepthNative_CheckedChanged);
+            // 
+            // grOutliers
+            // 
+            this.grOutliers.Controls.Add(this.pInfoBackground);
+            this.grOutliers.Controls.Add(this.btClearBackground);
+            this.grOutliers.Controls.Add(this.btLearnBackground);
+            this.grOutliers.Controls.Add(this.nudBackgroundTolerance);
+            this.grOutliers.Controls.Add(this.lbBackgroundTolerance);
+            this.grOutliers.Controls.Add(this.pInfoOutliers);
+            this.grOutliers.Controls.Add(this.nudOutlierNeighbors);
+            this.grOutliers.Controls.Add(this.lbOutlierNeighbors);
+            this.grOutliers.Controls.Add(this.nudOutlierRadius);
+            this.grOutliers.Controls.Add(this.lbOutlierRadius);
+            this.grOutliers.Controls.Add(this.chFilterOutliers);
+            this.grOutliers.Location = new System.Drawing.Point(9, 248);
+            this.grOutliers.Name = "grOutliers";
+            this.grOutliers.Size = new System.Drawing.Size(440, 93);
+            this.grOutliers.TabIndex = 66;
+            this.grOutliers.TabStop = false;
+            this.grOutliers.Text = "Point Filters";
+            // 
+            // chFilterOutliers
+            // 
+            this.chFilterOutliers.AutoSize = true;
+            this.chFilterOutliers.Location = new System.Drawing.Point(11, 20);
+            this.chFilterOutliers.Name = "chFilterOutliers";
+            this.chFilterOutliers.Size = new System.Drawing.Size(103, 17);
+            this.chFilterOutliers.TabIndex = 0;
+            this.chFilterOutliers.Text = "Remove outliers";
+            this.chFilterOutliers.UseVisualStyleBackColor = true;
+            this.chFilterOutliers.CheckedChanged += new System.EventHandler(this.chFilterOutliers_CheckedChanged);
+            // 
+            // lbOutlierRadius
+            // 
+            this.lbOutlierRadius.AutoSize = true;
+            this.lbOutlierRadius.Location = new System.Drawing.Point(130, 21);
+            this.lbOutlierRadius.Name = "lbOutlierRadius";
+            this.lbOutlierRadius.Size = new System.Drawing.Size(68, 13);
+            this.lbOutlierRadius.TabIndex = 1;
+            this.lbOutlierRadius.Text = "Radius (mm):";
+            // 
+            // nudOutlierRadius
+            // 
+            this.nudOutlierRadius.Location = new System.Drawing.Point(204, 19);
+            this.nudOutlierRadius.Maximum = new decimal(new int[] {
+            200,
+            0,
+            0,
+            0});
+            this.nudOutlierRadius.Minimum = new decimal(new int[] {
+            1,
+            0,
+            0,
+            0});
+            this.nudOutlierRadius.Name = "nudOutlierRadius";
+            this.nudOutlierRadius.Size = new System.Drawing.Size(45, 20);
+            this.nudOutlierRadius.TabIndex = 2;
+            this.nudOutlierRadius.Value = new decimal(new int[] {
+            20,
+            0,
+            0,
+            0});
+            this.nudOutlierRadius.ValueChanged += new System.EventHandler(this.nudOutlierRadius_ValueChanged);
+            // 
+            // lbOutlierNeighbors
+            // 
+            this.lbOutlierNeighbors.AutoSize = true;
+            this.lbOutlierNeighbors.Location = new System.Drawing.Point(270, 21);
+            this.lbOutlierNeighbors.Name = "lbOutlierNeighbors";
+            this.lbOutlierNeighbors.Size = new System.Drawing.Size(86, 13);
+            this.lbOutlierNeighbors.TabIndex = 3;
+            this.lbOutlierNeighbors.Text = "Min. neighbours:";
+            // 
+            // nudOutlierNeighbors
+            // 
+            this.nudOutlierNeighbors.Location = new System.Drawing.Point(362, 19);
+            this.nudOutlierNeighbors.Minimum = new decimal(new int[] {
+            1,
+            0,
+            0,
+            0});
+            this.nudOutlierNeighbors.Name = "nudOutlierNeighbors";
+            this.nudOutlierNeighbors.Size = new System.Drawing.Size(45, 20);
+            this.nudOutlierNeighbors.TabIndex = 4;
+            this.nudOutlierNeighbors.Value = new decimal(new int[] {
+            5,
+            0,
+            0,
+            0});
+            this.nudOutlierNeighbors.ValueChanged += new System.EventHandler(this.nudOutlierNeighbors_ValueChanged);
+            // 
+            // pInfoOutliers
+            // 
+            this.pInfoOutliers.Image = global::LiveScanServer.Properties.Resources.info_box;
+            this.pInfoOutliers.Location = new System.Drawing.Point(415, 21);
+            this.pInfoOutliers.Name = "pInfoOutliers";
+            this.pInfoOutliers.Size = new System.Drawing.Size(15, 15);
+            this.pInfoOutliers.SizeMode = System.Windows.Forms.PictureBoxSizeMode.StretchImage;
+            this.pInfoOutliers.TabIndex = 5;
+            this.pInfoOutliers.TabStop = false;
+            this.tooltips.SetToolTip(this.pInfoOutliers, "Removes every point that has less than the minimum number of neighbours within th" +
+        "e radius. Runs on the clients for every frame, before it is stored or sent");
+            // 
+            // lbBackgroundTolerance
+            // 
+            this.lbBackgroundTolerance.AutoSize = true;
+            this.lbBackgroundTolerance.Location = new System.Drawing.Point(8, 59);
+            this.lbBackgroundTolerance.Name = "lbBackgroundTolerance";
+            this.lbBackgroundTolerance.Size = new System.Drawing.Size(136, 13);
+            this.lbBackgroundTolerance.TabIndex = 6;
+            this.lbBackgroundTolerance.Text = "Background tolerance (SD):";
+            // 
+            // nudBackgroundTolerance
+            // 
+            this.nudBackgroundTolerance.DecimalPlaces = 1;
+            this.nudBackgroundTolerance.Increment = new decimal(new int[] {
+            5,
+            0,
+            0,
+            65536});
+            this.nudBackgroundTolerance.Location = new System.Drawing.Point(150, 57);
+            this.nudBackgroundTolerance.Maximum = new decimal(new int[] {
+            10,
+            0,
+            0,
+            0});
+            this.nudBackgroundTolerance.Minimum = new decimal(new int[] {
+            1,
+            0,
+            0,
+            0});
+            this.nudBackgroundTolerance.Name = "nudBackgroundTolerance";
+            this.nudBackgroundTolerance.Size = new System.Drawing.Size(45, 20);
+            this.nudBackgroundTolerance.TabIndex = 7;
+            this.nudBackgroundTolerance.Value = new decimal(new int[] {
+            3,
+            0,
+            0,
+            0});
+            this.nudBackgroundTolerance.ValueChanged += new System.EventHandler(this.nudBackgroundTolerance_ValueChanged);
+            // 
+            // btLearnBackground
+            // 
+            this.btLearnBackground.Location = new System.Drawing.Point(204, 55);
+            this.btLearnBackground.Name = "btLearnBackground";
+            this.btLearnBackground.Size = new System.Drawing.Size(100, 23);
+            this.btLearnBackground.TabIndex = 8;
+            this.btLearnBackground.Text = "Learn Background";
+            this.btLearnBackground.UseVisualStyleBackColor = true;
+            this.btLearnBackground.Click += new System.EventHandler(this.btLearnBackground_Click);
+            // 
+            // btClearBackground
+            // 
+            this.btClearBackground.Location = new System.Drawing.Point(307, 55);
+            this.btClearBackground.Name = "btClearBackground";
+            this.btClearBackground.Size = new System.Drawing.Size(100, 23);
+            this.btClearBackground.TabIndex = 9;
+            this.btClearBackground.Text = "Clear Background";
+            this.btClearBackground.UseVisualStyleBackColor = true;
+            this.btClearBackground.Click += new System.EventHandler(this.btClearBackground_Click);
+            // 
+            // pInfoBackground
+            // 
+            this.pInfoBackground.Image = global::LiveScanServer.Properties.Resources.info_box;
+            this.pInfoBackground.Location = new System.Drawing.Point(415, 59);
+            this.pInfoBackground.Name = "pInfoBackground";
+            this.pInfoBackground.Size = new System.Drawing.Size(15, 15);
+            this.pInfoBackground.SizeMode = System.Windows.Forms.PictureBoxSizeMode.StretchImage;
+            this.pInfoBackground.TabIndex = 10;
+            this.pInfoBackground.TabStop = false;
+            this.tooltips.SetToolTip(this.pInfoBackground, "Each client learns the static background from its next frames, so the scene has t" +
+        "o be empty. Points within the tolerance of the background are removed from then o" +
+        "n. The background is stored per device and loaded again when the client starts");
+            // 
+            // grTransfer
+            // 
+            this.grTransfer.Controls.Add(this.chSharedMemory);
+            this.grTransfer.Controls.Add(this.chAdaptiveCompression);
+            this.grTransfer.Controls.Add(this.cbFrameEncoding);
+            this.grTransfer.Controls.Add(this.lbFrameEncoding);
+            this.grTransfer.Location = new System.Drawing.Point(455, 248);
+            this.grTransfer.Name = "grTransfer";
+            this.grTransfer.Size = new System.Drawing.Size(200, 93);
+            this.grTransfer.TabIndex = 67;
+            this.grTransfer.TabStop = false;
+            this.grTransfer.Text = "Transfer";
+            // 
+            // lbFrameEncoding
+            // 
+            this.lbFrameEncoding.AutoSize = true;
+            this.lbFrameEncoding.Location = new System.Drawing.Point(6, 22);
+            this.lbFrameEncoding.Name = "lbFrameEncoding";
+            this.lbFrameEncoding.Size = new System.Drawing.Size(55, 13);
+            this.lbFrameEncoding.TabIndex = 0;
+            this.lbFrameEncoding.Text = "Encoding:";
+            // 
+            // cbFrameEncoding
+            // 
+            this.cbFrameEncoding.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+            this.cbFrameEncoding.FormattingEnabled = true;
+            this.cbFrameEncoding.Items.AddRange(new object[] {
+            "Interleaved (v1)",
+            "Columnar (v2)"});
+            this.cbFrameEncoding.Location = new System.Drawing.Point(67, 18);
+            this.cbFrameEncoding.Name = "cbFrameEncoding";
+            this.cbFrameEncoding.Size = new System.Drawing.Size(121, 21);
+            this.cbFrameEncoding.TabIndex = 1;
+            this.tooltips.SetToolTip(this.cbFrameEncoding, "Layout of the frames the clients send. The columnar layout compresses to about ha" +
+        "lf the size, the interleaved one is the original layout");
+            this.cbFrameEncoding.SelectedIndexChanged += new System.EventHandler(this.cbFrameEncoding_SelectedIndexChanged);
+            // 
+            // chAdaptiveCompression
+            // 
+            this.chAdaptiveCompression.AutoSize = true;
+            this.chAdaptiveCompression.Location = new System.Drawing.Point(9, 45);
+            this.chAdaptiveCompression.Name = "chAdaptiveCompression";
+            this.chAdaptiveCompression.Size = new System.Drawing.Size(132, 17);
+            this.chAdaptiveCompression.TabIndex = 2;
+            this.chAdaptiveCompression.Text = "Adaptive compression";
+            this.tooltips.SetToolTip(this.chAdaptiveCompression, "The clients raise or lower the compression level and use more threads as needed t" +
+        "o keep up with the camera, starting at the compression level set under Export");
+            this.chAdaptiveCompression.UseVisualStyleBackColor = true;
+            this.chAdaptiveCompression.CheckedChanged += new System.EventHandler(this.chAdaptiveCompression_CheckedChanged);
+            // 
+            // chSharedMemory
+            // 
+            this.chSharedMemory.AutoSize = true;
+            this.chSharedMemory.Location = new System.Drawing.Point(9, 68);
+            this.chSharedMemory.Name = "chSharedMemory";
+            this.chSharedMemory.Size = new System.Drawing.Size(158, 17);
+            this.chSharedMemory.TabIndex = 3;
+            this.chSharedMemory.Text = "Shared memory on this host";
+            this.tooltips.SetToolTip(this.chSharedMemory, "Clients running on the same computer as the server hand over their frames uncompr" +
+        "essed through shared memory instead of the network. Other clients are not affected");
+            this.chSharedMemory.UseVisualStyleBackColor = true;
+            this.chSharedMemory.CheckedChanged += new System.EventHandler(this.chSharedMemory_CheckedChanged);
+            // 
+            // grDownsampling
+            // 
+            this.grDownsampling.Controls.Add(this.pInfoDownsampling);
+            this.grDownsampling.Controls.Add(this.nudPointBudget);
+            this.grDownsampling.Controls.Add(this.lbPointBudget);
+            this.grDownsampling.Controls.Add(this.nudVoxelLeafSize);
+            this.grDownsampling.Controls.Add(this.lbVoxelLeafSize);
+            this.grDownsampling.Location = new System.Drawing.Point(9, 347);
+            this.grDownsampling.Name = "grDownsampling";
+            this.grDownsampling.Size = new System.Drawing.Size(440, 50);
+            this.grDownsampling.TabIndex = 68;
+            this.grDownsampling.TabStop = false;
+            this.grDownsampling.Text = "Downsampling";
+            // 
+            // lbVoxelLeafSize
+            // 
+            this.lbVoxelLeafSize.AutoSize = true;
+            this.lbVoxelLeafSize.Location = new System.Drawing.Point(8, 22);
+            this.lbVoxelLeafSize.Name = "lbVoxelLeafSize";
+            this.lbVoxelLeafSize.Size = new System.Drawing.Size(87, 13);
+            this.lbVoxelLeafSize.TabIndex = 0;
+            this.lbVoxelLeafSize.Text = "Voxel size (mm):";
+            // 
+            // nudVoxelLeafSize
+            // 
+            this.nudVoxelLeafSize.Location = new System.Drawing.Point(101, 20);
+            this.nudVoxelLeafSize.Name = "nudVoxelLeafSize";
+            this.nudVoxelLeafSize.Size = new System.Drawing.Size(45, 20);
+            this.nudVoxelLeafSize.TabIndex = 1;
+            this.nudVoxelLeafSize.ValueChanged += new System.EventHandler(this.nudVoxelLeafSize_ValueChanged);
+            // 
+            // lbPointBudget
+            // 
+            this.lbPointBudget.AutoSize = true;
+            this.lbPointBudget.Location = new System.Drawing.Point(170, 22);
+            this.lbPointBudget.Name = "lbPointBudget";
+            this.lbPointBudget.Size = new System.Drawing.Size(133, 13);
+            this.lbPointBudget.TabIndex = 2;
+            this.lbPointBudget.Text = "Point budget per camera:";
+            // 
+            // nudPointBudget
+            // 
+            this.nudPointBudget.Increment = new decimal(new int[] {
+            10000,
+            0,
+            0,
+            0});
+            this.nudPointBudget.Location = new System.Drawing.Point(309, 20);
+            this.nudPointBudget.Maximum = new decimal(new int[] {
+            2000000,
+            0,
+            0,
+            0});
+            this.nudPointBudget.Name = "nudPointBudget";
+            this.nudPointBudget.Size = new System.Drawing.Size(98, 20);
+            this.nudPointBudget.TabIndex = 3;
+            this.nudPointBudget.ThousandsSeparator = true;
+            this.nudPointBudget.ValueChanged += new System.EventHandler(this.nudPointBudget_ValueChanged);
+            // 
+            // pInfoDownsampling
+            // 
+            this.pInfoDownsampling.Image = global::LiveScanServer.Properties.Resources.info_box;
+            this.pInfoDownsampling.Location = new System.Drawing.Point(415, 22);
+            this.pInfoDownsampling.Name = "pInfoDownsampling";
+            this.pInfoDownsampling.Size = new System.Drawing.Size(15, 15);
+            this.pInfoDownsampling.SizeMode = System.Windows.Forms.PictureBoxSizeMode.StretchImage;
+            this.pInfoDownsampling.TabIndex = 4;
+            this.pInfoDownsampling.TabStop = false;
+            this.tooltips.SetToolTip(this.pInfoDownsampling, "The clients merge all points within a voxel of this size into one, with the avera" +
+        "ge position and color. With a point budget, the voxels grow as needed so that no" +
+        " frame of a camera has more points than that. 0 turns either of them off");
+            // 
+            // grRecording
+            // 
+            this.grRecording.Controls.Add(this.chCompressRecording);
+            this.grRecording.Controls.Add(this.pInfoRecording);
+            this.grRecording.Controls.Add(this.chUnbufferedRecording);
+            this.grRecording.Controls.Add(this.nudRecordingPreallocation);
+            this.grRecording.Controls.Add(this.lbRecordingPreallocation);
+            this.grRecording.Controls.Add(this.cbRecordingQueuePolicy);
+            this.grRecording.Controls.Add(this.lbRecordingQueuePolicy);
+            this.grRecording.Location = new System.Drawing.Point(9, 403);
+            this.grRecording.Name = "grRecording";
+            this.grRecording.Size = new System.Drawing.Size(646, 73);
+            this.grRecording.TabIndex = 69;
+            this.grRecording.TabStop = false;
+            this.grRecording.Text = "Recording";
+            // 
+            // lbRecordingQueuePolicy
+            // 
+            this.lbRecordingQueuePolicy.AutoSize = true;
+            this.lbRecordingQueuePolicy.Location = new System.Drawing.Point(8, 22);
+            this.lbRecordingQueuePolicy.Name = "lbRecordingQueuePolicy";
+            this.lbRecordingQueuePolicy.Size = new System.Drawing.Size(146, 13);
+            this.lbRecordingQueuePolicy.TabIndex = 0;
+            this.lbRecordingQueuePolicy.Text = "When the disk can't keep up:";
+            // 
+            // cbRecordingQueuePolicy
+            // 
+            this.cbRecordingQueuePolicy.DropDownStyle = System.Windows.Forms.ComboBoxStyle.DropDownList;
+            this.cbRecordingQueuePolicy.FormattingEnabled = true;
+            this.cbRecordingQueuePolicy.Items.AddRange(new object[] {
+            "Wait for it",
+            "Drop frames"});
+            this.cbRecordingQueuePolicy.Location = new System.Drawing.Point(160, 18);
+            this.cbRecordingQueuePolicy.Name = "cbRecordingQueuePolicy";
+            this.cbRecordingQueuePolicy.Size = new System.Drawing.Size(100, 21);
+            this.cbRecordingQueuePolicy.TabIndex = 1;
+            this.cbRecordingQueuePolicy.SelectedIndexChanged += new System.EventHandler(this.cbRecordingQueuePolicy_SelectedIndexChanged);
+            // 
+            // lbRecordingPreallocation
+            // 
+            this.lbRecordingPreallocation.AutoSize = true;
+            this.lbRecordingPreallocation.Location = new System.Drawing.Point(280, 22);
+            this.lbRecordingPreallocation.Name = "lbRecordingPreallocation";
+            this.lbRecordingPreallocation.Size = new System.Drawing.Size(92, 13);
+            this.lbRecordingPreallocation.TabIndex = 2;
+            this.lbRecordingPreallocation.Text = "Preallocate (MB):";
+            // 
+            // nudRecordingPreallocation
+            // 
+            this.nudRecordingPreallocation.Increment = new decimal(new int[] {
+            1024,
+            0,
+            0,
+            0});
+            this.nudRecordingPreallocation.Location = new System.Drawing.Point(378, 20);
+            this.nudRecordingPreallocation.Maximum = new decimal(new int[] {
+            1000000,
+            0,
+            0,
+            0});
+            this.nudRecordingPreallocation.Name = "nudRecordingPreallocation";
+            this.nudRecordingPreallocation.Size = new System.Drawing.Size(70, 20);
+            this.nudRecordingPreallocation.TabIndex = 3;
+            this.nudRecordingPreallocation.ThousandsSeparator = true;
+            this.nudRecordingPreallocation.ValueChanged += new System.EventHandler(this.nudRecordingPreallocation_ValueChanged);
+            // 
+            // chUnbufferedRecording
+            // 
+            this.chUnbufferedRecording.AutoSize = true;
+            this.chUnbufferedRecording.Location = new System.Drawing.Point(470, 21);
+            this.chUnbufferedRecording.Name = "chUnbufferedRecording";
+            this.chUnbufferedRecording.Size = new System.Drawing.Size(109, 17);
+            this.chUnbufferedRecording.TabIndex = 4;
+            this.chUnbufferedRecording.Text = "Unbuffered writes";
+            this.chUnbufferedRecording.UseVisualStyleBackColor = true;
+            this.chUnbufferedRecording.CheckedChanged += new System.EventHandler(this.chUnbufferedRecording_CheckedChanged);
+            // 
+            // pInfoRecording
+            // 
+            this.pInfoRecording.Image = global::LiveScanServer.Properties.Resources.info_box;
+            this.pInfoRecording.Location = new System.Drawing.Point(621, 22);
+            this.pInfoRecording.Name = "pInfoRecording";
+            this.pInfoRecording.Size = new System.Drawing.Size(15, 15);
+            this.pInfoRecording.SizeMode = System.Windows.Forms.PictureBoxSizeMode.StretchImage;
+            this.pInfoRecording.TabIndex = 5;
+            this.pInfoRecording.TabStop = false;
+            this.tooltips.SetToolTip(this.pInfoRecording, "The clients write recorded frames on a separate thread. When the disk falls behind" +
+        " for longer than about a second, they either wait for it (frames are then lost b" +
+        "efore they are processed) or drop the frames that don't fit. Preallocating space" +
+        " and unbuffered writes help slow or fragmented disks. Compressed pointclouds take" +
+        " a fraction of the space and disk bandwidth, but cost the clients some CPU time." +
+        " Takes effect with the next recording");
+            // 
+            // chCompressRecording
+            // 
+            this.chCompressRecording.AutoSize = true;
+            this.chCompressRecording.Location = new System.Drawing.Point(11, 46);
+            this.chCompressRecording.Name = "chCompressRecording";
+            this.chCompressRecording.Size = new System.Drawing.Size(170, 17);
+            this.chCompressRecording.TabIndex = 6;
+            this.chCompressRecording.Text = "Compress recorded pointclouds";
+            this.chCompressRecording.UseVisualStyleBackColor = true;
+            this.chCompressRecording.CheckedChanged += new System.EventHandler(this.chCompressRecording_CheckedChanged);
+            // 
             // SettingsForm
             // 
             this.AutoScaleDimensions = new System.Drawing.SizeF(6F, 13F);
             this.AutoScaleMode = System.Windows.Forms.AutoScaleMode.Font;
-            this.ClientSize = new System.Drawing.Size(676, 270);
+            this.ClientSize = new System.Drawing.Size(676, 503);
             this.Controls.Add(this.grClient);
             this.FormBorderStyle = System.Windows.Forms.FormBorderStyle.FixedSingle;
             this.MaximizeBox = false;
@@ -663,6 +1139,24 @@
             ((System.ComponentModel.ISupportInitialize)(this.pInfoMaxBounds)).EndInit();
             ((System.ComponentModel.ISupportInitialize)(this.PInfoMinBounds)).EndInit();
             ((System.ComponentModel.ISupportInitialize)(this.pInfoCompression)).EndInit();
+            this.grOutliers.ResumeLayout(false);
+            this.grOutliers.PerformLayout();
+            ((System.ComponentModel.ISupportInitialize)(this.nudOutlierRadius)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nudOutlierNeighbors)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoOutliers)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nudBackgroundTolerance)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoBackground)).EndInit();
+            this.grTransfer.ResumeLayout(false);
+            this.grTransfer.PerformLayout();
+            this.grDownsampling.ResumeLayout(false);
+            this.grDownsampling.PerformLayout();
+            ((System.ComponentModel.ISupportInitialize)(this.nudVoxelLeafSize)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.nudPointBudget)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoDownsampling)).EndInit();
+            this.grRecording.ResumeLayout(false);
+            this.grRecording.PerformLayout();
+            ((System.ComponentModel.ISupportInitialize)(this.nudRecordingPreallocation)).EndInit();
+            ((System.ComponentModel.ISupportInitialize)(this.pInfoRecording)).EndInit();
             this.ResumeLayout(false);
 
         }
@@ -719,5 +1213,37 @@
         private System.Windows.Forms.ToolTip tooltips;
         private System.Windows.Forms.NumericUpDown nudCompressionLvl;
         private System.Windows.Forms.PictureBox pInfoCompression;
+        private System.Windows.Forms.CheckBox chDepthNative;
+        private System.Windows.Forms.GroupBox grOutliers;
+        private System.Windows.Forms.CheckBox chFilterOutliers;
+        private System.Windows.Forms.Label lbOutlierRadius;
+        private System.Windows.Forms.NumericUpDown nudOutlierRadius;
+        private System.Windows.Forms.Label lbOutlierNeighbors;
+        private System.Windows.Forms.NumericUpDown nudOutlierNeighbors;
+        private System.Windows.Forms.PictureBox pInfoOutliers;
+        private System.Windows.Forms.Label lbBackgroundTolerance;
+        private System.Windows.Forms.NumericUpDown nudBackgroundTolerance;
+        private System.Windows.Forms.Button btLearnBackground;
+        private System.Windows.Forms.Button btClearBackground;
+        private System.Windows.Forms.PictureBox pInfoBackground;
+        private System.Windows.Forms.GroupBox grTransfer;
+        private System.Windows.Forms.Label lbFrameEncoding;
+        private System.Windows.Forms.ComboBox cbFrameEncoding;
+        private System.Windows.Forms.CheckBox chAdaptiveCompression;
+        private System.Windows.Forms.CheckBox chSharedMemory;
+        private System.Windows.Forms.GroupBox grDownsampling;
+        private System.Windows.Forms.Label lbVoxelLeafSize;
+        private System.Windows.Forms.NumericUpDown nudVoxelLeafSize;
+        private System.Windows.Forms.Label lbPointBudget;
+        private System.Windows.Forms.NumericUpDown nudPointBudget;
+        private System.Windows.Forms.PictureBox pInfoDownsampling;
+        private System.Windows.Forms.GroupBox grRecording;
+        private System.Windows.Forms.Label lbRecordingQueuePolicy;
+        private System.Windows.Forms.ComboBox cbRecordingQueuePolicy;
+        private System.Windows.Forms.Label lbRecordingPreallocation;
+        private System.Windows.Forms.NumericUpDown nudRecordingPreallocation;
+        private System.Windows.Forms.CheckBox chUnbufferedRecording;
+        private System.Windows.Forms.PictureBox pInfoRecording;
+        private System.Windows.Forms.CheckBox chCompressRecording;
     }
 }
\ No newline at end of file
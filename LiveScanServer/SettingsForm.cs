@@ -91,6 +91,23 @@ namespace LiveScanServer
 
             cbExtrinsicsFormat.SelectedIndex = (int)settings.eExtrinsicsFormat;
 
+            chDepthNative.Checked = settings.bDepthNativePointcloud;
+
+            chFilterOutliers.Checked = settings.bFilterOutliers;
+            nudOutlierRadius.Value = settings.nOutlierRadius;
+            nudOutlierNeighbors.Value = settings.nOutlierMinNeighbors;
+            nudBackgroundTolerance.Value = (decimal)settings.fBackgroundTolerance;
+            nudVoxelLeafSize.Value = settings.nVoxelLeafSize;
+            nudPointBudget.Value = settings.nPointBudget;
+            cbRecordingQueuePolicy.SelectedIndex = (int)settings.eRecordingQueuePolicy;
+            chUnbufferedRecording.Checked = settings.bUnbufferedRecording;
+            nudRecordingPreallocation.Value = settings.nRecordingPreallocationMB;
+            chCompressRecording.Checked = settings.bCompressRecording;
+
+            cbFrameEncoding.SelectedIndex = (int)settings.eFrameEncoding;
+            chAdaptiveCompression.Checked = settings.bAdaptiveCompression;
+            chSharedMemory.Checked = settings.bSharedMemoryTransport;
+
             if (settings.bSaveAsBinaryPLY)
             {
                 rBinaryPly.Checked = true;
@@ -131,6 +148,20 @@ namespace LiveScanServer
             currentSettings.iCompressionLevel = settings.iCompressionLevel;
             currentSettings.nNumICPIterations = settings.nNumICPIterations;
             currentSettings.nNumRefineIters = settings.nNumRefineIters;
+            currentSettings.bDepthNativePointcloud = settings.bDepthNativePointcloud;
+            currentSettings.bFilterOutliers = settings.bFilterOutliers;
+            currentSettings.nOutlierRadius = settings.nOutlierRadius;
+            currentSettings.nOutlierMinNeighbors = settings.nOutlierMinNeighbors;
+            currentSettings.fBackgroundTolerance = settings.fBackgroundTolerance;
+            currentSettings.nVoxelLeafSize = settings.nVoxelLeafSize;
+            currentSettings.nPointBudget = settings.nPointBudget;
+            currentSettings.eRecordingQueuePolicy = settings.eRecordingQueuePolicy;
+            currentSettings.bUnbufferedRecording = settings.bUnbufferedRecording;
+            currentSettings.nRecordingPreallocationMB = settings.nRecordingPreallocationMB;
+            currentSettings.bCompressRecording = settings.bCompressRecording;
+            currentSettings.eFrameEncoding = settings.eFrameEncoding;
+            currentSettings.bAdaptiveCompression = settings.bAdaptiveCompression;
+            currentSettings.bSharedMemoryTransport = settings.bSharedMemoryTransport;
             return currentSettings;
         }
 
@@ -208,6 +239,100 @@ namespace LiveScanServer
             UpdateSettings();
         }
 
+        private void chDepthNative_CheckedChanged(object sender, EventArgs e)
+        {
+            settings.bDepthNativePointcloud = chDepthNative.Checked;
+            UpdateSettings();
+        }
+
+        private void chFilterOutliers_CheckedChanged(object sender, EventArgs e)
+        {
+            settings.bFilterOutliers = chFilterOutliers.Checked;
+            UpdateSettings();
+        }
+
+        private void nudOutlierRadius_ValueChanged(object sender, EventArgs e)
+        {
+            settings.nOutlierRadius = (int)nudOutlierRadius.Value;
+            UpdateSettings();
+        }
+
+        private void nudOutlierNeighbors_ValueChanged(object sender, EventArgs e)
+        {
+            settings.nOutlierMinNeighbors = (int)nudOutlierNeighbors.Value;
+            UpdateSettings();
+        }
+
+        private void nudBackgroundTolerance_ValueChanged(object sender, EventArgs e)
+        {
+            settings.fBackgroundTolerance = (float)nudBackgroundTolerance.Value;
+            UpdateSettings();
+        }
+
+        private void nudVoxelLeafSize_ValueChanged(object sender, EventArgs e)
+        {
+            settings.nVoxelLeafSize = (int)nudVoxelLeafSize.Value;
+            UpdateSettings();
+        }
+
+        private void nudPointBudget_ValueChanged(object sender, EventArgs e)
+        {
+            settings.nPointBudget = (int)nudPointBudget.Value;
+            UpdateSettings();
+        }
+
+        private void cbRecordingQueuePolicy_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            settings.eRecordingQueuePolicy = (ClientSettings.RecordingQueuePolicy)cbRecordingQueuePolicy.SelectedIndex;
+            UpdateSettings();
+        }
+
+        private void chUnbufferedRecording_CheckedChanged(object sender, EventArgs e)
+        {
+            settings.bUnbufferedRecording = chUnbufferedRecording.Checked;
+            UpdateSettings();
+        }
+
+        private void nudRecordingPreallocation_ValueChanged(object sender, EventArgs e)
+        {
+            settings.nRecordingPreallocationMB = (int)nudRecordingPreallocation.Value;
+            UpdateSettings();
+        }
+
+        private void chCompressRecording_CheckedChanged(object sender, EventArgs e)
+        {
+            settings.bCompressRecording = chCompressRecording.Checked;
+            UpdateSettings();
+        }
+
+        private void btLearnBackground_Click(object sender, EventArgs e)
+        {
+            liveScanServer.LearnBackground();
+        }
+
+        private void btClearBackground_Click(object sender, EventArgs e)
+        {
+            liveScanServer.ClearBackground();
+        }
+
+        private void cbFrameEncoding_SelectedIndexChanged(object sender, EventArgs e)
+        {
+            settings.eFrameEncoding = (FrameEncoding)cbFrameEncoding.SelectedIndex;
+            UpdateSettings();
+        }
+
+        private void chAdaptiveCompression_CheckedChanged(object sender, EventArgs e)
+        {
+            settings.bAdaptiveCompression = chAdaptiveCompression.Checked;
+            UpdateSettings();
+        }
+
+        private void chSharedMemory_CheckedChanged(object sender, EventArgs e)
+        {
+            settings.bSharedMemoryTransport = chSharedMemory.Checked;
+            UpdateSettings();
+        }
+
         private void btSaveMarker_Click(object sender, EventArgs e)
         {
             SaveFileDialog saveFileDialog = new SaveFileDialog();
@@ -0,0 +1,160 @@
+﻿using System;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+
+namespace LiveScanServer
+{
+    /// <summary>
+    /// Reads the frames that a client on the same host puts into shared memory instead of sending them over the socket.
+    /// The layout is copied from sharedFrameRing.h on the client: A 64 byte ring header, followed by the slots.
+    /// Every slot starts with a 64 byte header holding its seqlock, the message type and the size of the frame that follows.
+    /// The client never waits for us, so frames that we don't read in time are overwritten and counted as dropped.
+    /// </summary>
+    public class SharedFrameRingReader : IDisposable
+    {
+        const uint ringMagic = 0x4C535246;
+        const uint ringVersion = 2;
+        const int ringHeaderSize = 64;
+        const int slotHeaderSize = 64;
+
+        //Offsets in the ring header
+        const int slotCountOffset = 8;
+        const int slotSizeOffset = 12;
+        const int publishedOffset = 16;
+
+        //Offsets in the slot header
+        const int messageTypeOffset = 8;
+        const int frameSizeOffset = 12;
+
+        MemoryMappedFile oFile;
+        MemoryMappedViewAccessor oView;
+
+        int iSlotCount;
+        int iSlotSize;
+        ulong iNextFrame;
+
+        public ulong iDroppedFrames = 0;
+
+        public string sName = "";
+
+        /// <summary>
+        /// Opens the ring of a client. Reading starts with the next frame the client writes
+        /// </summary>
+        /// <returns>False if the ring doesn't exist on this host or isn't valid</returns>
+        public bool Open(string name)
+        {
+            try
+            {
+                oFile = MemoryMappedFile.OpenExisting(name, MemoryMappedFileRights.Read);
+                oView = oFile.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+            }
+
+            catch (Exception)
+            {
+                Dispose();
+                return false;
+            }
+
+            iSlotCount = oView.ReadInt32(slotCountOffset);
+            iSlotSize = oView.ReadInt32(slotSizeOffset);
+
+            if (oView.ReadUInt32(0) != ringMagic || oView.ReadUInt32(4) != ringVersion || iSlotCount <= 0 || iSlotSize <= slotHeaderSize ||
+                oView.Capacity < ringHeaderSize + (long)iSlotCount * iSlotSize)
+            {
+                Dispose();
+                return false;
+            }
+
+            sName = name;
+            iNextFrame = ReadPublished();
+            iDroppedFrames = 0;
+
+            return true;
+        }
+
+        /// <summary>
+        /// Copies the next frame out of the ring, without waiting for one
+        /// </summary>
+        /// <param name="frame">The FrameHeader followed by the payload</param>
+        /// <returns>False if there is no new frame</returns>
+        public bool Read(out int messageType, out byte[] frame)
+        {
+            messageType = -1;
+            frame = null;
+
+            if (oView == null)
+                return false;
+
+            ulong published = ReadPublished();
+
+            //Everything older than the number of slots is already overwritten
+            if (published - iNextFrame > (ulong)iSlotCount)
+            {
+                iDroppedFrames += published - (ulong)iSlotCount - iNextFrame;
+                iNextFrame = published - (ulong)iSlotCount;
+            }
+
+            while (iNextFrame < published)
+            {
+                ulong current = iNextFrame++;
+                long slot = ringHeaderSize + (long)(current % (ulong)iSlotCount) * iSlotSize;
+
+                ulong sequence = oView.ReadUInt64(slot);
+                Thread.MemoryBarrier();
+
+                if (sequence != 2 * current + 2)
+                {
+                    iDroppedFrames++;
+                    continue;
+                }
+
+                int type = oView.ReadInt32(slot + messageTypeOffset);
+                int size = oView.ReadInt32(slot + frameSizeOffset);
+
+                if (size < FrameHeader.Size || size > iSlotSize - slotHeaderSize)
+                {
+                    iDroppedFrames++;
+                    continue;
+                }
+
+                byte[] data = new byte[size];
+                oView.ReadArray(slot + slotHeaderSize, data, 0, size);
+
+                //If the client came around while we were copying, the copy is torn
+                Thread.MemoryBarrier();
+
+                if (oView.ReadUInt64(slot) != sequence)
+                {
+                    iDroppedFrames++;
+                    continue;
+                }
+
+                messageType = type;
+                frame = data;
+                return true;
+            }
+
+            return false;
+        }
+
+        ulong ReadPublished()
+        {
+            ulong published = oView.ReadUInt64(publishedOffset);
+            Thread.MemoryBarrier();
+            return published;
+        }
+
+        public void Dispose()
+        {
+            if (oView != null)
+                oView.Dispose();
+
+            if (oFile != null)
+                oFile.Dispose();
+
+            oView = null;
+            oFile = null;
+            sName = "";
+        }
+    }
+}
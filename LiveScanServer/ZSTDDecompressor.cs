@@ -8,7 +8,7 @@ using size_t = System.UIntPtr;
 
 namespace LiveScanServer
 {
-    static class ZSTDDecompressor
+    public static class ZSTDDecompressor
     {
         private const string dllName = "libzstd.dll";
 
@@ -19,6 +19,29 @@ namespace LiveScanServer
         public static extern size_t ZSTD_decompress(IntPtr dst, size_t dstSize, 
             IntPtr src, size_t srcSize);
 
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern uint ZSTD_isError(size_t code);
+
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr ZSTD_createDCtx();
+
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern size_t ZSTD_freeDCtx(IntPtr dctx);
+
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern size_t ZSTD_decompressDCtx(IntPtr dctx, IntPtr dst, size_t dstSize,
+            IntPtr src, size_t srcSize);
+
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr ZSTD_createDDict(byte[] dictBuffer, size_t dictSize);
+
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern size_t ZSTD_freeDDict(IntPtr ddict);
+
+        [DllImport(dllName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern size_t ZSTD_decompress_usingDDict(IntPtr dctx, IntPtr dst, size_t dstSize,
+            IntPtr src, size_t srcSize, IntPtr ddict);
+
         public static byte[] Decompress(byte []array)
         {
             int size = array.Count();
@@ -37,5 +60,55 @@ namespace LiveScanServer
             Marshal.FreeHGlobal(outPtr);
             return outArray;
         }
+
+        /// <summary>
+        /// Decompresses a frame whose uncompressed size is already known, like the streamed frames of the clients.
+        /// Returns null if the data could not be decompressed
+        /// </summary>
+        public static byte[] Decompress(byte[] array, int outSize)
+        {
+            byte[] outArray = new byte[outSize];
+
+            GCHandle inHandle = GCHandle.Alloc(array, GCHandleType.Pinned);
+            GCHandle outHandle = GCHandle.Alloc(outArray, GCHandleType.Pinned);
+
+            size_t result = ZSTD_decompress(outHandle.AddrOfPinnedObject(), (size_t)outSize, inHandle.AddrOfPinnedObject(), (size_t)array.Length);
+
+            inHandle.Free();
+            outHandle.Free();
+
+            if (ZSTD_isError(result) != 0 || (int)(ulong)result != outSize)
+                return null;
+
+            return outArray;
+        }
+
+        /// <summary>
+        /// Like Decompress(array, outSize), but reuses a context from ZSTD_createDCtx() and decompresses with a dictionary
+        /// from ZSTD_createDDict(). IntPtr.Zero as the dictionary decompresses without one.
+        /// Returns null if the data could not be decompressed
+        /// </summary>
+        public static byte[] Decompress(byte[] array, int outSize, IntPtr context, IntPtr dictionary)
+        {
+            byte[] outArray = new byte[outSize];
+
+            GCHandle inHandle = GCHandle.Alloc(array, GCHandleType.Pinned);
+            GCHandle outHandle = GCHandle.Alloc(outArray, GCHandleType.Pinned);
+
+            size_t result;
+
+            if (dictionary != IntPtr.Zero)
+                result = ZSTD_decompress_usingDDict(context, outHandle.AddrOfPinnedObject(), (size_t)outSize, inHandle.AddrOfPinnedObject(), (size_t)array.Length, dictionary);
+            else
+                result = ZSTD_decompressDCtx(context, outHandle.AddrOfPinnedObject(), (size_t)outSize, inHandle.AddrOfPinnedObject(), (size_t)array.Length);
+
+            inHandle.Free();
+            outHandle.Free();
+
+            if (ZSTD_isError(result) != 0 || (int)(ulong)result != outSize)
+                return null;
+
+            return outArray;
+        }
     }
 }
@@ -23,9 +23,15 @@ public:
 	SYNC_STATE eHardwareSyncState;
 	int nSyncOffset;
 	int nGlobalDeviceIndex;
-	static const int byteLength = 42;//Expected length of the serialized form sent over the network. 
+	static const int byteLength = 48;//Expected length of the serialized form sent over the network. 
 	bool filter_depth_map;
 	int filter_depth_map_size = 5;
+	int color_decode_scale = 1; //The color image is decoded at 1/color_decode_scale of its resolution. Can be 1, 2, 4 or 8
+	bool decode_color_to_yuv = false; //In pointcloud mode, only convert the colors of the points that survive the culling
+	bool filter_flying_pixels = false; //Removes depth pixels that jump away from a neighbour, see DepthFilter
+	int flying_pixel_threshold = 5; //Maximum depth difference to a neighbour, in percent of the depth. Also used to separate the components
+	bool filter_small_components = false; //Removes regions of continuous depth that are smaller than small_component_size pixels
+	int small_component_size = 50;
 	char* ToBytes();
 	void SetFromBytes(char* received);
 	void Save();
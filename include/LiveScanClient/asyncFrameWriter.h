@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <k4a/k4a.h>
+#include "frameBufferPool.h"
+#include "frameFileWriterReader.h"
+
+/// <summary>
+/// What happens to a recorded frame when the disk can't keep up and the queue of the writer is full
+/// </summary>
+enum WRITE_QUEUE_POLICY
+{
+	WQ_BLOCK = 0, //The sink stage waits for room in the queue. Nothing that is recorded gets lost, but the pipeline drops frames at the acquisition instead
+	WQ_DROP = 1 //The frame is not recorded. Live frames and the preview keep going
+};
+
+struct AsyncWriterStats
+{
+	int queueDepth = 0;
+	int highWaterMark = 0; //Most frames that were waiting at once
+	int capacity = 0;
+	uint64_t framesWritten = 0;
+	uint64_t framesDropped = 0;
+	uint64_t writeErrors = 0;
+	uint64_t bytesWritten = 0;
+	float bytesPerSecond = 0; //What came in since the stats were reset
+	float diskBytesPerSecond = 0; //How fast the writes went, while there was something to write
+	uint64_t blockedMilliseconds = 0; //How long the sink had to wait for room in the queue
+};
+
+/// <summary>
+/// Writes the recorded frames on a thread of its own, so that a slow or stalling disk doesn't hold up the sink stage of the pipeline.
+/// The writer copies the points of a pointcloud into a buffer of its own that only holds as many points as the frame has,
+/// instead of keeping the pooled buffer, which has room for every pixel of the camera. These copies are reused for the next frames.
+/// Of a raw frame, it takes its own reference of the MJPEG and depth images, which it releases once the frame is written. The queue is double buffered: the sink appends to one list while the writer thread
+/// works through the other, so that the two only contend for the lock when the lists are swapped.
+/// Pointclouds and raw frames go through the FrameFileWriterReader, which collects them into large sequential writes.
+/// Everything else that uses the FrameFileWriterReader must only happen after Flush(), while nothing new is queued.
+/// </summary>
+class AsyncFrameWriter
+{
+public:
+	AsyncFrameWriter(FrameFileWriterReader* fileWriter, int queueCapacity);
+	~AsyncFrameWriter();
+
+	void SetPolicy(WRITE_QUEUE_POLICY policy);
+	bool WritePointcloudFrame(FrameBuffer* frame, uint64_t timestamp, int deviceID);
+	bool WriteRawFrame(k4a_image_t colorImageMJPG, k4a_image_t depthImage, int frameIndex, uint64_t timestamp, int deviceID);
+	void Flush();
+
+	AsyncWriterStats GetStats();
+	std::string GetStatsString();
+	void ResetStats();
+
+private:
+	struct PointcloudCopy
+	{
+		std::vector<Point3s> vertices;
+		std::vector<RGBA> colors;
+	};
+
+	struct WriteJob
+	{
+		PointcloudCopy* pointcloud;
+		k4a_image_t colorImageMJPG;
+		k4a_image_t depthImage;
+		uint64_t timestamp;
+		int deviceID;
+		int frameIndex;
+		size_t bytes; //Of raw frames only, pointclouds count what the file writer appended for them
+	};
+
+	bool Enqueue(const WriteJob& job);
+	void WriterThreadFunction();
+	bool WriteJobToDisk(const WriteJob& job);
+	void ReleaseJob(WriteJob& job);
+
+	FrameFileWriterReader* m_pFileWriter;
+	std::thread m_WriterThread;
+
+	std::mutex m_mQueue;
+	std::condition_variable m_cvWork; //Signals the writer thread that there are new jobs
+	std::condition_variable m_cvDone; //Signals waiting producers and Flush() that a job has been written
+	std::vector<WriteJob> m_vPending; //Filled by the sink
+	std::vector<WriteJob> m_vWriting; //Only touched by the writer thread
+	std::vector<PointcloudCopy*> m_vFreeCopies; //Copies of pointclouds that have been written, guarded by m_mQueue
+	int m_nQueued; //Pending and being written, this is what the capacity limits
+	const int m_nCapacity;
+	WRITE_QUEUE_POLICY m_ePolicy;
+	bool m_bRunning;
+
+	//Guarded by m_mQueue
+	int m_nHighWaterMark;
+	uint64_t m_nFramesWritten;
+	uint64_t m_nFramesDropped;
+	uint64_t m_nWriteErrors;
+	uint64_t m_nBytesWritten;
+	std::chrono::steady_clock::duration m_tWriting;
+	std::chrono::steady_clock::duration m_tBlocked;
+	std::chrono::steady_clock::time_point m_tStatsReset;
+};
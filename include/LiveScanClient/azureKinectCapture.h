@@ -2,6 +2,8 @@
 #include "ICapture.h"
 #include <opencv2/opencv.hpp>
 #include "turbojpeg/turbojpeg.h"
+#include "depthFilter.h"
+#include "backgroundModel.h"
 #include <chrono>
 
 class AzureKinectCapture : public ICapture
@@ -19,10 +21,14 @@ public:
 	virtual void SetManualDeviceIndex(int index);
 
 	virtual bool AquireRawFrame();
+	virtual bool DetachRawFrame(RawFrame& frame);
+	virtual void AttachRawFrame(RawFrame& frame);
 	void DecodeRawColor();
+	bool DecodeRawColorToYUV();
 	void DownscaleColorImgToDepthImgSize();
 	void MapDepthToColor();
 	void GeneratePointcloud();
+	void GenerateDepthNativePointcloud();
 	void PointCloudImageToPoint3f(Point3f* pCameraSpacePoints);
 
 	virtual bool AquireSerialFromDevice();
@@ -33,22 +39,55 @@ public:
 	virtual bool GetIntrinsicsJSON(std::vector<uint8_t>& calibration_buffer, size_t& calibration_size);
 	virtual void SetConfiguration(KinectConfiguration& configuration);
 	virtual void SetWhiteBalanceState(bool enableAutoBalance, int kelvin);
-	virtual void SetFilters(bool enableDepthFilter, int depthFilterSize);
+	virtual void SetFilters(KinectConfiguration& configuration);
+	virtual void LearnBackground(int frames);
+	virtual void AddBackgroundFrame();
+	virtual void ClearBackground();
+	virtual bool LoadBackground();
+	virtual void SetBackgroundTolerance(float sigmas);
+	virtual void SetColorDecodeScale(int scale);
+	virtual void SetCullBounds(const Matrix4x4& toWorld, const float* bounds);
 
 protected:
+	void CreateColorTransformation();
+	void CreateDepthRayLUT(const k4a_calibration_t& calibration);
+	void CreatePointCloudImage(int width, int height);
+	void FilterDepthImage();
+	void UpdateCullROIs();
+
 	k4a_device_t kinectSensor = NULL;
 	int32_t captureTimeoutMs = 1000;
 	k4a_image_t depthImageInColor = NULL;
 	k4a_image_t colorImageDownscaled = NULL;
 	k4a_transformation_t transformationColorDownscaled = NULL;
 	k4a_transformation_t transformation = NULL;  
+	RawFrame aquiredFrame;
 	LogBuffer logBuffer;
-	Log* log;
+	Log* log = NULL;
 	std::string serialNumber;
 
 	int colorImageDownscaledWidth;
 	int colorImageDownscaledHeight;
 
+	k4a_calibration_t cameraCalibration;
+	int colorDecodeScale = 1; //The color image is decoded at 1/colorDecodeScale of its size, transformation always matches this size
+
+	std::vector<Point3f> depthRaysInColorSpace; //For every depth pixel, the direction of its ray (at 1mm depth) rotated into color camera space
+	float depthToColorTranslation[3] = { 0, 0, 0 };
+	k4a_calibration_camera_t colorCameraCalibration;
+
+	bool cullBoundsSet = false;
+	Matrix4x4 colorFromWorld; //Inverse of the toWorld transformation of the pointcloud, from world space (in m) to color camera space (in mm)
+	float cullBounds[6] = { 0, 0, 0, 0, 0, 0 };
+	CullROI colorCullROI; //ROI for pointclouds at color resolution
+	CullROI depthCullROI; //ROI for pointclouds at depth resolution
+
+	DepthFilter depthFilter;
+	bool depthImageFiltered = false;
+
+	BackgroundModel backgroundModel;
+	bool backgroundMismatchLogged = false; //The model was learned at another depth resolution than the current one
+
 	bool syncInConnected = false;
 	bool syncOutConnected = false;
 	uint64_t currentTimeStamp = 0;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// The static scenery one camera sees (walls, floor, rigging), learned from frames of the empty scene as the mean and the standard deviation
+/// of the depth of every pixel. Pixels of later frames whose depth lies within the tolerance of the mean are background and get removed
+/// from the depth image before it is transformed, just like the DepthFilter removes unreliable pixels.
+/// Pixels that had no valid depth in most of the learning frames have no model, so everything that appears there is kept.
+/// The model is stored as temp/background_[serial].bin, next to the calibration of the camera.
+/// Learning and subtracting happen on the decode stage of the pipeline, every other call must only happen while the pipeline is flushed.
+/// </summary>
+class BackgroundModel
+{
+public:
+	void StartLearning(int frames);
+	bool AddFrame(const uint16_t* depth, int width, int height);
+	void Clear();
+
+	bool IsLearning() const { return m_nFramesToLearn > 0; }
+	bool IsValid() const { return !m_vMean.empty(); }
+	bool Matches(int width, int height) const { return width == m_nWidth && height == m_nHeight; }
+	int GetModeledPixelsPercent() const;
+
+	void SetTolerance(float sigmas);
+	bool Subtract(uint16_t* depth, int width, int height);
+
+	bool Save(const std::string& serialNumber) const;
+	bool Load(const std::string& serialNumber);
+	static void Delete(const std::string& serialNumber);
+
+private:
+	void FinishLearning();
+	void UpdateThresholds();
+	static std::string GetPath(const std::string& serialNumber);
+
+	int m_nWidth = 0;
+	int m_nHeight = 0;
+	float m_fTolerance = 3.0f; //In standard deviations
+
+	//While learning: The running mean and the sum of the squared differences to it (Welford), and the number of valid samples per pixel
+	int m_nFramesToLearn = 0;
+	int m_nFramesLearned = 0;
+	std::vector<float> m_vRunningMean;
+	std::vector<float> m_vRunningSquares;
+	std::vector<uint16_t> m_vSamples;
+
+	//The finished model, the mean is 0 for pixels without a model
+	std::vector<float> m_vMean;
+	std::vector<float> m_vDeviation;
+
+	//The depth range of the background of every pixel, derived from the model and the tolerance
+	std::vector<uint16_t> m_vLower;
+	std::vector<uint16_t> m_vUpper;
+};
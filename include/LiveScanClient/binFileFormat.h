@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+//Layout of the .bin recordings since version 2, written by FrameFileWriterReader, read by MappedFrameFile and FrameFileReaderBin.cs in the player:
+//BinFileHeader, then for each frame a BinFrameHeader followed by its data, then the offset of every frame header as uint64 and the BinFileFooter.
+//Files with compressed frames may carry the zstd dictionary of the take right after the BinFileHeader, the first frame starts after it.
+//Version 1 files have no file header and text lines in front of each frame instead, they can still be read.
+const uint32_t binFileMagic = 0x4E42534C; //"LSBN"
+const uint32_t binFileVersion = 2;
+const uint32_t binFrameMagic = 0x4D52464C; //"LFRM"
+
+enum BIN_COMPRESSION
+{
+	BC_NONE = 0, //All vertices of the frame, then all of its colors
+	BC_ZSTD_COLUMNAR = 1 //The frame in the columnar encoding of frameEncoding.h (without the alpha of the colors), compressed with zstd and the dictionary of the file, if it has one
+};
+
+enum BIN_FILE_FLAGS
+{
+	BF_DICTIONARY = 1 //The zstd dictionary follows the BinFileHeader and fills the rest of the header
+};
+
+struct BinFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize; //Where the first frame starts
+	uint32_t frameHeaderSize;
+	int32_t deviceIndex;
+	uint32_t flags; //BIN_FILE_FLAGS
+};
+
+struct BinFrameHeader
+{
+	uint32_t magic; //binFrameMagic, so that rebuilding the index of a file that wasn't closed properly stops at the first thing that isn't a frame
+	int32_t pointCount;
+	int32_t compression; //BIN_COMPRESSION
+	uint32_t reserved; //Zero
+	uint64_t timestamp; //Device timestamp in microseconds
+	uint64_t dataSize; //Bytes of data that follow the header
+};
+
+//Ends a file that was closed properly. Files that weren't, for example because the client crashed while recording, have their index rebuilt from the frame headers
+struct BinFileFooter
+{
+	uint64_t indexOffset;
+	uint32_t frameCount;
+	uint32_t magic;
+};
+
+static_assert(sizeof(BinFileHeader) == 24 && sizeof(BinFrameHeader) == 32 && sizeof(BinFileFooter) == 16, "The layout is shared with the player");
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+/// <summary>
+/// What the CompressionController currently uses, and what it measured over its last window of frames
+/// </summary>
+struct CompressionStats
+{
+	int level = 0;
+	int workers = 1;
+	float compressMs = 0; //Average time per frame spent compressing
+	float sendMs = 0; //Average time per frame the socket blocked while sending
+	float ratio = 0; //Uncompressed bytes / sent bytes
+	float sentMBps = 0; //Sent bytes over the time spent sending them, what the link achieved
+	int adjustments = 0; //How often the level or the workers changed since the last reset
+};
+
+/// <summary>
+/// Picks the zstd level and the number of compression workers for the frames that are sent to the server.
+/// The level set on the server is only where it starts: After every window of frames it compares the time a frame took to compress
+/// and to send against the frame interval of the camera, and then:
+/// - Over budget and waiting mostly on the socket: The link is the bottleneck, so it compresses harder to send less.
+/// - Over budget and busy mostly compressing: It adds workers, or lowers the level once all workers are in use.
+/// - Well under budget: It gives workers back, or raises the level to save bandwidth. A level that already overran the budget
+///   is not tried again for a while, so it doesn't bounce between two levels.
+/// Not thread safe except for GetStatsTS(), it's meant to be driven from the thread that sends the frames.
+/// </summary>
+class CompressionController
+{
+public:
+	CompressionController();
+
+	void Reset(int level);
+	void SetFrameInterval(float frameIntervalMs);
+	bool AddFrame(double compressMs, double sendMs, int uncompressedBytes, int sentBytes);
+
+	int GetLevel() const { return m_nLevel; }
+	int GetWorkers() const { return m_nWorkers; }
+	const std::string& GetLastDecision() const { return m_sLastDecision; }
+
+	CompressionStats GetStatsTS();
+	std::string GetStatsString();
+
+private:
+	bool Adjust(double compressMs, double sendMs);
+
+	int m_nLevel;
+	int m_nWorkers;
+	int m_nMaxWorkers;
+	float m_fBudgetMs;
+
+	//The lowest level that overran the budget because of compression, and for how many more windows we stay below it
+	int m_nLevelCeiling;
+	int m_nCeilingWindows;
+
+	int m_nWindowFrames;
+	double m_dWindowCompressMs;
+	double m_dWindowSendMs;
+	double m_dWindowUncompressedBytes;
+	double m_dWindowSentBytes;
+
+	std::string m_sLastDecision;
+
+	std::mutex m_mStats;
+	CompressionStats m_Stats;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "KinectConfiguration.h"
+
+/// <summary>
+/// Removes unreliable pixels from the depth image before it gets transformed, so that they don't cost transformation,
+/// compression and storage downstream. All buffers are kept between frames, so no allocations happen while capturing.
+/// The filters are enabled in the KinectConfiguration and run in this order:
+/// 1. Flying pixels: Pixels whose depth jumps away from one of their neighbours by more than a percentage of their own depth.
+///    These are the points smeared between foreground and background along depth edges.
+/// 2. Small components: Regions of continuous depth with less pixels than the minimum size, mostly specks that are left floating
+///    after the flying pixels have been removed.
+/// 3. Erosion: The rectangular erosion of the depth map.
+/// </summary>
+class DepthFilter
+{
+public:
+	void Apply(uint16_t* depth, int width, int height, const KinectConfiguration& configuration);
+
+	void RemoveFlyingPixels(uint16_t* depth, int width, int height, int maxJumpPercent);
+	void RemoveSmallComponents(uint16_t* depth, int width, int height, int maxJumpPercent, int minComponentSize);
+	void Erode(uint16_t* depth, int width, int height, int kernelSize);
+
+private:
+	std::vector<uint16_t> m_vPaddedDepth; //Copy of the depth image with a border of invalid pixels, so every pixel has four neighbours
+	std::vector<int32_t> m_vComponentLabels;
+	std::vector<int> m_vComponentPixels;
+
+	cv::Mat m_ErodedDepth;
+	cv::Mat m_ErosionKernel;
+	int m_nErosionKernelSize = 0;
+};
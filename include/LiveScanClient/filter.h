@@ -14,49 +14,59 @@
 //    }
 #pragma once
 
+#include <stdint.h>
 #include <vector>
 
-#include "nanoflann.h"
 #include "utils.h"
 
-struct KNNeighborsResult
+/// <summary>
+/// Removes isolated points from a culled pointcloud, before it is stored or sent.
+/// A point is an outlier if less than minNeighbors other points lie within radius millimeters of it.
+/// The neighbours are found in a voxel hash with a cell size of the radius, so only the 27 cells around each point need to be searched
+/// and the whole filter runs in linear time. All buffers are kept between frames, so no allocations happen while capturing.
+/// </summary>
+class OutlierFilter
 {
-	std::vector<size_t> neighbors;
-	std::vector<float> distances;
-	float kDistance;
+public:
+	int Apply(Point3s* vertices, RGBA* colors, int count, int radius, int minNeighbors);
+
+private:
+	std::vector<uint32_t> m_vPointBuckets; //Hash bucket of the voxel of each point
+	std::vector<int> m_vBucketStarts; //Start of each bucket in m_vSortedVertices, has one more entry than there are buckets
+	std::vector<Point3s> m_vSortedVertices; //The vertices grouped by their bucket, so that each neighbour search reads contiguous memory
+	std::vector<int> m_vSortedIndices; //Index of each sorted vertex in the input
+	std::vector<uint8_t> m_vKeep;
 };
 
-struct PointCloud
+/// <summary>
+/// Downsamples a culled pointcloud to one point per voxel of the leaf size, at the average position and color of the points in it.
+/// The voxels are found through an open addressing hash of their coordinates and keep the order in which their first point came in,
+/// so the output still runs along the image rows like the input.
+/// With a point budget, the leaf size is raised until the frame fits into it, so that the frame size no longer depends on how close
+/// the performer stands to the camera. The raised leaf size carries over to the next frames and only slowly shrinks back once they
+/// stay well below the budget. All buffers are kept between frames, so no allocations happen while capturing.
+/// </summary>
+class VoxelGridFilter
 {
-	std::vector<Point3f> pts;
+public:
+	int Apply(Point3s* vertices, RGBA* colors, int count, int leafSize, int pointBudget);
+	float GetLeafSize() const { return m_fLeafSize; }
 
-	// Must return the number of data points
-	inline size_t kdtree_get_point_count() const { return pts.size(); }
-	// Returns the distance between the vector "p1[0:size-1]" and the data point with index "idx_p2" stored in the class:
-	inline float kdtree_distance(const float *p1, const size_t idx_p2, size_t /*size*/) const
-	{
-		const float d0 = p1[0] - pts[idx_p2].X;
-		const float d1 = p1[1] - pts[idx_p2].Y;
-		const float d2 = p1[2] - pts[idx_p2].Z;
-
-		return d0*d0 + d1*d1 + d2*d2;
-	}
-	// Returns the dim'th component of the idx'th point in the class:
-	// Since this is inlined and the "dim" argument is typically an immediate value, the
-	// "if/else's" are actually solved at compile time.
-	inline float kdtree_get_pt(const size_t idx, int dim) const
+private:
+	struct Voxel
 	{
-		if (dim == 0) return pts[idx].X;
-		else if (dim == 1) return pts[idx].Y;
-		else return pts[idx].Z;
-	}
-	// Optional bounding-box computation: return false to default to a standard bbox computation loop.
-	// Return true if the BBOX was already computed by the class and returned in "bb" so it can be avoided to redo it again.
-	// Look at bb.size() to find out the expected dimensionality (e.g. 2 or 3 for point clouds)
-	template <class BBOX>
-	bool kdtree_get_bbox(BBOX& /*bb*/) const { return false; }
-};
+		int64_t x, y, z;
+		uint32_t red, green, blue;
+		int count;
+		int firstPoint;
+	};
 
-typedef nanoflann::KDTreeSingleIndexAdaptor<nanoflann::L2_Simple_Adaptor<float, PointCloud>, PointCloud, 3> kdTree;
+	int Voxelize(const Point3s* vertices, const RGBA* colors, int count, float leafSize);
 
-void filter(std::vector<Point3f> &vertices, std::vector<RGBA> &colors, int k = 10, float maxDist = 0.01);
\ No newline at end of file
+	float m_fBudgetLeafSize = 0; //Raised leaf size that keeps the frames within the point budget, 0 while it isn't needed
+	float m_fLeafSize = 0; //Leaf size the last frame was downsampled with
+
+	std::vector<uint64_t> m_vTableKeys;
+	std::vector<int> m_vTableVoxels;
+	std::vector<Voxel> m_vVoxels;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "utils.h"
+
+class FrameBufferPool;
+
+/// <summary>
+/// Reference counted storage for one pointcloud frame or one preview image, borrowed from a FrameBufferPool.
+/// Every holder calls Release() when done, the last one hands the buffer back to its pool.
+/// </summary>
+class FrameBuffer
+{
+public:
+	void AddRef();
+	void Release();
+
+	Point3s* pVertices; //NULL for pools that only store colors
+	RGBA* pColors;
+	int nSize;
+	int nCapacity;
+
+private:
+	friend class FrameBufferPool;
+
+	FrameBuffer(FrameBufferPool* pool, int capacity, bool withVertices);
+	~FrameBuffer();
+
+	FrameBufferPool* m_pPool;
+	std::atomic<int> m_nReferences;
+};
+
+/// <summary>
+/// Keeps released FrameBuffers around, so that the per-frame paths don't need to allocate.
+/// All pooled buffers have the same capacity, which should be set from the camera configuration.
+/// Borrowing more points than that is possible, but these buffers are freed instead of pooled when they come back.
+/// The pool is destroyed with Dispose(), and only goes away once the last borrowed buffer has been released.
+/// </summary>
+class FrameBufferPool
+{
+public:
+	FrameBufferPool(bool withVertices);
+
+	void SetCapacity(int pointCapacity);
+	int GetCapacity();
+	FrameBuffer* Borrow(int size);
+	void Dispose();
+
+private:
+	friend class FrameBuffer;
+
+	~FrameBufferPool();
+	void Return(FrameBuffer* buffer);
+	void ClearFreeBuffers();
+
+	std::mutex m_mPool;
+	std::vector<FrameBuffer*> m_vFreeBuffers;
+	bool m_bWithVertices;
+	bool m_bDisposed;
+	int m_nCapacity;
+	int m_nBorrowed;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "zstd.h"
+
+/// <summary>
+/// Compresses frames with zstd. The compression context, the stream and the output buffer are created once and reused for every frame,
+/// instead of being set up anew by every ZSTD_compress call. Not thread safe, every thread that compresses needs its own FrameCompressor.
+/// </summary>
+class FrameCompressor
+{
+public:
+	//Receives the compressed data of a stream in pieces of at most GetStreamChunkSize() bytes
+	typedef std::function<void(const char* data, int size)> ChunkSink;
+
+	FrameCompressor();
+	~FrameCompressor();
+
+	FrameCompressor(const FrameCompressor&) = delete;
+	FrameCompressor& operator=(const FrameCompressor&) = delete;
+
+	int Compress(const char* source, int sourceSize, int level);
+	const char* GetCompressed() const { return m_vOutput.data(); }
+
+	bool CompressStream(const char* source, int sourceSize, int level, const ChunkSink& sink);
+	int GetStreamChunkSize() const { return m_nStreamChunkSize; }
+
+	int CompressParallel(const char* source, int sourceSize, int level, int workers);
+	static int GetParallelSegmentCount(int sourceSize, int workers);
+
+	static int TrainDictionary(const std::vector<char>& samples, const std::vector<size_t>& sampleSizes, int maxSize, std::vector<char>& outDictionary);
+	bool SetDictionary(const char* dictionary, int size, int level);
+	int CompressWithDictionary(const char* source, int sourceSize);
+
+private:
+	ZSTD_CCtx* m_pContext;
+	ZSTD_CDict* m_pDictionary; //Digested once for its compression level, so that every frame that uses it doesn't have to load it again
+	ZSTD_CStream* m_pStream;
+	int m_nStreamChunkSize;
+	std::vector<char> m_vOutput;
+
+	//One context per segment of CompressParallel(), created the first time that many segments are needed
+	std::vector<ZSTD_CCtx*> m_vSegmentContexts;
+	std::vector<size_t> m_vSegmentSizes;
+};
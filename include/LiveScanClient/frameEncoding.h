@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include "utils.h"
+#include "iCapture.h"
+
+/// <summary>
+/// How a pointcloud frame is laid out before it is compressed and sent to the server. Both encodings start with the number of points
+/// as an int and take 9 bytes per point, so they have the same size:
+/// FE_INTERLEAVED (v1): Per point the red, green and blue byte, followed by the X, Y and Z shorts.
+/// FE_COLUMNAR (v2): The X, Y and Z shorts as three columns, then the red, green and blue bytes as three columns.
+///    Each coordinate is stored as the difference to the one of the previous point, which is small as the points follow the scanlines
+///    of the camera. The differences are byte-shuffled, all low bytes of the column first, then all high bytes, so that zstd sees
+///    long runs of similar bytes.
+/// FE_BIN_FILE: The number of points, followed by all X, Y and Z shorts and then all colors as RGBA, just as they are stored in a .bin file.
+///    Takes 10 bytes per point. Only sent by the bulk transfer of the stored frames, when it sends the points straight from the file.
+/// Also copied to ServerUtils.cs on the server.
+/// </summary>
+enum FRAME_ENCODING
+{
+	FE_INTERLEAVED,
+	FE_COLUMNAR,
+	FE_BIN_FILE
+};
+
+int GetEncodedFrameSize(int pointCount);
+void EncodeFrame(FRAME_ENCODING encoding, const Point3s* vertices, const RGBA* colors, int pointCount, char* outBuffer);
+bool DecodeFrame(FRAME_ENCODING encoding, const char* buffer, int bufferSize, Point3s* outVertices, RGBA* outColors, int maxPoints, int& outPointCount);
+
+/// <summary>
+/// Encodes and compresses the pointclouds of a running (virtual) capture with both encodings, and reports the compression ratio
+/// and the encode and decode throughput of each. Also checks that the decoded frames match the originals
+/// </summary>
+std::string BenchmarkFrameEncoding(ICapture* capture, int frames, int compressionLevel);
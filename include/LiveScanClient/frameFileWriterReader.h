@@ -15,6 +15,11 @@
 #include <assert.h>
 #include "Log.h"
 #include "utils.h"
+#include "frameBufferPool.h"
+#include "mappedFrameFile.h"
+#include "sequentialFileWriter.h"
+#include "frameCompressor.h"
+#include "rawRecordingFile.h"
 
 class FrameFileWriterReader
 {
@@ -29,15 +34,26 @@ public:
 	void SetRecordingDirPath(std::string path);
 	bool CreateRecordDirectory(std::string dirToCreate, int deviceID);
 	bool DirExists(std::string path);
-
-	bool writeNextBinaryFrame(Point3s* points, int pointsSize, RGBA* colors, uint64_t timestamp, int deviceID);
-	bool readNextBinaryFrame(Point3s*& outPoints, RGBA*& outColors, int& outPointsSize, int& outTimestamp);
+	void SetWriteOptions(uint64_t preallocateBytes, bool unbuffered, bool compress);
+
+	bool writeNextBinaryFrame(const Point3s* points, int pointsSize, const RGBA* colors, uint64_t timestamp, int deviceID);
+	uint64_t getAppendedFrameBytes() { return m_nAppendedFrameBytes; }
+	bool readNextBinaryFrame(FrameBufferPool* pool, FrameBuffer*& outFrame, uint64_t& outTimestamp);
+	bool readNextBinaryFrameView(BinFrameView& outFrame, bool decode = true);
+	int getLastReadFrameID() { return m_nCurrentReadFrameID - 1; }
+	FILE* getSendFileHandle() { return m_bFileOpenedForReading ? m_pFileHandle : nullptr; }
+	const char* getDictionary() { return m_MappedFile.GetDictionary(); }
+	int getDictionarySize() { return m_MappedFile.GetDictionarySize(); }
 	void seekBinaryReaderToFrame(int frameID);
 	void skipOneFrameBinaryReader();
 
+	bool writeNextRawFrame(const void* colorMJPG, size_t colorSize, const uint16_t* depth, int depthWidth, int depthHeight, size_t depthStrideBytes, int frameIndex, uint64_t timestamp, int deviceID);
+	void closeRawFileIfOpened();
+	bool PostSyncRawFile(const std::vector<int>& frameIDs, const std::vector<int>& syncedFrameIDs, const std::vector<unsigned char>& emptyColorJPG);
+	bool ExtractRawFile(std::string path, int& outFrames);
+
 	void WriteColorJPGFile(void* buffer, size_t bufferSize, int frameIndex, std::string optionalPrefix);
-	void WriteDepthTiffFile(const k4a_image_t& im, int frameIndex, std::string optionalPrefix);
-	bool RenameRawFramePair(int oldFrameIndex, int newFrameIndex, std::string optionalPrefix);
+	void WriteDepthTiffFile(const uint16_t* depth, int width, int height, size_t strideBytes, int frameIndex, std::string optionalPrefix);
 
 	void WriteTimestampLog(std::vector<int> frames, std::vector<uint64_t> timestamps, int deviceIndex);
 	void WriteCalibrationJSON(int deviceIndex, const std::vector<uint8_t> calibration_buffer, size_t calibration_size);
@@ -56,14 +72,54 @@ private:
 	void resetTimer();
 	int getRecordingTimeMilliseconds();
 	bool CreateDir(const std::filesystem::path dirToCreate);
-
-	FILE *m_pFileHandle = nullptr;
+	void openMappedFile(std::string path);
+	std::string makeRecordingFileName(int deviceID, std::string prefix, std::string extension);
+	void writeFrameIndex();
+	void writeFileHeader(const std::vector<char>& dictionary);
+	bool writeCompressedFrame(const char* encodedFrame, int encodedSize, int pointCount, uint64_t timestamp);
+	void writeHeldBackFrames();
+
+	FILE *m_pFileHandle = nullptr; //Only while reading, for sending frames straight from the file. The frames themselves are read through the mapping
 	bool m_bFileOpenedForWriting = false;
 	bool m_bFileOpenedForReading = false;
 	int m_nCurrentReadFrameID = 0;
 
+	//Frames are read in place from the mapping, the file handle is only kept open for reading so that frames can be sent straight from it
+	MappedFrameFile m_MappedFile;
+
+	//Frames are collected into large sequential writes. The options are used for the next file that is opened for writing
+	SequentialFileWriter m_BinFileWriter;
+	uint64_t m_nPreallocateBytes = 0;
+	bool m_bUnbufferedWrites = false;
+	bool m_bCompressFrames = false;
+	int m_nWriteDeviceID = 0;
+
+	//Compressed files only get their header once the dictionary has been trained on their first frames, which are held back until then
+	struct HeldBackFrame
+	{
+		std::vector<char> encoded;
+		int pointCount;
+		uint64_t timestamp;
+	};
+
+	bool m_bCompressingFile = false;
+	bool m_bFileHeaderWritten = false;
+	std::vector<HeldBackFrame> m_vHeldBackFrames;
+	FrameCompressor m_Compressor;
+	std::vector<char> m_vEncodedFrame;
+	uint64_t m_nUncompressedFrameBytes = 0;
+	uint64_t m_nCompressedFrameBytes = 0;
+	uint64_t m_nAppendedFrameBytes = 0; //Headers and data of all frames appended to .bin files, compressed or not. Never reset
+
+	//Offset of the header of every frame written so far, written as the index when the file is closed
+	std::vector<uint64_t> m_vFrameOffsets;
+
 	std::string m_sBinFilePath = "";
 
+	//Raw frames go into a single file per take as well, instead of a JPG and a TIFF file per frame. Uses the same write options as the .bin file
+	RawRecordingFile m_RawFile;
+	std::string m_sRawFilePath = "";
+
 	std::string m_sFrameRecordingsDir = "";
 
 	std::chrono::steady_clock::time_point recording_start_time;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum FRAME_HEADER_FLAGS
+{
+	FHF_CHECKSUM = 1 //Not set for frames that are sent straight from the .bin file, as their points never pass through memory
+};
+
+/// <summary>
+/// Follows the message type of every frame the client sends, over the socket as well as in the shared memory, and is followed by the payload.
+/// It tells the server which device took the frame and when, so that it can line up the frames of several devices and drop stale ones
+/// without asking the client. The checksum covers the uncompressed payload, so a frame that was corrupted or mixed up on the way is
+/// dropped instead of being fused. Also copied to FrameHeader.cs on the server
+/// </summary>
+struct FrameHeader
+{
+	int32_t payloadSize; //Bytes that follow the header, for FC_ZSTD_STREAM the uncompressed size. -1 ends the bulk transfer of the stored frames
+	int32_t compression; //FRAME_COMPRESSION
+	int32_t encoding; //FRAME_ENCODING, the version of the payload layout
+	int32_t pointCount;
+	uint64_t timestamp; //Device timestamp in microseconds. When the devices are temporally synced, they share the same clock
+	int32_t frameIndex; //Counts the frames the client acquired since it started, or the position of a stored frame in the .bin file
+	int32_t deviceIndex; //The global device index the server assigned to the client
+	uint32_t checksum; //XXH32 of the uncompressed payload, with a seed of 0
+	uint32_t flags; //FRAME_HEADER_FLAGS
+};
+
+static_assert(sizeof(FrameHeader) == 40, "The layout is shared with the server");
+
+uint32_t XXHash32(const void* data, size_t size, uint32_t seed);
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <string>
+#include "ICapture.h"
+#include "utils.h"
+#include "frameBufferPool.h"
+
+/// <summary>
+/// A bounded, lock-free ring buffer for exactly one producer thread and exactly one consumer thread.
+/// Push() may only be called from the producer, Pop() only from the consumer.
+/// </summary>
+template<typename T>
+class SPSCRing
+{
+public:
+	SPSCRing(size_t capacity) : m_vBuffer(capacity), m_nCapacity(capacity), m_nHead(0), m_nTail(0) {}
+
+	bool Push(const T& item)
+	{
+		size_t head = m_nHead.load(std::memory_order_relaxed);
+
+		if (head - m_nTail.load(std::memory_order_acquire) == m_nCapacity)
+			return false;
+
+		m_vBuffer[head % m_nCapacity] = item;
+		m_nHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T& item)
+	{
+		size_t tail = m_nTail.load(std::memory_order_relaxed);
+
+		if (tail == m_nHead.load(std::memory_order_acquire))
+			return false;
+
+		item = m_vBuffer[tail % m_nCapacity];
+		m_nTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t Size() const
+	{
+		return m_nHead.load(std::memory_order_acquire) - m_nTail.load(std::memory_order_acquire);
+	}
+
+	bool Empty() const { return Size() == 0; }
+	size_t Capacity() const { return m_nCapacity; }
+
+private:
+	std::vector<T> m_vBuffer;
+	const size_t m_nCapacity;
+	std::atomic<size_t> m_nHead;
+	std::atomic<size_t> m_nTail;
+};
+
+/// <summary>
+/// One frame travelling through the pipeline. The slots are allocated once and then recycled,
+/// so that the buffers they own (decoded color, pointcloud image, culled vertices) are reused from frame to frame.
+/// </summary>
+struct FrameSlot
+{
+	//Input, filled by the acquisition stage
+	RawFrame raw;
+	int frameIndex = 0; //Sent to the server in the FrameHeader
+
+	//What needs to be done with this frame. Decided once on the acquisition stage,
+	//so that later stages don't depend on flags the network thread might change in the meantime
+	bool generateRGBData = false;
+	bool generateDepthToColorData = false;
+	bool generatePointcloud = false;
+	bool depthNativePointcloud = false;
+	bool decodeColorToYUV = false;
+	bool calibrate = false;
+	bool capture = false;
+	bool sendLiveFrame = false; //Requested by the server
+	bool pushLiveFrame = false; //Pushed to a live frame subscription, which a credit has already been taken from
+	int liveFrameSubscription = 0; //The subscription the credit was taken from
+	bool learnBackground = false; //Added to the background model that is being learned
+	bool updateCullROI = false;
+	bool filterOutliers = false;
+	int outlierRadius = 0;
+	int outlierMinNeighbors = 0;
+	int voxelLeafSize = 0;
+	int pointBudget = 0;
+	CAPTURE_MODE captureMode = CM_POINTCLOUD;
+
+	//Snapshot of the world transform and bounds at the time of the acquisition
+	Matrix4x4 toWorld;
+	float bounds[6] = { 0, 0, 0, 0, 0, 0 };
+
+	//Output of the decode/transform stage
+	cv::Mat colorBGR;
+	YUVImage colorYUV;
+	k4a_image_t pointCloudImage = NULL;
+	int nColorFrameWidth = 0;
+	int nColorFrameHeight = 0;
+	cv::Mat pointCloudColorBGR;
+	int nPointCloudWidth = 0;
+	int nPointCloudHeight = 0;
+	CullROI cullROI;
+
+	//Output of the cull/compaction stage, borrowed from the pointcloud pool
+	FrameBuffer* pPointcloud = NULL;
+};
+
+enum PIPELINE_STAGE
+{
+	STAGE_ACQUISITION,
+	STAGE_DECODE,
+	STAGE_CULL,
+	STAGE_SINK,
+	STAGE_COUNT
+};
+
+struct PipelineStageStats
+{
+	int queueDepth = 0;
+	uint64_t processed = 0;
+	uint64_t dropped = 0;
+};
+
+/// <summary>
+/// Runs the processing of a frame in four stages: acquisition -> decode/transform -> cull/compaction -> sink (disk/network).
+/// The acquisition stage runs on the thread of the caller, every other stage gets its own worker thread.
+/// The stages are connected by single-producer/single-consumer rings, and used slots are returned to the acquisition
+/// stage by the sink over a ring as well, so no stage ever needs to take a lock to hand over a frame.
+/// </summary>
+class FramePipeline
+{
+public:
+	typedef std::function<void(FrameSlot*)> StageFunction;
+
+	FramePipeline(int slotCount);
+	~FramePipeline();
+
+	void Start(StageFunction decodeStage, StageFunction cullStage, StageFunction sinkStage);
+	void Stop();
+
+	FrameSlot* GetFreeSlot();
+	void Submit(FrameSlot* slot);
+	void Flush();
+	void ReleaseSlotResources();
+
+	bool HasNewerFrame(PIPELINE_STAGE stage);
+	void CountDrop(PIPELINE_STAGE stage);
+	PipelineStageStats GetStats(PIPELINE_STAGE stage);
+	std::string GetStatsString();
+
+private:
+	void StageThreadFunction(PIPELINE_STAGE stage, StageFunction function);
+	void Forward(PIPELINE_STAGE fromStage, FrameSlot* slot);
+	void RecycleSlot(FrameSlot* slot);
+
+	std::vector<FrameSlot> m_vSlots;
+
+	//m_vRings[STAGE_ACQUISITION] holds the free slots, every other ring is the input queue of its stage
+	std::vector<SPSCRing<FrameSlot*>*> m_vRings;
+	std::vector<std::thread> m_vStageThreads;
+
+	std::mutex m_mWake[STAGE_COUNT];
+	std::condition_variable m_cvWake[STAGE_COUNT];
+
+	std::atomic<uint64_t> m_nProcessed[STAGE_COUNT];
+	std::atomic<uint64_t> m_nDropped[STAGE_COUNT];
+
+	std::mutex m_mFlush;
+	std::condition_variable m_cvFlush;
+	std::atomic<int> m_nInFlight;
+
+	std::atomic<bool> m_bRunning;
+};
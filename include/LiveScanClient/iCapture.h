@@ -19,6 +19,8 @@
 #include "opencv2/opencv.hpp"
 //#include <stdint.h>
 #include "Log.h" 
+#include "yuvColor.h"
+#include "pointcloudCull.h"
 
 struct Joint
 {
@@ -38,6 +40,17 @@ struct Body
 	std::vector<Point2f> vJointsInColorSpace;
 };
 
+/// <summary>
+/// The unprocessed images of one capture. Each handle holds its own reference,
+/// so the frame stays valid after the camera has aquired the next one
+/// </summary>
+struct RawFrame
+{
+	k4a_image_t colorImageMJPG = NULL;
+	k4a_image_t depthImage16Int = NULL;
+	uint64_t timeStamp = 0;
+};
+
 class ICapture
 {
 public:
@@ -53,10 +66,14 @@ public:
 	virtual void SetManualDeviceIndex(int index) = 0; //Only used for testing devices for now
 
 	virtual bool AquireRawFrame() = 0;
+	virtual bool DetachRawFrame(RawFrame& frame) = 0;
+	virtual void AttachRawFrame(RawFrame& frame) = 0;
 	virtual void DecodeRawColor() = 0;
+	virtual bool DecodeRawColorToYUV() = 0;
 	virtual void DownscaleColorImgToDepthImgSize() = 0;
 	virtual void MapDepthToColor() = 0;
 	virtual void GeneratePointcloud() = 0;
+	virtual void GenerateDepthNativePointcloud() = 0;
 	virtual void PointCloudImageToPoint3f(Point3f* pCameraSpacePoints) = 0;
 
 	virtual bool AquireSerialFromDevice() = 0;
@@ -65,7 +82,14 @@ public:
 	virtual uint64_t GetTimeStamp() = 0;
 	virtual void SetExposureState(bool enableAutoExposure, int exposureStep) = 0;
 	virtual void SetWhiteBalanceState(bool enableAutoWhiteBalance, int kelvin) = 0;
-	virtual void SetFilters(bool enableDepthFilter, int depthFilterSize) = 0;
+	virtual void SetFilters(KinectConfiguration& configuration) = 0;
+	virtual void LearnBackground(int frames) = 0;
+	virtual void AddBackgroundFrame() = 0;
+	virtual void ClearBackground() = 0;
+	virtual bool LoadBackground() = 0;
+	virtual void SetBackgroundTolerance(float sigmas) = 0;
+	virtual void SetColorDecodeScale(int scale) = 0;
+	virtual void SetCullBounds(const Matrix4x4& toWorld, const float* bounds) = 0;
 	virtual bool GetIntrinsicsJSON(std::vector<uint8_t>& calibration_buffer, size_t& calibration_size) = 0;
 	virtual void SetConfiguration(KinectConfiguration& configuration) = 0;
 
@@ -73,12 +97,17 @@ public:
 	bool bStarted;
 
 	int nColorFrameHeight, nColorFrameWidth;
+	int nPointCloudHeight, nPointCloudWidth;
 
 	k4a_image_t colorImageMJPG;
 	k4a_image_t depthImage16Int;
 	k4a_image_t transformedDepthImage;
 	k4a_image_t pointCloudImage;
 	cv::Mat colorBGR;
+	cv::Mat pointCloudColorBGR; //Only used by depth native pointclouds, as their colors don't come from colorBGR directly
+	YUVImage colorYUV; //Replaces colorBGR when the color has been decoded with DecodeRawColorToYUV()
+	bool bColorDecodedToYUV;
+	CullROI pointCloudROI; //The part of the pointCloudImage that can lie inside the bounds. Only this part is guaranteed to be generated
 
 	std::vector<uint8_t> calibrationBuffer;
 	size_t nCalibrationSize;
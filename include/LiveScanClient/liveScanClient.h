@@ -15,6 +15,8 @@
 #pragma once
 #include "SocketCS.h" //Should always be on top, otherwise lots of definition errors
 #include <thread>
+#include <memory>
+#include <functional>
 #include <mutex>
 #include <chrono>
 #include <fstream>
@@ -24,8 +26,18 @@
 #include "calibration.h"
 #include "azureKinectCaptureVirtual.h"
 #include "frameFileWriterReader.h"
+#include "asyncFrameWriter.h"
 #include "zstd.h"
+#include "frameCompressor.h"
+#include "frameEncoding.h"
+#include "frameHeader.h"
+#include "compressionController.h"
+#include "messageFramer.h"
+#include "sharedFrameRing.h"
 #include "filter.h"
+#include "framePipeline.h"
+#include "pointcloudCull.h"
+#include "yuvColor.h"
 
 
 enum CLIENT_STATUS
@@ -65,6 +77,7 @@ public:
 
 	//Below are thread-safe functions to get different resources from this client
 	float GetFPSTS();
+	CompressionStats GetCompressionStatsTS();
 	PreviewFrame GetColorTS();
 	PreviewFrame GetDepthTS();
 	StatusMessage GetStatusMessageTS();
@@ -107,13 +120,67 @@ private:
 	bool m_bSendTimeStampList;
 	bool m_bPostSyncedListReceived;
 	bool m_bShowPreviewDuringRecording;
+	bool m_bDepthNativePointcloud;
+	bool m_bFilterOutliers;
+	int m_nOutlierRadius; //In millimeters
+	int m_nOutlierMinNeighbors;
+	int m_nVoxelLeafSize; //In millimeters, 0 disables the downsampling unless the point budget needs it
+	int m_nPointBudget; //Most points a frame may have, 0 for no limit
+	bool m_bUpdateCullROI;
 	bool m_bPreviewDisabled;
 	bool m_bRequestLiveFrame;
+
+	//Once the server subscribes, every m_nLiveFrameInterval-th frame is pushed to it without being requested.
+	//Each pushed frame uses up one of the credits the server granted, without credits they are dropped before they are even processed.
+	//The credit is taken when the frame is acquired, and given back if the frame doesn't make it through the pipeline.
+	//All of these are guarded by m_mSocketThread
+	bool m_bLiveFramesSubscribed;
+	int m_nLiveFrameInterval;
+	int m_nLiveFrameCredits;
+	int m_nLiveFrameCounter;
+	int m_nLiveFramesPushed;
+	int m_nLiveFramesDropped;
+	int m_nLiveFrameSubscription; //Counts the subscriptions, so that a credit taken under an earlier one isn't given back to the current one
+
+	//Bulk transfer of the stored frames: HandleSocket() streams them on its own, as long as fewer than m_nStoredFrameWindow
+	//of them haven't been acknowledged by the server yet. Guarded by m_mSocketThread
+	bool m_bStreamingStoredFrames;
+	int m_nStoredFramesLeft; //-1 for all remaining frames
+	int m_nStoredFrameWindow;
+	int m_nStoredFramesInFlight;
+	int m_nStoredFramesSent;
+
+	//Background subtraction, see BackgroundModel. The server's commands are carried out by UpdateFrame() once the pipeline is flushed.
+	//Guarded by m_mSocketThread, except for m_nBackgroundFramesToLearn, which only the acquisition stage uses
+	bool m_bUpdateBackground;
+	float m_fBackgroundTolerance; //In standard deviations
+	int m_nLearnBackgroundFrames;
+	bool m_bClearBackground;
+	int m_nBackgroundFramesToLearn;
 	bool m_bShowDepth;
 	bool m_bActiveClient;
 
+	cv::Mat m_PixelCoordinates; //Stands in for the color image in the culling, when the color has been decoded to YUV
+	OutlierFilter m_OutlierFilter; //Only used by the cull stage
+	std::vector<Point3s> m_vCullScratchVertices; //Only used by the cull stage, grows to the largest region of interest
+	std::vector<RGBA> m_vCullScratchColors;
+	VoxelGridFilter m_VoxelGridFilter; //Only used by the cull stage
+
 	bool m_bFrameCompression;
 	int m_iCompressionLevel;
+	bool m_bAdaptiveCompression; //m_iCompressionLevel is only the starting point for m_CompressionController then
+	FRAME_ENCODING m_eFrameEncoding;
+
+	//Only used by SendFrame() and the settings, which always run with m_mSocketThread locked
+	FrameCompressor m_FrameCompressor;
+	CompressionController m_CompressionController;
+
+	//When the server runs on the same host, frames are put into shared memory uncompressed instead of being sent over the socket.
+	//Only used once the server confirmed it could open the ring, guarded by m_mSocketThread
+	bool m_bSharedMemoryTransport;
+	bool m_bSharedFrameRingConfirmed;
+	SharedFrameRing m_SharedFrameRing;
+	std::vector<char> m_vFrameBuffer;
 
 	bool m_bAutoExposureEnabled;
 	int m_nExposureStep;
@@ -136,7 +203,21 @@ private:
 
 	FrameFileWriterReader* m_framesFileWriterReader;
 
+	//Recorded frames are written by its own thread. The write options only take effect for the next recording,
+	//they are handed to m_framesFileWriterReader once nothing is being written
+	AsyncFrameWriter* m_pFrameWriter;
+	const int m_nRecordingQueueFrames = 30;
+	WRITE_QUEUE_POLICY m_eRecordingQueuePolicy;
+	bool m_bUnbufferedRecording;
+	int m_nRecordingPreallocationMB; //0 to let the file grow as needed
+	bool m_bCompressRecording; //Pointclouds are stored compressed, with a dictionary trained on the first frames of the take
+
 	SocketClient *m_pClientSocket;
+
+	//Cuts what the socket thread receives into messages, m_vMessageHandlers holds what to do for each message type
+	typedef std::function<void(MessageReader& payload)> MessageHandler;
+	MessageFramer m_MessageFramer;
+	std::vector<MessageHandler> m_vMessageHandlers;
 	std::string m_sReceived;
 	char byteToSend;
 	std::string m_sLastUsedIP;
@@ -144,9 +225,11 @@ private:
 
 	std::vector<float> m_vBounds;
 
-	Point3s* m_vLastFrameVertices;
-	int m_vLastFrameVerticesSize;
-	RGBA* m_vLastFrameRGB;
+	FramePipeline* m_pFramePipeline;
+	const int m_nPipelineSlots = 4;
+
+	FrameBufferPool* m_pPointcloudPool;
+	FrameBufferPool* m_pPreviewPool;
 
 	std::vector<int> m_vFrameCount;
 	std::vector<uint64_t> m_vFrameTimestamps;
@@ -157,14 +240,13 @@ private:
 	Log* log;
 
 	int m_nFrameIndex;
+	int m_nAcquiredFrameIndex; //Counts every frame the camera delivered, only used by the acquisition stage
 
 	Point3f* m_pCameraSpaceCoordinates;
-	RGBA* m_pColorPreview;
-	RGBA* m_pDepthPreview;
+	FrameBuffer* m_pColorPreview;
+	FrameBuffer* m_pDepthPreview;
 	int m_nPreviewWidth;
 	int m_nPreviewHeight;
-	Point3f* m_pAllVertices;
-	int m_nAllVerticesSize;
    
 	//Image Resources
 	std::vector<uchar> emptyJPEGBuffer;
@@ -176,23 +258,41 @@ private:
 
 
 	void UpdateFrame();
+	void DecodeTransformStage(FrameSlot* slot);
+	void CullStage(FrameSlot* slot);
+	void SinkStage(FrameSlot* slot);
 	void UpdatePreview();
-	void SaveRawFrame();
-	void SavePointcloudFrame(uint64_t timeStamp);
+	void SetPreviewBuffer(FrameBuffer*& preview, FrameBuffer* newPreview, int width, int height);
+	void UpdateFrameBufferPools();
+	bool SaveRawFrame(FrameSlot* slot);
+	bool SavePointcloudFrame(FrameSlot* slot);
 	void Calibrate();
 	void SetStatusMessage(std::wstring message, int time, bool priority);
-	void HandleSocket();
+	void HandleSocket(bool readable);
+	void RegisterMessageHandlers();
+	void ReceiveMessages(bool readable);
+	void ResetLiveFrameSubscription();
+	void UpdateSharedFrameRing();
+	void CloseSharedFrameRing();
+	void LoseConnection();
+	void StreamStoredFrames();
+	bool SendNextStoredFrame();
+	bool SendStoredFrameFromFile(const FrameHeader& header, const char* prefix, int prefixSize, const char* data, long long fileOffset, int dataSize);
+	void SendStoredFrameDictionary();
+	void SendNoMoreStoredFrames();
 	bool StartCamera();
 	void StopCamera();
 	void DisposeDevice();
 	void SendPostSyncConfirmation(bool success);
-	void SendFrame(Point3s* vertices,int verticesSize, RGBA* RGB, bool live);
+	FrameHeader MakeFrameHeader(int payloadSize, int compression, int encoding, int pointCount, uint64_t timestamp, int frameIndex);
+	bool SendFrame(const Point3s* vertices, int verticesSize, const RGBA* RGB, uint64_t timestamp, int frameIndex, OUTGOING_MESSAGE_TYPE message);
 	bool PostSyncPointclouds();
 	bool PostSyncRawFrames();
 
 	void SocketThreadFunction();
-	void StoreFrame(k4a_image_t pointCloudImage, cv::Mat *colorInDepth);
+	void StoreFrame(FrameSlot* slot);
 	void UpdateFPS();
+	float GetFrameIntervalMs();
 
 	//Turbo Rainbow Color Map by Google, Copyright 2019 Google LLC., SPDX-License-Identifier: Apache-2.0, Author: Anton Mikhailov
 	//Modified a bit so that all values are cramped into half the range, to have a better readability on close distances (up to 5m) where most of the action happens
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "binFileFormat.h"
+#include "utils.h"
+#include "zstd.h"
+
+/// <summary>
+/// One frame of a .bin recording, read in place from the mapping. Only valid until the file is closed.
+/// Compressed frames are decoded into buffers of the MappedFrameFile, their view is only valid until the next frame is read.
+/// When they are read without decoding them, only their compressed data is set, vertices and colors are NULL
+/// </summary>
+struct BinFrameView
+{
+	const Point3s* vertices; //In version 1 files, these aren't always aligned to 2 bytes. Fine on x86, where the client runs
+	const RGBA* colors;
+	int pointCount;
+	uint64_t timestamp;
+	long long dataOffset; //Where the vertices start in the file, the colors follow right after them. -1 for compressed frames, which aren't stored that way
+
+	//Only for compressed frames: The zstd frame as it is stored, in the mapping and in the file. NULL and -1 otherwise
+	const char* compressed;
+	long long compressedOffset;
+	int compressedSize;
+};
+
+/// <summary>
+/// Maps a .bin recording read-only into memory, so that its frames can be read in place instead of being copied through FILE* buffers.
+/// The whole file is mapped at once, the OS only loads the pages that are actually touched. For playback that goes through the frames
+/// in order, the file can be opened as sequential and the next frames prefetched, so that they are loaded before they are needed.
+/// Reads version 2 files as well as the version 1 files with text lines in front of each frame.
+/// Compressed frames are decompressed and decoded when they are read, with the zstd dictionary of the file if it has one.
+/// </summary>
+class MappedFrameFile
+{
+public:
+	MappedFrameFile();
+	~MappedFrameFile();
+
+	bool Open(const std::string& path, bool sequential);
+	void Close();
+
+	bool IsOpen() const { return m_bOpen; }
+	int GetVersion() const { return m_nVersion; }
+	int GetFrameCount() const { return (int)m_vFrameOffsets.size(); }
+	bool IsIndexRebuilt() const { return m_bIndexRebuilt; }
+	const char* GetDictionary() const { return m_pDictionaryData; }
+	int GetDictionarySize() const { return m_nDictionarySize; }
+
+	bool GetFrame(int index, BinFrameView& outFrame, bool decode = true);
+	void Prefetch(int firstFrame, int frameCount) const;
+
+private:
+	bool Map(const std::string& path, bool sequential);
+	bool ReadIndex();
+	void RebuildIndex(uint64_t firstFrameOffset);
+	void IndexVersion1();
+	bool ParseVersion1Header(uint64_t offset, int& outPoints, uint64_t& outTimestamp, uint64_t& outDataOffset) const;
+	bool DecompressFrame(const BinFrameHeader& header, uint64_t dataOffset, bool decode, BinFrameView& outFrame);
+
+	bool m_bOpen;
+	const char* m_pMemory; //NULL for empty files, which can't be mapped
+	uint64_t m_nSize;
+
+	void* m_hFile; //The HANDLEs of the file and its mapping on Windows
+	void* m_hMapping;
+	int m_nFileDescriptor; //Of the file everywhere else
+
+	int m_nVersion;
+	bool m_bIndexRebuilt; //The file is missing its index, because it wasn't closed properly
+	std::vector<uint64_t> m_vFrameOffsets; //Where the header of every frame starts
+
+	//For compressed frames. The buffers only grow, so that they are allocated once for the largest frame
+	ZSTD_DCtx* m_pDecompressionContext;
+	ZSTD_DDict* m_pDictionary; //NULL if the file has no dictionary
+	const char* m_pDictionaryData; //Where the dictionary is in the mapping, for sending it on
+	int m_nDictionarySize;
+	std::vector<char> m_vDecompressed;
+	std::vector<Point3s> m_vVertices;
+	std::vector<RGBA> m_vColors;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "utils.h"
+
+/// <summary>
+/// Every message from the server starts with its type as one byte and the size of its payload as an int, followed by the payload.
+/// Also copied to ClientSocket.cs on the server
+/// </summary>
+const int messageHeaderSize = 1 + sizeof(int);
+
+//Anything larger is treated as a corrupted stream
+const int maxMessagePayloadSize = 64 * 1024 * 1024;
+
+struct ServerMessage
+{
+	INCOMING_MESSAGE_TYPE type;
+	const char* payload;
+	int size;
+};
+
+/// <summary>
+/// Collects the bytes received from the server and cuts them into complete messages, no matter how the messages were split across reads.
+/// Works like a ring buffer, but instead of wrapping around, the unread bytes are moved to the front when the end is reached.
+/// That way every message can be handed out as one contiguous block
+/// </summary>
+class MessageFramer
+{
+public:
+	MessageFramer();
+
+	char* GetWriteBuffer(int minimumSize);
+	int GetWriteBufferSize() const { return (int)(m_vBuffer.size() - m_nWritePosition); }
+	void CommitWrite(int size);
+
+	bool NextMessage(ServerMessage& message);
+	bool HasError() const { return m_bError; }
+	void Reset();
+
+private:
+	std::vector<char> m_vBuffer;
+	size_t m_nReadPosition;
+	size_t m_nWritePosition;
+	bool m_bError;
+};
+
+/// <summary>
+/// Reads the fields of a message payload one after another. Every read checks that the payload is long enough,
+/// so a short message leaves the remaining values untouched instead of reading past its end
+/// </summary>
+class MessageReader
+{
+public:
+	MessageReader(const char* payload, int size) : m_pData(payload), m_nSize(size), m_nPosition(0), m_bOverrun(false) {}
+
+	template<typename T>
+	bool Read(T& value)
+	{
+		return ReadBytes(&value, sizeof(T));
+	}
+
+	//Flags are sent as a single byte
+	bool ReadFlag(bool& value)
+	{
+		char flag;
+
+		if (!Read(flag))
+			return false;
+
+		value = flag != 0;
+		return true;
+	}
+
+	bool ReadBytes(void* destination, int size)
+	{
+		if (size < 0 || size > Remaining())
+		{
+			m_bOverrun = true;
+			return false;
+		}
+
+		memcpy(destination, m_pData + m_nPosition, size);
+		m_nPosition += size;
+		return true;
+	}
+
+	bool ReadString(std::string& value, int length)
+	{
+		if (length < 0 || length > Remaining())
+		{
+			m_bOverrun = true;
+			return false;
+		}
+
+		value.assign(m_pData + m_nPosition, length);
+		m_nPosition += length;
+		return true;
+	}
+
+	const char* Current() const { return m_pData + m_nPosition; }
+	int Remaining() const { return m_nSize - m_nPosition; }
+	bool Overrun() const { return m_bOverrun; }
+
+private:
+	const char* m_pData;
+	int m_nSize;
+	int m_nPosition;
+	bool m_bOverrun;
+};
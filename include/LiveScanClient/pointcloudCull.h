@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <climits>
+#include <string>
+#include "utils.h"
+
+/// <summary>
+/// The part of the pointcloud image in which points can lie inside the bounds, and the range of their camera space Z (in mm).
+/// Pixels outside of it are skipped before they are transformed. right and bottom are exclusive, the default covers the whole frame.
+/// minDepth is at least 1, as invalid points have a Z of 0
+/// </summary>
+struct CullROI
+{
+	int left = 0;
+	int top = 0;
+	int right = INT_MAX;
+	int bottom = INT_MAX;
+	float minDepth = 1;
+	float maxDepth = SHRT_MAX;
+};
+
+/// <summary>
+/// Fused kernels that transform the int16 XYZ pointcloud of the camera (in mm) into world space,
+/// cull all invalid and out of bounds points, and write the survivors compacted as Point3s + RGBA in one pass.
+/// Points with a camera space Z outside of minDepth - maxDepth are rejected before the transformation.
+/// The output buffers need room for pointCount points. All kernels produce the exact same output.
+/// </summary>
+int CullPointcloud(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s* outVertices, RGBA* outColors);
+int CullPointcloudScalar(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s* outVertices, RGBA* outColors);
+int CullPointcloudAVX2(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s* outVertices, RGBA* outColors);
+bool CullKernelAVX2Supported();
+
+/// <summary>
+/// Splits the region of interest of the frame into tiles of rows, which are culled in parallel into their own region of the scratch buffers.
+/// The tiles are then copied to their offsets in the output, so the result is identical to culling the whole frame at once.
+/// Scratch buffers need room for GetCullROIPointCount() points, output buffers for width * height points.
+/// </summary>
+int CullPointcloudTiled(const int16_t* pointcloud, const uint8_t* colorBGRA, int width, int height, const Matrix4x4& toWorld, const float* bounds, const CullROI& roi,
+	Point3s* scratchVertices, RGBA* scratchColors, Point3s* outVertices, RGBA* outColors);
+
+/// <summary>
+/// How many pixels of the frame the region of interest covers, once it is clamped to the frame
+/// </summary>
+int GetCullROIPointCount(int width, int height, const CullROI& roi);
+
+const int cullTileRows = 64;
+
+/// <summary>
+/// Times the fused kernels against the previous two-pass implementation on a synthetic frame and checks that all outputs match
+/// </summary>
+std::string BenchmarkPointcloudCull(int width, int height, int iterations);
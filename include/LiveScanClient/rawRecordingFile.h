@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "frameCompressor.h"
+#include "sequentialFileWriter.h"
+
+//Layout of the raw recordings (.lsr), one file per client and take:
+//RawFileHeader, then for each frame a RawChunkHeader followed by the MJPEG color image and the compressed depth image,
+//then a RawIndexEntry per frame and the RawFileFooter. Post sync only replaces the index, the chunks are never touched again.
+const uint32_t rawFileMagic = 0x5752534C; //"LSRW"
+const uint32_t rawChunkMagic = 0x4B48434C; //"LCHK"
+const uint32_t rawFileVersion = 1;
+
+enum RAW_DEPTH_COMPRESSION
+{
+	RD_NONE = 0, //The rows of 16 bit depth values, without any padding
+	RD_ZSTD_DELTA = 1 //Each value as the difference to the one left of it, split into a plane of the low and one of the high bytes, compressed with zstd
+};
+
+enum RAW_INDEX_FLAGS
+{
+	RI_SYNCED = 1 //The frame has been post synced, its frame index is the synced one
+};
+
+struct RawFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize; //Where the first chunk starts
+	uint32_t chunkHeaderSize;
+	int32_t deviceIndex;
+	uint32_t flags;
+};
+
+struct RawChunkHeader
+{
+	uint32_t magic; //rawChunkMagic, so that the index of a file that wasn't closed properly can be rebuilt from the chunks
+	int32_t frameIndex; //As it was recorded
+	uint64_t timestamp; //Device timestamp in microseconds
+	uint32_t colorSize; //Bytes of the MJPEG image, which follows the header
+	uint32_t depthSize; //Bytes of the depth image, which follows the color image
+	uint16_t depthWidth;
+	uint16_t depthHeight;
+	int32_t depthCompression; //RAW_DEPTH_COMPRESSION
+};
+
+struct RawIndexEntry
+{
+	uint64_t chunkOffset;
+	int32_t frameIndex; //What the frame is called in the Color_N.jpg and Depth_N.tiff files it is extracted to
+	uint32_t flags; //RAW_INDEX_FLAGS
+};
+
+struct RawFileFooter
+{
+	uint64_t indexOffset;
+	uint32_t entryCount;
+	uint32_t magic;
+};
+
+static_assert(sizeof(RawFileHeader) == 24 && sizeof(RawChunkHeader) == 32 && sizeof(RawIndexEntry) == 16 && sizeof(RawFileFooter) == 16, "The layout is stored on disk");
+
+/// <summary>
+/// One frame read back from a raw recording
+/// </summary>
+struct RawFrameData
+{
+	std::vector<char> colorMJPG;
+	std::vector<uint16_t> depth; //depthWidth * depthHeight values, without padding
+	int depthWidth = 0;
+	int depthHeight = 0;
+	int frameIndex = 0;
+	uint64_t timestamp = 0;
+	bool synced = false;
+};
+
+/// <summary>
+/// Stores the raw frames of a recording (the MJPEG color image and the 16 bit depth image) in a single append-only file, instead of
+/// a JPG and a TIFF file per frame. The chunks are written through a SequentialFileWriter, so the disk only sees large sequential writes,
+/// and the depth images are compressed on the way. Opened either for writing with Create(), or for reading with Open().
+/// Not thread-safe, only one thread may use it at a time.
+/// </summary>
+class RawRecordingFile
+{
+public:
+	RawRecordingFile();
+	~RawRecordingFile();
+
+	RawRecordingFile(const RawRecordingFile&) = delete;
+	RawRecordingFile& operator=(const RawRecordingFile&) = delete;
+
+	bool Create(const std::string& path, int deviceIndex, uint64_t preallocateBytes, bool unbuffered);
+	bool WriteFrame(const void* colorMJPG, size_t colorSize, const uint16_t* depth, int depthWidth, int depthHeight, size_t depthStrideBytes, int frameIndex, uint64_t timestamp);
+
+	bool Open(const std::string& path);
+	int GetFrameCount() const { return (int)m_vIndex.size(); }
+	bool IsIndexRebuilt() const { return m_bIndexRebuilt; }
+	bool ReadFrame(int entry, RawFrameData& outFrame);
+
+	bool PostSync(const std::vector<int>& frameIDs, const std::vector<int>& syncedFrameIDs, const std::vector<unsigned char>& emptyColorMJPG);
+
+	bool Close();
+	bool IsOpenForWriting() const { return m_Writer.IsOpen(); }
+	bool IsOpenForReading() const { return m_pFile != NULL; }
+
+private:
+	bool ReadIndex();
+	void RebuildIndex(uint64_t firstChunkOffset);
+	bool Seek(uint64_t offset);
+
+	SequentialFileWriter m_Writer;
+	FILE* m_pFile; //Only while reading
+	std::string m_sPath;
+
+	std::vector<RawIndexEntry> m_vIndex;
+	uint64_t m_nIndexOffset; //Where the chunks end, the index of a file that is read can be replaced from here on
+	uint64_t m_nFileSize;
+	bool m_bIndexRebuilt; //The file is missing its index, because it wasn't closed properly
+
+	//Only grow, so that they are allocated once for the largest frame
+	FrameCompressor m_Compressor;
+	std::vector<char> m_vDepthPlanes; //The shuffled low and high byte planes of a depth image
+	std::vector<char> m_vDepthCompressed; //A compressed depth image, as it is read from the file
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// Appends to a file through a large staging buffer, so that the disk gets a few big sequential writes instead of one small write per call.
+/// The file can be preallocated, so that it doesn't get fragmented while it grows, and written unbuffered, which bypasses the page cache of the OS.
+/// Unbuffered writes need sector aligned memory, offsets and sizes, so the staging buffer is aligned and only whole chunks are written.
+/// The last, partial chunk is padded when the file is closed, and the file is then cut back to the size that was actually written.
+/// Not thread-safe, only one thread may use it at a time.
+/// </summary>
+class SequentialFileWriter
+{
+public:
+	SequentialFileWriter();
+	~SequentialFileWriter();
+
+	bool Open(const std::string& path, uint64_t preallocateBytes, bool unbuffered);
+	bool Write(const void* data, size_t size);
+	bool Close();
+
+	bool IsOpen() const { return m_bOpen; }
+	bool IsUnbuffered() const { return m_bUnbuffered; }
+
+	//How many bytes have been appended so far, including the ones still in the staging buffer
+	uint64_t GetPosition() const { return m_nFileOffset + m_nBufferFill; }
+
+private:
+	bool WriteBuffer(size_t size);
+	void CloseFile();
+
+	bool m_bOpen;
+	bool m_bUnbuffered;
+	bool m_bFailed; //Once a write failed, the file is incomplete and nothing more is appended
+
+	char* m_pBuffer; //Sector aligned
+	size_t m_nBufferFill;
+	uint64_t m_nFileOffset; //How much of the file has been written to the disk
+
+	void* m_hFile; //The HANDLE of the file on Windows
+	int m_nFileDescriptor; //Of the file everywhere else
+};
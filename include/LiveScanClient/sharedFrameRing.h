@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "frameHeader.h"
+
+/// <summary>
+/// Layout of the shared memory, also copied to SharedFrameRing.cs on the server.
+/// The ring header is followed by slotCount slots of slotSize bytes each. Every slot starts with a SharedFrameSlotHeader,
+/// followed by the frame just like it is sent over the socket after the message type: The FrameHeader with a compression of FC_NONE
+/// and the uncompressed payload
+/// </summary>
+const uint32_t sharedFrameRingMagic = 0x4C535246; //"FRSL"
+const uint32_t sharedFrameRingVersion = 2;
+
+//Enough for a frame at the color resolution of 2048x1536 that wasn't culled at all
+const int sharedFrameRingSlots = 4;
+const int sharedFrameRingSlotSize = 32 * 1024 * 1024;
+
+struct SharedFrameRingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t slotCount;
+	int32_t slotSize;
+	std::atomic<uint64_t> published; //Number of frames written so far, frame n is in slot n % slotCount
+	char padding[40];
+};
+
+struct SharedFrameSlotHeader
+{
+	//Seqlock of the slot: Odd while the writer fills it, 2 * (n + 1) once frame n is complete.
+	//A reader that sees a different value after copying the frame knows it was overwritten in the meantime
+	std::atomic<uint64_t> sequence;
+	int32_t messageType;
+	int32_t size; //Bytes of the frame header and payload that follow
+	char padding[48];
+};
+
+static_assert(sizeof(SharedFrameRingHeader) == 64 && sizeof(SharedFrameSlotHeader) == 64, "The layout is shared with the server");
+
+/// <summary>
+/// Hands frames to a server on the same host through named shared memory instead of the socket.
+/// There is one writer, the client that created the ring. The writer never waits: When a reader falls behind by more than
+/// the number of slots, the oldest frames are overwritten and the reader notices that it dropped them.
+/// Readers poll the published counter, the socket is still used for all control messages.
+/// </summary>
+class SharedFrameRing
+{
+public:
+	SharedFrameRing();
+	~SharedFrameRing();
+
+	static std::string MakeUniqueName();
+
+	bool Create(const std::string& name, int slotCount, int slotSize);
+	bool Open(const std::string& name);
+	void Close();
+
+	bool IsOpen() const { return m_pMemory != NULL; }
+	const std::string& GetName() const { return m_sName; }
+	int GetSlotCount() const { return m_nSlotCount; }
+	int GetSlotSize() const { return m_nSlotSize; }
+	int GetMaxFrameSize() const { return m_nSlotSize - (int)sizeof(SharedFrameSlotHeader); }
+
+	bool Write(int messageType, const FrameHeader& header, const char* payload, int payloadSize);
+	bool Read(int& messageType, std::vector<char>& frame);
+	uint64_t GetDroppedFrames() const { return m_nDroppedFrames; }
+
+private:
+	bool Map(size_t size, bool writable);
+	SharedFrameRingHeader* GetHeader() const { return (SharedFrameRingHeader*)m_pMemory; }
+	SharedFrameSlotHeader* GetSlot(uint64_t frame) const;
+
+	std::string m_sName;
+	char* m_pMemory;
+	size_t m_nMappedSize;
+	bool m_bOwner;
+
+	void* m_hMapping; //The HANDLE of the file mapping on Windows
+	int m_nFileDescriptor; //Of the shm object everywhere else
+
+	int m_nSlotCount;
+	int m_nSlotSize;
+
+	//Only used when reading
+	uint64_t m_nNextFrame;
+	uint64_t m_nDroppedFrames;
+};
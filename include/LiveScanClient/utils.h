@@ -37,7 +37,16 @@ enum INCOMING_MESSAGE_TYPE
 	MSG_START_CAPTURING_FRAMES,
 	MSG_STOP_CAPTURING_FRAMES,
 	MSG_REQUEST_TIMESTAMP_LIST,
-	MSG_RECEIVE_POSTSYNC_LIST
+	MSG_RECEIVE_POSTSYNC_LIST,
+	MSG_SUBSCRIBE_LIVE_FRAMES,
+	MSG_UNSUBSCRIBE_LIVE_FRAMES,
+	MSG_GRANT_LIVE_CREDITS,
+	MSG_CONFIRM_SHARED_FRAME_RING,
+	MSG_REQUEST_STORED_FRAMES,
+	MSG_ACK_STORED_FRAMES,
+	MSG_LEARN_BACKGROUND,
+	MSG_CLEAR_BACKGROUND,
+	MSG_INCOMING_COUNT //Not a message, the number of message types
 };
 
 enum OUTGOING_MESSAGE_TYPE
@@ -53,7 +62,24 @@ enum OUTGOING_MESSAGE_TYPE
 	MSG_SEND_TIMESTAMP_LIST,
 	MSG_CONFIRM_POSTSYNCED,
 	MSG_CONFIRM_POST_RECORD_PROCESS,
-	MSG_CONFIRM_PRE_RECORD_PROCESS
+	MSG_CONFIRM_PRE_RECORD_PROCESS,
+	MSG_PUSHED_LIVE_FRAME, //Same as MSG_LAST_FRAME, but sent on a live frame subscription without being requested
+	MSG_SHARED_FRAME_RING, //The name of the shared memory the frames are put into from now on, empty if it was closed
+	MSG_STORED_FRAME_DICTIONARY //The zstd dictionary of the take, sent before the frames of a bulk transfer. Empty if the take has none
+};
+
+//How the payload of a MSG_STORED_FRAME, MSG_LAST_FRAME or MSG_PUSHED_LIVE_FRAME is compressed, also copied to ServerUtils.cs on the server.
+//FC_ZSTD_STREAM sends the uncompressed size in the header, followed by the zstd frame in chunks that each start with their size.
+//A chunk size of 0 ends the frame.
+//FC_ZSTD_PARALLEL splits the frame into segments that are compressed independently, see FrameCompressor::CompressParallel()
+//FC_ZSTD_DICTIONARY is a stored frame as it was compressed in the .bin file, in FE_COLUMNAR and with the dictionary of MSG_STORED_FRAME_DICTIONARY
+enum FRAME_COMPRESSION
+{
+	FC_NONE,
+	FC_ZSTD,
+	FC_ZSTD_STREAM,
+	FC_ZSTD_PARALLEL,
+	FC_ZSTD_DICTIONARY
 };
 
 enum SYNC_STATE
@@ -239,9 +265,12 @@ typedef struct RGBA
 	}
 };
 
+class FrameBuffer;
+
 typedef struct PreviewFrame
 {
-	RGBA* picture;
+	RGBA* picture = NULL;
+	FrameBuffer* buffer = NULL; //Owns the picture, needs to be released by the receiver
 	int width;
 	int height;
 	bool previewDisabled = true;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "turbojpeg/turbojpeg.h"
+#include "utils.h"
+
+/// <summary>
+/// A JPEG color image, decoded only to its Y, Cb and Cr planes without converting it to BGRA.
+/// The chroma planes keep the subsampling of the JPEG, so they might be smaller than the luma plane. Grayscale images only have a luma plane
+/// </summary>
+struct YUVImage
+{
+	cv::Mat planes[3];
+	int width = 0;
+	int height = 0;
+	int chromaShiftX = 0; //log2 of the chroma subsampling
+	int chromaShiftY = 0;
+	bool grayscale = false;
+};
+
+bool DecodeJPEGToYUV(tjhandle turboJpeg, const uint8_t* jpeg, unsigned long jpegSize, int scale, YUVImage& outImage);
+
+/// <summary>
+/// Instead of colors, the pointcloud can carry the coordinates of the color pixel of each point through the culling.
+/// The cull kernels treat them as a BGRA color, so they are packed into the first three bytes (12 bits each for x and y) and read back
+/// from red, green and blue. SampleYUVColors() then replaces them with the actual colors, so only surviving points need a colorspace conversion
+/// </summary>
+inline uint32_t PixelCoordinatesAsColor(int x, int y)
+{
+	return (uint32_t)x | ((uint32_t)y << 12);
+}
+
+inline void PixelCoordinatesFromColor(const RGBA& color, int& x, int& y)
+{
+	int packed = color.red | (color.green << 8) | (color.blue << 16);
+	x = packed & 0xFFF;
+	y = packed >> 12;
+}
+
+const int maxPixelCoordinate = 1 << 12;
+
+void CreatePixelCoordinateImage(cv::Mat& coordinateImage, int width, int height);
+void SampleYUVColors(const YUVImage& image, RGBA* colors, int count);
+
+/// <summary>
+/// Times decoding a JPEG to BGRA and gathering the colors of the surviving pixels against decoding it to YUV planes
+/// and only converting the survivors. Also checks that both paths produce the same colors
+/// </summary>
+std::string BenchmarkColorDecode(const std::string& jpegPath, float survivingRatio, int iterations);
@@ -33,7 +33,31 @@
 //
 
 
+#ifdef _WIN32
 #include <WinSock2.h>
+#else
+//Maps the few Winsock names we use to their POSIX counterparts, so the client socket also builds on Linux
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+typedef int SOCKET;
+typedef timeval TIMEVAL;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#define closesocket close
+#define ioctlsocket ioctl
+#define WSAGetLastError() errno
+#endif
+
+#include <cstdio>
 #include <iostream>
 #include <string>
 
@@ -49,6 +73,20 @@ public:
   std::string ReceiveLine();
   std::string ReceiveBytes();
 
+  // Blocks until data can be read, the connection was closed
+  // or the timeout passed. Returns false on timeout.
+  bool   WaitReadable(int timeoutMs);
+
+  // The same on the bare handle, for waiting without holding on
+  // to the Socket. A handle that was closed in the meantime
+  // counts as readable.
+  static bool WaitReadable(SOCKET s, int timeoutMs);
+  SOCKET GetHandle() const { return s_; }
+
+  // Reads what is already available, at most len bytes, without blocking.
+  // Returns 0 if nothing is available, -1 on errors.
+  int    ReceiveAvailable(char *buf, int len);
+
   void   Close();
 
   // The parameter of SendLine is not a const reference
@@ -58,7 +96,17 @@ public:
   // The parameter of SendBytes is a const reference
   // because SendBytes does not modify the std::string passed 
   // (in contrast to SendLine).
-  void   SendBytes(const char *buf, int len);
+  // Returns false if not all of the bytes could be sent.
+  bool   SendBytes(const char *buf, int len);
+
+  // Sends len bytes of the file, starting at offset, straight
+  // from the file cache (TransmitFile/sendfile), without copying
+  // them through a buffer of ours. Returns how many of them
+  // have been sent, the rest can still be sent with SendBytes.
+  // Returns -1 if the connection failed while sending, then it
+  // is unknown how much of the range went out.
+  // Moves the position of the file on Windows.
+  int    SendFileRange(FILE *file, long long offset, int len);
 
 protected:
   friend class SocketServer;
@@ -73,9 +121,12 @@ protected:
   int* refCounter_;
 
 private:
+  // Every socket that isn't a copy starts Winsock and ends it once
+  // its last copy is gone. Winsock counts the starts itself, so
+  // sockets of several clients in one process don't need a shared
+  // counter.
   static void Start();
   static void End();
-  static int  nofSockets_;
 };
 
 class SocketClient : public Socket {
@@ -1,4 +1,5 @@
 #include "KinectConfiguration.h"
+#include <cstdlib>
 
 
 std::string sSerialNumber;
@@ -81,6 +82,18 @@ char* KinectConfiguration::ToBytes()
 	message[i] = filter_depth_map ? 1 : 0;
 	i++;
 	message[i] = filter_depth_map_size;
+	i++;
+	message[i] = color_decode_scale;
+	i++;
+	message[i] = decode_color_to_yuv ? 1 : 0;
+	i++;
+	message[i] = filter_flying_pixels ? 1 : 0;
+	i++;
+	message[i] = flying_pixel_threshold;
+	i++;
+	message[i] = filter_small_components ? 1 : 0;
+	i++;
+	message[i] = small_component_size;
 
 	return message;
 }
@@ -138,6 +151,26 @@ void KinectConfiguration::SetFromBytes(char* received)
 	filter_depth_map = ((int)received[i] == 0) ? false : true;
 	i++;
 	filter_depth_map_size = int(received[i]);
+	i++;
+
+	//Only scaling factors that turbojpeg can do in the IDCT are allowed
+	color_decode_scale = int(received[i]);
+	if (color_decode_scale != 1 && color_decode_scale != 2 && color_decode_scale != 4 && color_decode_scale != 8)
+		color_decode_scale = 1;
+	i++;
+
+	decode_color_to_yuv = ((int)received[i] == 0) ? false : true;
+	i++;
+
+	filter_flying_pixels = ((int)received[i] == 0) ? false : true;
+	i++;
+	flying_pixel_threshold = (int)(unsigned char)received[i];
+	if (flying_pixel_threshold < 1 || flying_pixel_threshold > 99)
+		flying_pixel_threshold = 5;
+	i++;
+	filter_small_components = ((int)received[i] == 0) ? false : true;
+	i++;
+	small_component_size = (int)(unsigned char)received[i];
 	//update const byteLength when changing this.
 }
 
@@ -151,6 +184,12 @@ void KinectConfiguration::Save()
 	content += std::to_string((int)config.camera_fps) + "\n";
 	content += std::to_string((bool)filter_depth_map) + "\n";
 	content += std::to_string((int)filter_depth_map_size) + "\n";
+	content += std::to_string((int)color_decode_scale) + "\n";
+	content += std::to_string((bool)decode_color_to_yuv) + "\n";
+	content += std::to_string((bool)filter_flying_pixels) + "\n";
+	content += std::to_string((int)flying_pixel_threshold) + "\n";
+	content += std::to_string((bool)filter_small_components) + "\n";
+	content += std::to_string((int)small_component_size) + "\n";
 
 	std::ofstream configFile;
 	configFile.open(path);
@@ -190,10 +229,48 @@ void KinectConfiguration::TryLoad()
 	i += 2;
 	filter_depth_map = (bool)(content[i] - 48);
 	i += 2;
-	filter_depth_map_size = (int)(content[i] - 48);
 
-	
+	//From here on, values can have more than one digit, so we read them line by line.
+	//Older configuration files don't contain all of them yet, these keep their defaults
+	auto readValue = [&](int& value)
+	{
+		if (i >= content.size())
+			return false;
+
+		size_t end = content.find('\n', i);
+		if (end == std::string::npos)
+			end = content.size();
+
+		value = atoi(content.substr(i, end - i).c_str());
+		i = (int)end + 1;
+		return true;
+	};
+
+	int value;
+
+	if (readValue(value))
+		filter_depth_map_size = value;
+
+	if (readValue(value))
+		color_decode_scale = value;
+
+	if (color_decode_scale != 1 && color_decode_scale != 2 && color_decode_scale != 4 && color_decode_scale != 8)
+		color_decode_scale = 1;
+
+	if (readValue(value))
+		decode_color_to_yuv = value != 0;
+
+	if (readValue(value))
+		filter_flying_pixels = value != 0;
+
+	if (readValue(value) && value >= 1 && value <= 99)
+		flying_pixel_threshold = value;
+
+	if (readValue(value))
+		filter_small_components = value != 0;
 
+	if (readValue(value))
+		small_component_size = value;
 }
 
 void KinectConfiguration::InitializeDefaults()
@@ -211,6 +288,12 @@ void KinectConfiguration::InitializeDefaults()
 	eHardwareSyncState = UnknownState;
 	filter_depth_map = false;
 	filter_depth_map_size = 5;
+	color_decode_scale = 1;
+	decode_color_to_yuv = false;
+	filter_flying_pixels = false;
+	flying_pixel_threshold = 5;
+	filter_small_components = false;
+	small_component_size = 50;
 }
 
 int KinectConfiguration::GetDepthCameraWidth()
@@ -0,0 +1,269 @@
+#include "asyncFrameWriter.h"
+#include <algorithm>
+
+AsyncFrameWriter::AsyncFrameWriter(FrameFileWriterReader* fileWriter, int queueCapacity) : m_pFileWriter(fileWriter), m_nQueued(0),
+	m_nCapacity((std::max)(1, queueCapacity)), m_ePolicy(WQ_BLOCK), m_bRunning(true)
+{
+	m_vPending.reserve(m_nCapacity);
+	m_vWriting.reserve(m_nCapacity);
+	ResetStats();
+
+	m_WriterThread = std::thread(&AsyncFrameWriter::WriterThreadFunction, this);
+}
+
+/// <summary>
+/// Writes all frames that are still queued, then stops the writer thread
+/// </summary>
+AsyncFrameWriter::~AsyncFrameWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mQueue);
+		m_bRunning = false;
+	}
+
+	m_cvWork.notify_all();
+	m_WriterThread.join();
+
+	for (PointcloudCopy* copy : m_vFreeCopies)
+		delete copy;
+}
+
+void AsyncFrameWriter::SetPolicy(WRITE_QUEUE_POLICY policy)
+{
+	std::lock_guard<std::mutex> lock(m_mQueue);
+	m_ePolicy = policy;
+}
+
+/// <summary>
+/// Queues a pointcloud to be appended to the current .bin file. The writer copies the points of the frame, the caller keeps the frame
+/// </summary>
+/// <returns>False if the queue was full and the frame has been dropped</returns>
+bool AsyncFrameWriter::WritePointcloudFrame(FrameBuffer* frame, uint64_t timestamp, int deviceID)
+{
+	WriteJob job = {};
+	job.timestamp = timestamp;
+	job.deviceID = deviceID;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mQueue);
+
+		if (m_vFreeCopies.empty())
+			job.pointcloud = new PointcloudCopy();
+
+		else
+		{
+			job.pointcloud = m_vFreeCopies.back();
+			m_vFreeCopies.pop_back();
+		}
+	}
+
+	//The copies keep the room of the largest frame they held, so they only allocate while the frames grow
+	job.pointcloud->vertices.assign(frame->pVertices, frame->pVertices + frame->nSize);
+	job.pointcloud->colors.assign(frame->pColors, frame->pColors + frame->nSize);
+
+	if (Enqueue(job))
+		return true;
+
+	std::lock_guard<std::mutex> lock(m_mQueue);
+	ReleaseJob(job);
+	return false;
+}
+
+/// <summary>
+/// Queues the color (MJPEG) and depth image of a raw frame to be appended to the raw recording file. The writer takes its own references of the images
+/// </summary>
+/// <returns>False if the queue was full and the frame has been dropped</returns>
+bool AsyncFrameWriter::WriteRawFrame(k4a_image_t colorImageMJPG, k4a_image_t depthImage, int frameIndex, uint64_t timestamp, int deviceID)
+{
+	WriteJob job = {};
+	job.colorImageMJPG = colorImageMJPG;
+	job.depthImage = depthImage;
+	job.frameIndex = frameIndex;
+	job.timestamp = timestamp;
+	job.deviceID = deviceID;
+
+	if (colorImageMJPG != NULL)
+	{
+		job.bytes += k4a_image_get_size(colorImageMJPG);
+		k4a_image_reference(colorImageMJPG);
+	}
+
+	if (depthImage != NULL)
+	{
+		job.bytes += k4a_image_get_size(depthImage);
+		k4a_image_reference(depthImage);
+	}
+
+	if (Enqueue(job))
+		return true;
+
+	std::lock_guard<std::mutex> lock(m_mQueue);
+	ReleaseJob(job);
+	return false;
+}
+
+bool AsyncFrameWriter::Enqueue(const WriteJob& job)
+{
+	std::unique_lock<std::mutex> lock(m_mQueue);
+
+	if (m_nQueued >= m_nCapacity)
+	{
+		if (m_ePolicy == WQ_DROP)
+		{
+			m_nFramesDropped++;
+			return false;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_cvDone.wait(lock, [this] { return m_nQueued < m_nCapacity; });
+		m_tBlocked += std::chrono::steady_clock::now() - start;
+	}
+
+	m_vPending.push_back(job);
+	m_nQueued++;
+	m_nHighWaterMark = (std::max)(m_nHighWaterMark, m_nQueued);
+
+	m_cvWork.notify_one();
+	return true;
+}
+
+/// <summary>
+/// Blocks until every queued frame has been handed to the FrameFileWriterReader
+/// </summary>
+void AsyncFrameWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mQueue);
+	m_cvDone.wait(lock, [this] { return m_nQueued == 0; });
+}
+
+void AsyncFrameWriter::WriterThreadFunction()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mQueue);
+			m_cvWork.wait(lock, [this] { return !m_vPending.empty() || !m_bRunning; });
+
+			//When the writer is destroyed, the frames that are still queued are written first
+			if (m_vPending.empty())
+				return;
+
+			m_vPending.swap(m_vWriting);
+		}
+
+		for (size_t i = 0; i < m_vWriting.size(); i++)
+		{
+			//Compressed recordings hold back their first frames until the dictionary is trained, these are counted with the frame that lets them go
+			uint64_t appendedBefore = m_pFileWriter->getAppendedFrameBytes();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			bool written = WriteJobToDisk(m_vWriting[i]);
+			std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() - start;
+
+			uint64_t bytes = m_vWriting[i].pointcloud != NULL ? m_pFileWriter->getAppendedFrameBytes() - appendedBefore : m_vWriting[i].bytes;
+
+			std::lock_guard<std::mutex> lock(m_mQueue);
+			ReleaseJob(m_vWriting[i]);
+			m_nQueued--;
+			m_tWriting += duration;
+
+			if (written)
+			{
+				m_nFramesWritten++;
+				m_nBytesWritten += bytes;
+			}
+
+			else
+				m_nWriteErrors++;
+
+			m_cvDone.notify_all();
+		}
+
+		m_vWriting.clear();
+	}
+}
+
+bool AsyncFrameWriter::WriteJobToDisk(const WriteJob& job)
+{
+	if (job.pointcloud != NULL)
+		return m_pFileWriter->writeNextBinaryFrame(job.pointcloud->vertices.data(), (int)job.pointcloud->vertices.size(), job.pointcloud->colors.data(), job.timestamp, job.deviceID);
+
+	if (job.colorImageMJPG == NULL || job.depthImage == NULL)
+		return false;
+
+	return m_pFileWriter->writeNextRawFrame(k4a_image_get_buffer(job.colorImageMJPG), k4a_image_get_size(job.colorImageMJPG), (const uint16_t*)k4a_image_get_buffer(job.depthImage),
+		k4a_image_get_width_pixels(job.depthImage), k4a_image_get_height_pixels(job.depthImage), k4a_image_get_stride_bytes(job.depthImage), job.frameIndex, job.timestamp, job.deviceID);
+}
+
+/// <summary>
+/// Must be called with m_mQueue locked
+/// </summary>
+void AsyncFrameWriter::ReleaseJob(WriteJob& job)
+{
+	if (job.pointcloud != NULL)
+		m_vFreeCopies.push_back(job.pointcloud);
+
+	if (job.colorImageMJPG != NULL)
+		k4a_image_release(job.colorImageMJPG);
+
+	if (job.depthImage != NULL)
+		k4a_image_release(job.depthImage);
+
+	job.pointcloud = NULL;
+	job.colorImageMJPG = NULL;
+	job.depthImage = NULL;
+}
+
+AsyncWriterStats AsyncFrameWriter::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mQueue);
+
+	AsyncWriterStats stats;
+	stats.queueDepth = m_nQueued;
+	stats.highWaterMark = m_nHighWaterMark;
+	stats.capacity = m_nCapacity;
+	stats.framesWritten = m_nFramesWritten;
+	stats.framesDropped = m_nFramesDropped;
+	stats.writeErrors = m_nWriteErrors;
+	stats.bytesWritten = m_nBytesWritten;
+	stats.blockedMilliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(m_tBlocked).count();
+
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_tStatsReset).count();
+	double writingSeconds = std::chrono::duration<double>(m_tWriting).count();
+
+	if (elapsedSeconds > 0)
+		stats.bytesPerSecond = (float)(m_nBytesWritten / elapsedSeconds);
+
+	if (writingSeconds > 0)
+		stats.diskBytesPerSecond = (float)(m_nBytesWritten / writingSeconds);
+
+	return stats;
+}
+
+std::string AsyncFrameWriter::GetStatsString()
+{
+	AsyncWriterStats stats = GetStats();
+	const float megabyte = 1024.0f * 1024.0f;
+
+	return "queue= " + std::to_string(stats.queueDepth) + "/" + std::to_string(stats.capacity) + " high water mark= " + std::to_string(stats.highWaterMark) +
+		" written= " + std::to_string(stats.framesWritten) + " (" + std::to_string((int)(stats.bytesWritten / megabyte)) + " MB, " +
+		std::to_string((int)(stats.bytesPerSecond / megabyte)) + " MB/s, disk " + std::to_string((int)(stats.diskBytesPerSecond / megabyte)) + " MB/s)" +
+		" dropped= " + std::to_string(stats.framesDropped) + " errors= " + std::to_string(stats.writeErrors) + " blocked= " + std::to_string(stats.blockedMilliseconds) + " ms";
+}
+
+/// <summary>
+/// Starts counting from zero, for example at the start of a recording
+/// </summary>
+void AsyncFrameWriter::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mQueue);
+
+	m_nHighWaterMark = m_nQueued;
+	m_nFramesWritten = 0;
+	m_nFramesDropped = 0;
+	m_nWriteErrors = 0;
+	m_nBytesWritten = 0;
+	m_tWriting = std::chrono::steady_clock::duration::zero();
+	m_tBlocked = std::chrono::steady_clock::duration::zero();
+	m_tStatsReset = std::chrono::steady_clock::now();
+}
@@ -1,6 +1,153 @@
 #include "azureKinectCapture.h"
+#include <cfloat>
 
+namespace
+{
+	/// <summary>
+	/// Projects a point in the space of a camera (in mm) onto its image with the Brown-Conrady lens model of the Azure Kinect.
+	/// Does the same as k4a_calibration_3d_to_2d, without its overhead per call.
+	/// </summary>
+	/// <returns>Returns false if the point lies outside of the valid area of the lens model</returns>
+	inline bool ProjectToCamera(const k4a_calibration_camera_t& camera, float x, float y, float z, float& u, float& v)
+	{
+		const auto& param = camera.intrinsics.parameters.param;
+
+		float xp = x / z - param.codx;
+		float yp = y / z - param.cody;
+
+		float xp2 = xp * xp;
+		float yp2 = yp * yp;
+		float xyp = xp * yp;
+		float rs = xp2 + yp2;
+
+		if (camera.metric_radius > 0 && rs > camera.metric_radius * camera.metric_radius)
+			return false;
+
+		float rss = rs * rs;
+		float rsc = rss * rs;
+		float a = 1.f + param.k1 * rs + param.k2 * rss + param.k3 * rsc;
+		float b = 1.f + param.k4 * rs + param.k5 * rss + param.k6 * rsc;
+		float d = b != 0.f ? a / b : a;
+
+		float xpd = xp * d + (rs + 2.f * xp2) * param.p2 + 2.f * xyp * param.p1;
+		float ypd = yp * d + (rs + 2.f * yp2) * param.p1 + 2.f * xyp * param.p2;
+
+		u = (xpd + param.codx) * param.fx + param.cx;
+		v = (ypd + param.cody) * param.fy + param.cy;
+
+		return true;
+	}
+
+	/// <summary>
+	/// Projects the world bounds into the image of a camera, to get a conservative ROI for the culling. The lens distortion bends
+	/// the edges of the bounds box, so they are sampled instead of only projecting the corners, and the result is padded.
+	/// The depth range is the Z range of the corners in color camera space, as all pointclouds are in color camera space
+	/// </summary>
+	/// <param name="colorFromWorld">Transforms world space (in m) into color camera space (in mm)</param>
+	/// <param name="colorToCamera">Extrinsics from the color camera to the camera of the image, NULL if it's the color camera itself</param>
+	/// <param name="imageScale">Size of the image relative to the resolution the camera has been calibrated for</param>
+	CullROI ProjectBoundsToROI(const Matrix4x4& colorFromWorld, const float* bounds, const k4a_calibration_camera_t& camera,
+		const k4a_calibration_extrinsics_t* colorToCamera, int imageWidth, int imageHeight, float imageScale)
+	{
+		CullROI roi;
+
+		Point3f corners[8];
+		float minZ = FLT_MAX;
+		float maxZ = -FLT_MAX;
+
+		for (int i = 0; i < 8; i++)
+		{
+			Point3f world = Point3f(bounds[(i & 1) ? 3 : 0], bounds[(i & 2) ? 4 : 1], bounds[(i & 4) ? 5 : 2]);
+			corners[i] = colorFromWorld * world;
+
+			minZ = corners[i].Z < minZ ? corners[i].Z : minZ;
+			maxZ = corners[i].Z > maxZ ? corners[i].Z : maxZ;
+		}
+
+		//The kernels transform the other way around, which might round a bit differently
+		const float depthMargin = 10.f;
+		roi.minDepth = minZ - depthMargin > 1.f ? minZ - depthMargin : 1.f;
+		roi.maxDepth = maxZ + depthMargin < SHRT_MAX ? maxZ + depthMargin : SHRT_MAX;
+
+		if (colorToCamera != NULL)
+		{
+			const float* rotation = colorToCamera->rotation;
+			const float* translation = colorToCamera->translation;
+
+			for (int i = 0; i < 8; i++)
+			{
+				Point3f p = corners[i];
+				corners[i].X = rotation[0] * p.X + rotation[1] * p.Y + rotation[2] * p.Z + translation[0];
+				corners[i].Y = rotation[3] * p.X + rotation[4] * p.Y + rotation[5] * p.Z + translation[1];
+				corners[i].Z = rotation[6] * p.X + rotation[7] * p.Y + rotation[8] * p.Z + translation[2];
+			}
+		}
+
+		//If the bounds reach behind (or very close to) the camera, they can cover any pixel, so we only use the depth range
+		const float nearPlane = 100.f;
+		for (int i = 0; i < 8; i++)
+		{
+			if (corners[i].Z < nearPlane)
+				return roi;
+		}
+
+		const int edges[12][2] = { {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7} };
+		const int edgeSamples = 16;
+		const auto& param = camera.intrinsics.parameters.param;
+
+		float minU = FLT_MAX, minV = FLT_MAX;
+		float maxU = -FLT_MAX, maxV = -FLT_MAX;
+
+		for (int edge = 0; edge < 12; edge++)
+		{
+			const Point3f& a = corners[edges[edge][0]];
+			const Point3f& b = corners[edges[edge][1]];
+
+			for (int sample = 0; sample <= edgeSamples; sample++)
+			{
+				float t = (float)sample / edgeSamples;
+				float x = a.X + (b.X - a.X) * t;
+				float y = a.Y + (b.Y - a.Y) * t;
+				float z = a.Z + (b.Z - a.Z) * t;
+
+				//Outside of the valid area of the lens model, the undistorted projection still lands far outside of the image
+				float u, v;
+				if (!ProjectToCamera(camera, x, y, z, u, v))
+				{
+					u = x / z * param.fx + param.cx;
+					v = y / z * param.fy + param.cy;
+				}
+
+				minU = u < minU ? u : minU;
+				maxU = u > maxU ? u : maxU;
+				minV = v < minV ? v : minV;
+				maxV = v > maxV ? v : maxV;
+			}
+		}
+
+		//Pixel centers are at integer coordinates, so we shift by half a pixel to scale
+		minU = (minU + 0.5f) * imageScale - 0.5f;
+		maxU = (maxU + 0.5f) * imageScale - 0.5f;
+		minV = (minV + 0.5f) * imageScale - 0.5f;
+		maxV = (maxV + 0.5f) * imageScale - 0.5f;
+
+		//Covers the sampling of the edges and the rounding of the transformations
+		float paddingU = 4.f + 0.02f * imageWidth;
+		float paddingV = 4.f + 0.02f * imageHeight;
+
+		float left = floorf(minU - paddingU);
+		float right = ceilf(maxU + paddingU) + 1;
+		float top = floorf(minV - paddingV);
+		float bottom = ceilf(maxV + paddingV) + 1;
 
+		roi.left = left < 0 ? 0 : (left > imageWidth ? imageWidth : (int)left);
+		roi.right = right < roi.left ? roi.left : (right > imageWidth ? imageWidth : (int)right);
+		roi.top = top < 0 ? 0 : (top > imageHeight ? imageHeight : (int)top);
+		roi.bottom = bottom < roi.top ? roi.top : (bottom > imageHeight ? imageHeight : (int)bottom);
+
+		return roi;
+	}
+}
 
 AzureKinectCapture::AzureKinectCapture()
 {
@@ -126,8 +273,11 @@ bool AzureKinectCapture::StartCamera(KinectConfiguration& configuration)
 		SetExposureState(false, exposureTimeStep);
 	}
 
-	transformation = k4a_transformation_create(&calibration);
+	cameraCalibration = calibration;
+	colorDecodeScale = configuration.color_decode_scale;
+	CreateColorTransformation();
 
+	CreateDepthRayLUT(calibration);
 
 	//It's crucial for this program to output accurately mapped Pointclouds. The highest accuracy mapping is achieved
 	//by using the k4a_transformation_depth_image_to_color_camera function. However this converts a small depth image 
@@ -189,6 +339,8 @@ void AzureKinectCapture::StopCamera()
 	k4a_device_stop_cameras(kinectSensor);
 
 	//We release the resources here, as the might change dimensions on new start
+	k4a_image_release(aquiredFrame.colorImageMJPG);
+	k4a_image_release(aquiredFrame.depthImage16Int);
 	k4a_image_release(colorImageMJPG);
 	k4a_image_release(depthImage16Int);
 	k4a_image_release(pointCloudImage);
@@ -197,7 +349,10 @@ void AzureKinectCapture::StopCamera()
 	k4a_image_release(colorImageDownscaled);
 	k4a_transformation_destroy(transformationColorDownscaled);
 	k4a_transformation_destroy(transformation);
+	pointCloudColorBGR.release();
+	depthRaysInColorSpace.clear();
 
+	aquiredFrame = RawFrame();
 	colorImageMJPG = NULL;
 	depthImage16Int = NULL;
 	pointCloudImage = NULL;
@@ -252,20 +407,21 @@ bool AzureKinectCapture::AquireRawFrame()
 		return false;
 	}
 
-	k4a_image_release(colorImageMJPG);
-	k4a_image_release(depthImage16Int);
-
-	colorImageMJPG = k4a_capture_get_color_image(capture);
-	depthImage16Int = k4a_capture_get_depth_image(capture);
+	//Only releases our reference, if the frame has been detached, the detached frame keeps the images alive
+	k4a_image_release(aquiredFrame.colorImageMJPG);
+	k4a_image_release(aquiredFrame.depthImage16Int);
 
-	currentTimeStamp = k4a_image_get_device_timestamp_usec(colorImageMJPG);
+	aquiredFrame.colorImageMJPG = k4a_capture_get_color_image(capture);
+	aquiredFrame.depthImage16Int = k4a_capture_get_depth_image(capture);
 
-	if (colorImageMJPG == NULL || depthImage16Int == NULL)
+	if (aquiredFrame.colorImageMJPG == NULL || aquiredFrame.depthImage16Int == NULL)
 	{
 		k4a_capture_release(capture);
 		return false;
 	}
 
+	aquiredFrame.timeStamp = k4a_image_get_device_timestamp_usec(aquiredFrame.colorImageMJPG);
+
 	k4a_capture_release(capture);
 
 	return true;
@@ -273,18 +429,60 @@ bool AzureKinectCapture::AquireRawFrame()
 }
 
 /// <summary>
-/// Decompresses the raw MJPEG image from the camera to a BGRA cvMat using TurboJpeg
+/// Hands out the last aquired frame, so that it can be processed on another thread while the next frame is being aquired.
+/// The caller owns the references in the frame and needs to release them.
+/// </summary>
+/// <returns>Returns false if no frame has been aquired yet</returns>
+bool AzureKinectCapture::DetachRawFrame(RawFrame& frame)
+{
+	if (aquiredFrame.colorImageMJPG == NULL || aquiredFrame.depthImage16Int == NULL)
+		return false;
+
+	frame.colorImageMJPG = aquiredFrame.colorImageMJPG;
+	frame.depthImage16Int = aquiredFrame.depthImage16Int;
+	frame.timeStamp = aquiredFrame.timeStamp;
+
+	k4a_image_reference(frame.colorImageMJPG);
+	k4a_image_reference(frame.depthImage16Int);
+
+	return true;
+}
+
+/// <summary>
+/// Makes a detached frame the current frame, so that DecodeRawColor(), MapDepthToColor(), etc. work on it.
+/// Takes an additional reference, the frame still needs to be released by its owner
+/// </summary>
+void AzureKinectCapture::AttachRawFrame(RawFrame& frame)
+{
+	k4a_image_release(colorImageMJPG);
+	k4a_image_release(depthImage16Int);
+
+	colorImageMJPG = frame.colorImageMJPG;
+	depthImage16Int = frame.depthImage16Int;
+	currentTimeStamp = frame.timeStamp;
+
+	k4a_image_reference(colorImageMJPG);
+	k4a_image_reference(depthImage16Int);
+
+	depthImageFiltered = false;
+}
+
+/// <summary>
+/// Decompresses the raw MJPEG image from the camera to a BGRA cvMat using TurboJpeg.
+/// With a decode scale > 1, TurboJpeg scales the image down in the IDCT, which is a lot cheaper than a full decode
 /// </summary>
 void AzureKinectCapture::DecodeRawColor()
 {
+	tjscalingfactor scalingFactor = { 1, colorDecodeScale };
 
-	nColorFrameHeight = k4a_image_get_height_pixels(colorImageMJPG);
-	nColorFrameWidth = k4a_image_get_width_pixels(colorImageMJPG);
+	nColorFrameHeight = TJSCALED(k4a_image_get_height_pixels(colorImageMJPG), scalingFactor);
+	nColorFrameWidth = TJSCALED(k4a_image_get_width_pixels(colorImageMJPG), scalingFactor);
 
 	if (colorBGR.cols != nColorFrameWidth || colorBGR.rows != nColorFrameHeight) //If we use downscaling again, we need to seperate the downscaled and non-downscaled images into seperate buffers
 		colorBGR = cv::Mat(nColorFrameHeight, nColorFrameWidth, CV_8UC4);
 
 	tjDecompress2(turboJpeg, k4a_image_get_buffer(colorImageMJPG), static_cast<unsigned long>(k4a_image_get_size(colorImageMJPG)), colorBGR.data, nColorFrameWidth, 0, nColorFrameHeight, TJPF_BGRA, TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE);
+	bColorDecodedToYUV = false;
 
 	int colorSize = colorBGR.total() * colorBGR.elemSize();
 	int depthSize = k4a_image_get_size(depthImage16Int);
@@ -294,6 +492,26 @@ void AzureKinectCapture::DecodeRawColor()
 	std::cout << "Decoded color + depth size KB = " << std::to_string((colorSizeKB + depthSizeKB)) << std::endl;*/
 }
 
+/// <summary>
+/// Decompresses the raw MJPEG image only to its YUV planes, without converting it to BGRA. colorBGR is not updated,
+/// the pointcloud carries the pixel coordinates as colors instead, which are converted with SampleYUVColors() after culling
+/// </summary>
+/// <returns>False if the image couldn't be decoded. colorYUV then still holds the planes of an older frame, or none at all</returns>
+bool AzureKinectCapture::DecodeRawColorToYUV()
+{
+	if (!DecodeJPEGToYUV(turboJpeg, k4a_image_get_buffer(colorImageMJPG), static_cast<unsigned long>(k4a_image_get_size(colorImageMJPG)), colorDecodeScale, colorYUV))
+	{
+		logBuffer.LogWarning("Could not decode the color image to YUV");
+		bColorDecodedToYUV = false;
+		return false;
+	}
+
+	nColorFrameWidth = colorYUV.width;
+	nColorFrameHeight = colorYUV.height;
+	bColorDecodedToYUV = true;
+	return true;
+}
+
 void AzureKinectCapture::DownscaleColorImgToDepthImgSize()
 {
 
@@ -307,23 +525,39 @@ void AzureKinectCapture::DownscaleColorImgToDepthImgSize()
 }
 
 
+/// <summary>
+/// Runs the depth filters that are enabled in the configuration on the depth image, in place. Only filters each frame once,
+/// even if it's needed for more than one output
+/// </summary>
+void AzureKinectCapture::FilterDepthImage()
+{
+	if (depthImageFiltered || depthImage16Int == NULL)
+		return;
+
+	uint16_t* depth = (uint16_t*)k4a_image_get_buffer(depthImage16Int);
+	int width = k4a_image_get_width_pixels(depthImage16Int);
+	int height = k4a_image_get_height_pixels(depthImage16Int);
+
+	//The static scenery goes first, the other filters then clean up what is left of it along its edges
+	if (backgroundModel.IsValid() && !backgroundModel.Subtract(depth, width, height) && !backgroundMismatchLogged)
+	{
+		logBuffer.LogWarning("The background model was learned at another depth resolution, it needs to be learned again");
+		backgroundMismatchLogged = true;
+	}
+
+	depthFilter.Apply(depth, width, height, configuration);
+	depthImageFiltered = true;
+}
+
 void AzureKinectCapture::MapDepthToColor()
 {
-	//fix depth image here
-	if (configuration.filter_depth_map)
+	FilterDepthImage();
+
+	//The color resolution changes with the decode scale
+	if (transformedDepthImage != NULL && (k4a_image_get_width_pixels(transformedDepthImage) != nColorFrameWidth || k4a_image_get_height_pixels(transformedDepthImage) != nColorFrameHeight))
 	{
-		cv::Mat cImgD = cv::Mat(k4a_image_get_height_pixels(depthImage16Int), k4a_image_get_width_pixels(depthImage16Int), CV_16UC1, k4a_image_get_buffer(depthImage16Int));
-		cv::Mat cImgD2 = cv::Mat::zeros(cv::Size(k4a_image_get_height_pixels(depthImage16Int), k4a_image_get_width_pixels(depthImage16Int)), CV_16UC1);// k4a_image_get_buffer(depthImage));
-		cv::Mat cImgD3 = cv::Mat::zeros(cv::Size(k4a_image_get_height_pixels(depthImage16Int), k4a_image_get_width_pixels(depthImage16Int)), CV_16UC1);// k4a_image_get_buffer(depthImage));
-
-		cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(configuration.filter_depth_map_size, configuration.filter_depth_map_size));
-
-		//cv::medianBlur(cImgD, cImgD2, 5);
-		int CLOSING = 3;
-		// 4 will do a good edge detection if you threshold after as well
-		//cv::morphologyEx(cImgD, cImgD2, CLOSING, kernel);
-		cv::erode(cImgD, cImgD, kernel);
-		//cv::GaussianBlur(cImgD3, cImgD, cv::Size(configuration.filter_depth_map_size, configuration.filter_depth_map_size), 0);
+		k4a_image_release(transformedDepthImage);
+		transformedDepthImage = NULL;
 	}
 
 	if (transformedDepthImage == NULL)
@@ -340,13 +574,175 @@ void AzureKinectCapture::MapDepthToColor()
 /// </summary>
 void AzureKinectCapture::GeneratePointcloud()
 {
+	CreatePointCloudImage(nColorFrameWidth, nColorFrameHeight);
 
-	if (pointCloudImage == NULL)
+	k4a_transformation_depth_image_to_point_cloud(transformation, transformedDepthImage, K4A_CALIBRATION_TYPE_COLOR, pointCloudImage);
+
+	nPointCloudWidth = nColorFrameWidth;
+	nPointCloudHeight = nColorFrameHeight;
+	pointCloudROI = colorCullROI;
+}
+
+/// <summary>
+/// Creates a Pointcloud at depth camera resolution out of the depthImage16Int and saves it in PointcloudImage, its colors in pointCloudColorBGR.
+/// Every depth pixel is unprojected with the ray lookup table and then projected into the color image to get its color, so no depth image
+/// at color resolution is needed. The points are in color camera space, just like the ones from GeneratePointcloud.
+/// If the color has been decoded to YUV, the colors are the pixel coordinates for SampleYUVColors().
+/// Make sure to run DecodeRawColor or DecodeRawColorToYUV before calling this function
+/// </summary>
+void AzureKinectCapture::GenerateDepthNativePointcloud()
+{
+	FilterDepthImage();
+
+	int depthWidth = k4a_image_get_width_pixels(depthImage16Int);
+	int depthHeight = k4a_image_get_height_pixels(depthImage16Int);
+
+	nPointCloudWidth = 0;
+	nPointCloudHeight = 0;
+
+	if (depthRaysInColorSpace.size() != (size_t)depthWidth * depthHeight || nColorFrameWidth == 0)
+		return;
+
+	CreatePointCloudImage(depthWidth, depthHeight);
+
+	if (pointCloudColorBGR.cols != depthWidth || pointCloudColorBGR.rows != depthHeight)
+		pointCloudColorBGR = cv::Mat(depthHeight, depthWidth, CV_8UC4);
+
+	const uint16_t* depthData = (uint16_t*)k4a_image_get_buffer(depthImage16Int);
+	int16_t* pointCloudData = (int16_t*)k4a_image_get_buffer(pointCloudImage);
+	const uint32_t* colorData = (uint32_t*)colorBGR.data;
+	uint32_t* pointColorData = (uint32_t*)pointCloudColorBGR.data;
+
+	int colorWidth = nColorFrameWidth;
+	int colorHeight = nColorFrameHeight;
+	bool writeColorCoordinates = bColorDecodedToYUV;
+
+	//The color image might be decoded at a lower resolution than the one it has been calibrated for
+	float colorScaleX = (float)colorWidth / colorCameraCalibration.resolution_width;
+	float colorScaleY = (float)colorHeight / colorCameraCalibration.resolution_height;
+
+	//Pixels outside of the ROI can't end up inside the bounds, the culling doesn't look at them, so we don't generate them at all
+	CullROI roi = depthCullROI;
+	int firstCol = roi.left < depthWidth ? roi.left : depthWidth;
+	int lastCol = roi.right < depthWidth ? roi.right : depthWidth;
+	int firstRow = roi.top < depthHeight ? roi.top : depthHeight;
+	int lastRow = roi.bottom < depthHeight ? roi.bottom : depthHeight;
+
+	#pragma omp parallel for
+	for (int row = firstRow; row < lastRow; row++)
 	{
-		k4a_image_create(K4A_IMAGE_FORMAT_CUSTOM, nColorFrameWidth, nColorFrameHeight, nColorFrameWidth * 3 * (int)sizeof(int16_t), &pointCloudImage);
+		for (int col = firstCol; col < lastCol; col++)
+		{
+			int i = col + row * depthWidth;
+			int16_t* point = pointCloudData + 3 * i;
+			const Point3f& ray = depthRaysInColorSpace[i];
+			float depth = depthData[i];
+
+			//Points without depth or color stay at 0, so that they get culled
+			point[0] = 0;
+			point[1] = 0;
+			point[2] = 0;
+			pointColorData[i] = 0;
+
+			if (depthData[i] == 0 || ray.Invalid)
+				continue;
+
+			float x = ray.X * depth + depthToColorTranslation[0];
+			float y = ray.Y * depth + depthToColorTranslation[1];
+			float z = ray.Z * depth + depthToColorTranslation[2];
+
+			//Also saves the projection for the background behind the bounds
+			if (z < roi.minDepth || z > roi.maxDepth)
+				continue;
+
+			float u, v;
+			if (!ProjectToCamera(colorCameraCalibration, x, y, z, u, v))
+				continue;
+
+			//Pixel centers are at integer coordinates, so we shift by half a pixel to scale and round to the nearest pixel
+			float colorX = (u + 0.5f) * colorScaleX;
+			float colorY = (v + 0.5f) * colorScaleY;
+
+			if (colorX < 0 || colorY < 0 || colorX >= colorWidth || colorY >= colorHeight)
+				continue;
+
+			point[0] = cv::saturate_cast<int16_t>(x);
+			point[1] = cv::saturate_cast<int16_t>(y);
+			point[2] = cv::saturate_cast<int16_t>(z);
+
+			if (writeColorCoordinates)
+				pointColorData[i] = PixelCoordinatesAsColor((int)colorX, (int)colorY);
+			else
+				pointColorData[i] = colorData[(int)colorX + (int)colorY * colorWidth];
+		}
 	}
 
-	k4a_transformation_depth_image_to_point_cloud(transformation, transformedDepthImage, K4A_CALIBRATION_TYPE_COLOR, pointCloudImage);
+	nPointCloudWidth = depthWidth;
+	nPointCloudHeight = depthHeight;
+	pointCloudROI = roi;
+}
+
+/// <summary>
+/// Precomputes the ray of every depth pixel for GenerateDepthNativePointcloud. The undistortion of the depth camera and the rotation
+/// into color camera space only need to be done once, a depth pixel with depth d then lies at d * ray + depthToColorTranslation
+/// </summary>
+void AzureKinectCapture::CreateDepthRayLUT(const k4a_calibration_t& calibration)
+{
+	int width = calibration.depth_camera_calibration.resolution_width;
+	int height = calibration.depth_camera_calibration.resolution_height;
+
+	const k4a_calibration_extrinsics_t& depthToColor = calibration.extrinsics[K4A_CALIBRATION_TYPE_DEPTH][K4A_CALIBRATION_TYPE_COLOR];
+	const float* rotation = depthToColor.rotation;
+
+	depthRaysInColorSpace.assign((size_t)width * height, Point3f());
+
+	for (int row = 0; row < height; row++)
+	{
+		for (int col = 0; col < width; col++)
+		{
+			k4a_float2_t pixel;
+			pixel.xy.x = (float)col;
+			pixel.xy.y = (float)row;
+
+			k4a_float3_t ray;
+			int valid = 0;
+
+			Point3f& rayInColorSpace = depthRaysInColorSpace[col + row * width];
+
+			if (K4A_FAILED(k4a_calibration_2d_to_3d(&calibration, &pixel, 1.f, K4A_CALIBRATION_TYPE_DEPTH, K4A_CALIBRATION_TYPE_DEPTH, &ray, &valid)) || !valid)
+			{
+				rayInColorSpace.Invalid = true;
+				continue;
+			}
+
+			rayInColorSpace.X = rotation[0] * ray.xyz.x + rotation[1] * ray.xyz.y + rotation[2] * ray.xyz.z;
+			rayInColorSpace.Y = rotation[3] * ray.xyz.x + rotation[4] * ray.xyz.y + rotation[5] * ray.xyz.z;
+			rayInColorSpace.Z = rotation[6] * ray.xyz.x + rotation[7] * ray.xyz.y + rotation[8] * ray.xyz.z;
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+		depthToColorTranslation[i] = depthToColor.translation[i];
+
+	colorCameraCalibration = calibration.color_camera_calibration;
+}
+
+/// <summary>
+/// Makes sure the pointCloudImage has the given size. It's only reallocated when the size changes, e.g. when switching between
+/// color and depth resolution pointclouds
+/// </summary>
+void AzureKinectCapture::CreatePointCloudImage(int width, int height)
+{
+	if (pointCloudImage != NULL && (k4a_image_get_width_pixels(pointCloudImage) != width || k4a_image_get_height_pixels(pointCloudImage) != height))
+	{
+		k4a_image_release(pointCloudImage);
+		pointCloudImage = NULL;
+	}
+
+	if (pointCloudImage == NULL)
+	{
+		k4a_image_create(K4A_IMAGE_FORMAT_CUSTOM, width, height, width * 3 * (int)sizeof(int16_t), &pointCloudImage);
+	}
 }
 
 
@@ -431,10 +827,159 @@ void AzureKinectCapture::SetWhiteBalanceState(bool enableAutoBalance, int kelvin
 	}
 }
 
-void AzureKinectCapture::SetFilters(bool depthFilterEnabled, int depthFilterSize)
+/// <summary>
+/// Takes over the depth filter settings of the configuration, see DepthFilter
+/// </summary>
+void AzureKinectCapture::SetFilters(KinectConfiguration& newConfiguration)
+{
+	configuration.filter_depth_map = newConfiguration.filter_depth_map;
+	configuration.filter_depth_map_size = newConfiguration.filter_depth_map_size;
+	configuration.filter_flying_pixels = newConfiguration.filter_flying_pixels;
+	configuration.flying_pixel_threshold = newConfiguration.flying_pixel_threshold;
+	configuration.filter_small_components = newConfiguration.filter_small_components;
+	configuration.small_component_size = newConfiguration.small_component_size;
+}
+
+/// <summary>
+/// Learns a new background model from the next frames that are passed to AddBackgroundFrame(). Only call this while no frame is being processed
+/// </summary>
+void AzureKinectCapture::LearnBackground(int frames)
+{
+	logBuffer.LogInfo("Learning the background from the next " + std::to_string(frames) + " frames, the scene should be empty");
+	backgroundModel.StartLearning(frames);
+	backgroundMismatchLogged = false;
+}
+
+/// <summary>
+/// Adds the depth image of the current frame to the background model that is being learned. Has to be called before the depth image
+/// gets filtered, the model is learned from the unfiltered depth. Stores the model once it is finished
+/// </summary>
+void AzureKinectCapture::AddBackgroundFrame()
 {
-	configuration.filter_depth_map = depthFilterEnabled;
-	configuration.filter_depth_map_size = depthFilterSize;
+	if (depthImage16Int == NULL || depthImageFiltered)
+		return;
+
+	if (!backgroundModel.AddFrame((uint16_t*)k4a_image_get_buffer(depthImage16Int), k4a_image_get_width_pixels(depthImage16Int), k4a_image_get_height_pixels(depthImage16Int)))
+		return;
+
+	logBuffer.LogInfo("Learned the background, " + std::to_string(backgroundModel.GetModeledPixelsPercent()) + "% of the pixels are modeled");
+
+	if (!backgroundModel.Save(serialNumber))
+		logBuffer.LogWarning("Could not store the background model, it will be gone when the client restarts");
+}
+
+/// <summary>
+/// Stops subtracting the background and removes the stored model. Only call this while no frame is being processed
+/// </summary>
+void AzureKinectCapture::ClearBackground()
+{
+	logBuffer.LogInfo("Clearing the background model");
+	backgroundModel.Clear();
+	BackgroundModel::Delete(serialNumber);
+}
+
+/// <summary>
+/// Loads the background model that was stored for this device. Only call this while no frame is being processed
+/// </summary>
+bool AzureKinectCapture::LoadBackground()
+{
+	backgroundMismatchLogged = false;
+	return backgroundModel.Load(serialNumber);
+}
+
+void AzureKinectCapture::SetBackgroundTolerance(float sigmas)
+{
+	backgroundModel.SetTolerance(sigmas);
+}
+
+/// <summary>
+/// Sets the decode scale of the color image. Only call this while no frame is being processed
+/// </summary>
+/// <param name="scale">Decodes the color image at 1/scale of its resolution. Can be 1, 2, 4 or 8</param>
+void AzureKinectCapture::SetColorDecodeScale(int scale)
+{
+	if (scale == colorDecodeScale)
+		return;
+
+	logBuffer.LogDebug("Setting color decode scale to 1/" + std::to_string(scale));
+
+	colorDecodeScale = scale;
+	configuration.color_decode_scale = scale;
+
+	if (bStarted)
+		CreateColorTransformation();
+}
+
+/// <summary>
+/// Creates the transformation between the depth camera and the color image as DecodeRawColor() outputs it.
+/// When the color image is decoded at a lower scale, the color intrinsics are scaled down the same way as for the downscaled transformation
+/// </summary>
+void AzureKinectCapture::CreateColorTransformation()
+{
+	if (transformation != NULL)
+		k4a_transformation_destroy(transformation);
+
+	k4a_calibration_t calibrationColorScaled;
+	memcpy(&calibrationColorScaled, &cameraCalibration, sizeof(k4a_calibration_t));
+
+	tjscalingfactor scalingFactor = { 1, colorDecodeScale };
+	float scale = (float)colorDecodeScale;
+
+	calibrationColorScaled.color_camera_calibration.resolution_width = TJSCALED(cameraCalibration.color_camera_calibration.resolution_width, scalingFactor);
+	calibrationColorScaled.color_camera_calibration.resolution_height = TJSCALED(cameraCalibration.color_camera_calibration.resolution_height, scalingFactor);
+	calibrationColorScaled.color_camera_calibration.intrinsics.parameters.param.cx /= scale;
+	calibrationColorScaled.color_camera_calibration.intrinsics.parameters.param.cy /= scale;
+	calibrationColorScaled.color_camera_calibration.intrinsics.parameters.param.fx /= scale;
+	calibrationColorScaled.color_camera_calibration.intrinsics.parameters.param.fy /= scale;
+	transformation = k4a_transformation_create(&calibrationColorScaled);
+
+	//The color ROI depends on the decode scale
+	UpdateCullROIs();
+}
+
+/// <summary>
+/// Sets the bounds that the pointclouds get culled with, so that the parts of the image that can't lie inside them are skipped.
+/// Call this whenever the bounds or the world transformation change
+/// </summary>
+/// <param name="toWorld">Transforms color camera space (in mm) into world space (in m)</param>
+void AzureKinectCapture::SetCullBounds(const Matrix4x4& toWorld, const float* bounds)
+{
+	Matrix4x4 transform = toWorld;
+	colorFromWorld = transform.Inverse();
+
+	for (int i = 0; i < 6; i++)
+		cullBounds[i] = bounds[i];
+
+	cullBoundsSet = true;
+
+	if (bStarted)
+		UpdateCullROIs();
+}
+
+/// <summary>
+/// Projects the cull bounds into the color and depth image, see ProjectBoundsToROI()
+/// </summary>
+void AzureKinectCapture::UpdateCullROIs()
+{
+	colorCullROI = CullROI();
+	depthCullROI = CullROI();
+
+	if (!cullBoundsSet)
+		return;
+
+	tjscalingfactor scalingFactor = { 1, colorDecodeScale };
+	int colorWidth = TJSCALED(cameraCalibration.color_camera_calibration.resolution_width, scalingFactor);
+	int colorHeight = TJSCALED(cameraCalibration.color_camera_calibration.resolution_height, scalingFactor);
+
+	colorCullROI = ProjectBoundsToROI(colorFromWorld, cullBounds, cameraCalibration.color_camera_calibration, NULL,
+		colorWidth, colorHeight, 1.f / colorDecodeScale);
+
+	depthCullROI = ProjectBoundsToROI(colorFromWorld, cullBounds, cameraCalibration.depth_camera_calibration, &cameraCalibration.extrinsics[K4A_CALIBRATION_TYPE_COLOR][K4A_CALIBRATION_TYPE_DEPTH],
+		cameraCalibration.depth_camera_calibration.resolution_width, cameraCalibration.depth_camera_calibration.resolution_height, 1.f);
+
+	logBuffer.LogDebug("Cull ROI color: " + std::to_string(colorCullROI.left) + ", " + std::to_string(colorCullROI.top) + " - " + std::to_string(colorCullROI.right) + ", " + std::to_string(colorCullROI.bottom) +
+		", depth: " + std::to_string(depthCullROI.left) + ", " + std::to_string(depthCullROI.top) + " - " + std::to_string(depthCullROI.right) + ", " + std::to_string(depthCullROI.bottom) +
+		", Z: " + std::to_string((int)colorCullROI.minDepth) + " - " + std::to_string((int)colorCullROI.maxDepth) + "mm");
 }
 
 bool AzureKinectCapture::AquireSerialFromDevice()
@@ -43,7 +43,10 @@ bool AzureKinectCaptureVirtual::StartCamera(KinectConfiguration& configuration)
 	if (GetIntrinsicsJSON(calibrationBuffer, nCalibrationSize))
 	{
 		k4a_calibration_get_from_raw((char*)calibrationBuffer.data(), nCalibrationSize, configuration.config.depth_mode, configuration.config.color_resolution, &calibration);
-		transformation = k4a_transformation_create(&calibration);
+		cameraCalibration = calibration;
+		colorDecodeScale = configuration.color_decode_scale;
+		CreateColorTransformation();
+		CreateDepthRayLUT(calibration);
 	}
 
 	else
@@ -96,6 +99,8 @@ void AzureKinectCaptureVirtual::StopCamera()
 
 	logBuffer.LogInfo("Stopping Virtual Azure Kinect camera");
 
+	k4a_image_release(aquiredFrame.colorImageMJPG);
+	k4a_image_release(aquiredFrame.depthImage16Int);
 	k4a_image_release(colorImageMJPG);
 	k4a_image_release(depthImage16Int);
 	k4a_image_release(pointCloudImage);
@@ -104,7 +109,10 @@ void AzureKinectCaptureVirtual::StopCamera()
 	k4a_image_release(colorImageDownscaled);
 	k4a_transformation_destroy(transformationColorDownscaled);
 	k4a_transformation_destroy(transformation);
+	pointCloudColorBGR.release();
+	depthRaysInColorSpace.clear();
 
+	aquiredFrame = RawFrame();
 	colorImageMJPG = NULL;
 	depthImage16Int = NULL;
 	pointCloudImage = NULL;
@@ -161,19 +169,22 @@ bool AzureKinectCaptureVirtual::AquireRawFrame()
 	int imageSequenceIndex = framesPassed % m_vVirtualColorImageSequence.size();
 
 	//We have to release the depth image, as it get's copied every frame
-	k4a_image_release(depthImage16Int);
+	k4a_image_release(aquiredFrame.depthImage16Int);
+	k4a_image_release(aquiredFrame.colorImageMJPG);
 
-	colorImageMJPG = m_vVirtualColorImageSequence[imageSequenceIndex];
+	//The color image is shared with the buffered sequence, so we take our own reference on it
+	aquiredFrame.colorImageMJPG = m_vVirtualColorImageSequence[imageSequenceIndex];
+	k4a_image_reference(aquiredFrame.colorImageMJPG);
 
 	//We create a copy of the depth images, so that the buffered sequence won't be affected by possible modifications to the "aquired" image
 	//We don't have to do this for the color image, as it will be decoded and duplicated anyways
 	int width = k4a_image_get_width_pixels(m_vVirtualDepthImageSequence[imageSequenceIndex]);
 	int height = k4a_image_get_height_pixels(m_vVirtualDepthImageSequence[imageSequenceIndex]);
 	int step = k4a_image_get_stride_bytes(m_vVirtualDepthImageSequence[imageSequenceIndex]);
-	k4a_image_create(K4A_IMAGE_FORMAT_DEPTH16, width, height, step, &depthImage16Int);
-	memcpy(k4a_image_get_buffer(depthImage16Int), k4a_image_get_buffer(m_vVirtualDepthImageSequence[imageSequenceIndex]), step * height);
+	k4a_image_create(K4A_IMAGE_FORMAT_DEPTH16, width, height, step, &aquiredFrame.depthImage16Int);
+	memcpy(k4a_image_get_buffer(aquiredFrame.depthImage16Int), k4a_image_get_buffer(m_vVirtualDepthImageSequence[imageSequenceIndex]), step * height);
 
-	currentTimeStamp = timeStamp;
+	aquiredFrame.timeStamp = timeStamp;
 	m_lLastFrameTimeus = timeStamp;
 
 	return true;
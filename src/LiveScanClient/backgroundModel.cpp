@@ -0,0 +1,245 @@
+#include "backgroundModel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+	const uint32_t backgroundFileMagic = 0x4742534C; //"LSBG"
+	const uint32_t backgroundFileVersion = 1;
+
+	//Pixels need a valid depth in at least this share of the learning frames to get a model
+	const float minValidSamplesShare = 0.5f;
+
+	//The sensor noise grows with the depth. Pixels that barely changed while learning would otherwise get a tolerance of almost nothing
+	const float minTolerancePercent = 1.0f;
+}
+
+/// <summary>
+/// Drops the current model and learns a new one from the next frames that are passed to AddFrame()
+/// </summary>
+void BackgroundModel::StartLearning(int frames)
+{
+	Clear();
+	m_nFramesToLearn = frames;
+}
+
+/// <summary>
+/// Adds the unfiltered depth image of an empty scene to the model that is being learned
+/// </summary>
+/// <returns>True if this was the last frame, the model is finished then</returns>
+bool BackgroundModel::AddFrame(const uint16_t* depth, int width, int height)
+{
+	if (!IsLearning())
+		return false;
+
+	int pixelCount = width * height;
+
+	//The depth mode might have changed in the middle of learning, only the frames at the latest resolution count
+	if (!Matches(width, height) || m_vSamples.empty())
+	{
+		m_nWidth = width;
+		m_nHeight = height;
+		m_nFramesLearned = 0;
+		m_vRunningMean.assign(pixelCount, 0.0f);
+		m_vRunningSquares.assign(pixelCount, 0.0f);
+		m_vSamples.assign(pixelCount, 0);
+	}
+
+	#pragma omp parallel for
+	for (int i = 0; i < pixelCount; i++)
+	{
+		if (depth[i] == 0)
+			continue;
+
+		float value = depth[i];
+		float count = ++m_vSamples[i];
+		float difference = value - m_vRunningMean[i];
+		m_vRunningMean[i] += difference / count;
+		m_vRunningSquares[i] += difference * (value - m_vRunningMean[i]);
+	}
+
+	m_nFramesLearned++;
+
+	if (--m_nFramesToLearn > 0)
+		return false;
+
+	FinishLearning();
+	return true;
+}
+
+void BackgroundModel::FinishLearning()
+{
+	int pixelCount = m_nWidth * m_nHeight;
+	int minSamples = (std::max)(1, (int)std::ceil(m_nFramesLearned * minValidSamplesShare));
+
+	m_vMean.assign(pixelCount, 0.0f);
+	m_vDeviation.assign(pixelCount, 0.0f);
+
+	for (int i = 0; i < pixelCount; i++)
+	{
+		if (m_vSamples[i] < minSamples)
+			continue;
+
+		m_vMean[i] = m_vRunningMean[i];
+		m_vDeviation[i] = std::sqrt(m_vRunningSquares[i] / m_vSamples[i]);
+	}
+
+	m_vRunningMean.clear();
+	m_vRunningSquares.clear();
+	m_vSamples.clear();
+
+	UpdateThresholds();
+}
+
+void BackgroundModel::Clear()
+{
+	m_nWidth = 0;
+	m_nHeight = 0;
+	m_nFramesToLearn = 0;
+	m_nFramesLearned = 0;
+	m_vRunningMean.clear();
+	m_vRunningSquares.clear();
+	m_vSamples.clear();
+	m_vMean.clear();
+	m_vDeviation.clear();
+	m_vLower.clear();
+	m_vUpper.clear();
+}
+
+int BackgroundModel::GetModeledPixelsPercent() const
+{
+	if (m_vMean.empty())
+		return 0;
+
+	size_t modeled = 0;
+
+	for (size_t i = 0; i < m_vMean.size(); i++)
+	{
+		if (m_vMean[i] > 0)
+			modeled++;
+	}
+
+	return (int)(modeled * 100 / m_vMean.size());
+}
+
+/// <param name="sigmas">How many standard deviations a pixel may be away from the mean and still count as background</param>
+void BackgroundModel::SetTolerance(float sigmas)
+{
+	if (sigmas == m_fTolerance)
+		return;
+
+	m_fTolerance = sigmas;
+	UpdateThresholds();
+}
+
+void BackgroundModel::UpdateThresholds()
+{
+	if (m_vMean.empty())
+		return;
+
+	size_t pixelCount = m_vMean.size();
+	m_vLower.resize(pixelCount);
+	m_vUpper.resize(pixelCount);
+
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		//An empty range, so that pixels without a model are never removed
+		if (m_vMean[i] <= 0)
+		{
+			m_vLower[i] = UINT16_MAX;
+			m_vUpper[i] = 0;
+			continue;
+		}
+
+		float tolerance = (std::max)(m_fTolerance * m_vDeviation[i], m_vMean[i] * minTolerancePercent / 100.0f);
+		m_vLower[i] = (uint16_t)(std::max)(1.0f, m_vMean[i] - tolerance);
+		m_vUpper[i] = (uint16_t)(std::min)((float)UINT16_MAX, m_vMean[i] + tolerance);
+	}
+}
+
+/// <summary>
+/// Invalidates all pixels of the depth image that belong to the background
+/// </summary>
+/// <returns>False if the model was learned at another depth resolution, the image is left untouched then</returns>
+bool BackgroundModel::Subtract(uint16_t* depth, int width, int height)
+{
+	if (!IsValid() || !Matches(width, height))
+		return false;
+
+	int pixelCount = width * height;
+	const uint16_t* lower = m_vLower.data();
+	const uint16_t* upper = m_vUpper.data();
+
+	#pragma omp parallel for
+	for (int i = 0; i < pixelCount; i++)
+	{
+		if (depth[i] >= lower[i] && depth[i] <= upper[i])
+			depth[i] = 0;
+	}
+
+	return true;
+}
+
+std::string BackgroundModel::GetPath(const std::string& serialNumber)
+{
+	return "temp/background_" + serialNumber + ".bin";
+}
+
+bool BackgroundModel::Save(const std::string& serialNumber) const
+{
+	if (!IsValid())
+		return false;
+
+	std::ofstream file(GetPath(serialNumber), std::ios::binary);
+
+	if (!file.is_open())
+		return false;
+
+	uint32_t header[4] = { backgroundFileMagic, backgroundFileVersion, (uint32_t)m_nWidth, (uint32_t)m_nHeight };
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)m_vMean.data(), m_vMean.size() * sizeof(float));
+	file.write((const char*)m_vDeviation.data(), m_vDeviation.size() * sizeof(float));
+
+	return file.good();
+}
+
+/// <returns>False if there is no model stored for this camera, the current model is kept then</returns>
+bool BackgroundModel::Load(const std::string& serialNumber)
+{
+	std::ifstream file(GetPath(serialNumber), std::ios::binary);
+
+	if (!file.is_open())
+		return false;
+
+	uint32_t header[4];
+
+	if (!file.read((char*)header, sizeof(header)) || header[0] != backgroundFileMagic || header[1] != backgroundFileVersion ||
+		header[2] == 0 || header[3] == 0 || header[2] > 8192 || header[3] > 8192)
+		return false;
+
+	size_t pixelCount = (size_t)header[2] * header[3];
+	std::vector<float> mean(pixelCount);
+	std::vector<float> deviation(pixelCount);
+
+	if (!file.read((char*)mean.data(), pixelCount * sizeof(float)) || !file.read((char*)deviation.data(), pixelCount * sizeof(float)))
+		return false;
+
+	Clear();
+	m_nWidth = header[2];
+	m_nHeight = header[3];
+	m_vMean.swap(mean);
+	m_vDeviation.swap(deviation);
+	UpdateThresholds();
+
+	return true;
+}
+
+/// <summary>
+/// Removes the stored model, so that it isn't loaded again the next time the client starts
+/// </summary>
+void BackgroundModel::Delete(const std::string& serialNumber)
+{
+	std::remove(GetPath(serialNumber).c_str());
+}
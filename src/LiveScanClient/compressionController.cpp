@@ -0,0 +1,188 @@
+#include "compressionController.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	//Above this, zstd gets much slower for little gain on pointclouds
+	const int maxAdaptiveLevel = 9;
+	const int minAdaptiveLevel = 1;
+
+	//Frames per decision, so a single slow frame doesn't change anything
+	const int windowFrames = 15;
+
+	//How many windows a level that overran the budget stays off limits
+	const int ceilingWindows = 20;
+
+	//Share of the frame interval compressing and sending may take, the rest is headroom for jitter
+	const float budgetShare = 0.8f;
+
+	//Below this share of the budget, there is room to compress harder or to give workers back
+	const float headroomShare = 0.5f;
+}
+
+CompressionController::CompressionController()
+{
+	unsigned int threads = std::thread::hardware_concurrency();
+
+	//Leave at least half of the cores to the rest of the pipeline
+	m_nMaxWorkers = (std::max)(1, (std::min)(8, (int)threads / 2));
+
+	SetFrameInterval(1000.0f / 30.0f);
+	Reset(2);
+}
+
+/// <summary>
+/// Starts over from the given level with a single worker, called whenever the server sends new settings
+/// </summary>
+void CompressionController::Reset(int level)
+{
+	m_nLevel = (std::max)(minAdaptiveLevel, (std::min)(maxAdaptiveLevel, level));
+	m_nWorkers = 1;
+
+	m_nLevelCeiling = maxAdaptiveLevel + 1;
+	m_nCeilingWindows = 0;
+
+	m_nWindowFrames = 0;
+	m_dWindowCompressMs = 0;
+	m_dWindowSendMs = 0;
+	m_dWindowUncompressedBytes = 0;
+	m_dWindowSentBytes = 0;
+
+	m_sLastDecision.clear();
+
+	std::lock_guard<std::mutex> lock(m_mStats);
+	m_Stats = CompressionStats();
+	m_Stats.level = m_nLevel;
+	m_Stats.workers = m_nWorkers;
+}
+
+/// <summary>
+/// The time between two frames of the camera, compressing and sending a frame should fit into it
+/// </summary>
+void CompressionController::SetFrameInterval(float frameIntervalMs)
+{
+	m_fBudgetMs = frameIntervalMs * budgetShare;
+}
+
+/// <summary>
+/// Adds the measurements of one sent frame. Once a window is complete, the level and the workers are adjusted
+/// </summary>
+/// <param name="sendMs">Time the socket blocked while sending. When compressing and sending overlap, only the blocking part</param>
+/// <returns>True if the level or the number of workers changed, GetLastDecision() tells why</returns>
+bool CompressionController::AddFrame(double compressMs, double sendMs, int uncompressedBytes, int sentBytes)
+{
+	m_nWindowFrames++;
+	m_dWindowCompressMs += compressMs;
+	m_dWindowSendMs += sendMs;
+	m_dWindowUncompressedBytes += uncompressedBytes;
+	m_dWindowSentBytes += sentBytes;
+
+	if (m_nWindowFrames < windowFrames)
+		return false;
+
+	double averageCompressMs = m_dWindowCompressMs / m_nWindowFrames;
+	double averageSendMs = m_dWindowSendMs / m_nWindowFrames;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mStats);
+		m_Stats.compressMs = (float)averageCompressMs;
+		m_Stats.sendMs = (float)averageSendMs;
+		m_Stats.ratio = m_dWindowSentBytes > 0 ? (float)(m_dWindowUncompressedBytes / m_dWindowSentBytes) : 0;
+		m_Stats.sentMBps = m_dWindowSendMs > 0 ? (float)(m_dWindowSentBytes / 1000.0 / m_dWindowSendMs) : 0;
+	}
+
+	m_nWindowFrames = 0;
+	m_dWindowCompressMs = 0;
+	m_dWindowSendMs = 0;
+	m_dWindowUncompressedBytes = 0;
+	m_dWindowSentBytes = 0;
+
+	if (m_nCeilingWindows > 0 && --m_nCeilingWindows == 0)
+		m_nLevelCeiling = maxAdaptiveLevel + 1;
+
+	bool changed = Adjust(averageCompressMs, averageSendMs);
+
+	if (changed)
+	{
+		std::lock_guard<std::mutex> lock(m_mStats);
+		m_Stats.level = m_nLevel;
+		m_Stats.workers = m_nWorkers;
+		m_Stats.adjustments++;
+	}
+
+	return changed;
+}
+
+bool CompressionController::Adjust(double compressMs, double sendMs)
+{
+	double frameMs = compressMs + sendMs;
+	std::string measured = "compress " + std::to_string((int)compressMs) + " ms + send " + std::to_string((int)sendMs) + " ms, budget " +
+		std::to_string((int)m_fBudgetMs) + " ms";
+
+	if (frameMs > m_fBudgetMs)
+	{
+		if (sendMs >= compressMs)
+		{
+			if (m_nLevel >= maxAdaptiveLevel || m_nLevel + 1 >= m_nLevelCeiling)
+				return false;
+
+			m_nLevel++;
+			m_sLastDecision = "Link bound (" + measured + "), raising level to " + std::to_string(m_nLevel);
+			return true;
+		}
+
+		if (m_nWorkers < m_nMaxWorkers)
+		{
+			m_nWorkers = (std::min)(m_nMaxWorkers, m_nWorkers * 2);
+			m_sLastDecision = "Compression bound (" + measured + "), using " + std::to_string(m_nWorkers) + " workers";
+			return true;
+		}
+
+		if (m_nLevel > minAdaptiveLevel)
+		{
+			m_nLevelCeiling = m_nLevel;
+			m_nCeilingWindows = ceilingWindows;
+			m_nLevel--;
+			m_sLastDecision = "Compression bound with all workers (" + measured + "), lowering level to " + std::to_string(m_nLevel);
+			return true;
+		}
+
+		return false;
+	}
+
+	if (frameMs > m_fBudgetMs * headroomShare)
+		return false;
+
+	//Halving the workers roughly doubles the compression time, only do it if that still leaves headroom
+	if (m_nWorkers > 1 && compressMs * 2 + sendMs < m_fBudgetMs * headroomShare)
+	{
+		m_nWorkers /= 2;
+		m_sLastDecision = "Headroom (" + measured + "), reducing to " + std::to_string(m_nWorkers) + " workers";
+		return true;
+	}
+
+	if (m_nLevel < maxAdaptiveLevel && m_nLevel + 1 < m_nLevelCeiling)
+	{
+		m_nLevel++;
+		m_sLastDecision = "Headroom (" + measured + "), raising level to " + std::to_string(m_nLevel);
+		return true;
+	}
+
+	return false;
+}
+
+CompressionStats CompressionController::GetStatsTS()
+{
+	std::lock_guard<std::mutex> lock(m_mStats);
+	return m_Stats;
+}
+
+std::string CompressionController::GetStatsString()
+{
+	CompressionStats stats = GetStatsTS();
+
+	return "level= " + std::to_string(stats.level) + " workers= " + std::to_string(stats.workers) + " compress= " + std::to_string(stats.compressMs) +
+		" ms send= " + std::to_string(stats.sendMs) + " ms ratio= " + std::to_string(stats.ratio) + " link= " + std::to_string(stats.sentMBps) +
+		" MB/s adjustments= " + std::to_string(stats.adjustments);
+}
@@ -0,0 +1,197 @@
+#include "depthFilter.h"
+#include <emmintrin.h>
+#include <cstring>
+
+namespace
+{
+	/// <summary>
+	/// The jump threshold as 16 bit fixed point fraction, so that the maximum jump of a pixel is (depth * factor) >> 16
+	/// </summary>
+	inline uint16_t JumpFactor(int maxJumpPercent)
+	{
+		if (maxJumpPercent < 1)
+			maxJumpPercent = 1;
+
+		if (maxJumpPercent > 99)
+			maxJumpPercent = 99;
+
+		return static_cast<uint16_t>((maxJumpPercent << 16) / 100);
+	}
+
+	inline bool IsJump(uint16_t center, uint16_t neighbour, uint16_t maxJump)
+	{
+		//Neighbours without depth are holes, not edges
+		if (neighbour == 0)
+			return false;
+
+		int difference = center > neighbour ? center - neighbour : neighbour - center;
+		return difference > maxJump;
+	}
+}
+
+/// <summary>
+/// Runs all depth filters that are enabled in the configuration on the depth image, in place
+/// </summary>
+void DepthFilter::Apply(uint16_t* depth, int width, int height, const KinectConfiguration& configuration)
+{
+	if (configuration.filter_flying_pixels)
+		RemoveFlyingPixels(depth, width, height, configuration.flying_pixel_threshold);
+
+	if (configuration.filter_small_components)
+		RemoveSmallComponents(depth, width, height, configuration.flying_pixel_threshold, configuration.small_component_size);
+
+	if (configuration.filter_depth_map)
+		Erode(depth, width, height, configuration.filter_depth_map_size);
+}
+
+/// <summary>
+/// Invalidates every pixel that has a valid neighbour (left, right, above or below) whose depth differs from its own by more
+/// than maxJumpPercent of its depth. Processes 8 pixels per SSE2 instruction
+/// </summary>
+void DepthFilter::RemoveFlyingPixels(uint16_t* depth, int width, int height, int maxJumpPercent)
+{
+	int stride = width + 2;
+	m_vPaddedDepth.assign((size_t)stride * (height + 2), 0);
+
+	for (int row = 0; row < height; row++)
+		memcpy(m_vPaddedDepth.data() + (row + 1) * stride + 1, depth + row * width, width * sizeof(uint16_t));
+
+	const uint16_t factor = JumpFactor(maxJumpPercent);
+	const uint16_t* padded = m_vPaddedDepth.data();
+
+	#pragma omp parallel for
+	for (int row = 0; row < height; row++)
+	{
+		const uint16_t* source = padded + (row + 1) * stride + 1;
+		uint16_t* output = depth + row * width;
+
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i factors = _mm_set1_epi16((short)factor);
+
+		int col = 0;
+		for (; col + 8 <= width; col += 8)
+		{
+			__m128i center = _mm_loadu_si128((const __m128i*)(source + col));
+			__m128i maxJump = _mm_mulhi_epu16(center, factors);
+			__m128i jump = zero;
+
+			const uint16_t* neighbours[4] = { source + col - 1, source + col + 1, source + col - stride, source + col + stride };
+
+			for (int n = 0; n < 4; n++)
+			{
+				__m128i neighbour = _mm_loadu_si128((const __m128i*)neighbours[n]);
+				__m128i difference = _mm_or_si128(_mm_subs_epu16(center, neighbour), _mm_subs_epu16(neighbour, center));
+
+				//There are no unsigned 16 bit compares, but the saturated difference is only 0 if it's within the limit
+				__m128i withinLimit = _mm_cmpeq_epi16(_mm_subs_epu16(difference, maxJump), zero);
+				__m128i hole = _mm_cmpeq_epi16(neighbour, zero);
+
+				jump = _mm_or_si128(jump, _mm_andnot_si128(_mm_or_si128(withinLimit, hole), _mm_cmpeq_epi16(zero, zero)));
+			}
+
+			_mm_storeu_si128((__m128i*)(output + col), _mm_andnot_si128(jump, center));
+		}
+
+		for (; col < width; col++)
+		{
+			uint16_t center = source[col];
+			uint16_t maxJump = static_cast<uint16_t>((center * factor) >> 16);
+
+			if (IsJump(center, source[col - 1], maxJump) || IsJump(center, source[col + 1], maxJump)
+				|| IsJump(center, source[col - stride], maxJump) || IsJump(center, source[col + stride], maxJump))
+				output[col] = 0;
+			else
+				output[col] = center;
+		}
+	}
+}
+
+/// <summary>
+/// Finds the connected regions of the depth image with a flood fill and invalidates all that have less than minComponentSize pixels.
+/// Two neighbouring pixels belong to the same region if their depth is continuous by the same criteria as the flying pixel filter.
+/// Every pixel is visited a constant number of times, so this runs in linear time
+/// </summary>
+void DepthFilter::RemoveSmallComponents(uint16_t* depth, int width, int height, int maxJumpPercent, int minComponentSize)
+{
+	//Works on a padded copy, the invalid border stops the flood fill without checking the image bounds
+	int stride = width + 2;
+	int paddedCount = stride * (height + 2);
+	m_vPaddedDepth.assign(paddedCount, 0);
+
+	for (int row = 0; row < height; row++)
+		memcpy(m_vPaddedDepth.data() + (row + 1) * stride + 1, depth + row * width, width * sizeof(uint16_t));
+
+	const uint16_t factor = JumpFactor(maxJumpPercent);
+	const uint16_t* padded = m_vPaddedDepth.data();
+	const int offsets[4] = { -1, 1, -stride, stride };
+
+	m_vComponentLabels.assign(paddedCount, 0);
+
+	if (m_vComponentPixels.capacity() < (size_t)paddedCount)
+		m_vComponentPixels.reserve(paddedCount);
+
+	int32_t* labels = m_vComponentLabels.data();
+	int32_t label = 0;
+
+	for (int start = stride; start < paddedCount - stride; start++)
+	{
+		if (padded[start] == 0 || labels[start] != 0)
+			continue;
+
+		label++;
+		m_vComponentPixels.clear();
+		m_vComponentPixels.push_back(start);
+		labels[start] = label;
+
+		//The pixel list doubles as the queue of the flood fill
+		for (size_t next = 0; next < m_vComponentPixels.size(); next++)
+		{
+			int pixel = m_vComponentPixels[next];
+			uint16_t center = padded[pixel];
+			uint16_t maxJump = static_cast<uint16_t>((center * factor) >> 16);
+
+			for (int n = 0; n < 4; n++)
+			{
+				int neighbour = pixel + offsets[n];
+
+				if (labels[neighbour] != 0 || padded[neighbour] == 0 || IsJump(center, padded[neighbour], maxJump))
+					continue;
+
+				labels[neighbour] = label;
+				m_vComponentPixels.push_back(neighbour);
+			}
+		}
+
+		if ((int)m_vComponentPixels.size() < minComponentSize)
+		{
+			for (int pixel : m_vComponentPixels)
+			{
+				int row = pixel / stride - 1;
+				int col = pixel % stride - 1;
+				depth[col + row * width] = 0;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Erodes the depth image with a rectangular kernel. The kernel and the output image are only recreated when the size changes
+/// </summary>
+void DepthFilter::Erode(uint16_t* depth, int width, int height, int kernelSize)
+{
+	if (kernelSize < 1)
+		return;
+
+	if (m_nErosionKernelSize != kernelSize)
+	{
+		m_ErosionKernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernelSize, kernelSize));
+		m_nErosionKernelSize = kernelSize;
+	}
+
+	if (m_ErodedDepth.cols != width || m_ErodedDepth.rows != height)
+		m_ErodedDepth = cv::Mat(height, width, CV_16UC1);
+
+	cv::Mat depthImage = cv::Mat(height, width, CV_16UC1, depth);
+	cv::erode(depthImage, m_ErodedDepth, m_ErosionKernel);
+	m_ErodedDepth.copyTo(depthImage);
+}
@@ -13,63 +13,310 @@
 //        year={2015},
 //    }
 #include "filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
-using namespace std;
+namespace
+{
+	//Short coordinates can be negative, the voxel coordinates are counted from the lowest possible coordinate instead
+	const int voxelOffset = 32768;
+
+	inline uint32_t VoxelHash(int x, int y, int z)
+	{
+		return (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+	}
+
+	/// <summary>
+	/// The 27 voxels around a point, nearest first. On a dense surface the own voxel mostly holds enough neighbours already,
+	/// so the search can stop before it scans the voxels that barely overlap the radius
+	/// </summary>
+	struct VoxelNeighbourhood
+	{
+		int offsets[27][3];
+
+		VoxelNeighbourhood()
+		{
+			int n = 0;
+
+			//Sorted by the number of axes in which the voxel is offset: center, faces, edges, corners
+			for (int axes = 0; axes <= 3; axes++)
+			{
+				for (int dz = -1; dz <= 1; dz++)
+				{
+					for (int dy = -1; dy <= 1; dy++)
+					{
+						for (int dx = -1; dx <= 1; dx++)
+						{
+							if (abs(dx) + abs(dy) + abs(dz) != axes)
+								continue;
+
+							offsets[n][0] = dx;
+							offsets[n][1] = dy;
+							offsets[n][2] = dz;
+							n++;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const VoxelNeighbourhood voxelNeighbourhood;
 
-vector<KNNeighborsResult> KNNeighbors(PointCloud &cloud, kdTree &tree, int k)
+	//Voxel coordinates take 16 bits each in the key, which holds for all leaf sizes from one millimeter up
+	const float minLeafSize = 1.0f;
+	const uint64_t emptyVoxelKey = UINT64_MAX;
+
+	//The point count of a surface falls with the square of the leaf size. A few attempts are enough to get below the budget,
+	//the rest is cut off by subsampling the voxels
+	const int maxBudgetAttempts = 4;
+	const float budgetLeafMargin = 1.05f;
+
+	//Frames below this share of the budget let the raised leaf size shrink by the factor for the next frame
+	const float budgetRelaxShare = 0.7f;
+	const float budgetRelaxFactor = 0.95f;
+}
+
+/// <summary>
+/// Removes all points that have less than minNeighbors other points within radius (in millimeters, like the vertices) and compacts
+/// the survivors to the front of the vertices and colors, keeping their order.
+/// </summary>
+/// <returns>The number of points that survived</returns>
+int OutlierFilter::Apply(Point3s* vertices, RGBA* colors, int count, int radius, int minNeighbors)
 {
-	vector<KNNeighborsResult> result(cloud.pts.size());
-	int nCloudPts = static_cast<int>(cloud.pts.size());
+	if (count <= 0 || radius <= 0 || minNeighbors <= 0)
+		return count;
+
+	//Most voxels hold many points, so one bucket per point keeps the chains short without making the bucket table bigger than it needs to be
+	uint32_t bucketCount = 1024;
+	while (bucketCount < (uint32_t)count)
+		bucketCount <<= 1;
 
-#pragma omp parallel for
-	for (int i = 0; i < nCloudPts; i++)
+	const uint32_t bucketMask = bucketCount - 1;
+
+	m_vPointBuckets.resize(count);
+	uint32_t* pointBuckets = m_vPointBuckets.data();
+
+	#pragma omp parallel for
+	for (int i = 0; i < count; i++)
 	{
-		result[i].neighbors.resize(k);
-		result[i].distances.resize(k);
-		tree.knnSearch((float*)(cloud.pts.data() + i), k, (size_t*)result[i].neighbors.data(), result[i].distances.data());
-		result[i].kDistance = result[i].distances[k - 1];
+		const Point3s& vertex = vertices[i];
+		pointBuckets[i] = VoxelHash((vertex.X + voxelOffset) / radius, (vertex.Y + voxelOffset) / radius, (vertex.Z + voxelOffset) / radius) & bucketMask;
 	}
 
-	return result;
+	//Counting sort of the vertices by their bucket
+	m_vBucketStarts.assign(bucketCount + 1, 0);
+	int* bucketStarts = m_vBucketStarts.data();
+
+	for (int i = 0; i < count; i++)
+		bucketStarts[pointBuckets[i] + 1]++;
+
+	for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+		bucketStarts[bucket + 1] += bucketStarts[bucket];
+
+	m_vSortedVertices.resize(count);
+	m_vSortedIndices.resize(count);
+	Point3s* sortedVertices = m_vSortedVertices.data();
+	int* sortedIndices = m_vSortedIndices.data();
+
+	//Uses the bucket starts as write positions, afterwards each of them points to the start of the next bucket
+	for (int i = 0; i < count; i++)
+	{
+		int position = bucketStarts[pointBuckets[i]]++;
+		sortedVertices[position] = vertices[i];
+		sortedIndices[position] = i;
+	}
+
+	for (uint32_t bucket = bucketCount; bucket > 0; bucket--)
+		bucketStarts[bucket] = bucketStarts[bucket - 1];
+
+	bucketStarts[0] = 0;
+
+	m_vKeep.resize(count);
+	uint8_t* keep = m_vKeep.data();
+
+	//The point itself is always found in its own voxel
+	const int requiredPoints = minNeighbors + 1;
+	const int radiusSquared = radius * radius;
+
+	//Goes through the points in bucket order, so that consecutive points search the same voxels and find them in the cache
+	#pragma omp parallel for schedule(dynamic, 1024)
+	for (int i = 0; i < count; i++)
+	{
+		const Point3s& vertex = sortedVertices[i];
+		int voxelX = (vertex.X + voxelOffset) / radius;
+		int voxelY = (vertex.Y + voxelOffset) / radius;
+		int voxelZ = (vertex.Z + voxelOffset) / radius;
+
+		//Neighbouring voxels can share a bucket, each bucket may only be searched once or its points would be counted twice
+		uint32_t searchedBuckets[27];
+		int searchedCount = 0;
+		int found = 0;
+
+		for (int n = 0; n < 27 && found < requiredPoints; n++)
+		{
+			const int* offset = voxelNeighbourhood.offsets[n];
+			uint32_t bucket = VoxelHash(voxelX + offset[0], voxelY + offset[1], voxelZ + offset[2]) & bucketMask;
+
+			bool searched = false;
+			for (int s = 0; s < searchedCount; s++)
+				searched |= searchedBuckets[s] == bucket;
+
+			if (searched)
+				continue;
+
+			searchedBuckets[searchedCount++] = bucket;
+
+			for (int j = bucketStarts[bucket]; j < bucketStarts[bucket + 1] && found < requiredPoints; j++)
+			{
+				int differenceX = abs(sortedVertices[j].X - vertex.X);
+				int differenceY = abs(sortedVertices[j].Y - vertex.Y);
+				int differenceZ = abs(sortedVertices[j].Z - vertex.Z);
+
+				//Also rejects the points of other voxels that landed in the same bucket, before their squared distance could overflow
+				if (differenceX > radius || differenceY > radius || differenceZ > radius)
+					continue;
+
+				if (differenceX * differenceX + differenceY * differenceY + differenceZ * differenceZ <= radiusSquared)
+					found++;
+			}
+		}
+
+		keep[sortedIndices[i]] = found >= requiredPoints ? 1 : 0;
+	}
+
+	int goodCount = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (!keep[i])
+			continue;
+
+		vertices[goodCount] = vertices[i];
+		colors[goodCount] = colors[i];
+		goodCount++;
+	}
+
+	return goodCount;
+}
+
+/// <summary>
+/// Replaces the points by the averages of the voxels they fall into and compacts them to the front of the vertices and colors.
+/// </summary>
+/// <param name="leafSize">Edge length of the voxels in millimeters, 0 to only downsample when the point budget requires it</param>
+/// <param name="pointBudget">Most points the frame may have afterwards, 0 for no limit</param>
+/// <returns>The number of points that are left</returns>
+int VoxelGridFilter::Apply(Point3s* vertices, RGBA* colors, int count, int leafSize, int pointBudget)
+{
+	if (pointBudget <= 0)
+		m_fBudgetLeafSize = 0;
+
+	m_fLeafSize = (std::max)((float)leafSize, m_fBudgetLeafSize);
+
+	if (count <= 0 || (m_fLeafSize <= 0 && (pointBudget <= 0 || count <= pointBudget)))
+		return count;
+
+	m_fLeafSize = (std::max)(m_fLeafSize, minLeafSize);
+	int voxelCount = Voxelize(vertices, colors, count, m_fLeafSize);
+
+	if (pointBudget > 0)
+	{
+		for (int attempt = 0; attempt < maxBudgetAttempts && voxelCount > pointBudget; attempt++)
+		{
+			m_fLeafSize *= std::sqrt((float)voxelCount / pointBudget) * budgetLeafMargin;
+			voxelCount = Voxelize(vertices, colors, count, m_fLeafSize);
+		}
+
+		if (m_fLeafSize > leafSize)
+			m_fBudgetLeafSize = m_fLeafSize;
+
+		//Lets the leaf size follow the frames back down once the performer moves away, but slowly, so that it doesn't oscillate
+		if (m_fBudgetLeafSize > 0 && voxelCount < pointBudget * budgetRelaxShare)
+		{
+			m_fBudgetLeafSize *= budgetRelaxFactor;
+
+			if (m_fBudgetLeafSize <= (std::max)((float)leafSize, minLeafSize))
+				m_fBudgetLeafSize = 0;
+		}
+	}
+
+	//The budget is a hard limit, whatever the attempts left over is thinned out evenly
+	int outputCount = voxelCount;
+	if (pointBudget > 0)
+		outputCount = (std::min)(voxelCount, pointBudget);
+
+	const Voxel* voxels = m_vVoxels.data();
+
+	//Each voxel was started by one of its points, so the voxel can always be written over the point it came from or an earlier one
+	for (int i = 0; i < outputCount; i++)
+	{
+		const Voxel& voxel = voxels[(int64_t)i * voxelCount / outputCount];
+		RGBA color = colors[voxel.firstPoint];
+
+		vertices[i] = Point3s((short)(voxel.x / voxel.count), (short)(voxel.y / voxel.count), (short)(voxel.z / voxel.count));
+		color.red = (uint8_t)(voxel.red / voxel.count);
+		color.green = (uint8_t)(voxel.green / voxel.count);
+		color.blue = (uint8_t)(voxel.blue / voxel.count);
+		colors[i] = color;
+	}
+
+	return outputCount;
 }
 
-//void filter(std::vector<Point3f> &vertices, std::vector<RGB> &colors, int k, float maxDist)
-//{
-//	if (k <= 0 || maxDist <= 0)
-//		return;
-//
-//	PointCloud cloud;
-//	cloud.pts = vertices;
-//
-//	kdTree tree(3, cloud);
-//	tree.buildIndex();
-//
-//	vector<KNNeighborsResult> knn = KNNeighbors(cloud, tree, k);
-//	
-//	vector<int> indicesToRemove;
-//
-//	float distThreshold = pow(maxDist, 2);
-//	for (unsigned int i = 0; i < cloud.pts.size(); i++)
-//	{
-//		if (knn[i].kDistance > distThreshold)
-//			indicesToRemove.push_back(i);
-//	}
-//
-//	int lastElemIdx = 0;
-//	unsigned int idxToCheck = 0;
-//	for (unsigned int i = 0; i < vertices.size(); i++)
-//	{
-//		if (idxToCheck < indicesToRemove.size() && i == indicesToRemove[idxToCheck])
-//		{
-//			idxToCheck++;
-//			continue;
-//		}
-//		vertices[lastElemIdx] = vertices[i];
-//		colors[lastElemIdx] = colors[i];
-//
-//		lastElemIdx++;
-//	}
-//
-//	vertices.resize(lastElemIdx);
-//	colors.resize(lastElemIdx);
-//}
\ No newline at end of file
+/// <summary>
+/// Sums up the points of each voxel in m_vVoxels
+/// </summary>
+/// <returns>The number of voxels that hold at least one point</returns>
+int VoxelGridFilter::Voxelize(const Point3s* vertices, const RGBA* colors, int count, float leafSize)
+{
+	//At most half full, so that the probing stays short
+	uint32_t tableSize = 1024;
+	while (tableSize < (uint32_t)count * 2)
+		tableSize <<= 1;
+
+	const uint32_t tableMask = tableSize - 1;
+	const float inverseLeafSize = 1.0f / leafSize;
+
+	m_vTableKeys.assign(tableSize, emptyVoxelKey);
+	m_vTableVoxels.resize(tableSize);
+	m_vVoxels.resize(count);
+
+	uint64_t* tableKeys = m_vTableKeys.data();
+	int* tableVoxels = m_vTableVoxels.data();
+	Voxel* voxels = m_vVoxels.data();
+	int voxelCount = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		const Point3s& vertex = vertices[i];
+		uint32_t voxelX = (uint32_t)((vertex.X + voxelOffset) * inverseLeafSize);
+		uint32_t voxelY = (uint32_t)((vertex.Y + voxelOffset) * inverseLeafSize);
+		uint32_t voxelZ = (uint32_t)((vertex.Z + voxelOffset) * inverseLeafSize);
+		uint64_t key = (uint64_t)voxelX | (uint64_t)voxelY << 16 | (uint64_t)voxelZ << 32;
+
+		uint32_t slot = VoxelHash(voxelX, voxelY, voxelZ) & tableMask;
+
+		while (tableKeys[slot] != key && tableKeys[slot] != emptyVoxelKey)
+			slot = (slot + 1) & tableMask;
+
+		if (tableKeys[slot] == emptyVoxelKey)
+		{
+			tableKeys[slot] = key;
+			tableVoxels[slot] = voxelCount;
+			voxels[voxelCount] = Voxel{ 0, 0, 0, 0, 0, 0, 0, i };
+			voxelCount++;
+		}
+
+		Voxel& voxel = voxels[tableVoxels[slot]];
+		voxel.x += vertex.X;
+		voxel.y += vertex.Y;
+		voxel.z += vertex.Z;
+		voxel.red += colors[i].red;
+		voxel.green += colors[i].green;
+		voxel.blue += colors[i].blue;
+		voxel.count++;
+	}
+
+	return voxelCount;
+}
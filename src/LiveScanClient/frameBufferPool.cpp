@@ -0,0 +1,139 @@
+#include "frameBufferPool.h"
+
+FrameBuffer::FrameBuffer(FrameBufferPool* pool, int capacity, bool withVertices)
+{
+	m_pPool = pool;
+	m_nReferences = 0;
+	nSize = 0;
+	nCapacity = capacity;
+
+	//new[] with zero elements is valid, but we always want a valid pointer to hand out
+	int allocationSize = capacity > 0 ? capacity : 1;
+
+	pVertices = withVertices ? new Point3s[allocationSize] : NULL;
+	pColors = new RGBA[allocationSize];
+}
+
+FrameBuffer::~FrameBuffer()
+{
+	delete[] pVertices;
+	delete[] pColors;
+}
+
+void FrameBuffer::AddRef()
+{
+	m_nReferences++;
+}
+
+void FrameBuffer::Release()
+{
+	if (--m_nReferences == 0)
+		m_pPool->Return(this);
+}
+
+FrameBufferPool::FrameBufferPool(bool withVertices)
+{
+	m_bWithVertices = withVertices;
+	m_bDisposed = false;
+	m_nCapacity = 0;
+	m_nBorrowed = 0;
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+	ClearFreeBuffers();
+}
+
+/// <summary>
+/// Sets how many points each pooled buffer can hold. Buffers with the old capacity are freed, borrowed ones once they are returned.
+/// </summary>
+void FrameBufferPool::SetCapacity(int pointCapacity)
+{
+	std::lock_guard<std::mutex> lock(m_mPool);
+
+	if (pointCapacity == m_nCapacity)
+		return;
+
+	ClearFreeBuffers();
+	m_nCapacity = pointCapacity;
+}
+
+int FrameBufferPool::GetCapacity()
+{
+	std::lock_guard<std::mutex> lock(m_mPool);
+	return m_nCapacity;
+}
+
+/// <summary>
+/// Gets a buffer that can hold at least the given amount of points. The caller holds the only reference to it.
+/// </summary>
+FrameBuffer* FrameBufferPool::Borrow(int size)
+{
+	std::lock_guard<std::mutex> lock(m_mPool);
+
+	FrameBuffer* buffer = NULL;
+
+	if (size > m_nCapacity)
+		buffer = new FrameBuffer(this, size, m_bWithVertices);
+
+	else if (!m_vFreeBuffers.empty())
+	{
+		buffer = m_vFreeBuffers.back();
+		m_vFreeBuffers.pop_back();
+	}
+
+	else
+		buffer = new FrameBuffer(this, m_nCapacity, m_bWithVertices);
+
+	buffer->m_nReferences = 1;
+	buffer->nSize = size;
+	m_nBorrowed++;
+
+	return buffer;
+}
+
+/// <summary>
+/// Frees all unused buffers. The pool itself is deleted as soon as no buffer is borrowed anymore, don't use it after calling this.
+/// </summary>
+void FrameBufferPool::Dispose()
+{
+	bool deletePool = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mPool);
+		m_bDisposed = true;
+		ClearFreeBuffers();
+		deletePool = m_nBorrowed == 0;
+	}
+
+	if (deletePool)
+		delete this;
+}
+
+void FrameBufferPool::Return(FrameBuffer* buffer)
+{
+	bool deletePool = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mPool);
+		m_nBorrowed--;
+
+		if (m_bDisposed || buffer->nCapacity != m_nCapacity)
+			delete buffer;
+		else
+			m_vFreeBuffers.push_back(buffer);
+
+		deletePool = m_bDisposed && m_nBorrowed == 0;
+	}
+
+	if (deletePool)
+		delete this;
+}
+
+void FrameBufferPool::ClearFreeBuffers()
+{
+	for (size_t i = 0; i < m_vFreeBuffers.size(); i++)
+		delete m_vFreeBuffers[i];
+
+	m_vFreeBuffers.clear();
+}
@@ -0,0 +1,236 @@
+#define ZSTD_STATIC_LINKING_ONLY //For ZSTD_initCStream_advanced(), so that streamed frames still carry their size
+#include "frameCompressor.h"
+#include "zdict.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	//Smaller segments compress noticeably worse, as every segment starts without any history
+	const int minParallelSegmentSize = 256 * 1024;
+}
+
+FrameCompressor::FrameCompressor()
+{
+	m_pContext = ZSTD_createCCtx();
+	m_pDictionary = NULL;
+	m_pStream = ZSTD_createCStream();
+
+	//Large enough to always hold at least one complete compressed block
+	m_nStreamChunkSize = static_cast<int>(ZSTD_CStreamOutSize());
+}
+
+FrameCompressor::~FrameCompressor()
+{
+	ZSTD_freeCCtx(m_pContext);
+	ZSTD_freeCDict(m_pDictionary);
+	ZSTD_freeCStream(m_pStream);
+
+	for (ZSTD_CCtx* context : m_vSegmentContexts)
+		ZSTD_freeCCtx(context);
+}
+
+/// <summary>
+/// Compresses the source in one go. The result stays valid in GetCompressed() until the next call
+/// </summary>
+/// <returns>The compressed size, or -1 if zstd reported an error</returns>
+int FrameCompressor::Compress(const char* source, int sourceSize, int level)
+{
+	size_t bound = ZSTD_compressBound(sourceSize);
+
+	//Only grows, so that the buffer is allocated once for the largest frame we have seen
+	if (m_vOutput.size() < bound)
+		m_vOutput.resize(bound);
+
+	size_t compressedSize = ZSTD_compressCCtx(m_pContext, m_vOutput.data(), m_vOutput.size(), source, sourceSize, level);
+
+	if (ZSTD_isError(compressedSize))
+		return -1;
+
+	return static_cast<int>(compressedSize);
+}
+
+/// <summary>
+/// Compresses the source as a single zstd frame, but hands every filled output chunk to the sink right away.
+/// This way the first part of the frame can already be sent while the rest is still being compressed.
+/// The output can be decompressed with ZSTD_decompress() just like the output of Compress()
+/// </summary>
+/// <returns>False if zstd reported an error, the data already given to the sink is incomplete then</returns>
+bool FrameCompressor::CompressStream(const char* source, int sourceSize, int level, const ChunkSink& sink)
+{
+	if (m_vOutput.size() < (size_t)m_nStreamChunkSize)
+		m_vOutput.resize(m_nStreamChunkSize);
+
+	//The size is known in advance, which lets zstd pick the right parameters and write it into the frame header
+	ZSTD_parameters parameters = ZSTD_getParams(level, sourceSize, 0);
+	parameters.fParams.contentSizeFlag = 1;
+
+	if (ZSTD_isError(ZSTD_initCStream_advanced(m_pStream, NULL, 0, parameters, sourceSize)))
+		return false;
+
+	ZSTD_inBuffer input = { source, (size_t)sourceSize, 0 };
+	ZSTD_outBuffer output = { m_vOutput.data(), (size_t)m_nStreamChunkSize, 0 };
+
+	while (input.pos < input.size)
+	{
+		if (ZSTD_isError(ZSTD_compressStream(m_pStream, &output, &input)))
+			return false;
+
+		if (output.pos == output.size)
+		{
+			sink(m_vOutput.data(), (int)output.pos);
+			output.pos = 0;
+		}
+	}
+
+	//Flushes what zstd still buffers internally, and the frame epilogue. Returns how much is left to flush
+	size_t remaining;
+
+	do
+	{
+		remaining = ZSTD_endStream(m_pStream, &output);
+
+		if (ZSTD_isError(remaining))
+			return false;
+
+		if (output.pos > 0)
+		{
+			sink(m_vOutput.data(), (int)output.pos);
+			output.pos = 0;
+		}
+	} while (remaining > 0);
+
+	return true;
+}
+
+/// <summary>
+/// How many segments CompressParallel() splits a frame of this size into
+/// </summary>
+int FrameCompressor::GetParallelSegmentCount(int sourceSize, int workers)
+{
+	int segments = sourceSize / minParallelSegmentSize;
+
+	if (segments > workers)
+		segments = workers;
+
+	return segments < 1 ? 1 : segments;
+}
+
+/// <summary>
+/// Splits the source into up to one segment per worker and compresses them at the same time, each as its own zstd frame.
+/// The vendored zstd has no multithreaded compression of a single frame, so this is how we spread a large frame over several cores.
+/// The output is the number of segments, then per segment its uncompressed and compressed size (all ints), then the compressed segments.
+/// Like Compress(), the result stays valid in GetCompressed() until the next call
+/// </summary>
+/// <returns>The size of the output, or -1 if zstd reported an error for any segment</returns>
+int FrameCompressor::CompressParallel(const char* source, int sourceSize, int level, int workers)
+{
+	int segments = GetParallelSegmentCount(sourceSize, workers);
+	int segmentSize = (sourceSize + segments - 1) / segments;
+
+	while ((int)m_vSegmentContexts.size() < segments)
+		m_vSegmentContexts.push_back(ZSTD_createCCtx());
+
+	int tableSize = (int)sizeof(int) * (1 + 2 * segments);
+	size_t segmentBound = ZSTD_compressBound(segmentSize);
+	size_t bound = tableSize + segmentBound * segments;
+
+	if (m_vOutput.size() < bound)
+		m_vOutput.resize(bound);
+
+	m_vSegmentSizes.assign(segments, 0);
+	char* output = m_vOutput.data();
+	bool failed = false;
+
+	//Every segment first goes into its own region of the output, sized for the worst case
+	#pragma omp parallel for num_threads(segments) reduction(||:failed)
+	for (int i = 0; i < segments; i++)
+	{
+		int start = i * segmentSize;
+		int size = (std::min)(segmentSize, sourceSize - start);
+
+		size_t compressedSize = ZSTD_compressCCtx(m_vSegmentContexts[i], output + tableSize + i * segmentBound, segmentBound, source + start, size, level);
+
+		if (ZSTD_isError(compressedSize))
+			failed = true;
+		else
+			m_vSegmentSizes[i] = compressedSize;
+	}
+
+	if (failed)
+		return -1;
+
+	int* table = (int*)output;
+	table[0] = segments;
+
+	//Then the segments are moved together. Each one moves to the front, so it never overwrites a segment that still needs to be moved
+	int outputSize = tableSize;
+
+	for (int i = 0; i < segments; i++)
+	{
+		int start = i * segmentSize;
+		table[1 + 2 * i] = (std::min)(segmentSize, sourceSize - start);
+		table[2 + 2 * i] = (int)m_vSegmentSizes[i];
+
+		memmove(output + outputSize, output + tableSize + i * segmentBound, m_vSegmentSizes[i]);
+		outputSize += (int)m_vSegmentSizes[i];
+	}
+
+	return outputSize;
+}
+
+/// <summary>
+/// Builds a zstd dictionary out of the samples, which are stored one after the other. zstd wants a few hundred samples at least,
+/// about a hundred times the size of the dictionary in total
+/// </summary>
+/// <returns>The size of the dictionary, or -1 if zstd couldn't build one from these samples</returns>
+int FrameCompressor::TrainDictionary(const std::vector<char>& samples, const std::vector<size_t>& sampleSizes, int maxSize, std::vector<char>& outDictionary)
+{
+	outDictionary.resize(maxSize);
+
+	size_t dictionarySize = ZDICT_trainFromBuffer(outDictionary.data(), outDictionary.size(), samples.data(), sampleSizes.data(), (unsigned)sampleSizes.size());
+
+	if (ZDICT_isError(dictionarySize))
+	{
+		outDictionary.clear();
+		return -1;
+	}
+
+	outDictionary.resize(dictionarySize);
+	return static_cast<int>(dictionarySize);
+}
+
+/// <summary>
+/// Sets the dictionary and the compression level that CompressWithDictionary() uses. A size of 0 compresses without a dictionary
+/// </summary>
+/// <returns>False if zstd can't load the dictionary</returns>
+bool FrameCompressor::SetDictionary(const char* dictionary, int size, int level)
+{
+	ZSTD_freeCDict(m_pDictionary);
+
+	//An empty dictionary is fine for zstd, the CDict then only carries the compression level
+	m_pDictionary = ZSTD_createCDict(dictionary, size > 0 ? size : 0, level);
+	return m_pDictionary != NULL;
+}
+
+/// <summary>
+/// Compresses the source with the dictionary given to SetDictionary(). The result stays valid in GetCompressed() until the next call
+/// </summary>
+/// <returns>The compressed size, or -1 if zstd reported an error or no dictionary has been set</returns>
+int FrameCompressor::CompressWithDictionary(const char* source, int sourceSize)
+{
+	if (m_pDictionary == NULL)
+		return -1;
+
+	size_t bound = ZSTD_compressBound(sourceSize);
+
+	if (m_vOutput.size() < bound)
+		m_vOutput.resize(bound);
+
+	size_t compressedSize = ZSTD_compress_usingCDict(m_pContext, m_vOutput.data(), m_vOutput.size(), source, sourceSize, m_pDictionary);
+
+	if (ZSTD_isError(compressedSize))
+		return -1;
+
+	return static_cast<int>(compressedSize);
+}
@@ -0,0 +1,283 @@
+#include "frameEncoding.h"
+#include "frameCompressor.h"
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	void EncodeInterleaved(const Point3s* vertices, const RGBA* colors, int pointCount, char* buffer)
+	{
+		for (int i = 0; i < pointCount; i++)
+		{
+			*buffer++ = colors[i].red;
+			*buffer++ = colors[i].green;
+			*buffer++ = colors[i].blue;
+
+			memcpy(buffer, &vertices[i], sizeof(short) * 3);
+			buffer += sizeof(short) * 3;
+		}
+	}
+
+	void DecodeInterleaved(const char* buffer, int pointCount, Point3s* vertices, RGBA* colors)
+	{
+		for (int i = 0; i < pointCount; i++)
+		{
+			colors[i].red = *buffer++;
+			colors[i].green = *buffer++;
+			colors[i].blue = *buffer++;
+			colors[i].alpha = 0;
+
+			memcpy(&vertices[i], buffer, sizeof(short) * 3);
+			buffer += sizeof(short) * 3;
+		}
+	}
+
+	/// <summary>
+	/// Writes the differences between consecutive values of one coordinate, the low bytes to lowBytes and the high bytes to highBytes
+	/// </summary>
+	void EncodeCoordinateColumn(const short* coordinates, int pointCount, uint8_t* lowBytes, uint8_t* highBytes)
+	{
+		uint16_t previous = 0;
+
+		//The coordinates are strided by the size of a Point3s
+		for (int i = 0; i < pointCount; i++)
+		{
+			uint16_t value = (uint16_t)coordinates[3 * i];
+			uint16_t difference = (uint16_t)(value - previous);
+			previous = value;
+
+			lowBytes[i] = (uint8_t)difference;
+			highBytes[i] = (uint8_t)(difference >> 8);
+		}
+	}
+
+	void DecodeCoordinateColumn(const uint8_t* lowBytes, const uint8_t* highBytes, int pointCount, short* coordinates)
+	{
+		uint16_t value = 0;
+
+		for (int i = 0; i < pointCount; i++)
+		{
+			value += (uint16_t)(lowBytes[i] | (highBytes[i] << 8));
+			coordinates[3 * i] = (short)value;
+		}
+	}
+
+	//The color columns are sent as red, green, blue, like the interleaved encoding
+	const size_t colorChannelOffsets[3] = { offsetof(RGBA, red), offsetof(RGBA, green), offsetof(RGBA, blue) };
+
+	void EncodeColumnar(const Point3s* vertices, const RGBA* colors, int pointCount, char* buffer)
+	{
+		uint8_t* columns = (uint8_t*)buffer;
+
+		//The three coordinate columns and the three color columns don't depend on each other
+		#pragma omp parallel for
+		for (int column = 0; column < 6; column++)
+		{
+			if (column < 3)
+			{
+				uint8_t* lowBytes = columns + 2 * column * pointCount;
+				EncodeCoordinateColumn(&vertices->X + column, pointCount, lowBytes, lowBytes + pointCount);
+			}
+
+			else
+			{
+				uint8_t* channel = columns + 6 * pointCount + (column - 3) * pointCount;
+				const uint8_t* source = (const uint8_t*)colors + colorChannelOffsets[column - 3];
+
+				for (int i = 0; i < pointCount; i++)
+					channel[i] = source[i * sizeof(RGBA)];
+			}
+		}
+	}
+
+	void DecodeColumnar(const char* buffer, int pointCount, Point3s* vertices, RGBA* colors)
+	{
+		const uint8_t* columns = (const uint8_t*)buffer;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const uint8_t* lowBytes = columns + 2 * axis * pointCount;
+			DecodeCoordinateColumn(lowBytes, lowBytes + pointCount, pointCount, &vertices->X + axis);
+		}
+
+		const uint8_t* red = columns + 6 * pointCount;
+		const uint8_t* green = red + pointCount;
+		const uint8_t* blue = green + pointCount;
+
+		for (int i = 0; i < pointCount; i++)
+		{
+			colors[i].red = red[i];
+			colors[i].green = green[i];
+			colors[i].blue = blue[i];
+			colors[i].alpha = 0;
+		}
+	}
+}
+
+int GetEncodedFrameSize(int pointCount)
+{
+	return sizeof(int) + pointCount * (3 + 3 * sizeof(short));
+}
+
+/// <summary>
+/// Writes the frame in the given encoding. outBuffer needs room for GetEncodedFrameSize(pointCount) bytes
+/// </summary>
+void EncodeFrame(FRAME_ENCODING encoding, const Point3s* vertices, const RGBA* colors, int pointCount, char* outBuffer)
+{
+	memcpy(outBuffer, &pointCount, sizeof(pointCount));
+	outBuffer += sizeof(pointCount);
+
+	if (encoding == FE_COLUMNAR)
+		EncodeColumnar(vertices, colors, pointCount, outBuffer);
+	else
+		EncodeInterleaved(vertices, colors, pointCount, outBuffer);
+}
+
+/// <summary>
+/// Reads a frame written by EncodeFrame(). The server has its own decoder, this one is used to verify the encodings
+/// </summary>
+/// <returns>False if the buffer doesn't hold a complete frame, or the frame has more than maxPoints points</returns>
+bool DecodeFrame(FRAME_ENCODING encoding, const char* buffer, int bufferSize, Point3s* outVertices, RGBA* outColors, int maxPoints, int& outPointCount)
+{
+	if (bufferSize < (int)sizeof(int))
+		return false;
+
+	memcpy(&outPointCount, buffer, sizeof(int));
+
+	if (outPointCount < 0 || outPointCount > maxPoints || GetEncodedFrameSize(outPointCount) > bufferSize)
+		return false;
+
+	buffer += sizeof(int);
+
+	if (encoding == FE_COLUMNAR)
+		DecodeColumnar(buffer, outPointCount, outVertices, outColors);
+	else
+		DecodeInterleaved(buffer, outPointCount, outVertices, outColors);
+
+	return true;
+}
+
+std::string BenchmarkFrameEncoding(ICapture* capture, int frames, int compressionLevel)
+{
+	//Culls with wide bounds, so that we get the pointcloud the client would send without any bounds set
+	Matrix4x4 toWorld = Matrix4x4(
+		0.001f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.001f, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.001f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+
+	float bounds[6] = { -30.0f, -30.0f, -30.0f, 30.0f, 30.0f, 30.0f };
+
+	std::vector<Point3s> vertices, decodedVertices;
+	std::vector<RGBA> colors, decodedColors;
+	std::vector<char> encoded, decompressed;
+
+	FrameCompressor compressor;
+	const FRAME_ENCODING encodings[2] = { FE_INTERLEAVED, FE_COLUMNAR };
+	const char* encodingNames[2] = { "Interleaved (v1)", "Columnar (v2)" };
+
+	double rawBytes = 0;
+	double compressedBytes[2] = { 0, 0 };
+	double encodeMs[2] = { 0, 0 };
+	double decodeMs[2] = { 0, 0 };
+	bool roundTripFailed[2] = { false, false };
+	int benchmarkedFrames = 0;
+
+	for (int frame = 0; frame < frames; frame++)
+	{
+		//The virtual device only hands out a new frame every 33ms
+		int attempts = 0;
+		while (!capture->AquireRawFrame() && attempts++ < 100)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+		capture->DecodeRawColor();
+		capture->MapDepthToColor();
+		capture->GeneratePointcloud();
+
+		int pointCount = capture->nPointCloudWidth * capture->nPointCloudHeight;
+
+		if (pointCount == 0)
+			continue;
+
+		vertices.resize(pointCount);
+		colors.resize(pointCount);
+		decodedVertices.resize(pointCount);
+		decodedColors.resize(pointCount);
+
+		int16_t* pointCloud = (int16_t*)(void*)k4a_image_get_buffer(capture->pointCloudImage);
+		int goodPoints = CullPointcloud(pointCloud, capture->colorBGR.data, pointCount, toWorld, bounds, 1, SHRT_MAX, vertices.data(), colors.data());
+
+		int encodedSize = GetEncodedFrameSize(goodPoints);
+		encoded.resize(encodedSize);
+		decompressed.resize(encodedSize);
+		rawBytes += encodedSize;
+		benchmarkedFrames++;
+
+		for (int e = 0; e < 2; e++)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			EncodeFrame(encodings[e], vertices.data(), colors.data(), goodPoints, encoded.data());
+			int compressedSize = compressor.Compress(encoded.data(), encodedSize, compressionLevel);
+
+			if (compressedSize < 0)
+			{
+				roundTripFailed[e] = true;
+				continue;
+			}
+
+			auto middle = std::chrono::steady_clock::now();
+
+			size_t decompressedSize = ZSTD_decompress(decompressed.data(), decompressed.size(), compressor.GetCompressed(), compressedSize);
+
+			int decodedCount = 0;
+			bool decoded = !ZSTD_isError(decompressedSize) &&
+				DecodeFrame(encodings[e], decompressed.data(), (int)decompressedSize, decodedVertices.data(), decodedColors.data(), pointCount, decodedCount);
+
+			auto end = std::chrono::steady_clock::now();
+
+			encodeMs[e] += std::chrono::duration<double, std::milli>(middle - start).count();
+			decodeMs[e] += std::chrono::duration<double, std::milli>(end - middle).count();
+			compressedBytes[e] += compressedSize;
+
+			if (!decoded || decodedCount != goodPoints)
+			{
+				roundTripFailed[e] = true;
+				continue;
+			}
+
+			for (int i = 0; i < goodPoints; i++)
+			{
+				if (memcmp(&decodedVertices[i], &vertices[i], sizeof(Point3s)) != 0 || decodedColors[i].red != colors[i].red
+					|| decodedColors[i].green != colors[i].green || decodedColors[i].blue != colors[i].blue)
+				{
+					roundTripFailed[e] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (benchmarkedFrames == 0)
+		return "The virtual device delivered no pointclouds\n";
+
+	double rawMB = rawBytes / (1024.0 * 1024.0);
+
+	std::string result = std::to_string(benchmarkedFrames) + " frames, " + std::to_string((int)(rawBytes / benchmarkedFrames)) +
+		" bytes per frame uncompressed, zstd level " + std::to_string(compressionLevel) + "\n";
+
+	for (int e = 0; e < 2; e++)
+	{
+		result += std::string(encodingNames[e]) + ": ratio " + std::to_string(rawBytes / compressedBytes[e]) +
+			", encode + compress " + std::to_string(rawMB / (encodeMs[e] / 1000.0)) + " MB/s" +
+			", decompress + decode " + std::to_string(rawMB / (decodeMs[e] / 1000.0)) + " MB/s\n";
+
+		if (roundTripFailed[e])
+			result += "Warning: the decoded frames don't match the originals\n";
+	}
+
+	return result;
+}
@@ -1,7 +1,27 @@
 #include "frameFileWriterReader.h"
+#include "frameEncoding.h"
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
+namespace
+{
+	//How many frames ahead of the one being read are prefetched from the disk
+	const int readaheadFrames = 4;
+
+	//The fastest level, the disk has to keep up with the camera at 30 fps while the pipeline keeps the other cores busy
+	const int recordingCompressionLevel = 1;
+
+	//The first frames of a compressed recording are held back and the dictionary is trained on them. A third of a second at 30 fps
+	const int dictionaryTrainingFrames = 8;
+
+	//Each held back frame is cut into this many samples, spread over all of its columns. The samples of all frames add up to 2 MB,
+	//about 30 times the dictionary, which keeps the training short enough to not back up the write queue
+	const int dictionarySamplesPerFrame = 64;
+	const int dictionarySampleSize = 4 * 1024;
+	const int maxDictionarySize = 64 * 1024;
+}
+
 
 FrameFileWriterReader::FrameFileWriterReader(Log* logger)
 {
@@ -12,17 +32,37 @@ FrameFileWriterReader::FrameFileWriterReader(Log* logger)
 FrameFileWriterReader::~FrameFileWriterReader()
 {
 	closeFileIfOpened();
+	closeRawFileIfOpened();
 	log->UnRegisterBuffer(&logBuffer);
 }
 
 void FrameFileWriterReader::closeFileIfOpened()
 {
-	if (!m_pFileHandle)
+	m_MappedFile.Close();
+
+	if (!m_pFileHandle && !m_BinFileWriter.IsOpen())
 		return;
 
 	logBuffer.LogDebug("Closing current .bin file");
 
-	fclose(m_pFileHandle);
+	if (m_BinFileWriter.IsOpen())
+	{
+		//Files with fewer frames than the dictionary is trained on
+		if (!m_bFileHeaderWritten)
+			writeHeldBackFrames();
+
+		writeFrameIndex();
+
+		if (!m_BinFileWriter.Close())
+			logBuffer.LogError("Could not write all frames to the .bin file: " + m_sBinFilePath);
+
+		else if (m_bCompressingFile && m_nUncompressedFrameBytes > 0)
+			logBuffer.LogInfo("Compressed the frames of the .bin file to " + std::to_string((int)(100 * m_nCompressedFrameBytes / m_nUncompressedFrameBytes)) + "% of their size");
+	}
+
+	if (m_pFileHandle)
+		fclose(m_pFileHandle);
+
 	m_pFileHandle = nullptr;
 	m_bFileOpenedForReading = false;
 	m_bFileOpenedForWriting = false;
@@ -30,12 +70,19 @@ void FrameFileWriterReader::closeFileIfOpened()
 
 void FrameFileWriterReader::closeAndDeleteFile()
 {
-	if (!m_pFileHandle)
+	if (!m_pFileHandle && !m_BinFileWriter.IsOpen())
 		return;
 
 	logBuffer.LogDebug("Closing and deleting .bin file: " + m_sBinFilePath);
 
-	fclose(m_pFileHandle);
+	//Windows can't delete a file that is still mapped
+	m_MappedFile.Close();
+	m_BinFileWriter.Close();
+	m_vHeldBackFrames.clear();
+
+	if (m_pFileHandle)
+		fclose(m_pFileHandle);
+
 	remove(m_sBinFilePath.c_str());
 
 	m_pFileHandle = nullptr;
@@ -61,14 +108,11 @@ void FrameFileWriterReader::openCurrentBinFileForReading()
 
 	logBuffer.LogDebug("Opening current bin file for reading");
 
-	m_pFileHandle = fopen(m_sBinFilePath.c_str(), "rb");
-	m_bFileOpenedForReading = true;
-	m_bFileOpenedForWriting = false;
-	m_nCurrentReadFrameID = 0;
+	openMappedFile(m_sBinFilePath);
 }
 
 /// <summary>
-/// Opens a .bin recording file from anywhere on disk
+/// Opens a .bin recording file from anywhere on disk. It becomes the current .bin file
 /// </summary>
 /// <param name="path">The absolute or relative path to the bin file, including the file and file-ending </param>
 void FrameFileWriterReader::openNewBinFileForReading(std::string path)
@@ -78,8 +122,24 @@ void FrameFileWriterReader::openNewBinFileForReading(std::string path)
 
 	logBuffer.LogDebug("Opening new .bin file for reading at path: " + path);
 
+	m_sBinFilePath = path;
+	openMappedFile(path);
+}
+
+void FrameFileWriterReader::openMappedFile(std::string path)
+{
 	m_pFileHandle = fopen(path.c_str(), "rb");
 
+	if (!m_pFileHandle)
+		logBuffer.LogWarning("Could not open .bin file to send frames straight from it, they will be copied: " + path);
+
+	//The frames are mostly read in order, when they are sent to the server or played back
+	if (!m_MappedFile.Open(path, true))
+		logBuffer.LogError("Could not open .bin file for reading: " + path);
+
+	else if (m_MappedFile.IsIndexRebuilt())
+		logBuffer.LogWarning("The .bin file has no frame index, it was probably not closed properly. Rebuilt the index from the frames");
+
 	m_bFileOpenedForReading = true;
 	m_bFileOpenedForWriting = false;
 	m_nCurrentReadFrameID = 0;
@@ -94,66 +154,189 @@ void FrameFileWriterReader::openNewBinFileForWriting(int deviceID, std::string p
 {
 	closeFileIfOpened();
 
+	m_sBinFilePath = makeRecordingFileName(deviceID, prefix, "bin");
+
+	logBuffer.LogDebug("Opening new .bin file for writing at path: " + m_sBinFilePath);
+
+	m_bFileOpenedForReading = false;
+	m_bFileOpenedForWriting = true;
+	m_vFrameOffsets.clear();
+	m_vHeldBackFrames.clear();
+	m_nWriteDeviceID = deviceID;
+	m_bCompressingFile = m_bCompressFrames;
+	m_bFileHeaderWritten = false;
+	m_nUncompressedFrameBytes = 0;
+	m_nCompressedFrameBytes = 0;
+
+	if (m_BinFileWriter.Open(m_sBinFilePath, m_nPreallocateBytes, m_bUnbufferedWrites))
+	{
+		//The header of a compressed file has to wait for its dictionary
+		if (!m_bCompressingFile)
+			writeFileHeader(std::vector<char>());
+
+		if (m_bUnbufferedWrites && !m_BinFileWriter.IsUnbuffered())
+			logBuffer.LogWarning("Unbuffered writes are not supported here, writing the .bin file buffered");
+	}
+
+	else
+		logBuffer.LogError("Could not open .bin file for writing: " + m_sBinFilePath);
+
+	resetTimer();
+}
+
+/// <summary>
+/// The path of a new recording file in the current recording directory, named after the device and the current time
+/// </summary>
+std::string FrameFileWriterReader::makeRecordingFileName(int deviceID, std::string prefix, std::string extension)
+{
 	char filename[1024];
 	time_t t = time(0);
 	struct tm* now = localtime(&t);
-	sprintf(filename, "recording_%01d_%04d_%02d_%02d_%02d_%02d.bin", deviceID, now->tm_year + 1900, now->tm_mon + 1, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
+	sprintf(filename, "recording_%01d_%04d_%02d_%02d_%02d_%02d.", deviceID, now->tm_year + 1900, now->tm_mon + 1, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
 
-	m_sBinFilePath = m_sFrameRecordingsDir;
+	std::string path = m_sFrameRecordingsDir;
 
 	if (prefix.size() > 0)
 	{
-		m_sBinFilePath += prefix + "_";
+		path += prefix + "_";
 	}
 
-	m_sBinFilePath += filename;
-	m_pFileHandle = fopen(m_sBinFilePath.c_str(), "wb");
+	return path + filename + extension;
+}
 
-	logBuffer.LogDebug("Opening new .bin file for writing at path: " + m_sBinFilePath);
+/// <summary>
+/// Writes the header at the start of the file
+/// </summary>
+/// <param name="dictionary">The zstd dictionary the frames are compressed with, stored right after the header. Empty if there is none</param>
+void FrameFileWriterReader::writeFileHeader(const std::vector<char>& dictionary)
+{
+	BinFileHeader header = { binFileMagic, binFileVersion, (uint32_t)(sizeof(BinFileHeader) + dictionary.size()), sizeof(BinFrameHeader), m_nWriteDeviceID, 0 };
 
-	m_bFileOpenedForReading = false;
-	m_bFileOpenedForWriting = true;
+	if (dictionary.size() > 0)
+		header.flags |= BF_DICTIONARY;
 
-	resetTimer();
+	m_BinFileWriter.Write(&header, sizeof(header));
+	m_BinFileWriter.Write(dictionary.data(), dictionary.size());
+	m_bFileHeaderWritten = true;
 }
 
 /// <summary>
-/// Reads the next frame from the opened .bin file. If you need to read a certain frame, first seek to it with seekBinaryReaderToFrame() and the use this function.
+/// Trains the dictionary of the file on the frames that have been held back, writes the header with it and then the held back frames.
+/// If there are too few frames to train on, or zstd can't build a dictionary from them, the frames are compressed without one
 /// </summary>
-/// <param name="outPoints"> Point buffer to be filled </param>
-/// <param name="outColors"> RGB buffer to be filled </param>
-/// <param name="outTimestamp"> The timestamp at which the frame was taken. Returns -1 when timestamp could not be retrieved </param>
-/// <returns></returns>
-bool FrameFileWriterReader::readNextBinaryFrame(Point3s*& outPoints, RGBA*& outColors, int& outPointsSize, int& outTimestamp)
+void FrameFileWriterReader::writeHeldBackFrames()
 {
-	logBuffer.LogCaptureDebug("Reading next binary frame. Frame number: "+ std::to_string(m_nCurrentReadFrameID));
+	std::vector<char> samples;
+	std::vector<size_t> sampleSizes;
 
-	if (!m_bFileOpenedForReading)
-		openCurrentBinFileForReading();
+	for (size_t i = 0; i < m_vHeldBackFrames.size(); i++)
+	{
+		const std::vector<char>& encoded = m_vHeldBackFrames[i].encoded;
+		size_t stride = (std::max)((size_t)dictionarySampleSize, encoded.size() / dictionarySamplesPerFrame);
 
-	FILE* f = m_pFileHandle;
-	int nPoints, timestamp;
-	char tmp[1024];
-	int nread = fscanf_s(f, "%s %d %s %d", tmp, 1024, &nPoints, tmp, 1024, &timestamp);
+		for (size_t start = 0; start < encoded.size(); start += stride)
+		{
+			size_t size = (std::min)((size_t)dictionarySampleSize, encoded.size() - start);
+			samples.insert(samples.end(), encoded.begin() + start, encoded.begin() + start + size);
+			sampleSizes.push_back(size);
+		}
+	}
 
-	if (nread < 4)
-		return false;
+	std::vector<char> dictionary;
 
-	if (nPoints > 0)
+	if (sampleSizes.size() > 0 && FrameCompressor::TrainDictionary(samples, sampleSizes, maxDictionarySize, dictionary) < 0)
+		logBuffer.LogWarning("Could not train a dictionary on the first frames of the recording, compressing them without one");
+
+	if (!m_Compressor.SetDictionary(dictionary.data(), (int)dictionary.size(), recordingCompressionLevel))
 	{
+		logBuffer.LogWarning("Could not load the dictionary of the recording, compressing the frames without one");
+		dictionary.clear();
+		m_Compressor.SetDictionary(NULL, 0, recordingCompressionLevel);
+	}
 
-		fgetc(f);		//  '\n'
-		outPoints = new Point3s[nPoints];
-		outColors = new RGBA[nPoints];
+	writeFileHeader(dictionary);
+
+	for (size_t i = 0; i < m_vHeldBackFrames.size(); i++)
+	{
+		const HeldBackFrame& frame = m_vHeldBackFrames[i];
 
-		fread((void*)outPoints, sizeof(outPoints[0]), nPoints, f);
-		fread((void*)outColors, sizeof(outColors[0]), nPoints, f);
-		fgetc(f);		// '\n'
+		if (!writeCompressedFrame(frame.encoded.data(), (int)frame.encoded.size(), frame.pointCount, frame.timestamp))
+			logBuffer.LogError("Could not write one of the first frames to the .bin file");
 	}
 
-	outPointsSize = nPoints;
-	outTimestamp = timestamp;
+	m_vHeldBackFrames.clear();
+}
+
+/// <summary>
+/// Appends the frame index and the footer, which ends the file
+/// </summary>
+void FrameFileWriterReader::writeFrameIndex()
+{
+	BinFileFooter footer;
+	footer.indexOffset = m_BinFileWriter.GetPosition();
+	footer.frameCount = (uint32_t)m_vFrameOffsets.size();
+	footer.magic = binFileMagic;
+
+	m_BinFileWriter.Write(m_vFrameOffsets.data(), m_vFrameOffsets.size() * sizeof(uint64_t));
+	m_BinFileWriter.Write(&footer, sizeof(footer));
+}
+
+/// <summary>
+/// Sets how the next .bin file that is opened for writing is written
+/// </summary>
+/// <param name="preallocateBytes">Space that is reserved for the file on the disk right away, 0 to let it grow as needed</param>
+/// <param name="unbuffered">Write past the page cache of the OS, so that a long recording doesn't push everything else out of the memory</param>
+/// <param name="compress">Store the frames columnar encoded and compressed with zstd, with a dictionary trained on the first frames of the file</param>
+void FrameFileWriterReader::SetWriteOptions(uint64_t preallocateBytes, bool unbuffered, bool compress)
+{
+	m_nPreallocateBytes = preallocateBytes;
+	m_bUnbufferedWrites = unbuffered;
+	m_bCompressFrames = compress;
+}
+
+/// <summary>
+/// Reads the next frame from the opened .bin file into a buffer borrowed from the pool.
+/// If you need to read a certain frame, first seek to it with seekBinaryReaderToFrame() and the use this function.
+/// Use readNextBinaryFrameView() instead when the frame doesn't need to outlive the file
+/// </summary>
+/// <param name="outFrame">Only set when the function succeeds. The caller needs to release it</param>
+/// <param name="outTimestamp">The timestamp at which the frame was taken</param>
+/// <returns>False if there are no more frames to read</returns>
+bool FrameFileWriterReader::readNextBinaryFrame(FrameBufferPool* pool, FrameBuffer*& outFrame, uint64_t& outTimestamp)
+{
+	BinFrameView view;
+
+	if (!readNextBinaryFrameView(view))
+		return false;
+
+	outFrame = pool->Borrow(view.pointCount);
+	memcpy(outFrame->pVertices, view.vertices, view.pointCount * sizeof(Point3s));
+	memcpy(outFrame->pColors, view.colors, view.pointCount * sizeof(RGBA));
+
+	outTimestamp = view.timestamp;
+	return true;
+}
+
+/// <summary>
+/// Gets the next frame of the opened .bin file without copying it, and prefetches the frames that follow it
+/// </summary>
+/// <param name="outFrame">Points into the file, valid until the file is closed. Compressed frames are decoded into a buffer of the reader instead, valid until the next frame is read</param>
+/// <param name="decode">If false, compressed frames only get their compressed data set, see BinFrameView</param>
+/// <returns>False if there are no more frames to read</returns>
+bool FrameFileWriterReader::readNextBinaryFrameView(BinFrameView& outFrame, bool decode)
+{
+	logBuffer.LogCaptureDebug("Reading next binary frame. Frame number: "+ std::to_string(m_nCurrentReadFrameID));
+
+	if (!m_bFileOpenedForReading)
+		openCurrentBinFileForReading();
+
+	if (!m_MappedFile.GetFrame(m_nCurrentReadFrameID, outFrame, decode))
+		return false;
+
 	m_nCurrentReadFrameID++;
+
+	//Only the frame that comes into reach, the ones before it were asked for by the previous calls already
+	m_MappedFile.Prefetch(m_nCurrentReadFrameID + readaheadFrames - 1, 1);
 	return true;
 }
 
@@ -165,90 +348,116 @@ bool FrameFileWriterReader::readNextBinaryFrame(Point3s*& outPoints, RGBA*& outC
 /// <param name="timestamp"></param>
 /// <param name="deviceID"></param>
 /// <returns></returns>
-bool FrameFileWriterReader::writeNextBinaryFrame(Point3s* points, int pointsSize, RGBA* colors, uint64_t timestamp, int deviceID)
+bool FrameFileWriterReader::writeNextBinaryFrame(const Point3s* points, int pointsSize, const RGBA* colors, uint64_t timestamp, int deviceID)
 {
 	logBuffer.LogCaptureDebug("Writing next binary frame with timestamp: " + std::to_string(timestamp));
 
 	if (!m_bFileOpenedForWriting)
 		openNewBinFileForWriting(deviceID, "");
 
-	FILE* f = m_pFileHandle;
+	if (!m_BinFileWriter.IsOpen())
+		return false;
 
-	//The Timestamp is generated by the Kinect instead of the system. If temporal Sync is enabled, Master and Subordinate have a synced timestamp
-	fprintf(f, "n_points= %d\nframe_timestamp= %d\n", pointsSize, timestamp);
+	if (pointsSize < 0)
+		pointsSize = 0;
 
-	int wroteCount = 0;
+	m_nUncompressedFrameBytes += (uint64_t)pointsSize * (sizeof(Point3s) + sizeof(RGBA));
 
-	if (pointsSize > 0)
+	if (m_bCompressingFile)
 	{
-		wroteCount += fwrite(points, sizeof(points[0]), pointsSize, f);
-		wroteCount += fwrite(colors, sizeof(colors[0]), pointsSize, f);
-	}
+		int encodedSize = GetEncodedFrameSize(pointsSize);
 
-	if (wroteCount != pointsSize * 2)
-		return false;
+		if (m_bFileHeaderWritten)
+		{
+			if ((int)m_vEncodedFrame.size() < encodedSize)
+				m_vEncodedFrame.resize(encodedSize);
+
+			EncodeFrame(FE_COLUMNAR, points, colors, pointsSize, m_vEncodedFrame.data());
+			return writeCompressedFrame(m_vEncodedFrame.data(), encodedSize, pointsSize, timestamp);
+		}
+
+		HeldBackFrame frame;
+		frame.encoded.resize(encodedSize);
+		frame.pointCount = pointsSize;
+		frame.timestamp = timestamp;
+		EncodeFrame(FE_COLUMNAR, points, colors, pointsSize, frame.encoded.data());
+		m_vHeldBackFrames.push_back(std::move(frame));
+
+		if ((int)m_vHeldBackFrames.size() >= dictionaryTrainingFrames)
+			writeHeldBackFrames();
 
-	else
 		return true;
+	}
+
+	//The Timestamp is generated by the Kinect instead of the system. If temporal Sync is enabled, Master and Subordinate have a synced timestamp
+	BinFrameHeader header;
+	header.magic = binFrameMagic;
+	header.pointCount = pointsSize;
+	header.compression = BC_NONE;
+	header.reserved = 0;
+	header.timestamp = timestamp;
+	header.dataSize = (uint64_t)pointsSize * (sizeof(Point3s) + sizeof(RGBA));
+
+	uint64_t offset = m_BinFileWriter.GetPosition();
+
+	if (!m_BinFileWriter.Write(&header, sizeof(header)) ||
+		!m_BinFileWriter.Write(points, pointsSize * sizeof(points[0])) ||
+		!m_BinFileWriter.Write(colors, pointsSize * sizeof(colors[0])))
+		return false;
 
-	fprintf(f, "\n");
+	m_vFrameOffsets.push_back(offset);
+	m_nAppendedFrameBytes += sizeof(header) + header.dataSize;
+	return true;
 }
 
 /// <summary>
-/// Seek to a certain frame in the opened .bin file. 
+/// Appends a frame that has been encoded with FE_COLUMNAR, compressed with the dictionary of the file
 /// </summary>
-/// <param name="frameID"></param>
-void FrameFileWriterReader::seekBinaryReaderToFrame(int frameID)
+bool FrameFileWriterReader::writeCompressedFrame(const char* encodedFrame, int encodedSize, int pointCount, uint64_t timestamp)
 {
+	int compressedSize = m_Compressor.CompressWithDictionary(encodedFrame, encodedSize);
 
-	logBuffer.LogDebug("Seeking .bin reader to frame: " + std::to_string(frameID));
+	if (compressedSize < 0)
+		return false;
 
-	if (frameID > m_nCurrentReadFrameID)
-	{
+	BinFrameHeader header;
+	header.magic = binFrameMagic;
+	header.pointCount = pointCount;
+	header.compression = BC_ZSTD_COLUMNAR;
+	header.reserved = 0;
+	header.timestamp = timestamp;
+	header.dataSize = (uint64_t)compressedSize;
 
-		while (frameID > m_nCurrentReadFrameID)
-		{
-			skipOneFrameBinaryReader();
-		}
-		return;
-	}
+	uint64_t offset = m_BinFileWriter.GetPosition();
 
-	else if (frameID == m_nCurrentReadFrameID)
-		return;
+	if (!m_BinFileWriter.Write(&header, sizeof(header)) || !m_BinFileWriter.Write(m_Compressor.GetCompressed(), compressedSize))
+		return false;
 
-	//If the desired frame ID is below the current frame ID, we need to search from the start of the file again,
-	//because we can't read the file backwards (yet)
-	else if (frameID < m_nCurrentReadFrameID)
-	{
+	m_vFrameOffsets.push_back(offset);
+	m_nCompressedFrameBytes += header.dataSize;
+	m_nAppendedFrameBytes += sizeof(header) + header.dataSize;
+	return true;
+}
 
-		m_nCurrentReadFrameID = 0;
-		FILE* f = m_pFileHandle;
-		fseek(f, 0, SEEK_SET); //Reset the file stream reader to the beginning of the file
+/// <summary>
+/// Seek to a certain frame in the opened .bin file. 
+/// </summary>
+/// <param name="frameID"></param>
+void FrameFileWriterReader::seekBinaryReaderToFrame(int frameID)
+{
+	logBuffer.LogDebug("Seeking .bin reader to frame: " + std::to_string(frameID));
 
-		while (frameID > m_nCurrentReadFrameID)
-		{
-			skipOneFrameBinaryReader();
-		}
-	}
+	if (!m_bFileOpenedForReading)
+		openCurrentBinFileForReading();
+
+	//The mapped file knows where every frame starts, so seeking doesn't need to touch the frames in between
+	m_nCurrentReadFrameID = (std::max)(0, frameID);
+	m_MappedFile.Prefetch(m_nCurrentReadFrameID, readaheadFrames);
 }
 
 void FrameFileWriterReader::skipOneFrameBinaryReader()
 {
-
-	FILE* f = m_pFileHandle;
-	long start = ftell(f);
-	int nPoints, timestamp;
-	char tmp[1024];
-	int nread = fscanf_s(f, "%s %d %s %d", tmp, 1024, &nPoints, tmp, 1024, &timestamp); //Get the size of nPoints so that we can skip them
-	long offsetVerts = nPoints * sizeof(Point3s);
-	long offsetColors = nPoints * sizeof(RGBA);
-
-	fgetc(f);		//  '\n'
-	fseek(f, offsetVerts, SEEK_CUR); //Skip vertices
-	fseek(f, offsetColors, SEEK_CUR); //Skip colors
-	fgetc(f);		// '\n'
-	long end = ftell(f);
-	m_nCurrentReadFrameID++;
+	seekBinaryReaderToFrame(m_nCurrentReadFrameID + 1);
 }
 
 std::string FrameFileWriterReader::ReadIPFromFile()
@@ -322,6 +531,123 @@ bool FrameFileWriterReader::CreateRecordDirectory(std::string newDirToCreate, co
 	return true;
 }
 
+/// <summary>
+/// Appends a raw frame to the raw recording of the take. The file is created in the current recording directory with the first frame
+/// </summary>
+/// <param name="depthStrideBytes">Bytes from the start of one row of the depth image to the next</param>
+/// <returns>False if the file couldn't be created or written</returns>
+bool FrameFileWriterReader::writeNextRawFrame(const void* colorMJPG, size_t colorSize, const uint16_t* depth, int depthWidth, int depthHeight, size_t depthStrideBytes, int frameIndex, uint64_t timestamp, int deviceID)
+{
+	logBuffer.LogCaptureDebug("Writing raw frame " + std::to_string(frameIndex) + " with timestamp: " + std::to_string(timestamp));
+
+	if (!m_RawFile.IsOpenForWriting())
+	{
+		closeRawFileIfOpened();
+		m_sRawFilePath = makeRecordingFileName(deviceID, "", "lsr");
+
+		logBuffer.LogDebug("Opening new raw recording file for writing at path: " + m_sRawFilePath);
+
+		if (!m_RawFile.Create(m_sRawFilePath, deviceID, m_nPreallocateBytes, m_bUnbufferedWrites))
+		{
+			logBuffer.LogError("Could not open raw recording file for writing: " + m_sRawFilePath);
+			return false;
+		}
+	}
+
+	if (colorMJPG == NULL || depth == NULL)
+	{
+		logBuffer.LogWarning("Could not write raw frame " + std::to_string(frameIndex) + ", image is empty!");
+		return false;
+	}
+
+	return m_RawFile.WriteFrame(colorMJPG, colorSize, depth, depthWidth, depthHeight, depthStrideBytes, frameIndex, timestamp);
+}
+
+/// <summary>
+/// Ends the raw recording that is being written with its index. The next raw frame starts a new file
+/// </summary>
+void FrameFileWriterReader::closeRawFileIfOpened()
+{
+	if (!m_RawFile.IsOpenForWriting() && !m_RawFile.IsOpenForReading())
+		return;
+
+	logBuffer.LogDebug("Closing raw recording file: " + m_sRawFilePath);
+
+	if (!m_RawFile.Close())
+		logBuffer.LogError("Could not write all frames to the raw recording file: " + m_sRawFilePath);
+}
+
+/// <summary>
+/// Post syncs the last raw recording. Only the index at the end of the file is rewritten, so that every frame is
+/// extracted under its synced index with the "synced" prefix
+/// </summary>
+/// <param name="frameIDs">The recorded frame of each synced frame, -1 if this device has no frame for it</param>
+/// <param name="syncedFrameIDs">The index each synced frame gets</param>
+/// <param name="emptyColorJPG">Stands in for the frames this device doesn't have</param>
+bool FrameFileWriterReader::PostSyncRawFile(const std::vector<int>& frameIDs, const std::vector<int>& syncedFrameIDs, const std::vector<unsigned char>& emptyColorJPG)
+{
+	closeRawFileIfOpened();
+
+	if (!m_RawFile.Open(m_sRawFilePath))
+	{
+		logBuffer.LogError("Could not open raw recording file for post sync: " + m_sRawFilePath);
+		return false;
+	}
+
+	if (m_RawFile.IsIndexRebuilt())
+		logBuffer.LogWarning("The raw recording file has no frame index, it was probably not closed properly. Rebuilt the index from the frames");
+
+	bool success = m_RawFile.PostSync(frameIDs, syncedFrameIDs, emptyColorJPG);
+
+	if (!success)
+		logBuffer.LogWarning("Not all frames of the raw recording could be post synced: " + m_sRawFilePath);
+
+	m_RawFile.Close();
+	return success;
+}
+
+/// <summary>
+/// Writes every frame of a raw recording as a Color_N.jpg and a Depth_N.tiff file next to it, which is how raw recordings used to be stored.
+/// Post synced frames get the "synced" prefix. The recording directory is set to the directory of the file
+/// </summary>
+/// <param name="outFrames">How many frames have been extracted</param>
+/// <returns>False if the file can't be read, or one of its frames is damaged</returns>
+bool FrameFileWriterReader::ExtractRawFile(std::string path, int& outFrames)
+{
+	outFrames = 0;
+	closeRawFileIfOpened();
+
+	if (!m_RawFile.Open(path))
+	{
+		logBuffer.LogError("Could not open raw recording file: " + path);
+		return false;
+	}
+
+	m_sRawFilePath = path;
+	SetRecordingDirPath((fs::path(path).parent_path() / "").string());
+
+	bool success = true;
+	RawFrameData frame;
+
+	for (int i = 0; i < m_RawFile.GetFrameCount(); i++)
+	{
+		if (!m_RawFile.ReadFrame(i, frame))
+		{
+			logBuffer.LogWarning("Could not read frame " + std::to_string(i) + " of the raw recording file: " + path);
+			success = false;
+			continue;
+		}
+
+		std::string prefix = frame.synced ? "synced" : "";
+		WriteColorJPGFile(frame.colorMJPG.data(), frame.colorMJPG.size(), frame.frameIndex, prefix);
+		WriteDepthTiffFile(frame.depth.data(), frame.depthWidth, frame.depthHeight, frame.depthWidth * sizeof(uint16_t), frame.frameIndex, prefix);
+		outFrames++;
+	}
+
+	m_RawFile.Close();
+	return success;
+}
+
 void FrameFileWriterReader::WriteColorJPGFile(void* buffer, size_t bufferSize, int frameIndex, std::string optionalPrefix)
 {
 
@@ -368,7 +694,7 @@ void FrameFileWriterReader::WriteCalibrationJSON(int deviceIndex, const std::vec
 	file.close();
 }
 
-void FrameFileWriterReader::WriteDepthTiffFile(const k4a_image_t& im, int frameIndex, std::string optionalPrefix)
+void FrameFileWriterReader::WriteDepthTiffFile(const uint16_t* depth, int width, int height, size_t strideBytes, int frameIndex, std::string optionalPrefix)
 {
 	std::string depthFileName;
 	if (optionalPrefix.size() > 0)
@@ -385,7 +711,7 @@ void FrameFileWriterReader::WriteDepthTiffFile(const k4a_image_t& im, int frameI
 
 	logBuffer.LogCaptureDebug("Writing Depth tiff file: " + filePath);
 
-	cv::Mat depthMat = cv::Mat(k4a_image_get_height_pixels(im), k4a_image_get_width_pixels(im), CV_16U, k4a_image_get_buffer(im), static_cast<size_t>(k4a_image_get_stride_bytes(im)));
+	cv::Mat depthMat = cv::Mat(height, width, CV_16U, (void*)depth, strideBytes);
 
 	bool result = false;
 
@@ -422,37 +748,6 @@ void FrameFileWriterReader::WriteTimestampLog(std::vector<int> frames, std::vect
 	file.close();
 }
 
-/// <summary>
-/// Renames a raw frame pair (Color JPEG & Depth TIFF File). Changes the index in the filename and optionally adds a prefix 
-/// </summary>
-/// <param name="oldFrameIndex"></param>
-/// <param name="newFrameIndex"></param>
-/// <param name="newPrefix"></param>
-/// <returns></returns>
-bool FrameFileWriterReader::RenameRawFramePair(int oldFrameIndex, int newFrameIndex, std::string newPrefix)
-{
-	fs::path oldFilePathColor = m_sFrameRecordingsDir + std::string("Color_") + std::to_string(oldFrameIndex) + ".jpg";
-	fs::path oldFilePathDepth = m_sFrameRecordingsDir + std::string("Depth_") + std::to_string(oldFrameIndex) + ".tiff";
-
-	fs::path newFilePathColor = m_sFrameRecordingsDir + newPrefix + std::string("Color_") + std::to_string(newFrameIndex) + ".jpg";
-	fs::path newFilePathDepth = m_sFrameRecordingsDir + newPrefix + std::string("Depth_") + std::to_string(newFrameIndex) + ".tiff";
-
-	try
-	{
-		fs::rename(oldFilePathColor, newFilePathColor);
-		fs::rename(oldFilePathDepth, newFilePathDepth);
-	}
-
-	catch (const fs::filesystem_error& ex)
-	{
-		std::string error = "Error trying to rename: " + ex.path1().string() + ex.path2().string() + ex.what() + "\n";
-		logBuffer.LogError(error);
-		return false;
-	}
-
-	return true;
-}
-
 /// <summary>
 /// Creates a directory. Should be given an absolute path
 /// </summary>
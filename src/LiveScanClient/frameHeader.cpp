@@ -0,0 +1,90 @@
+#include "frameHeader.h"
+#include <cstring>
+
+namespace
+{
+	const uint32_t prime1 = 2654435761U;
+	const uint32_t prime2 = 2246822519U;
+	const uint32_t prime3 = 3266489917U;
+	const uint32_t prime4 = 668265263U;
+	const uint32_t prime5 = 374761393U;
+
+	inline uint32_t RotateLeft(uint32_t value, int bits)
+	{
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+	//Both the client and the server only run on little endian machines
+	inline uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Round(uint32_t accumulator, uint32_t input)
+	{
+		accumulator += input * prime2;
+		accumulator = RotateLeft(accumulator, 13);
+		return accumulator * prime1;
+	}
+}
+
+/// <summary>
+/// The 32 bit variant of xxHash (https://github.com/Cyan4973/xxHash), which hashes several GB/s, so it can check every frame.
+/// Implemented here, as the zstd library we link against doesn't export its copy
+/// </summary>
+uint32_t XXHash32(const void* data, size_t size, uint32_t seed)
+{
+	const uint8_t* current = (const uint8_t*)data;
+	const uint8_t* end = current + size;
+	uint32_t hash;
+
+	if (size >= 16)
+	{
+		const uint8_t* limit = end - 16;
+		uint32_t v1 = seed + prime1 + prime2;
+		uint32_t v2 = seed + prime2;
+		uint32_t v3 = seed;
+		uint32_t v4 = seed - prime1;
+
+		//Four independent lanes, so the CPU can work on all of them at once
+		do
+		{
+			v1 = Round(v1, Read32(current));
+			v2 = Round(v2, Read32(current + 4));
+			v3 = Round(v3, Read32(current + 8));
+			v4 = Round(v4, Read32(current + 12));
+			current += 16;
+		} while (current <= limit);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+	}
+
+	else
+		hash = seed + prime5;
+
+	hash += (uint32_t)size;
+
+	while (current + 4 <= end)
+	{
+		hash += Read32(current) * prime3;
+		hash = RotateLeft(hash, 17) * prime4;
+		current += 4;
+	}
+
+	while (current < end)
+	{
+		hash += (*current) * prime5;
+		hash = RotateLeft(hash, 11) * prime1;
+		current++;
+	}
+
+	hash ^= hash >> 15;
+	hash *= prime2;
+	hash ^= hash >> 13;
+	hash *= prime3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
@@ -0,0 +1,241 @@
+#include "framePipeline.h"
+
+FramePipeline::FramePipeline(int slotCount) : m_vSlots(slotCount)
+{
+	m_bRunning = false;
+	m_nInFlight = 0;
+
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		m_vRings.push_back(new SPSCRing<FrameSlot*>(slotCount));
+		m_nProcessed[i] = 0;
+		m_nDropped[i] = 0;
+	}
+
+	for (int i = 0; i < slotCount; i++)
+		m_vRings[STAGE_ACQUISITION]->Push(&m_vSlots[i]);
+}
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+	ReleaseSlotResources();
+
+	for (size_t i = 0; i < m_vRings.size(); i++)
+		delete m_vRings[i];
+
+	m_vRings.clear();
+}
+
+/// <summary>
+/// Starts one worker thread for each of the stages after the acquisition
+/// </summary>
+void FramePipeline::Start(StageFunction decodeStage, StageFunction cullStage, StageFunction sinkStage)
+{
+	if (m_bRunning)
+		return;
+
+	m_bRunning = true;
+	m_vStageThreads.push_back(std::thread(&FramePipeline::StageThreadFunction, this, STAGE_DECODE, decodeStage));
+	m_vStageThreads.push_back(std::thread(&FramePipeline::StageThreadFunction, this, STAGE_CULL, cullStage));
+	m_vStageThreads.push_back(std::thread(&FramePipeline::StageThreadFunction, this, STAGE_SINK, sinkStage));
+}
+
+/// <summary>
+/// Lets all workers finish the frames that are still in the pipeline and then joins them
+/// </summary>
+void FramePipeline::Stop()
+{
+	if (!m_bRunning)
+		return;
+
+	Flush();
+	m_bRunning = false;
+
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		std::lock_guard<std::mutex> lock(m_mWake[i]);
+		m_cvWake[i].notify_all();
+	}
+
+	for (size_t i = 0; i < m_vStageThreads.size(); i++)
+		m_vStageThreads[i].join();
+
+	m_vStageThreads.clear();
+}
+
+/// <summary>
+/// Gets an unused slot for a newly aquired frame. Only call this from the acquisition thread.
+/// </summary>
+/// <returns>A free slot, or NULL when all slots are still being processed. In that case the frame should be dropped</returns>
+FrameSlot* FramePipeline::GetFreeSlot()
+{
+	FrameSlot* slot = NULL;
+
+	if (!m_vRings[STAGE_ACQUISITION]->Pop(slot))
+		return NULL;
+
+	return slot;
+}
+
+/// <summary>
+/// Hands a filled slot over to the decode stage. Only call this from the acquisition thread.
+/// </summary>
+void FramePipeline::Submit(FrameSlot* slot)
+{
+	m_nInFlight++;
+	m_nProcessed[STAGE_ACQUISITION]++;
+	Forward(STAGE_ACQUISITION, slot);
+}
+
+/// <summary>
+/// Blocks until every submitted frame has passed the sink stage. Needs to be called before anything that the
+/// stages depend on gets changed (e.g. restarting the camera) or before results of the sink are read (e.g. timestamp lists).
+/// </summary>
+void FramePipeline::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mFlush);
+	m_cvFlush.wait(lock, [this] { return m_nInFlight == 0; });
+}
+
+/// <summary>
+/// Frees the buffers owned by the slots, as their dimensions might change with a new camera configuration.
+/// The pipeline needs to be flushed before calling this.
+/// </summary>
+void FramePipeline::ReleaseSlotResources()
+{
+	for (size_t i = 0; i < m_vSlots.size(); i++)
+	{
+		FrameSlot& slot = m_vSlots[i];
+
+		slot.colorBGR.release();
+		slot.pointCloudColorBGR.release();
+		slot.colorYUV = YUVImage();
+
+		if (slot.pointCloudImage != NULL)
+			k4a_image_release(slot.pointCloudImage);
+
+		slot.pointCloudImage = NULL;
+		slot.nColorFrameWidth = 0;
+		slot.nColorFrameHeight = 0;
+		slot.nPointCloudWidth = 0;
+		slot.nPointCloudHeight = 0;
+
+		if (slot.pPointcloud != NULL)
+			slot.pPointcloud->Release();
+
+		slot.pPointcloud = NULL;
+	}
+}
+
+/// <summary>
+/// Returns true when a more recent frame is already waiting in front of the given stage.
+/// Stages can use this to skip work that is only needed for the newest frame, like the preview
+/// </summary>
+bool FramePipeline::HasNewerFrame(PIPELINE_STAGE stage)
+{
+	return !m_vRings[stage]->Empty();
+}
+
+void FramePipeline::CountDrop(PIPELINE_STAGE stage)
+{
+	m_nDropped[stage]++;
+}
+
+PipelineStageStats FramePipeline::GetStats(PIPELINE_STAGE stage)
+{
+	PipelineStageStats stats;
+
+	//For the acquisition, the interesting depth is how many slots are in use, for all other stages how many frames wait in front of it
+	if (stage == STAGE_ACQUISITION)
+		stats.queueDepth = m_nInFlight;
+	else
+		stats.queueDepth = static_cast<int>(m_vRings[stage]->Size());
+
+	stats.processed = m_nProcessed[stage];
+	stats.dropped = m_nDropped[stage];
+
+	return stats;
+}
+
+std::string FramePipeline::GetStatsString()
+{
+	const char* stageNames[STAGE_COUNT] = { "Acquisition", "Decode", "Cull", "Sink" };
+	std::string statsString;
+
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		PipelineStageStats stats = GetStats(static_cast<PIPELINE_STAGE>(i));
+		statsString += std::string(stageNames[i]) + ": queue= " + std::to_string(stats.queueDepth) + " processed= " + std::to_string(stats.processed) + " dropped= " + std::to_string(stats.dropped);
+
+		if (i < STAGE_COUNT - 1)
+			statsString += " | ";
+	}
+
+	return statsString;
+}
+
+void FramePipeline::StageThreadFunction(PIPELINE_STAGE stage, StageFunction function)
+{
+	SPSCRing<FrameSlot*>* input = m_vRings[stage];
+
+	while (true)
+	{
+		FrameSlot* slot = NULL;
+
+		if (!input->Pop(slot))
+		{
+			if (!m_bRunning)
+				return;
+
+			std::unique_lock<std::mutex> lock(m_mWake[stage]);
+			m_cvWake[stage].wait(lock, [this, input] { return !input->Empty() || !m_bRunning; });
+			continue;
+		}
+
+		function(slot);
+		m_nProcessed[stage]++;
+
+		if (stage == STAGE_SINK)
+			RecycleSlot(slot);
+		else
+			Forward(stage, slot);
+	}
+}
+
+void FramePipeline::Forward(PIPELINE_STAGE fromStage, FrameSlot* slot)
+{
+	int nextStage = fromStage + 1;
+
+	//Can't fail, every ring has room for all slots
+	m_vRings[nextStage]->Push(slot);
+
+	std::lock_guard<std::mutex> lock(m_mWake[nextStage]);
+	m_cvWake[nextStage].notify_one();
+}
+
+void FramePipeline::RecycleSlot(FrameSlot* slot)
+{
+	if (slot->raw.colorImageMJPG != NULL)
+		k4a_image_release(slot->raw.colorImageMJPG);
+
+	if (slot->raw.depthImage16Int != NULL)
+		k4a_image_release(slot->raw.depthImage16Int);
+
+	slot->raw = RawFrame();
+
+	if (slot->pPointcloud != NULL)
+		slot->pPointcloud->Release();
+
+	slot->pPointcloud = NULL;
+	slot->capture = false;
+	slot->sendLiveFrame = false;
+	slot->pushLiveFrame = false;
+	slot->calibrate = false;
+
+	m_vRings[STAGE_ACQUISITION]->Push(slot);
+
+	std::lock_guard<std::mutex> lock(m_mFlush);
+	m_nInFlight--;
+	m_cvFlush.notify_all();
+}
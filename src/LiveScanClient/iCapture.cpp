@@ -21,6 +21,9 @@ ICapture::ICapture()
 
 	nColorFrameHeight = 0;
 	nColorFrameWidth = 0;
+	nPointCloudHeight = 0;
+	nPointCloudWidth = 0;
+	bColorDecodedToYUV = false;
 
 	nCalibrationSize = 0;
 
@@ -41,6 +44,7 @@ ICapture::~ICapture()
 	}
 
 	colorBGR.release();
+	pointCloudColorBGR.release();
 
 	k4a_image_release(colorImageMJPG);
 	k4a_image_release(depthImage16Int);
@@ -33,9 +33,43 @@ LiveScanClient::LiveScanClient() :
 	m_bSendCalibration(false),
 	m_bShowDepth(false),
 	m_bShowPreviewDuringRecording(false),
+	m_bDepthNativePointcloud(false),
+	m_bFilterOutliers(false),
+	m_nOutlierRadius(20),
+	m_nOutlierMinNeighbors(5),
+	m_nVoxelLeafSize(0),
+	m_nPointBudget(0),
+	m_pFrameWriter(NULL),
+	m_eRecordingQueuePolicy(WQ_BLOCK),
+	m_bUnbufferedRecording(false),
+	m_nRecordingPreallocationMB(0),
+	m_bCompressRecording(false),
+	m_eFrameEncoding(FE_INTERLEAVED),
+	m_bUpdateCullROI(true),
 	m_bSocketThread(true),
 	m_bFrameCompression(true),
 	m_iCompressionLevel(2),
+	m_bAdaptiveCompression(true),
+	m_bSharedMemoryTransport(false),
+	m_bSharedFrameRingConfirmed(false),
+	m_bRequestLiveFrame(false),
+	m_bLiveFramesSubscribed(false),
+	m_nLiveFrameInterval(1),
+	m_nLiveFrameCredits(0),
+	m_nLiveFrameCounter(0),
+	m_nLiveFramesPushed(0),
+	m_nLiveFramesDropped(0),
+	m_nLiveFrameSubscription(0),
+	m_bStreamingStoredFrames(false),
+	m_nStoredFramesLeft(0),
+	m_nStoredFrameWindow(1),
+	m_nStoredFramesInFlight(0),
+	m_nStoredFramesSent(0),
+	m_bUpdateBackground(false),
+	m_fBackgroundTolerance(3.0f),
+	m_nLearnBackgroundFrames(0),
+	m_bClearBackground(false),
+	m_nBackgroundFramesToLearn(0),
 	m_pClientSocket(NULL),
 	m_bRequestConfiguration(false),
 	m_bSendConfiguration(false),
@@ -46,13 +80,18 @@ LiveScanClient::LiveScanClient() :
 	m_nExtrinsicsStyle(0), // 0 = no export of extrinsics
 	m_eCaptureMode(CM_POINTCLOUD),
 	m_nFrameIndex(0),
+	m_nAcquiredFrameIndex(0),
 	m_tFrameTime(0),
 	m_tOldFrameTime(0),
 	m_fAverageFPS(0),
 	m_nFPSFrameCounter(0),
 	m_nFPSUpdateCounter(0),
 	m_bActiveClient(true),
-	m_nAllVerticesSize(0)
+	m_pFramePipeline(NULL),
+	m_pColorPreview(NULL),
+	m_pDepthPreview(NULL),
+	m_nPreviewWidth(0),
+	m_nPreviewHeight(0)
 
 {
 	m_vBounds.push_back(-0.5);
@@ -61,12 +100,24 @@ LiveScanClient::LiveScanClient() :
 	m_vBounds.push_back(0.5);
 	m_vBounds.push_back(0.5);
 	m_vBounds.push_back(0.5);
+
+	m_pPointcloudPool = new FrameBufferPool(true);
+	m_pPreviewPool = new FrameBufferPool(false);
+
+	RegisterMessageHandlers();
 }
 
 LiveScanClient::~LiveScanClient()
 {
 	configuration.Save();
 
+	//The pipeline still holds frames of the capture, so it needs to go first
+	if (m_pFramePipeline)
+	{
+		delete m_pFramePipeline;
+		m_pFramePipeline = NULL;
+	}
+
 	if (pCapture)
 	{
 		delete pCapture;
@@ -85,6 +136,23 @@ LiveScanClient::~LiveScanClient()
 		m_pClientSocket = NULL;
 	}
 
+	if (m_pColorPreview)
+		m_pColorPreview->Release();
+
+	if (m_pDepthPreview)
+		m_pDepthPreview->Release();
+
+	//Holds frames of the pool and writes through m_framesFileWriterReader
+	if (m_pFrameWriter)
+	{
+		delete m_pFrameWriter;
+		m_pFrameWriter = NULL;
+	}
+
+	//The pools stay alive until the UI has released the last preview it holds
+	m_pPointcloudPool->Dispose();
+	m_pPreviewPool->Dispose();
+
 
 	delete m_framesFileWriterReader;
 	m_framesFileWriterReader = NULL;
@@ -118,6 +186,7 @@ void LiveScanClient::RunClient(Log* logger, bool virtualDevice)
 	m_mRunning.unlock();
 
 	m_framesFileWriterReader = new FrameFileWriterReader(log);
+	m_pFrameWriter = new AsyncFrameWriter(m_framesFileWriterReader, m_nRecordingQueueFrames);
 	cv::imencode(".jpg", cv::Mat(1, 1, CV_8UC3), emptyJPEGBuffer);
 
 	bool res = false;
@@ -142,6 +211,11 @@ void LiveScanClient::RunClient(Log* logger, bool virtualDevice)
 			m_sLastUsedIP = m_framesFileWriterReader->ReadIPFromFile();
 			configuration.eHardwareSyncState = static_cast<SYNC_STATE>(pCapture->GetSyncJackState());
 			calibration.LoadCalibration(serial);
+
+			if (pCapture->LoadBackground())
+				logBuffer.LogInfo("Loaded the background model of the device");
+
+			UpdateFrameBufferPools();
 			m_pCameraSpaceCoordinates = new Point3f[pCapture->nColorFrameWidth * pCapture->nColorFrameHeight];
 			pCapture->SetExposureState(true, 0);
 			m_eClientStatus = STATUS_RUNNING;
@@ -159,11 +233,20 @@ void LiveScanClient::RunClient(Log* logger, bool virtualDevice)
 	}
 
 
+	m_pFramePipeline = new FramePipeline(m_nPipelineSlots);
+	m_pFramePipeline->Start(
+		[this](FrameSlot* slot) { DecodeTransformStage(slot); },
+		[this](FrameSlot* slot) { CullStage(slot); },
+		[this](FrameSlot* slot) { SinkStage(slot); });
+
 	while (m_bRunning)
 	{
 		UpdateFrame();
 	}
 
+	m_pFramePipeline->Stop();
+	m_pFrameWriter->Flush();
+
 	m_framesFileWriterReader->WriteIPToFile(m_sLastUsedIP);
 
 	m_bSocketThread = false;
@@ -212,16 +295,41 @@ void LiveScanClient::UpdateFrame()
 		pCapture->SetExposureState(m_bAutoExposureEnabled, m_nExposureStep);
 		pCapture->SetWhiteBalanceState(m_bAutoWhiteBalanceEnabled, m_nKelvin);
 		calibration.UpdateClientPose();
+		m_bUpdateCullROI = true;
 		m_bSendCalibration = true;
 		m_bUpdateSettings = false;
 	}
 
 	if (m_bUpdateFilters)
 	{
-		pCapture->SetFilters(configuration.filter_depth_map, configuration.filter_depth_map_size);
+		m_pFramePipeline->Flush();
+		pCapture->SetFilters(configuration);
+		pCapture->SetColorDecodeScale(configuration.color_decode_scale);
 		m_bUpdateFilters = false;
 	}
 
+	//The decode stage uses the background model, so it can only be changed while no frame is in the pipeline
+	if (m_bUpdateBackground)
+	{
+		m_pFramePipeline->Flush();
+
+		std::lock_guard<std::mutex> lock(m_mSocketThread);
+		pCapture->SetBackgroundTolerance(m_fBackgroundTolerance);
+
+		if (m_bClearBackground)
+			pCapture->ClearBackground();
+
+		if (m_nLearnBackgroundFrames > 0)
+		{
+			pCapture->LearnBackground(m_nLearnBackgroundFrames);
+			m_nBackgroundFramesToLearn = m_nLearnBackgroundFrames;
+		}
+
+		m_bClearBackground = false;
+		m_nLearnBackgroundFrames = 0;
+		m_bUpdateBackground = false;
+	}
+
 	if (m_bCloseCamera)
 	{
 		StopCamera();
@@ -241,6 +349,18 @@ void LiveScanClient::UpdateFrame()
 
 	if (m_bStartPreRecordingProcess)
 	{
+		//Frames that are still in the pipeline belong to the time before the recording
+		m_pFramePipeline->Flush();
+		m_pFrameWriter->Flush();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mSocketThread);
+			m_pFrameWriter->SetPolicy(m_eRecordingQueuePolicy);
+			m_framesFileWriterReader->SetWriteOptions((uint64_t)m_nRecordingPreallocationMB * 1024 * 1024, m_bUnbufferedRecording, m_bCompressRecording);
+		}
+
+		m_pFrameWriter->ResetStats();
+
 		m_nFrameIndex = 0;
 		m_vFrameTimestamps.clear();
 		m_vFrameCount.clear();
@@ -257,6 +377,13 @@ void LiveScanClient::UpdateFrame()
 
 	if (m_bStartPostRecordingProcess)
 	{
+		//Make sure all captured frames have been written before we write the log
+		m_pFramePipeline->Flush();
+		m_pFrameWriter->Flush();
+		logBuffer.LogInfo("Recording writer: " + m_pFrameWriter->GetStatsString());
+
+		//Ends the raw recording of the take with its index, so that it is complete even if it never gets post synced
+		m_framesFileWriterReader->closeRawFileIfOpened();
 		m_framesFileWriterReader->WriteTimestampLog(m_vFrameCount, m_vFrameTimestamps, configuration.nGlobalDeviceIndex);
 
 		if (m_bPreviewDisabled)
@@ -272,6 +399,9 @@ void LiveScanClient::UpdateFrame()
 		m_bPostSyncedListReceived = false;
 		bool success = true;
 
+		m_pFramePipeline->Flush();
+		m_pFrameWriter->Flush();
+
 		if (m_eCaptureMode == CAPTURE_MODE::CM_RAW)
 			success = PostSyncRawFrames();
 
@@ -282,150 +412,359 @@ void LiveScanClient::UpdateFrame()
 		SendPostSyncConfirmation(success);
 	}
 
-	//We always need to capture the raw frame data
+	//We always need to capture the raw frame data. Everything else happens on the worker threads of the pipeline
 	if (pCapture->AquireRawFrame())
 	{
-		//We lock the network thread so it that the requirement variables don't change while we process the frame 
+		RawFrame rawFrame;
+
+		if (!pCapture->DetachRawFrame(rawFrame))
+			return;
+
+		FrameSlot* slot = m_pFramePipeline->GetFreeSlot();
+
+		//All slots are still in use by the later stages, so we have to skip this frame
+		if (slot == NULL)
+		{
+			k4a_image_release(rawFrame.colorImageMJPG);
+			k4a_image_release(rawFrame.depthImage16Int);
+			m_pFramePipeline->CountDrop(STAGE_ACQUISITION);
+			return;
+		}
+
+		slot->raw = rawFrame;
+		slot->frameIndex = m_nAcquiredFrameIndex++;
+
+		//We lock the network thread so it that the requirement variables don't change while we decide what to do with the frame
 		std::lock_guard<std::mutex> lock(m_mSocketThread);
 
 		//To optimize our use of system resources, we only process what is needed
-		bool generateRBGData = false;
-		bool generateDepthToColorData = false;
-		bool generatePointcloud = false;
+		slot->generateRGBData = false;
+		slot->generateDepthToColorData = false;
+		slot->generatePointcloud = false;
+		slot->depthNativePointcloud = false;
+		slot->decodeColorToYUV = false;
+
+		//A subscribed server gets every n-th frame, but only as long as it has credits left. Otherwise the frame is dropped here,
+		//so that we don't generate a pointcloud for it and a slow server doesn't make frames pile up in the socket.
+		//The credit is taken right away, so that the frames on their way through the pipeline never outnumber the credits.
+		//A frame that the server requested anyway is sent as the answer to the request instead
+		bool pushLiveFrame = false;
+
+		if (m_bLiveFramesSubscribed && m_nLiveFrameCounter++ % m_nLiveFrameInterval == 0 && !m_bRequestLiveFrame)
+		{
+			if (m_nLiveFrameCredits > 0)
+			{
+				m_nLiveFrameCredits--;
+				pushLiveFrame = true;
+			}
+
+			else
+				m_nLiveFramesDropped++;
+		}
 
-		if (m_eCaptureMode == CM_POINTCLOUD || m_bCalibrate || m_bRequestLiveFrame)
+		if (m_eCaptureMode == CM_POINTCLOUD || m_bCalibrate || m_bRequestLiveFrame || pushLiveFrame)
 		{
-			generateRBGData = true;
-			generateDepthToColorData = true;
-			generatePointcloud = true;
+			slot->generateRGBData = true;
+			slot->generatePointcloud = true;
+
+			//The marker detection needs a pointcloud that matches the color image, so calibration frames always use the color resolution
+			slot->depthNativePointcloud = m_bDepthNativePointcloud && !m_bCalibrate;
+
+			if (!slot->depthNativePointcloud)
+				slot->generateDepthToColorData = true;
 		}
 
-		if (!m_bPreviewDisabled && !m_bShowDepth && m_bActiveClient)
-			generateRBGData = true;
+		bool colorPreview = !m_bPreviewDisabled && !m_bShowDepth && m_bActiveClient;
+
+		if (colorPreview)
+			slot->generateRGBData = true;
+
+		//If nobody needs to see the color image, we only convert the colors of the points that survive the culling.
+		//The marker detection needs the full BGRA image, so calibration frames are always fully decoded
+		slot->decodeColorToYUV = configuration.decode_color_to_yuv && slot->generatePointcloud && !m_bCalibrate && !colorPreview;
 
 		if (!m_bPreviewDisabled && m_bShowDepth)
-			generateDepthToColorData = true;
+			slot->generateDepthToColorData = true;
+
+		slot->calibrate = m_bCalibrate;
+		slot->capture = m_bCaptureFrames || m_bCaptureSingleFrame;
+		slot->sendLiveFrame = m_bRequestLiveFrame;
+		slot->pushLiveFrame = pushLiveFrame;
+		slot->liveFrameSubscription = m_nLiveFrameSubscription;
+		slot->captureMode = m_eCaptureMode;
+		slot->updateCullROI = m_bUpdateCullROI;
+		m_bUpdateCullROI = false;
+		slot->filterOutliers = m_bFilterOutliers;
+		slot->outlierRadius = m_nOutlierRadius;
+		slot->outlierMinNeighbors = m_nOutlierMinNeighbors;
+		slot->voxelLeafSize = m_nVoxelLeafSize;
+		slot->pointBudget = m_nPointBudget;
+
+		//Only frames that make it into a slot count, the model gets exactly as many frames as the server asked for
+		slot->learnBackground = m_nBackgroundFramesToLearn > 0;
+
+		if (slot->learnBackground)
+			m_nBackgroundFramesToLearn--;
+
+		Matrix4x4 scale = Matrix4x4(
+			0.001f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.001f, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.001f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f);
+
+		slot->toWorld = calibration.worldTransform * scale;
+
+		for (int i = 0; i < 6; i++)
+			slot->bounds[i] = m_vBounds[i];
+
+		m_bCaptureSingleFrame = false;
+		m_bRequestLiveFrame = false;
+
+		m_pFramePipeline->Submit(slot);
+	}
+
+}
+
+/// <summary>
+/// Second stage of the pipeline. Decodes the color image and transforms the depth image into a pointcloud, as far as this frame needs it.
+/// Runs on its own thread and is the only stage that uses the processing functions of pCapture.
+/// </summary>
+void LiveScanClient::DecodeTransformStage(FrameSlot* slot)
+{
+	//Has to happen before the frame might be skipped, otherwise the new bounds would never reach the capture
+	if (slot->updateCullROI)
+		pCapture->SetCullBounds(slot->toWorld, slot->bounds);
 
-		if (generateRBGData)
+	//When a frame is only needed for the preview and a newer one is already waiting, we can skip it
+	if (!slot->generatePointcloud && !slot->calibrate && !slot->learnBackground && m_pFramePipeline->HasNewerFrame(STAGE_DECODE))
+	{
+		m_pFramePipeline->CountDrop(STAGE_DECODE);
+		return;
+	}
+
+	pCapture->AttachRawFrame(slot->raw);
+
+	//Has to happen before the depth image gets filtered below
+	if (slot->learnBackground)
+		pCapture->AddBackgroundFrame();
+
+	//The capture works on the buffers of the slot, so that the cull stage can still read them while we process the next frame
+	pCapture->colorBGR = slot->colorBGR;
+	pCapture->pointCloudColorBGR = slot->pointCloudColorBGR;
+	std::swap(pCapture->colorYUV, slot->colorYUV);
+	std::swap(pCapture->pointCloudImage, slot->pointCloudImage);
+
+	if (slot->decodeColorToYUV)
+	{
+		//The points would otherwise be colored from the planes of whichever frame was decoded into them before
+		if (!pCapture->DecodeRawColorToYUV())
 		{
-			pCapture->DecodeRawColor();
-			//pCapture->DownscaleColorImgToDepthImgSize();
+			slot->generatePointcloud = false;
+			m_pFramePipeline->CountDrop(STAGE_DECODE);
 		}
+	}
 
-		if (generateDepthToColorData)
-			pCapture->MapDepthToColor();
+	else if (slot->generateRGBData)
+	{
+		pCapture->DecodeRawColor();
+		//pCapture->DownscaleColorImgToDepthImgSize();
+	}
 
-		if (generatePointcloud)
-		{
+	if (slot->generateDepthToColorData)
+		pCapture->MapDepthToColor();
+
+	if (slot->generatePointcloud)
+	{
+		if (slot->depthNativePointcloud)
+			pCapture->GenerateDepthNativePointcloud();
+		else
 			pCapture->GeneratePointcloud();
-			StoreFrame(pCapture->pointCloudImage, &pCapture->colorBGR);
-		}
+	}
 
+	if (slot->calibrate)
+	{
+		std::lock_guard<std::mutex> lock(m_mSocketThread);
 
-		if (m_bCaptureFrames || m_bCaptureSingleFrame)
-		{
-			uint64_t timeStamp = pCapture->GetTimeStamp();
-			m_vFrameCount.push_back(m_nFrameIndex);
-			m_vFrameTimestamps.push_back(timeStamp);
+		//The calibration might already have succeeded on an earlier frame
+		if (m_bCalibrate)
+			Calibrate();
+	}
 
-			if (m_eCaptureMode == CM_RAW)
-			{
-				SaveRawFrame();
-			}
+	//colorBGR is outdated when we decoded to YUV, but the depth preview can still be shown
+	if (m_bActiveClient && !(slot->decodeColorToYUV && !m_bShowDepth))
+		UpdatePreview();
+
+	slot->colorBGR = pCapture->colorBGR;
+	slot->pointCloudColorBGR = pCapture->pointCloudColorBGR;
+	std::swap(pCapture->colorYUV, slot->colorYUV);
+	std::swap(pCapture->pointCloudImage, slot->pointCloudImage);
+	slot->nColorFrameWidth = pCapture->nColorFrameWidth;
+	slot->nColorFrameHeight = pCapture->nColorFrameHeight;
+	slot->nPointCloudWidth = pCapture->nPointCloudWidth;
+	slot->nPointCloudHeight = pCapture->nPointCloudHeight;
+	slot->cullROI = pCapture->pointCloudROI;
+}
 
-			else if (m_eCaptureMode == CM_POINTCLOUD)
-			{
-				SavePointcloudFrame(timeStamp);
-			}
+/// <summary>
+/// Third stage of the pipeline. Removes all invalid and out of bounds vertices from the pointcloud
+/// </summary>
+void LiveScanClient::CullStage(FrameSlot* slot)
+{
+	if (slot->generatePointcloud)
+		StoreFrame(slot);
+}
 
-			m_bCaptureSingleFrame = false;
-			m_bConfirmCaptured = true;
-			m_nFrameIndex++;
+/// <summary>
+/// Last stage of the pipeline. Writes the frame to disk and/or sends it to the server
+/// </summary>
+void LiveScanClient::SinkStage(FrameSlot* slot)
+{
+	if (slot->capture)
+	{
+		bool queued = false;
 
-			//Save the time since the last capture to estimate FPS. While recording, we only save the time after having stored a frame, so that the user gets a grasp of how fast the recording is taking place
-			m_tOldFrameTime = m_tFrameTime;
-			m_tFrameTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+		if (slot->captureMode == CM_RAW)
+		{
+			queued = SaveRawFrame(slot);
 		}
 
-		if (!m_bCapturing)
+		//The pointcloud is missing when the frame couldn't be decoded
+		else if (slot->captureMode == CM_POINTCLOUD && slot->pPointcloud != NULL)
 		{
-			m_tOldFrameTime = m_tFrameTime;
-			m_tFrameTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+			queued = SavePointcloudFrame(slot);
 		}
 
-		if (m_bCalibrate)
+		std::lock_guard<std::mutex> lock(m_mSocketThread);
+
+		//Frames the writer had to drop are left out of the timestamp log, so that it still matches the recorded frames
+		if (queued)
 		{
-			Calibrate();
+			m_vFrameCount.push_back(m_nFrameIndex);
+			m_vFrameTimestamps.push_back(slot->raw.timeStamp);
+			m_nFrameIndex++;
 		}
 
-		if (m_bRequestLiveFrame)
+		else if (slot->captureMode == CM_POINTCLOUD && slot->pPointcloud == NULL)
+			logBuffer.LogWarning("Could not decode the frame with timestamp " + to_string(slot->raw.timeStamp) + ", dropped it from the recording");
+
+		else
+			logBuffer.LogWarning("The disk can't keep up with the recording, dropped frame with timestamp: " + to_string(slot->raw.timeStamp));
+
+		m_bConfirmCaptured = true;
+
+		//Save the time since the last capture to estimate FPS. While recording, we only save the time after having stored a frame, so that the user gets a grasp of how fast the recording is taking place
+		m_tOldFrameTime = m_tFrameTime;
+		m_tFrameTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+	}
+
+	//Without a pointcloud, the frame couldn't be decoded. A request of the server stays open, so that the next frame answers it,
+	//and a pushed frame gives its credit back to the subscription it was taken from
+	if ((slot->sendLiveFrame || slot->pushLiveFrame) && slot->pPointcloud == NULL)
+	{
+		std::lock_guard<std::mutex> lock(m_mSocketThread);
+
+		if (slot->sendLiveFrame)
+			m_bRequestLiveFrame = true;
+
+		else
 		{
-			SendFrame(m_vLastFrameVertices, m_vLastFrameVerticesSize, m_vLastFrameRGB, true);
-			m_bRequestLiveFrame = false;
+			m_nLiveFramesDropped++;
+
+			if (m_bLiveFramesSubscribed && slot->liveFrameSubscription == m_nLiveFrameSubscription)
+				m_nLiveFrameCredits++;
 		}
+	}
 
-		if (m_bActiveClient)
-			UpdatePreview();
+	else if (slot->sendLiveFrame || slot->pushLiveFrame)
+	{
+		std::lock_guard<std::mutex> lock(m_mSocketThread);
+		bool send = slot->sendLiveFrame;
+		OUTGOING_MESSAGE_TYPE message = MSG_LAST_FRAME;
 
-		UpdateFPS();
+		//The credit was taken when the frame was acquired, but the server could have unsubscribed in the meantime
+		if (slot->pushLiveFrame)
+		{
+			if (m_bLiveFramesSubscribed && slot->liveFrameSubscription == m_nLiveFrameSubscription)
+			{
+				m_nLiveFramesPushed++;
+				message = MSG_PUSHED_LIVE_FRAME;
+				send = true;
+			}
+			else
+				m_nLiveFramesDropped++;
+		}
 
+		if (send)
+			SendFrame(slot->pPointcloud->pVertices, slot->pPointcloud->nSize, slot->pPointcloud->pColors, slot->raw.timeStamp, slot->frameIndex, message);
 	}
 
+	if (!m_bCapturing)
+	{
+		m_tOldFrameTime = m_tFrameTime;
+		m_tFrameTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch());
+	}
+
+	UpdateFPS();
 }
 
 void LiveScanClient::UpdatePreview()
 {
 	if (!m_bPreviewDisabled) //TODO: Only update preview when we need it (When the client tab is active)
 	{
-		std::lock_guard<std::mutex> lock(m_mPreviewResources);
-
-		//Check if we need to reinitialize the memory
-		if (m_nPreviewWidth * m_nPreviewHeight != pCapture->nColorFrameHeight * pCapture->nColorFrameWidth || !m_pColorPreview || !m_pDepthPreview)
-		{
-			if (m_pColorPreview != NULL)
-				delete[] m_pColorPreview;
-
-			if (m_pDepthPreview != NULL)
-				delete[] m_pDepthPreview;
-
-			m_nPreviewWidth = pCapture->nColorFrameWidth;
-			m_nPreviewHeight = pCapture->nColorFrameHeight;
-
-			m_pColorPreview = new RGBA[m_nPreviewWidth * m_nPreviewHeight];
-			m_pDepthPreview = new RGBA[m_nPreviewWidth * m_nPreviewHeight];
-		}
+		int width = pCapture->nColorFrameWidth;
+		int height = pCapture->nColorFrameHeight;
 
+		//We write into a fresh buffer, so that the UI can keep drawing the last preview without blocking us
 		if (m_bShowDepth)
 		{
 			// Make sure we've received valid data
 			if (pCapture->transformedDepthImage != NULL)
 			{
+				FrameBuffer* depthPreview = m_pPreviewPool->Borrow(width * height);
 				uint16_t* pointCloudImageData = (uint16_t*)(void*)k4a_image_get_buffer(pCapture->transformedDepthImage);
 
-				for (int i = 0; i < m_nPreviewWidth * m_nPreviewHeight; i++)
+				for (int i = 0; i < width * height; i++)
 				{
 					uint8_t intensity = pointCloudImageData[i] / 40;
-					m_pDepthPreview[i].red = rainbowLookup[intensity][0];
-					m_pDepthPreview[i].green = rainbowLookup[intensity][1];
-					m_pDepthPreview[i].blue = rainbowLookup[intensity][2];
+					depthPreview->pColors[i].red = rainbowLookup[intensity][0];
+					depthPreview->pColors[i].green = rainbowLookup[intensity][1];
+					depthPreview->pColors[i].blue = rainbowLookup[intensity][2];
 				}
+
+				SetPreviewBuffer(m_pDepthPreview, depthPreview, width, height);
 			}
 		}
 
 		else
 		{
-			//We copy the data into a secondary buffer so that we can use it thread safely, without blocking the pCapture resource too long
 			if (!pCapture->colorBGR.empty())
 			{
+				FrameBuffer* colorPreview = m_pPreviewPool->Borrow(width * height);
 
-				int size = pCapture->colorBGR.step * pCapture->colorBGR.size().height;
 				//Just copying, this makes the data actually BGR, not RGB as the type might indicates
-				std::memcpy(m_pColorPreview, pCapture->colorBGR.data, m_nPreviewWidth * m_nPreviewHeight * sizeof(RGBA));
+				std::memcpy(colorPreview->pColors, pCapture->colorBGR.data, width * height * sizeof(RGBA));
+
+				SetPreviewBuffer(m_pColorPreview, colorPreview, width, height);
 			}
 		}
 	}
 }
 
+/// <summary>
+/// Replaces the current preview with a new one. The old buffer goes back to the pool once the UI has released it too
+/// </summary>
+void LiveScanClient::SetPreviewBuffer(FrameBuffer*& preview, FrameBuffer* newPreview, int width, int height)
+{
+	std::lock_guard<std::mutex> lock(m_mPreviewResources);
+
+	if (preview != NULL)
+		preview->Release();
+
+	preview = newPreview;
+	m_nPreviewWidth = width;
+	m_nPreviewHeight = height;
+}
+
 
 PreviewFrame LiveScanClient::GetDepthTS()
 {
@@ -434,13 +773,13 @@ PreviewFrame LiveScanClient::GetDepthTS()
 	PreviewFrame frame;
 	frame.width = m_nPreviewWidth;
 	frame.height = m_nPreviewHeight;
-	frame.picture = NULL;
 	frame.previewDisabled = m_bPreviewDisabled;
 
-	if (m_nPreviewHeight * m_nPreviewWidth > 0 && !m_bPreviewDisabled)
+	if (m_pDepthPreview != NULL && !m_bPreviewDisabled)
 	{
-		frame.picture = new RGBA[frame.height * frame.width];
-		std::memcpy(frame.picture, m_pDepthPreview, m_nPreviewWidth * m_nPreviewHeight * sizeof(RGBA));
+		m_pDepthPreview->AddRef();
+		frame.buffer = m_pDepthPreview;
+		frame.picture = m_pDepthPreview->pColors;
 	}
 
 	return frame;
@@ -454,28 +793,31 @@ PreviewFrame LiveScanClient::GetColorTS()
 	PreviewFrame frame;
 	frame.width = m_nPreviewWidth;
 	frame.height = m_nPreviewHeight;
-	frame.picture = NULL;
 	frame.previewDisabled = m_bPreviewDisabled;
 
-	if (m_nPreviewHeight * m_nPreviewWidth > 0 && !m_bPreviewDisabled)
+	if (m_pColorPreview != NULL && !m_bPreviewDisabled)
 	{
-		frame.picture = new RGBA[frame.height * frame.width];
-		std::memcpy(frame.picture, m_pColorPreview, m_nPreviewWidth * m_nPreviewHeight * sizeof(RGBA));
+		m_pColorPreview->AddRef();
+		frame.buffer = m_pColorPreview;
+		frame.picture = m_pColorPreview->pColors;
 	}
 
 	return frame;
 }
 
 
-void LiveScanClient::SaveRawFrame()
+/// <summary>
+/// Queues the frame on the writer, which writes it on its own thread
+/// </summary>
+/// <returns>False if the writer had to drop the frame</returns>
+bool LiveScanClient::SaveRawFrame(FrameSlot* slot)
 {
-	m_framesFileWriterReader->WriteColorJPGFile(k4a_image_get_buffer(pCapture->colorImageMJPG), k4a_image_get_size(pCapture->colorImageMJPG), m_nFrameIndex, "");
-	m_framesFileWriterReader->WriteDepthTiffFile(pCapture->depthImage16Int, m_nFrameIndex, "");
+	return m_pFrameWriter->WriteRawFrame(slot->raw.colorImageMJPG, slot->raw.depthImage16Int, m_nFrameIndex, slot->raw.timeStamp, configuration.nGlobalDeviceIndex);
 }
 
-void LiveScanClient::SavePointcloudFrame(uint64_t timeStamp)
+bool LiveScanClient::SavePointcloudFrame(FrameSlot* slot)
 {
-	m_framesFileWriterReader->writeNextBinaryFrame(m_vLastFrameVertices, m_vLastFrameVerticesSize, m_vLastFrameRGB, timeStamp, configuration.nGlobalDeviceIndex);
+	return m_pFrameWriter->WritePointcloudFrame(slot->pPointcloud, slot->raw.timeStamp, configuration.nGlobalDeviceIndex);
 }
 
 void LiveScanClient::Calibrate()
@@ -495,6 +837,7 @@ void LiveScanClient::Calibrate()
 		logBuffer.LogInfo("Calibration Successfull");
 		calibration.SaveCalibration(configuration.serialNumber);
 		m_bSendCalibration = true;
+		m_bUpdateCullROI = true;
 		m_bCalibrate = false;
 	}
 
@@ -509,8 +852,27 @@ void LiveScanClient::SocketThreadFunction()
 {
 	while (m_bSocketThread)
 	{
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
-		HandleSocket();
+		bool connected;
+		SOCKET waitHandle;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mSocketThread);
+			connected = m_bConnected;
+			waitHandle = connected ? m_pClientSocket->GetHandle() : INVALID_SOCKET;
+		}
+
+		if (!connected)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		//Wakes up as soon as the server sends something. The timeout only bounds how long our own outgoing messages wait.
+		//Only the handle is waited on, without a copy of the Socket. If Disconnect() closes it meanwhile, it counts as readable
+		//and HandleSocket() finds the connection gone
+		bool readable = Socket::WaitReadable(waitHandle, 1);
+
+		HandleSocket(readable);
 	}
 }
 
@@ -526,6 +888,10 @@ bool LiveScanClient::Connect(std::string ip)
 		{
 			logBuffer.LogInfo("Trying to connect to server");
 			m_pClientSocket = new SocketClient(ip, 48001); //This can potentially take some time, depending on the timeout settings
+			m_MessageFramer.Reset();
+			ResetLiveFrameSubscription();
+			CloseSharedFrameRing();
+			m_bStreamingStoredFrames = false;
 
 			m_bConnected = true;
 			if (calibration.bCalibrated)
@@ -557,6 +923,8 @@ bool LiveScanClient::Disconnect()
 		delete m_pClientSocket;
 		m_pClientSocket = NULL;
 		m_bConnected = false;
+		ResetLiveFrameSubscription();
+		CloseSharedFrameRing();
 		return true;
 	}
 }
@@ -566,344 +934,591 @@ bool LiveScanClient::GetConnectedTS()
 	return m_bConnected;
 }
 
-//This is running on a seperate thread!
-//TODO: Put the whole sending/receiving in a seperate file/class, it's taking up a lot of space!
-
-void LiveScanClient::HandleSocket()
+/// <summary>
+/// Fills the dispatch table with what to do for every message the server can send. The handlers run on the socket thread,
+/// with m_mSocketThread locked, and read their payload from the MessageReader
+/// </summary>
+void LiveScanClient::RegisterMessageHandlers()
 {
-	char byteToSend;
-	std::lock_guard<std::mutex> lock(m_mSocketThread);
+	m_vMessageHandlers.assign(MSG_INCOMING_COUNT, MessageHandler());
 
-	if (!m_bConnected)
+	//Capture a single frame. Used for network-synced recording
+	m_vMessageHandlers[MSG_CAPTURE_SINGLE_FRAME] = [this](MessageReader& payload)
 	{
-		return;
-	}
+		logBuffer.LogTrace("Capture single frame Received");
+		m_bCaptureSingleFrame = true;
+	};
 
-	string received = m_pClientSocket->ReceiveBytes();
+	//Capture frames as fast as possible. Used for hardware-synced, or not-synced recording
+	m_vMessageHandlers[MSG_START_CAPTURING_FRAMES] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Capture frames start received");
+		m_bCaptureFrames = true;
+	};
 
-	if (!received.empty())
+	m_vMessageHandlers[MSG_STOP_CAPTURING_FRAMES] = [this](MessageReader& payload)
 	{
+		logBuffer.LogTrace("Capture frames stop received");
+		m_bCaptureFrames = false;
+	};
 
-		std::ostringstream message;
-		message << "Message Raw data: ";
+	m_vMessageHandlers[MSG_PRE_RECORD_PROCESS_START] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Received pre recording process start");
+		m_bStartPreRecordingProcess = true;
+	};
 
-		for (unsigned int i = 0; i < received.length(); i++)
-			message << (int)received[i] << " ";
+	m_vMessageHandlers[MSG_POST_RECORD_PROCESS_START] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Received post recording process start");
+		m_bStartPostRecordingProcess = true;
+	};
 
-		logBuffer.LogTrace(message.str());
-	}
+	m_vMessageHandlers[MSG_CALIBRATE] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Calibrate command recieved");
+		m_bCalibrate = true;
+	};
 
-	for (unsigned int i = 0; i < received.length(); i++)
+	m_vMessageHandlers[MSG_CANCEL_CALIBRATION] = [this](MessageReader& payload)
 	{
-		logBuffer.LogTrace("Received Server message");
+		logBuffer.LogTrace("Calibration cancel command received");
+		m_bCalibrate = false;
+	};
 
-		//Capture a single frame. Used for network-synced recording
-		if (received[i] == MSG_CAPTURE_SINGLE_FRAME)
-		{
-			logBuffer.LogTrace("Capture single frame Received");
-			m_bCaptureSingleFrame = true;
-		}
+	m_vMessageHandlers[MSG_CLOSE_CAMERA] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Closing camera command received");
+		m_bCloseCamera = true;
+	};
 
-		//Capture frames as fast as possible. Used for hardware-synced, or not-synced recording
-		if (received[i] == MSG_START_CAPTURING_FRAMES)
-		{
-			logBuffer.LogTrace("Capture frames start received");
-			m_bCaptureFrames = true;
-		}
+	m_vMessageHandlers[MSG_START_CAMERA] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Initialize camera command received");
+		m_bStartCamera = true;
+	};
 
-		if (received[i] == MSG_STOP_CAPTURING_FRAMES)
-		{
-			logBuffer.LogTrace("Capture frames stop received");
-			m_bCaptureFrames = false;
-		}
+	m_vMessageHandlers[MSG_SET_CONFIGURATION] = [this](MessageReader& payload)
+	{
+		logBuffer.LogInfo("Recieved new configuration");
 
-		if (received[i] == MSG_PRE_RECORD_PROCESS_START)
+		if (payload.Remaining() < KinectConfiguration::byteLength)
 		{
-			logBuffer.LogTrace("Received pre recording process start");
-			m_bStartPreRecordingProcess = true;
+			logBuffer.LogWarning("Configuration message is too short, ignoring it");
+			return;
 		}
 
-		if (received[i] == MSG_POST_RECORD_PROCESS_START)
-		{
-			logBuffer.LogTrace("Received post recording process start");
-			m_bStartPostRecordingProcess = true;
-		}
+		std::vector<char> message(KinectConfiguration::byteLength);
+		payload.ReadBytes(message.data(), KinectConfiguration::byteLength);
 
-		//calibrate
-		else if (received[i] == MSG_CALIBRATE)
-		{
-			logBuffer.LogTrace("Calibrate command recieved");
-			m_bCalibrate = true;
-		}
+		configuration.SetFromBytes(message.data());
+		m_bUpdateFilters = true;
+	};
+
+	m_vMessageHandlers[MSG_RECEIVE_SETTINGS] = [this](MessageReader& payload)
+	{
+		logBuffer.LogInfo("Recieved new settings");
+
+		vector<float> bounds(6);
 
-		else if (received[i] == MSG_CANCEL_CALIBRATION)
+		for (int j = 0; j < 6; j++)
+			payload.Read(bounds[j]);
+
+		m_vBounds = bounds;
+		m_bUpdateCullROI = true;
+
+		int nMarkers = 0;
+		payload.Read(nMarkers);
+
+		//Every marker takes a 4x4 matrix and its id
+		if (nMarkers < 0 || nMarkers > payload.Remaining() / (int)(16 * sizeof(float) + sizeof(int)))
+			nMarkers = 0;
+
+		calibration.markerPoses.resize(nMarkers);
+
+		for (int j = 0; j < nMarkers; j++)
 		{
-			logBuffer.LogTrace("Calibration cancel command received");
-			m_bCalibrate = false;
+			for (int k = 0; k < 4; k++)
+			{
+				for (int l = 0; l < 4; l++)
+					payload.Read(calibration.markerPoses[j].pose.mat[k][l]);
+			}
+
+			payload.Read(calibration.markerPoses[j].markerId);
 		}
 
-		else if (received[i] == MSG_CLOSE_CAMERA)
+		payload.Read(m_iCompressionLevel);
+		if (m_iCompressionLevel > 0)
+			m_bFrameCompression = true;
+		else
+			m_bFrameCompression = false;
+
+		payload.ReadFlag(m_bAutoExposureEnabled);
+		payload.Read(m_nExposureStep);
+		payload.ReadFlag(m_bAutoWhiteBalanceEnabled);
+		payload.Read(m_nKelvin);
+
+		int exportFormat = -1;
+		payload.Read(exportFormat);
+
+		if (exportFormat == 0)
 		{
-			logBuffer.LogTrace("Closing camera command received");
-			m_bCloseCamera = true;
+			logBuffer.LogInfo("Export format set to Pointcloud");
+			m_eCaptureMode = CM_POINTCLOUD;
 		}
 
-		else if (received[i] == MSG_START_CAMERA)
+		if (exportFormat == 1)
 		{
-			logBuffer.LogTrace("Initialize camera command received");
-			m_bStartCamera = true;
+			logBuffer.LogInfo("Export format set to Raw Data");
+			m_eCaptureMode = CM_RAW;
 		}
 
-		else if (received[i] == MSG_SET_CONFIGURATION)
-		{
-			i++;
+		payload.Read(m_nExtrinsicsStyle);
+		payload.ReadFlag(m_bShowPreviewDuringRecording);
+		payload.ReadFlag(m_bDepthNativePointcloud);
+		payload.ReadFlag(m_bFilterOutliers);
+		payload.Read(m_nOutlierRadius);
+		payload.Read(m_nOutlierMinNeighbors);
 
-			logBuffer.LogInfo("Recieved new configuration");
+		//FE_BIN_FILE only describes frames that are sent straight from a .bin file, live frames can't be encoded that way
+		int frameEncoding = m_eFrameEncoding;
+		payload.Read(frameEncoding);
 
-			char* message = new char[KinectConfiguration::byteLength];
-			for (int x = 0; x < KinectConfiguration::byteLength; x++)
-			{
-				message[x] = received[i + x];
-			}
+		if (frameEncoding == FE_INTERLEAVED || frameEncoding == FE_COLUMNAR)
+			m_eFrameEncoding = (FRAME_ENCODING)frameEncoding;
 
-			i += KinectConfiguration::byteLength;
-			configuration.SetFromBytes(message);
-			m_bUpdateFilters = true;
-			delete[] message;
+		else
+			logBuffer.LogWarning("Unknown frame encoding " + to_string(frameEncoding) + " in the settings, keeping the current one");
 
-			i--;
-		}
+		payload.ReadFlag(m_bAdaptiveCompression);
+		payload.ReadFlag(m_bSharedMemoryTransport);
 
-		//receive settings
-		//TODO: what if packet is split?
-		else if (received[i] == MSG_RECEIVE_SETTINGS)
+		float backgroundTolerance = m_fBackgroundTolerance;
+		payload.Read(backgroundTolerance);
+
+		if (backgroundTolerance != m_fBackgroundTolerance)
 		{
-			logBuffer.LogInfo("Recieved new settings");
+			m_fBackgroundTolerance = backgroundTolerance;
+			m_bUpdateBackground = true;
+		}
 
-			vector<float> bounds(6);
-			i++;
-			int nBytes = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+		payload.Read(m_nVoxelLeafSize);
+		payload.Read(m_nPointBudget);
 
-			for (int j = 0; j < 6; j++)
-			{
-				bounds[j] = *(float*)(received.c_str() + i);
-				i += sizeof(float);
-			}
+		int recordingQueuePolicy = m_eRecordingQueuePolicy;
+		payload.Read(recordingQueuePolicy);
+		m_eRecordingQueuePolicy = recordingQueuePolicy == WQ_DROP ? WQ_DROP : WQ_BLOCK;
 
-			m_vBounds = bounds;
+		payload.ReadFlag(m_bUnbufferedRecording);
+		payload.Read(m_nRecordingPreallocationMB);
+		m_nRecordingPreallocationMB = (std::max)(0, m_nRecordingPreallocationMB);
+		payload.ReadFlag(m_bCompressRecording);
 
-			int nMarkers = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+		//Settings that are missing keep their current value
+		if (payload.Overrun())
+			logBuffer.LogWarning("Settings message is shorter than expected, is the server older than this client?");
 
-			calibration.markerPoses.resize(nMarkers);
+		//The level from the server is where the adaptive compression starts again
+		m_CompressionController.Reset(m_iCompressionLevel);
 
-			for (int j = 0; j < nMarkers; j++)
-			{
-				for (int k = 0; k < 4; k++)
-				{
-					for (int l = 0; l < 4; l++)
-					{
-						calibration.markerPoses[j].pose.mat[k][l] = *(float*)(received.c_str() + i);
-						i += sizeof(float);
-					}
-				}
+		UpdateSharedFrameRing();
 
-				calibration.markerPoses[j].markerId = *(int*)(received.c_str() + i);
-				i += sizeof(int);
-			}
+		m_bUpdateSettings = true;
 
-			m_iCompressionLevel = *(int*)(received.c_str() + i);
-			i += sizeof(int);
-			if (m_iCompressionLevel > 0)
-				m_bFrameCompression = true;
-			else
-				m_bFrameCompression = false;
+		std::string settingsInfo = "Received Settings: Auto Exposure enabled= " + to_string(m_bAutoExposureEnabled) + ", Exposure Step = " +
+			to_string(m_nExposureStep) + ", Extrinsics Stlye = " + to_string(m_nExtrinsicsStyle) + ", Show preview during capture = " + to_string(m_bShowPreviewDuringRecording) +
+			", Depth resolution pointclouds = " + to_string(m_bDepthNativePointcloud) + ", Outlier filter = " + to_string(m_bFilterOutliers) +
+			", Outlier radius = " + to_string(m_nOutlierRadius) + ", Outlier min. neighbours = " + to_string(m_nOutlierMinNeighbors) +
+			", Frame encoding = " + to_string(m_eFrameEncoding) + ", Compression level = " + to_string(m_iCompressionLevel) +
+			", Adaptive compression = " + to_string(m_bAdaptiveCompression) + ", Shared memory transport = " + to_string(m_bSharedMemoryTransport) +
+			", Background tolerance = " + to_string(m_fBackgroundTolerance) + ", Voxel leaf size = " + to_string(m_nVoxelLeafSize) +
+			", Point budget = " + to_string(m_nPointBudget) + ", Recording queue policy = " + to_string(m_eRecordingQueuePolicy) +
+			", Unbuffered recording = " + to_string(m_bUnbufferedRecording) + ", Recording preallocation (MB) = " + to_string(m_nRecordingPreallocationMB) +
+			", Compress recording = " + to_string(m_bCompressRecording);
+		logBuffer.LogDebug(settingsInfo);
+	};
 
-			m_bAutoExposureEnabled = (received[i] != 0);
-			i++;
+	//send configuration
+	m_vMessageHandlers[MSG_REQUEST_CONFIGURATION] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Server requests configuration");
+		m_bRequestConfiguration = true;
+	};
 
-			m_nExposureStep = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+	//send stored frame
+	m_vMessageHandlers[MSG_REQUEST_STORED_FRAME] = [this](MessageReader& payload)
+	{
+		logBuffer.LogCaptureDebug("Server requests stored frame");
 
-			m_bAutoWhiteBalanceEnabled = (received[i] != 0);
-			i++;
+		BinFrameView frame;
 
-			m_nKelvin = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+		bool res = m_framesFileWriterReader->readNextBinaryFrameView(frame);
+		if (res == false)
+			SendNoMoreStoredFrames();
+		else
+			SendFrame(frame.vertices, frame.pointCount, frame.colors, frame.timestamp, m_framesFileWriterReader->getLastReadFrameID(), MSG_STORED_FRAME);
+	};
 
-			int exportFormat = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+	//Stream the stored frames, instead of waiting for a request for each one
+	m_vMessageHandlers[MSG_REQUEST_STORED_FRAMES] = [this](MessageReader& payload)
+	{
+		int firstFrame = 0;
+		int frameCount = -1;
+		int window = 1;
+		payload.Read(firstFrame);
+		payload.Read(frameCount);
+		payload.Read(window);
+
+		logBuffer.LogInfo("Server requests " + (frameCount < 0 ? std::string("all") : to_string(frameCount)) + " stored frames from frame " +
+			to_string(firstFrame) + " on, with a window of " + to_string(window) + " frames");
+
+		m_framesFileWriterReader->openCurrentBinFileForReading();
+		m_framesFileWriterReader->seekBinaryReaderToFrame(firstFrame);
+		SendStoredFrameDictionary();
+
+		m_bStreamingStoredFrames = true;
+		m_nStoredFramesLeft = frameCount;
+		m_nStoredFrameWindow = (std::max)(1, window);
+		m_nStoredFramesInFlight = 0;
+		m_nStoredFramesSent = 0;
+	};
+
+	//The server took stored frames of the bulk transfer, so that many more may be sent
+	m_vMessageHandlers[MSG_ACK_STORED_FRAMES] = [this](MessageReader& payload)
+	{
+		int frames = 0;
+		payload.Read(frames);
+		m_nStoredFramesInFlight = (std::max)(0, m_nStoredFramesInFlight - frames);
+	};
 
-			if (exportFormat == 0)
-			{
-				logBuffer.LogInfo("Export format set to Pointcloud");
-				m_eCaptureMode = CM_POINTCLOUD;
-			}
+	//send last frame
+	m_vMessageHandlers[MSG_REQUEST_LAST_FRAME] = [this](MessageReader& payload)
+	{
+		logBuffer.LogCaptureDebug("Server requests lastest frame");
+		m_bRequestLiveFrame = true;
+	};
 
-			if (exportFormat == 1)
-			{
-				logBuffer.LogInfo("Export format set to Raw Data");
-				m_eCaptureMode = CM_RAW;
+	//The server wants every n-th frame pushed to it, and grants the credits for the first ones
+	m_vMessageHandlers[MSG_SUBSCRIBE_LIVE_FRAMES] = [this](MessageReader& payload)
+	{
+		int interval = 1;
+		int credits = 0;
+		payload.Read(interval);
+		payload.Read(credits);
 
-			}
+		m_bLiveFramesSubscribed = true;
+		m_nLiveFrameSubscription++;
+		m_nLiveFrameInterval = (std::max)(1, interval);
+		m_nLiveFrameCredits = (std::max)(0, credits);
+		m_nLiveFrameCounter = 0;
 
-			m_nExtrinsicsStyle = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+		logBuffer.LogInfo("Server subscribed to every " + to_string(m_nLiveFrameInterval) + ". live frame with " + to_string(m_nLiveFrameCredits) + " credits");
+	};
 
-			m_bShowPreviewDuringRecording = (received[i] != 0);
-			i++;
+	m_vMessageHandlers[MSG_UNSUBSCRIBE_LIVE_FRAMES] = [this](MessageReader& payload)
+	{
+		logBuffer.LogInfo("Server unsubscribed from live frames after " + to_string(m_nLiveFramesPushed) + " pushed and " +
+			to_string(m_nLiveFramesDropped) + " dropped frames");
+		ResetLiveFrameSubscription();
+	};
 
-			m_bUpdateSettings = true;
+	//The server tells us if it could open the shared memory. If it couldn't, it's most likely running on another host
+	m_vMessageHandlers[MSG_CONFIRM_SHARED_FRAME_RING] = [this](MessageReader& payload)
+	{
+		bool opened = false;
+		payload.ReadFlag(opened);
 
-			std::string settingsInfo = "Received Settings: Auto Exposure enabled= " + to_string(m_bAutoExposureEnabled) + ", Exposure Step = " +
-				to_string(m_nExposureStep) + ", Extrinsics Stlye = " + to_string(m_nExtrinsicsStyle) + ", Show preview during capture = " + to_string(m_bShowPreviewDuringRecording);
-			logBuffer.LogDebug(settingsInfo);
+		if (!m_SharedFrameRing.IsOpen())
+			return;
 
-			//so that we do not lose the next character in the stream
-			i--;
+		if (opened)
+		{
+			logBuffer.LogInfo("Server opened the shared memory " + m_SharedFrameRing.GetName() + ", frames are no longer sent over the network");
+			m_bSharedFrameRingConfirmed = true;
 		}
 
-		//send configuration
-		else if (received[i] == MSG_REQUEST_CONFIGURATION)
+		else
 		{
-			logBuffer.LogTrace("Server requests configuration");
-			m_bRequestConfiguration = true;
+			logBuffer.LogInfo("Server could not open the shared memory, frames are still sent over the network");
+			m_bSharedFrameRingConfirmed = false;
+			m_SharedFrameRing.Close();
 		}
+	};
 
-		//send stored frame
-		else if (received[i] == MSG_REQUEST_STORED_FRAME)
-		{
-			logBuffer.LogCaptureDebug("Server requests stored frame");
+	//The server consumed pushed frames, so we may send that many more
+	m_vMessageHandlers[MSG_GRANT_LIVE_CREDITS] = [this](MessageReader& payload)
+	{
+		int credits = 0;
+		payload.Read(credits);
 
-			Point3s* points = NULL;
-			RGBA* colors = NULL;
-			int pointsSize;
-			int timeStamp;
+		if (m_bLiveFramesSubscribed && credits > 0)
+			m_nLiveFrameCredits += credits;
+	};
 
-			bool res = m_framesFileWriterReader->readNextBinaryFrame(points, colors, pointsSize, timeStamp);
-			if (res == false)
-			{
-				int size = -1;
-				char message = MSG_STORED_FRAME;
-				m_pClientSocket->SendBytes(&message, 1);
-				m_pClientSocket->SendBytes((char*)&size, 4);
-			}
-			else
-				SendFrame(points, pointsSize, colors, false);
+	//receive calibration data
+	m_vMessageHandlers[MSG_RECEIVE_CALIBRATION] = [this](MessageReader& payload)
+	{
+		logBuffer.LogInfo("Recieving calibration data");
 
-			delete[] points;
-			delete[] colors;
-		}
-		//send last frame
-		else if (received[i] == MSG_REQUEST_LAST_FRAME)
+		Matrix4x4 newRefinement = Matrix4x4();
+
+		if (!payload.ReadBytes(newRefinement.mat, 16 * sizeof(float)))
 		{
-			logBuffer.LogCaptureDebug("Server requests lastest frame");
-			m_bRequestLiveFrame = true;
+			logBuffer.LogWarning("Calibration message is too short, ignoring it");
+			return;
 		}
 
-		//receive calibration data
-		else if (received[i] == MSG_RECEIVE_CALIBRATION)
+		//We combine the refinement pose with the already existing one
+		//As the ICP offset is always based on the last ICP transformation
+		calibration.refinementTransform = newRefinement * calibration.refinementTransform;
+		calibration.UpdateClientPose();
+		m_bUpdateCullROI = true;
+
+		//We save the refined calibration data into a file
+		m_bSaveCalibration = true;
+	};
+
+	//Learns the background from the next frames, the scene has to be empty while they are taken
+	m_vMessageHandlers[MSG_LEARN_BACKGROUND] = [this](MessageReader& payload)
+	{
+		int frames = 0;
+		payload.Read(frames);
+
+		if (frames <= 0)
 		{
-			logBuffer.LogInfo("Recieving calibration data");
+			logBuffer.LogWarning("Server asked to learn the background from " + to_string(frames) + " frames, ignoring it");
+			return;
+		}
 
-			Matrix4x4 newRefinement = Matrix4x4();
+		logBuffer.LogTrace("Recieving command to learn the background");
+		m_nLearnBackgroundFrames = frames;
+		m_bUpdateBackground = true;
+	};
 
-			i++;
-			for (int j = 0; j < 4; j++)
-			{
-				for (int k = 0; k < 4; k++)
-				{
-					newRefinement.mat[j][k] = *(float*)(received.c_str() + i);
-					i += sizeof(float);
-				}
-			}
+	m_vMessageHandlers[MSG_CLEAR_BACKGROUND] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Recieving command to clear the background");
+		m_bClearBackground = true;
+		m_nLearnBackgroundFrames = 0;
+		m_bUpdateBackground = true;
+	};
 
-			//We combine the refinement pose with the already existing one
-			//As the ICP offset is always based on the last ICP transformation
-			calibration.refinementTransform = newRefinement * calibration.refinementTransform;
-			calibration.UpdateClientPose();
+	m_vMessageHandlers[MSG_CLEAR_STORED_FRAMES] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Recieving command to clear stored frames");
+		m_bStreamingStoredFrames = false;
+		m_framesFileWriterReader->closeFileIfOpened();
+	};
 
-			//so that we do not lose the next character in the stream
-			i--;
+	//Creates a dir on the client. Message also marks the start of the recording
+	m_vMessageHandlers[MSG_CREATE_DIR] = [this](MessageReader& payload)
+	{
+		int stringLength = 0;
+		payload.Read(stringLength); //Get the length of the following string
 
-			//We save the refined calibration data into a file
-			m_bSaveCalibration = true;
+		std::string dirPath;
+		bool validPath = payload.ReadString(dirPath, stringLength);
 
+		//Confirmation message that we have created a valid new directory on this system
+		char buffer[2];
+		buffer[0] = MSG_CONFIRM_DIR_CREATION;
+
+		if (validPath && m_framesFileWriterReader->CreateRecordDirectory(dirPath, configuration.nGlobalDeviceIndex))
+		{
+			buffer[1] = 1;
+			m_pClientSocket->SendBytes(buffer, sizeof(buffer));
 		}
-		else if (received[i] == MSG_CLEAR_STORED_FRAMES)
+
+		else
+		{
+			//Tell the server that the directory creation has failed, server will abort the recording
+			buffer[1] = 0;
+			m_pClientSocket->SendBytes(buffer, sizeof(buffer));
+			logBuffer.LogWarning("Recording directory creation has failed");
+		}
+
+		//Write the calibration intrinsics into the newly created dir if we record raw frames
+		if (configuration.config.color_format != K4A_IMAGE_FORMAT_COLOR_BGRA32)
+			m_framesFileWriterReader->WriteCalibrationJSON(configuration.nGlobalDeviceIndex, pCapture->calibrationBuffer, pCapture->nCalibrationSize);
+	};
+
+	m_vMessageHandlers[MSG_REQUEST_TIMESTAMP_LIST] = [this](MessageReader& payload)
+	{
+		logBuffer.LogTrace("Server requests timestamp list");
+		m_bSendTimeStampList = true;
+	};
+
+	m_vMessageHandlers[MSG_RECEIVE_POSTSYNC_LIST] = [this](MessageReader& payload)
+	{
+		logBuffer.LogInfo("Received Postsync List");
+
+		int size = 0;
+		payload.Read(size);
+
+		//Two lists of frame ids
+		if (size < 0 || size > payload.Remaining() / (int)(2 * sizeof(int)))
 		{
-			logBuffer.LogTrace("Recieving command to clear stored frames");
-			m_framesFileWriterReader->closeFileIfOpened();
+			logBuffer.LogWarning("Postsync list message is too short, ignoring it");
+			return;
 		}
 
-		else if (received[i] == MSG_CREATE_DIR) //Creates a dir on the client. Message also marks the start of the recording
+		m_vFrameID.resize(size);
+		m_vPostSyncedFrameID.resize(size);
+
+		payload.ReadBytes(m_vFrameID.data(), size * sizeof(int));
+		payload.ReadBytes(m_vPostSyncedFrameID.data(), size * sizeof(int));
+
+		m_bPostSyncedListReceived = true;
+	};
+}
+
+/// <summary>
+/// Stops pushing live frames, either because the server unsubscribed or the connection is gone.
+/// Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::ResetLiveFrameSubscription()
+{
+	m_bLiveFramesSubscribed = false;
+	m_nLiveFrameSubscription++;
+	m_nLiveFrameInterval = 1;
+	m_nLiveFrameCredits = 0;
+	m_nLiveFrameCounter = 0;
+	m_nLiveFramesPushed = 0;
+	m_nLiveFramesDropped = 0;
+}
+
+/// <summary>
+/// Creates or closes the shared memory for the frames, as the settings from the server ask for, and tells the server about it.
+/// Frames keep going over the socket until the server confirms it opened the ring. Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::UpdateSharedFrameRing()
+{
+	if (m_bSharedMemoryTransport == m_SharedFrameRing.IsOpen() || m_pClientSocket == NULL)
+		return;
+
+	if (m_bSharedMemoryTransport)
+	{
+		if (!m_SharedFrameRing.Create(SharedFrameRing::MakeUniqueName(), sharedFrameRingSlots, sharedFrameRingSlotSize))
 		{
-			i++;
-			int stringLength = *(int*)(received.c_str() + i); //Get the length of the following string
-			i += sizeof(int);
+			logBuffer.LogWarning("Could not create the shared memory for the frames, they are still sent over the network");
+			return;
+		}
+	}
 
-			std::string dirPath;
+	else
+		CloseSharedFrameRing();
 
-			dirPath.assign(received, i, stringLength); //Recieved is already a string, so we just copy the characters out of it
+	const std::string& name = m_SharedFrameRing.GetName();
+	int nameLength = (int)name.size();
 
-			i += stringLength;
+	std::vector<char> message(1 + sizeof(int) + nameLength);
+	message[0] = MSG_SHARED_FRAME_RING;
+	memcpy(message.data() + 1, &nameLength, sizeof(int));
+	memcpy(message.data() + 1 + sizeof(int), name.data(), nameLength);
 
-			//Confirmation message that we have created a valid new directory on this system
-			int size = 2;
-			char* buffer = new char[size];
-			buffer[0] = MSG_CONFIRM_DIR_CREATION;
+	m_pClientSocket->SendBytes(message.data(), (int)message.size());
+}
 
-			if (m_framesFileWriterReader->CreateRecordDirectory(dirPath, configuration.nGlobalDeviceIndex))
-			{
-				buffer[1] = 1;
-				m_pClientSocket->SendBytes(buffer, size);
-			}
+/// <summary>
+/// Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::CloseSharedFrameRing()
+{
+	m_bSharedFrameRingConfirmed = false;
+	m_SharedFrameRing.Close();
+}
 
-			else
+/// <summary>
+/// Drops the connection when the server has closed it, or when the stream in either direction can't be kept in step with the server anymore.
+/// Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::LoseConnection()
+{
+	SetStatusMessage(L"Lost connection to the server", 10000, true);
+	delete m_pClientSocket;
+	m_pClientSocket = NULL;
+	m_bConnected = false;
+	m_bStreamingStoredFrames = false;
+	ResetLiveFrameSubscription();
+	CloseSharedFrameRing();
+}
+
+/// <summary>
+/// Reads everything the server has sent so far into the framer without blocking, and hands every complete message to its handler.
+/// Must be called with m_mSocketThread locked
+/// </summary>
+/// <param name="readable">If the socket was signaled as readable before. If nothing can be read then, the server closed the connection</param>
+void LiveScanClient::ReceiveMessages(bool readable)
+{
+	const int receiveSize = 64 * 1024;
+	int totalReceived = 0;
+
+	while (true)
+	{
+		char* destination = m_MessageFramer.GetWriteBuffer(receiveSize);
+		int received = m_pClientSocket->ReceiveAvailable(destination, m_MessageFramer.GetWriteBufferSize());
+
+		if (received <= 0)
+		{
+			if (received < 0 || (readable && totalReceived == 0))
 			{
-				//Tell the server that the directory creation has failed, server will abort the recording
-				buffer[1] = 0;
-				m_pClientSocket->SendBytes(buffer, size);
-				logBuffer.LogWarning("Recording directory creation has failed");
+				logBuffer.LogInfo("Server closed the connection");
+				LoseConnection();
+				return;
 			}
 
-			//Write the calibration intrinsics into the newly created dir if we record raw frames
-			if (configuration.config.color_format != K4A_IMAGE_FORMAT_COLOR_BGRA32)
-				m_framesFileWriterReader->WriteCalibrationJSON(configuration.nGlobalDeviceIndex, pCapture->calibrationBuffer, pCapture->nCalibrationSize);
-
+			break;
 		}
 
-		else if (received[i] == MSG_REQUEST_TIMESTAMP_LIST)
+		m_MessageFramer.CommitWrite(received);
+		totalReceived += received;
+	}
+
+	ServerMessage message;
+
+	while (m_MessageFramer.NextMessage(message))
+	{
+		logBuffer.LogTrace("Received Server message " + to_string(message.type) + " with " + to_string(message.size) + " bytes");
+
+		if (!m_vMessageHandlers[message.type])
 		{
-			logBuffer.LogTrace("Server requests timestamp list");
-			m_bSendTimeStampList = true;
+			logBuffer.LogWarning("No handler for server message " + to_string(message.type));
+			continue;
 		}
 
-		else if (received[i] == MSG_RECEIVE_POSTSYNC_LIST)
-		{
-			logBuffer.LogInfo("Received Postsync List");
+		MessageReader payload(message.payload, message.size);
+		m_vMessageHandlers[message.type](payload);
 
-			i++;
-			int size = *(int*)(received.c_str() + i);
-			i += sizeof(int);
+		//A handler that lost the connection leaves nothing to answer the remaining messages on
+		if (!m_bConnected)
+			return;
+	}
 
-			m_vFrameID.clear();
-			m_vPostSyncedFrameID.clear();
-			m_vFrameID.resize(size);
-			m_vPostSyncedFrameID.resize(size);
+	//Once a header is corrupted, there is no telling where the next message starts, so the rest of the stream is useless
+	if (m_MessageFramer.HasError())
+	{
+		logBuffer.LogError("Received a corrupted message from the server, closing the connection");
+		LoseConnection();
+	}
+}
 
-			memcpy(m_vFrameID.data(), &received[i], size * sizeof(int));
-			i += size * sizeof(int);
+//This is running on a seperate thread!
+//TODO: Put the whole sending/receiving in a seperate file/class, it's taking up a lot of space!
 
+void LiveScanClient::HandleSocket(bool readable)
+{
+	char byteToSend;
+	std::lock_guard<std::mutex> lock(m_mSocketThread);
 
-			memcpy(m_vPostSyncedFrameID.data(), &received[i], size * sizeof(int));
-			i += size * sizeof(int);
+	if (!m_bConnected)
+	{
+		return;
+	}
 
-			m_bPostSyncedListReceived = true;
-		}
+	ReceiveMessages(readable);
 
-	}
+	if (!m_bConnected)
+		return;
 
 	if (m_bConfirmCaptured)
 	{
@@ -1042,6 +1657,140 @@ void LiveScanClient::HandleSocket()
 		m_bConfirmCameraInitialized = false;
 
 	}
+
+	if (m_bStreamingStoredFrames)
+		StreamStoredFrames();
+}
+
+/// <summary>
+/// Sends stored frames of the bulk transfer until the window is full. Called from the socket thread every time it wakes up,
+/// so the transfer continues as soon as the server acknowledges frames. Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::StreamStoredFrames()
+{
+	while (m_nStoredFramesInFlight < m_nStoredFrameWindow)
+	{
+		if (m_nStoredFramesLeft == 0 || !SendNextStoredFrame())
+		{
+			//A frame that couldn't be sent in full took the connection with it
+			if (!m_bConnected)
+				return;
+
+			SendNoMoreStoredFrames();
+			logBuffer.LogInfo("Sent all " + to_string(m_nStoredFramesSent) + " stored frames");
+			m_bStreamingStoredFrames = false;
+			return;
+		}
+
+		m_nStoredFramesInFlight++;
+		m_nStoredFramesSent++;
+
+		if (m_nStoredFramesLeft > 0)
+			m_nStoredFramesLeft--;
+	}
+}
+
+/// <summary>
+/// Reads the next frame from the .bin file and sends it to the server. Must be called with m_mSocketThread locked
+/// </summary>
+/// <returns>False if there are no more frames</returns>
+bool LiveScanClient::SendNextStoredFrame()
+{
+	BinFrameView frame;
+
+	//Frames that are stored compressed are only decoded for the shared memory, which takes uncompressed frames only
+	if (!m_framesFileWriterReader->readNextBinaryFrameView(frame, m_bSharedFrameRingConfirmed))
+		return false;
+
+	int frameIndex = m_framesFileWriterReader->getLastReadFrameID();
+
+	//Sent on as they are stored, the server decompresses them with the dictionary that was sent at the start of the transfer.
+	//The points never pass through memory here, so the frame goes without a checksum
+	if (frame.vertices == NULL && frame.compressed != NULL)
+	{
+		FrameHeader header = MakeFrameHeader(frame.compressedSize, FC_ZSTD_DICTIONARY, FE_COLUMNAR, frame.pointCount, frame.timestamp, frameIndex);
+		return SendStoredFrameFromFile(header, NULL, 0, frame.compressed, frame.compressedOffset, frame.compressedSize);
+	}
+
+	//Uncompressed frames are sent as they are stored as well, unless they are compressed for sending or go through the shared memory
+	if (!m_bFrameCompression && !m_bSharedFrameRingConfirmed && frame.dataOffset >= 0)
+	{
+		int points = frame.pointCount;
+		int dataSize = points * (sizeof(Point3s) + sizeof(RGBA));
+
+		FrameHeader header = MakeFrameHeader((int)sizeof(int) + dataSize, FC_NONE, FE_BIN_FILE, points, frame.timestamp, frameIndex);
+		return SendStoredFrameFromFile(header, (const char*)&points, sizeof(points), (const char*)frame.vertices, frame.dataOffset, dataSize);
+	}
+
+	//Encoded straight from the mapped file, or from the buffers of the reader for compressed frames
+	return SendFrame(frame.vertices, frame.pointCount, frame.colors, frame.timestamp, frameIndex, MSG_STORED_FRAME);
+}
+
+/// <summary>
+/// Sends a stored frame whose payload is a range of the .bin file, straight from the file to the socket. Must be called with m_mSocketThread locked
+/// </summary>
+/// <param name="prefix">Sent between the header and the data, may be NULL</param>
+/// <param name="data">The same range of the file in the mapping. What couldn't be sent from the file is sent from there</param>
+/// <returns>False if the frame couldn't be sent, which closes the connection</returns>
+bool LiveScanClient::SendStoredFrameFromFile(const FrameHeader& header, const char* prefix, int prefixSize, const char* data, long long fileOffset, int dataSize)
+{
+	FILE* sendFile = m_framesFileWriterReader->getSendFileHandle();
+	char message = MSG_STORED_FRAME;
+
+	bool sent = m_pClientSocket->SendBytes(&message, 1) && m_pClientSocket->SendBytes((const char*)&header, sizeof(header)) &&
+		(prefixSize == 0 || m_pClientSocket->SendBytes(prefix, prefixSize));
+
+	//The server now waits for exactly dataSize bytes
+	int sentFromFile = sent && sendFile != nullptr ? m_pClientSocket->SendFileRange(sendFile, fileOffset, dataSize) : 0;
+
+	//Some of the range may have gone out already, so it can't be sent again from memory
+	if (sentFromFile < 0)
+		sent = false;
+
+	else if (sent && sentFromFile < dataSize)
+	{
+		if (sendFile != nullptr)
+			logBuffer.LogWarning("Could not send a stored frame straight from the file, sending it from memory");
+
+		sent = m_pClientSocket->SendBytes(data + sentFromFile, dataSize - sentFromFile);
+	}
+
+	if (!sent)
+	{
+		logBuffer.LogError("Could not send a stored frame, closing the connection to the server");
+		LoseConnection();
+		return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Lets the server decompress the stored frames that are sent on as they were compressed in the file. Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::SendStoredFrameDictionary()
+{
+	int size = m_framesFileWriterReader->getDictionarySize();
+
+	std::vector<char> message(1 + sizeof(int) + size);
+	message[0] = MSG_STORED_FRAME_DICTIONARY;
+	memcpy(message.data() + 1, &size, sizeof(int));
+
+	if (size > 0)
+		memcpy(message.data() + 1 + sizeof(int), m_framesFileWriterReader->getDictionary(), size);
+
+	m_pClientSocket->SendBytes(message.data(), (int)message.size());
+}
+
+/// <summary>
+/// A full frame header with a size of -1 tells the server that there are no more frames. Must be called with m_mSocketThread locked
+/// </summary>
+void LiveScanClient::SendNoMoreStoredFrames()
+{
+	FrameHeader header = MakeFrameHeader(-1, FC_NONE, FE_INTERLEAVED, 0, 0, -1);
+	char message = MSG_STORED_FRAME;
+	m_pClientSocket->SendBytes(&message, 1);
+	m_pClientSocket->SendBytes((char*)&header, sizeof(header));
 }
 
 bool LiveScanClient::StartCamera()
@@ -1050,6 +1799,8 @@ bool LiveScanClient::StartCamera()
 
 	bool res = false;
 
+	m_pFramePipeline->Flush();
+
 	res = pCapture->StartCamera(configuration);
 	if (!res)
 	{
@@ -1063,15 +1814,33 @@ bool LiveScanClient::StartCamera()
 	{
 		configuration.eHardwareSyncState = static_cast<SYNC_STATE>(pCapture->GetSyncJackState());
 		m_pCameraSpaceCoordinates = new Point3f[pCapture->nColorFrameWidth * pCapture->nColorFrameHeight];
+		UpdateFrameBufferPools();
 	}
 
 	return true;
 }
 
+/// <summary>
+/// Sizes the pooled frame buffers so that they can hold a full frame of the current camera configuration
+/// </summary>
+void LiveScanClient::UpdateFrameBufferPools()
+{
+	int colorPixels = configuration.GetColorCameraWidth() * configuration.GetColorCameraHeight();
+	int depthPixels = configuration.GetDepthCameraWidth() * configuration.GetDepthCameraHeight();
+	int maxPoints = colorPixels > depthPixels ? colorPixels : depthPixels;
+
+	m_pPointcloudPool->SetCapacity(maxPoints);
+	m_pPreviewPool->SetCapacity(maxPoints);
+}
+
 void LiveScanClient::StopCamera()
 {
 	logBuffer.LogDebug("Stopping Camera");
+
+	//The pipeline works on the resources of the camera, which get released here
+	m_pFramePipeline->Flush();
 	pCapture->StopCamera();
+	m_pFramePipeline->ReleaseSlotResources();
 }
 
 void LiveScanClient::DisposeDevice()
@@ -1101,60 +1870,162 @@ void LiveScanClient::SendPostSyncConfirmation(bool success)
 	m_pClientSocket->SendBytes(buffer, size);
 }
 
-void LiveScanClient::SendFrame(Point3s* vertices, int verticesSize, RGBA* RGB, bool live)
+/// <summary>
+/// Fills in the header of a frame that is sent to the server. The checksum is left to the caller
+/// </summary>
+FrameHeader LiveScanClient::MakeFrameHeader(int payloadSize, int compression, int encoding, int pointCount, uint64_t timestamp, int frameIndex)
+{
+	FrameHeader header;
+	header.payloadSize = payloadSize;
+	header.compression = compression;
+	header.encoding = encoding;
+	header.pointCount = pointCount;
+	header.timestamp = timestamp;
+	header.frameIndex = frameIndex;
+	header.deviceIndex = configuration.nGlobalDeviceIndex;
+	header.checksum = 0;
+	header.flags = 0;
+
+	return header;
+}
+
+/// <param name="timestamp">The device timestamp of the capture</param>
+/// <param name="frameIndex">Of the acquired frame for live frames, of the frame in the .bin file for stored ones</param>
+/// <returns>False if the frame couldn't be sent, which closes the connection</returns>
+bool LiveScanClient::SendFrame(const Point3s* vertices, int verticesSize, const RGBA* RGB, uint64_t timestamp, int frameIndex, OUTGOING_MESSAGE_TYPE message)
 {
 	logBuffer.LogCaptureDebug("Sending Frame to server");
 
-	int size = verticesSize * (3 + 3 * sizeof(short)) + sizeof(int);
+	int size = GetEncodedFrameSize(verticesSize);
+
+	//Kept between frames, so it only allocates when a frame is larger than all before
+	if (m_vFrameBuffer.size() < (size_t)size)
+		m_vFrameBuffer.resize(size);
 
+	char* buffer = m_vFrameBuffer.data();
+	EncodeFrame(m_eFrameEncoding, vertices, RGB, verticesSize, buffer);
 
-	vector<char> buffer(size);
-	int pos = 0;
+	if (m_pClientSocket == NULL)
+		return false;
 
-	std::memcpy(buffer.data() + pos, &verticesSize, sizeof(verticesSize));
-	pos += sizeof(verticesSize);
+	//The server checks the uncompressed payload against it, after it decompressed the frame
+	FrameHeader header = MakeFrameHeader(size, FC_NONE, m_eFrameEncoding, verticesSize, timestamp, frameIndex);
+	header.checksum = XXHash32(buffer, size, 0);
+	header.flags |= FHF_CHECKSUM;
 
-	for (unsigned int i = 0; i < verticesSize; i++)
-	{
-		buffer[pos++] = RGB[i].red;
-		buffer[pos++] = RGB[i].green;
-		buffer[pos++] = RGB[i].blue;
+	//On the same host, the frame goes into shared memory as it is. Frames that don't fit into a slot are still sent over the socket
+	if (m_bSharedFrameRingConfirmed && m_SharedFrameRing.Write(message, header, buffer, size))
+		return true;
+
+	int compression = FC_NONE;
+	const char* payload = buffer;
+	int payloadSize = size;
 
-		std::memcpy(buffer.data() + pos, vertices, sizeof(short) * 3);
-		vertices++;
-		pos += sizeof(short) * 3;
+	int level = m_iCompressionLevel;
+	int workers = 1;
+
+	if (m_bAdaptiveCompression)
+	{
+		m_CompressionController.SetFrameInterval(GetFrameIntervalMs());
+		level = m_CompressionController.GetLevel();
+		workers = m_CompressionController.GetWorkers();
 	}
 
-	int iCompression = static_cast<int>(m_bFrameCompression);
+	//The time the socket blocks is measured separately, so that the controller can tell a slow link from slow compression
+	double sendMs = 0;
+	int sentBytes = 0;
+	bool sent = true;
+
+	//Once a send failed, the server can't make sense of the rest of the frame anymore, so nothing more is sent
+	auto sendTimed = [this, &sendMs, &sentBytes, &sent](const char* data, int length)
+	{
+		if (!sent)
+			return;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		sent = m_pClientSocket->SendBytes(data, length);
+		sendMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		sentBytes += length;
+	};
+
+	std::chrono::steady_clock::time_point compressStart = std::chrono::steady_clock::now();
 
 	if (m_bFrameCompression)
 	{
-		// *2, because according to zstd documentation, increasing the size of the output buffer above a
-		// bound should speed up the compression.
-		int cBuffSize = ZSTD_compressBound(size) * 2;
-		vector<char> compressedBuffer(cBuffSize);
-		int cSize = ZSTD_compress(compressedBuffer.data(), cBuffSize, buffer.data(), size, m_iCompressionLevel);
-		size = cSize;
-		buffer = compressedBuffer;
+		//Large frames are split over several workers once a single one can't keep up anymore
+		if (FrameCompressor::GetParallelSegmentCount(size, workers) > 1)
+		{
+			payloadSize = m_FrameCompressor.CompressParallel(buffer, size, level, workers);
+			compression = FC_ZSTD_PARALLEL;
+		}
+
+		//Frames that fit into one chunk of the stream have nothing to overlap, so they are compressed in one go
+		else if (ZSTD_compressBound(size) > (size_t)m_FrameCompressor.GetStreamChunkSize())
+			compression = FC_ZSTD_STREAM;
+
+		else
+		{
+			payloadSize = m_FrameCompressor.Compress(buffer, size, level);
+			compression = FC_ZSTD;
+		}
+
+		if (compression != FC_ZSTD_STREAM)
+		{
+			if (payloadSize >= 0)
+				payload = m_FrameCompressor.GetCompressed();
+
+			else
+			{
+				logBuffer.LogWarning("Could not compress frame, sending it uncompressed");
+				compression = FC_NONE;
+				payloadSize = size;
+			}
+		}
 	}
-	char header[8];
-	std::memcpy(header, (char*)&size, sizeof(size));
-	std::memcpy(header + 4, (char*)&iCompression, sizeof(iCompression));
 
-	char message;
+	//Streamed frames don't know their compressed size in advance, so the header carries the uncompressed size instead
+	header.payloadSize = payloadSize;
+	header.compression = compression;
 
-	if (live)
-		message = MSG_LAST_FRAME;
+	char messageType = message;
+	sendTimed(&messageType, 1);
+	sendTimed((char*)&header, sizeof(header));
+
+	if (compression != FC_ZSTD_STREAM)
+		sendTimed(payload, payloadSize);
 
 	else
-		message = MSG_STORED_FRAME;
+	{
+		//Each chunk goes onto the socket as soon as zstd has filled it, while the rest of the frame is still being compressed
+		bool compressed = m_FrameCompressor.CompressStream(buffer, size, level, [&sendTimed](const char* chunk, int chunkSize)
+		{
+			sendTimed((char*)&chunkSize, sizeof(chunkSize));
+			sendTimed(chunk, chunkSize);
+		});
+
+		if (!compressed)
+			logBuffer.LogError("Could not compress frame, the server will drop it");
+
+		int endOfFrame = 0;
+		sendTimed((char*)&endOfFrame, sizeof(endOfFrame));
+	}
 
-	if (m_pClientSocket != NULL)
+	if (!sent)
 	{
-		m_pClientSocket->SendBytes(&message, 1);
-		m_pClientSocket->SendBytes((char*)&header, sizeof(int) * 2);
-		m_pClientSocket->SendBytes(buffer.data(), size);
+		logBuffer.LogError("Could not send a frame, closing the connection to the server");
+		LoseConnection();
+		return false;
 	}
+
+	if (!m_bFrameCompression || !m_bAdaptiveCompression)
+		return true;
+
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compressStart).count();
+
+	if (m_CompressionController.AddFrame(totalMs - sendMs, sendMs, size, sentBytes))
+		logBuffer.LogInfo("Adaptive compression: " + m_CompressionController.GetLastDecision());
+
+	return true;
 }
 
 /// <summary>
@@ -1162,106 +2033,69 @@ void LiveScanClient::SendFrame(Point3s* vertices, int verticesSize, RGBA* RGB, b
 /// that are either invalid (depth of 0), or out of bounds, so that we don't
 /// write them to disk, and uneccessarily bloat the file size
 /// </summary>
-void LiveScanClient::StoreFrame(k4a_image_t pointcloudImage, cv::Mat* colorImage)
+void LiveScanClient::StoreFrame(FrameSlot* slot)
 {
 	logBuffer.LogTrace("Storing Frame");
 
-	int allVerticesNewSize = pCapture->nColorFrameHeight * pCapture->nColorFrameWidth;
-
-	if (m_nAllVerticesSize != allVerticesNewSize)
-	{
-		m_nAllVerticesSize = allVerticesNewSize;
-		delete[] m_pAllVertices;
-		m_pAllVertices = new Point3f[m_nAllVerticesSize];
-	}
-
-	int16_t* pointCloudImageData = (int16_t*)(void*)k4a_image_get_buffer(pointcloudImage);
-	Point3f invalidPoint = Point3f(0, 0, 0, true);
-	Point3f temp = Point3f(0, 0, 0);
-
-	Matrix4x4 scale = Matrix4x4(
-		0.001f, 0.0f, 0.0f, 0.0f,
-		0.0f, 0.001f, 0.0f, 0.0f,
-		0.0f, 0.0f, 0.001f, 0.0f,
-		0.0f, 0.0f, 0.0f, 1.0f);
+	int allVerticesSize = slot->nPointCloudHeight * slot->nPointCloudWidth;
 
-	Matrix4x4 toWorld = calibration.worldTransform * scale;
+	int16_t* pointCloudImageData = (int16_t*)(void*)k4a_image_get_buffer(slot->pointCloudImage);
+	uchar* colorValues = slot->colorBGR.data;
 
-	int goodVerticesCount = 0;
+	if (slot->depthNativePointcloud)
+		colorValues = slot->pointCloudColorBGR.data;
 
-	for (unsigned int vertexIndex = 0; vertexIndex < m_nAllVerticesSize; vertexIndex++)
+	//The culling carries the pixel coordinates of each point instead of its color, see PixelCoordinatesAsColor()
+	else if (slot->decodeColorToYUV)
 	{
-		//As the resizing function doesn't return a valid RGB-Reserved value which indicates that this pixel is invalid,
-		//we cut all vertices under a distance of 0.0001mm, as the invalid vertices always have a Z-Value of 0
-		if (pointCloudImageData[3 * vertexIndex + 2] >= 0.0001) // TODO: Needed? && colorInDepth->data[vertexIndex] == 255)
-		{
-			temp.X = pointCloudImageData[3 * vertexIndex + 0];
-			temp.Y = pointCloudImageData[3 * vertexIndex + 1];
-			temp.Z = pointCloudImageData[3 * vertexIndex + 2];
+		CreatePixelCoordinateImage(m_PixelCoordinates, slot->nColorFrameWidth, slot->nColorFrameHeight);
+		colorValues = m_PixelCoordinates.data;
+	}
 
-			temp = toWorld * temp;
+	//The slot might still hold the buffer of its previous frame if the sink didn't run for it
+	if (slot->pPointcloud != NULL)
+		slot->pPointcloud->Release();
 
-			if (temp.X < m_vBounds[0] || temp.X > m_vBounds[3]
-				|| temp.Y < m_vBounds[1] || temp.Y > m_vBounds[4]
-				|| temp.Z < m_vBounds[2] || temp.Z > m_vBounds[5])
-			{
-				m_pAllVertices[vertexIndex] = invalidPoint;
-				continue;
-			}
+	//We don't know how many vertices survive before culling, so we borrow enough room for all of them
+	slot->pPointcloud = m_pPointcloudPool->Borrow(allVerticesSize);
 
-			m_pAllVertices[vertexIndex] = temp;
-			goodVerticesCount++;
-		}
+	//Each row tile is culled on its own core into the scratch buffer and then copied to its place in the output.
+	//The scratch buffer is kept between frames and only needs room for the region of interest
+	size_t scratchSize = GetCullROIPointCount(slot->nPointCloudWidth, slot->nPointCloudHeight, slot->cullROI);
 
-		else
-		{
-			m_pAllVertices[vertexIndex] = invalidPoint;
-		}
+	if (m_vCullScratchVertices.size() < scratchSize)
+	{
+		m_vCullScratchVertices.resize(scratchSize);
+		m_vCullScratchColors.resize(scratchSize);
 	}
 
+	int goodVerticesCount = CullPointcloudTiled(pointCloudImageData, colorValues, slot->nPointCloudWidth, slot->nPointCloudHeight, slot->toWorld, slot->bounds, slot->cullROI,
+		m_vCullScratchVertices.data(), m_vCullScratchColors.data(), slot->pPointcloud->pVertices, slot->pPointcloud->pColors);
 
-	delete[] m_vLastFrameVertices;
-	delete[] m_vLastFrameRGB;
-
-	if (goodVerticesCount > 0)
-	{
-		m_vLastFrameVertices = new Point3s[goodVerticesCount];
-		m_vLastFrameRGB = new RGBA[goodVerticesCount];
-		m_vLastFrameVerticesSize = goodVerticesCount;
+	if (slot->decodeColorToYUV)
+		SampleYUVColors(slot->colorYUV, slot->pPointcloud->pColors, goodVerticesCount);
 
-		uchar* colorValues = colorImage->data;
+	//Runs after the culling, so that only the points inside the bounds need to be searched
+	if (slot->filterOutliers)
+		goodVerticesCount = m_OutlierFilter.Apply(slot->pPointcloud->pVertices, slot->pPointcloud->pColors, goodVerticesCount, slot->outlierRadius, slot->outlierMinNeighbors);
 
-		//Copy all valid vertices into a clean vector
-		int j = 0;
-		for (unsigned int i = 0; i < m_nAllVerticesSize; i++)
-		{
-			if (!m_pAllVertices[i].Invalid)
-			{
-				RGBA color;
-				color.red = colorValues[i * 4];
-				color.green = colorValues[(i * 4) + 1];
-				color.blue = colorValues[(i * 4) + 2];
-
-				m_vLastFrameVertices[j] = m_pAllVertices[i];
-				m_vLastFrameRGB[j] = color;
-				j++;
-			}
-		}
-	}
+	//Last, so that the outliers don't pull the averages of their voxels away and the budget only counts the points that are actually sent
+	if (slot->voxelLeafSize > 0 || slot->pointBudget > 0)
+		goodVerticesCount = m_VoxelGridFilter.Apply(slot->pPointcloud->pVertices, slot->pPointcloud->pColors, goodVerticesCount, slot->voxelLeafSize, slot->pointBudget);
 
 	//If the pointcloud is empty, we can't have an array with zero elements
-	else
+	if (goodVerticesCount == 0)
 	{
-		m_vLastFrameVertices = new Point3s[1];
 		Point3s point(0, 0, 0);
-		m_vLastFrameVertices[0] = point;
-		
-		m_vLastFrameRGB = new RGBA[1];
+		slot->pPointcloud->pVertices[0] = point;
+
 		RGBA color;
-		m_vLastFrameRGB[0] = color;
+		slot->pPointcloud->pColors[0] = color;
 
-		m_vLastFrameVerticesSize = 1;
-	}	
+		goodVerticesCount = 1;
+	}
+
+	slot->pPointcloud->nSize = goodVerticesCount;
 }
 
 void LiveScanClient::UpdateFPS()
@@ -1286,6 +2120,20 @@ void LiveScanClient::UpdateFPS()
 
 		m_nFPSFrameCounter = 0;
 		m_nFPSUpdateCounter = 0;
+
+		logBuffer.LogCaptureDebug("Pipeline: " + m_pFramePipeline->GetStatsString());
+
+		if (m_bCapturing)
+			logBuffer.LogCaptureDebug("Recording writer: " + m_pFrameWriter->GetStatsString());
+
+		if (m_bFrameCompression && m_bAdaptiveCompression)
+			logBuffer.LogCaptureDebug("Compression: " + m_CompressionController.GetStatsString());
+
+		std::lock_guard<std::mutex> lockSocket(m_mSocketThread);
+
+		if (m_bLiveFramesSubscribed)
+			logBuffer.LogCaptureDebug("Live frames: pushed= " + to_string(m_nLiveFramesPushed) + " dropped= " + to_string(m_nLiveFramesDropped) +
+				" credits= " + to_string(m_nLiveFrameCredits));
 	}
 
 }
@@ -1296,6 +2144,36 @@ float LiveScanClient::GetFPSTS()
 	return m_fAverageFPS;
 }
 
+CompressionStats LiveScanClient::GetCompressionStatsTS()
+{
+	CompressionStats stats = m_CompressionController.GetStatsTS();
+
+	//Without the controller, the level set on the server is used as it is
+	if (!m_bAdaptiveCompression || !m_bFrameCompression)
+	{
+		stats.level = m_bFrameCompression ? m_iCompressionLevel : 0;
+		stats.workers = 1;
+	}
+
+	return stats;
+}
+
+/// <summary>
+/// The time between two frames at the fps the camera is running with
+/// </summary>
+float LiveScanClient::GetFrameIntervalMs()
+{
+	switch (configuration.config.camera_fps)
+	{
+	case K4A_FRAMES_PER_SECOND_5:
+		return 1000.0f / 5.0f;
+	case K4A_FRAMES_PER_SECOND_15:
+		return 1000.0f / 15.0f;
+	default:
+		return 1000.0f / 30.0f;
+	}
+}
+
 void LiveScanClient::SetStatusMessage(std::wstring message, int time, bool priority)
 {
 	std::lock_guard<std::mutex> lock(m_mStatus);
@@ -1343,12 +2221,19 @@ bool LiveScanClient::PostSyncPointclouds()
 
 	Point3s* emptyPoints = new Point3s[0];
 	RGBA* emptyColors = new RGBA[0];
-	int timestamp = 0;
+	uint64_t timestamp = 0;
 
 	//We open a new .bin file in which we copy and paste all the frames from the recorded .bin file,
 	//but in the right order
 	FrameFileWriterReader* syncedFileWriter = new FrameFileWriterReader(log);
 	syncedFileWriter->SetRecordingDirPath(m_framesFileWriterReader->GetRecordingDirPath());
+
+	{
+		//The synced file is stored the same way as the recording
+		std::lock_guard<std::mutex> lock(m_mSocketThread);
+		syncedFileWriter->SetWriteOptions((uint64_t)m_nRecordingPreallocationMB * 1024 * 1024, m_bUnbufferedRecording, m_bCompressRecording);
+	}
+
 	syncedFileWriter->openNewBinFileForWriting(configuration.nGlobalDeviceIndex, "synced");
 	m_framesFileWriterReader->openCurrentBinFileForReading();
 
@@ -1367,20 +2252,23 @@ bool LiveScanClient::PostSyncPointclouds()
 		else
 		{
 
-			Point3s* points;
-			RGBA* colors;
-			int pointsSize;
+			BinFrameView frame;
 
 			m_framesFileWriterReader->seekBinaryReaderToFrame(m_vFrameID[i]);
-			m_framesFileWriterReader->readNextBinaryFrame(points, colors, pointsSize, timestamp);
-			if (!syncedFileWriter->writeNextBinaryFrame(points, pointsSize, colors, timestamp, configuration.nGlobalDeviceIndex))
+
+			//Written straight from the mapping of the recorded file into the synced one
+			if (!m_framesFileWriterReader->readNextBinaryFrameView(frame))
 			{
-				logBuffer.LogWarning("Could not write Pointcloud Frame during post sync. Frame ID: " + to_string(m_vFrameID[i]));
+				logBuffer.LogWarning("Could not read Pointcloud Frame during post sync. Frame ID: " + to_string(m_vFrameID[i]));
 				success = false;
+				continue;
 			}
 
-			delete[] points;
-			delete[] colors;
+			if (!syncedFileWriter->writeNextBinaryFrame(frame.vertices, frame.pointCount, frame.colors, frame.timestamp, configuration.nGlobalDeviceIndex))
+			{
+				logBuffer.LogWarning("Could not write Pointcloud Frame during post sync. Frame ID: " + to_string(m_vFrameID[i]));
+				success = false;
+			}
 		}
 	}
 
@@ -1399,30 +2287,9 @@ bool LiveScanClient::PostSyncRawFrames()
 {
 	logBuffer.LogDebug("Starting Post Sync for Raw frames");
 
-	bool success = true;
-	k4a_image_t emptyDepthFrame;
-	k4a_image_create(K4A_IMAGE_FORMAT_DEPTH16, 1, 1, 0, &emptyDepthFrame);
-
-	for (size_t i = 0; i < m_vFrameID.size(); i++)
-	{
-		//-1 indicates that this device doesn't have a valid frame for this capture. To keep a good frame timing, we fill in an empty frame
-		if (m_vFrameID[i] == -1)
-		{
-			m_framesFileWriterReader->WriteColorJPGFile(emptyJPEGBuffer.data(), emptyJPEGBuffer.size(), m_vPostSyncedFrameID[i], "synced");
-			m_framesFileWriterReader->WriteDepthTiffFile(emptyDepthFrame, m_vPostSyncedFrameID[i], "synced");
-		}
-
-		else
-		{
-			if (!m_framesFileWriterReader->RenameRawFramePair(m_vFrameID[i], m_vPostSyncedFrameID[i], std::string("synced_")))
-			{
-				logBuffer.LogWarning("Could not rename Frame during post sync. Frame ID: " + to_string(m_vFrameID[i]));
-				success = false;
-			}
-		}
-	}
-
-	return success;
+	//-1 in m_vFrameID indicates that this device doesn't have a valid frame for this capture. To keep a good frame timing, an empty frame is filled in.
+	//All frames stay where they were recorded, only the index of the raw recording is rewritten
+	return m_framesFileWriterReader->PostSyncRawFile(m_vFrameID, m_vPostSyncedFrameID, emptyJPEGBuffer);
 }
 
 
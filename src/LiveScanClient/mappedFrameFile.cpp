@@ -0,0 +1,442 @@
+#include "mappedFrameFile.h"
+#include "frameEncoding.h"
+#include <climits>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const uint64_t bytesPerPoint = sizeof(Point3s) + sizeof(RGBA);
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+}
+
+MappedFrameFile::MappedFrameFile() : m_bOpen(false), m_pMemory(NULL), m_nSize(0), m_hFile(NULL), m_hMapping(NULL), m_nFileDescriptor(-1), m_nVersion(0), m_bIndexRebuilt(false),
+	m_pDictionary(NULL), m_pDictionaryData(NULL), m_nDictionarySize(0)
+{
+	m_pDecompressionContext = ZSTD_createDCtx();
+}
+
+MappedFrameFile::~MappedFrameFile()
+{
+	Close();
+	ZSTD_freeDCtx(m_pDecompressionContext);
+}
+
+/// <summary>
+/// Maps the file and finds all of its frames
+/// </summary>
+/// <param name="sequential">Tells the OS that the frames will be read in order, so that it reads ahead further</param>
+/// <returns>False if the file can't be opened or has a version this client can't read</returns>
+bool MappedFrameFile::Open(const std::string& path, bool sequential)
+{
+	Close();
+
+	if (!Map(path, sequential))
+	{
+		Close();
+		return false;
+	}
+
+	m_bOpen = true;
+
+	if (!ReadIndex())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MappedFrameFile::Map(const std::string& path, bool sequential)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	m_hFile = file;
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(file, &size))
+		return false;
+
+	m_nSize = size.QuadPart;
+
+	if (m_nSize == 0)
+		return true;
+
+	m_hMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (m_hMapping == NULL)
+		return false;
+
+	m_pMemory = (const char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	m_nFileDescriptor = open(path.c_str(), O_RDONLY);
+
+	if (m_nFileDescriptor < 0)
+		return false;
+
+	struct stat status;
+
+	if (fstat(m_nFileDescriptor, &status) != 0)
+		return false;
+
+	m_nSize = status.st_size;
+
+	if (m_nSize == 0)
+		return true;
+
+	void* memory = mmap(NULL, m_nSize, PROT_READ, MAP_SHARED, m_nFileDescriptor, 0);
+	m_pMemory = memory == MAP_FAILED ? NULL : (const char*)memory;
+
+	if (m_pMemory != NULL && sequential)
+		madvise(memory, m_nSize, MADV_SEQUENTIAL);
+#endif
+
+	return m_pMemory != NULL;
+}
+
+void MappedFrameFile::Close()
+{
+#ifdef _WIN32
+	if (m_pMemory != NULL)
+		UnmapViewOfFile(m_pMemory);
+
+	if (m_hMapping != NULL)
+		CloseHandle(m_hMapping);
+
+	if (m_hFile != NULL)
+		CloseHandle(m_hFile);
+#else
+	if (m_pMemory != NULL)
+		munmap((void*)m_pMemory, m_nSize);
+
+	if (m_nFileDescriptor >= 0)
+		close(m_nFileDescriptor);
+#endif
+
+	m_bOpen = false;
+	m_pMemory = NULL;
+	m_nSize = 0;
+	m_hFile = NULL;
+	m_hMapping = NULL;
+	m_nFileDescriptor = -1;
+	m_nVersion = 0;
+	m_bIndexRebuilt = false;
+	m_vFrameOffsets.clear();
+
+	ZSTD_freeDDict(m_pDictionary);
+	m_pDictionary = NULL;
+	m_pDictionaryData = NULL;
+	m_nDictionarySize = 0;
+}
+
+/// <summary>
+/// Finds out which version the file has and gets the offsets of its frames
+/// </summary>
+bool MappedFrameFile::ReadIndex()
+{
+	m_vFrameOffsets.clear();
+
+	BinFileHeader header;
+	header.magic = 0;
+
+	if (m_nSize >= sizeof(header))
+		memcpy(&header, m_pMemory, sizeof(header));
+
+	if (header.magic != binFileMagic)
+	{
+		//Version 1 files start right with the text lines of the first frame
+		m_nVersion = 1;
+		IndexVersion1();
+		return true;
+	}
+
+	if (header.version != binFileVersion || header.frameHeaderSize != sizeof(BinFrameHeader) || header.headerSize > m_nSize)
+		return false;
+
+	m_nVersion = header.version;
+
+	//The dictionary fills the rest of the file header
+	if (header.flags & BF_DICTIONARY)
+	{
+		if (header.headerSize <= sizeof(header))
+			return false;
+
+		m_pDictionaryData = m_pMemory + sizeof(header);
+		m_nDictionarySize = (int)(header.headerSize - sizeof(header));
+		m_pDictionary = ZSTD_createDDict(m_pDictionaryData, m_nDictionarySize);
+
+		if (m_pDictionary == NULL)
+			return false;
+	}
+
+	if (m_nSize >= header.headerSize + sizeof(BinFileFooter))
+	{
+		BinFileFooter footer;
+		memcpy(&footer, m_pMemory + m_nSize - sizeof(footer), sizeof(footer));
+
+		if (footer.magic == binFileMagic && footer.indexOffset <= m_nSize &&
+			footer.indexOffset + (uint64_t)footer.frameCount * sizeof(uint64_t) + sizeof(BinFileFooter) == m_nSize)
+		{
+			m_vFrameOffsets.resize(footer.frameCount);
+			memcpy(m_vFrameOffsets.data(), m_pMemory + footer.indexOffset, footer.frameCount * sizeof(uint64_t));
+			return true;
+		}
+	}
+
+	//Not closed properly, for example because the client crashed while recording
+	RebuildIndex(header.headerSize);
+	m_bIndexRebuilt = true;
+	return true;
+}
+
+/// <summary>
+/// Collects the offsets of all frames by jumping from one frame header to the next. Stops at the first frame that isn't complete,
+/// or at the first header without the magic, for example in the zeros of blocks that were reserved for the file but never written
+/// </summary>
+void MappedFrameFile::RebuildIndex(uint64_t firstFrameOffset)
+{
+	uint64_t offset = firstFrameOffset;
+	BinFrameHeader header;
+
+	while (offset + sizeof(header) <= m_nSize)
+	{
+		memcpy(&header, m_pMemory + offset, sizeof(header));
+		uint64_t frameEnd = offset + sizeof(header) + header.dataSize;
+
+		if (header.magic != binFrameMagic || header.pointCount < 0 || header.dataSize > m_nSize || frameEnd > m_nSize)
+			break;
+
+		m_vFrameOffsets.push_back(offset);
+		offset = frameEnd;
+	}
+}
+
+/// <summary>
+/// Version 1 files have no index, so all frames have to be gone through once
+/// </summary>
+void MappedFrameFile::IndexVersion1()
+{
+	uint64_t offset = 0;
+	int points;
+	uint64_t timestamp;
+	uint64_t dataOffset;
+
+	while (ParseVersion1Header(offset, points, timestamp, dataOffset))
+	{
+		uint64_t frameEnd = dataOffset + points * bytesPerPoint;
+
+		if (frameEnd > m_nSize)
+			break;
+
+		m_vFrameOffsets.push_back(offset);
+		offset = frameEnd;
+	}
+}
+
+/// <summary>
+/// Parses the "n_points= " and "frame_timestamp= " lines in front of the points of a frame in version 1 files
+/// </summary>
+bool MappedFrameFile::ParseVersion1Header(uint64_t offset, int& outPoints, uint64_t& outTimestamp, uint64_t& outDataOffset) const
+{
+	const char* current = m_pMemory + offset;
+	const char* end = m_pMemory + m_nSize;
+	long long values[2];
+
+	for (int i = 0; i < 2; i++)
+	{
+		//The name of the value, then the value itself
+		while (current < end && IsSpace(*current))
+			current++;
+
+		while (current < end && !IsSpace(*current))
+			current++;
+
+		while (current < end && IsSpace(*current))
+			current++;
+
+		bool negative = current < end && *current == '-';
+
+		if (negative)
+			current++;
+
+		if (current == end || *current < '0' || *current > '9')
+			return false;
+
+		long long value = 0;
+
+		while (current < end && *current >= '0' && *current <= '9')
+			value = value * 10 + (*current++ - '0');
+
+		values[i] = negative ? -value : value;
+	}
+
+	if (values[0] < 0 || values[0] > INT32_MAX)
+		return false;
+
+	outPoints = (int)values[0];
+
+	//Older files stored only the lower 32 bits of the timestamp as a signed int, which is all we can get back from them
+	outTimestamp = values[1] < 0 ? (uint32_t)values[1] : (uint64_t)values[1];
+
+	//The points start after the line break that ends the timestamp line
+	outDataOffset = (current - m_pMemory) + 1;
+	return true;
+}
+
+/// <summary>
+/// Gets a frame without copying it. Compressed frames are decoded into the buffers of the MappedFrameFile
+/// </summary>
+/// <param name="decode">If false, compressed frames are only located, for sending them on as they are stored</param>
+/// <returns>False if there is no such frame, or it has a layout this client can't read</returns>
+bool MappedFrameFile::GetFrame(int index, BinFrameView& outFrame, bool decode)
+{
+	if (index < 0 || index >= (int)m_vFrameOffsets.size())
+		return false;
+
+	outFrame.compressed = NULL;
+	outFrame.compressedOffset = -1;
+	outFrame.compressedSize = 0;
+
+	uint64_t offset = m_vFrameOffsets[index];
+	uint64_t dataOffset;
+	int points;
+
+	if (m_nVersion < 2)
+	{
+		if (!ParseVersion1Header(offset, points, outFrame.timestamp, dataOffset))
+			return false;
+	}
+
+	else
+	{
+		BinFrameHeader header;
+
+		if (offset + sizeof(header) > m_nSize)
+			return false;
+
+		memcpy(&header, m_pMemory + offset, sizeof(header));
+
+		if (header.magic != binFrameMagic)
+			return false;
+
+		if (header.compression == BC_ZSTD_COLUMNAR)
+			return DecompressFrame(header, offset + sizeof(header), decode, outFrame);
+
+		if (header.compression != BC_NONE || header.pointCount < 0 || header.dataSize != header.pointCount * bytesPerPoint)
+			return false;
+
+		points = header.pointCount;
+		outFrame.timestamp = header.timestamp;
+		dataOffset = offset + sizeof(header);
+	}
+
+	if (dataOffset + points * bytesPerPoint > m_nSize)
+		return false;
+
+	outFrame.pointCount = points;
+	outFrame.dataOffset = (long long)dataOffset;
+	outFrame.vertices = (const Point3s*)(m_pMemory + dataOffset);
+	outFrame.colors = (const RGBA*)(m_pMemory + dataOffset + points * sizeof(Point3s));
+	return true;
+}
+
+/// <summary>
+/// Decompresses a BC_ZSTD_COLUMNAR frame and decodes it into the vertex and color buffers
+/// </summary>
+bool MappedFrameFile::DecompressFrame(const BinFrameHeader& header, uint64_t dataOffset, bool decode, BinFrameView& outFrame)
+{
+	if (header.pointCount < 0 || header.dataSize > m_nSize || dataOffset + header.dataSize > m_nSize || header.dataSize > INT_MAX)
+		return false;
+
+	outFrame.pointCount = header.pointCount;
+	outFrame.timestamp = header.timestamp;
+	outFrame.dataOffset = -1;
+	outFrame.compressed = m_pMemory + dataOffset;
+	outFrame.compressedOffset = (long long)dataOffset;
+	outFrame.compressedSize = (int)header.dataSize;
+
+	if (!decode)
+	{
+		outFrame.vertices = NULL;
+		outFrame.colors = NULL;
+		return true;
+	}
+
+	size_t encodedSize = GetEncodedFrameSize(header.pointCount);
+
+	if (m_vDecompressed.size() < encodedSize)
+		m_vDecompressed.resize(encodedSize);
+
+	size_t decompressedSize;
+
+	if (m_pDictionary != NULL)
+		decompressedSize = ZSTD_decompress_usingDDict(m_pDecompressionContext, m_vDecompressed.data(), encodedSize, m_pMemory + dataOffset, (size_t)header.dataSize, m_pDictionary);
+	else
+		decompressedSize = ZSTD_decompressDCtx(m_pDecompressionContext, m_vDecompressed.data(), encodedSize, m_pMemory + dataOffset, (size_t)header.dataSize);
+
+	if (ZSTD_isError(decompressedSize) || decompressedSize != encodedSize)
+		return false;
+
+	if ((int)m_vVertices.size() < header.pointCount)
+	{
+		m_vVertices.resize(header.pointCount);
+		m_vColors.resize(header.pointCount);
+	}
+
+	int points;
+
+	if (!DecodeFrame(FE_COLUMNAR, m_vDecompressed.data(), (int)decompressedSize, m_vVertices.data(), m_vColors.data(), header.pointCount, points) || points != header.pointCount)
+		return false;
+
+	outFrame.vertices = m_vVertices.data();
+	outFrame.colors = m_vColors.data();
+	return true;
+}
+
+/// <summary>
+/// Asks the OS to load the given frames in the background, so that reading them later doesn't have to wait for the disk
+/// </summary>
+void MappedFrameFile::Prefetch(int firstFrame, int frameCount) const
+{
+	if (m_pMemory == NULL || firstFrame < 0 || frameCount <= 0 || firstFrame >= (int)m_vFrameOffsets.size())
+		return;
+
+	int lastFrame = firstFrame + frameCount;
+	uint64_t start = m_vFrameOffsets[firstFrame];
+	uint64_t end = lastFrame < (int)m_vFrameOffsets.size() ? m_vFrameOffsets[lastFrame] : m_nSize;
+
+	if (end <= start)
+		return;
+
+#ifdef _WIN32
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (void*)(m_pMemory + start);
+	range.NumberOfBytes = (size_t)(end - start);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	//madvise needs an address at the start of a page
+	uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t pageStart = start - start % pageSize;
+	madvise((void*)(m_pMemory + pageStart), (size_t)(end - pageStart), MADV_WILLNEED);
+#endif
+}
@@ -0,0 +1,89 @@
+#include "messageFramer.h"
+
+namespace
+{
+	const size_t initialBufferSize = 64 * 1024;
+}
+
+MessageFramer::MessageFramer() : m_vBuffer(initialBufferSize), m_nReadPosition(0), m_nWritePosition(0), m_bError(false)
+{
+}
+
+/// <summary>
+/// Returns where the next received bytes should be written, with room for at least minimumSize bytes.
+/// Makes room by moving the unread bytes to the front first, and only grows the buffer if that isn't enough
+/// </summary>
+char* MessageFramer::GetWriteBuffer(int minimumSize)
+{
+	if (m_vBuffer.size() - m_nWritePosition < (size_t)minimumSize && m_nReadPosition > 0)
+	{
+		size_t unread = m_nWritePosition - m_nReadPosition;
+		memmove(m_vBuffer.data(), m_vBuffer.data() + m_nReadPosition, unread);
+		m_nReadPosition = 0;
+		m_nWritePosition = unread;
+	}
+
+	if (m_vBuffer.size() - m_nWritePosition < (size_t)minimumSize)
+		m_vBuffer.resize(m_nWritePosition + minimumSize);
+
+	return m_vBuffer.data() + m_nWritePosition;
+}
+
+void MessageFramer::CommitWrite(int size)
+{
+	m_nWritePosition += size;
+}
+
+/// <summary>
+/// Hands out the next complete message. The payload stays valid until the next call of GetWriteBuffer()
+/// </summary>
+/// <returns>False if no complete message has been received yet, or the stream is corrupted (see HasError())</returns>
+bool MessageFramer::NextMessage(ServerMessage& message)
+{
+	if (m_bError)
+		return false;
+
+	size_t available = m_nWritePosition - m_nReadPosition;
+
+	if (available < (size_t)messageHeaderSize)
+		return false;
+
+	const char* header = m_vBuffer.data() + m_nReadPosition;
+	unsigned char type = (unsigned char)header[0];
+	int size;
+	memcpy(&size, header + 1, sizeof(int));
+
+	//We can't find the start of the next message anymore, so nothing that follows can be trusted
+	if (type >= MSG_INCOMING_COUNT || size < 0 || size > maxMessagePayloadSize)
+	{
+		m_bError = true;
+		return false;
+	}
+
+	if (available < (size_t)(messageHeaderSize + size))
+		return false;
+
+	message.type = (INCOMING_MESSAGE_TYPE)type;
+	message.payload = header + messageHeaderSize;
+	message.size = size;
+
+	m_nReadPosition += messageHeaderSize + size;
+
+	if (m_nReadPosition == m_nWritePosition)
+	{
+		m_nReadPosition = 0;
+		m_nWritePosition = 0;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Drops everything received so far, called after an error or when a new connection starts
+/// </summary>
+void MessageFramer::Reset()
+{
+	m_nReadPosition = 0;
+	m_nWritePosition = 0;
+	m_bError = false;
+}
@@ -0,0 +1,523 @@
+#include "pointcloudCull.h"
+#include <immintrin.h>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CULL_TARGET_AVX2
+#else
+#define CULL_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
+namespace
+{
+	/// <summary>
+	/// Shuffle masks to pull the X, Y or Z components of 8 interleaved int16 points (loaded as three 16 byte vectors)
+	/// into one vector. masks[component][source vector], zeroing every lane that doesn't come from that source.
+	/// </summary>
+	struct DeinterleaveMasks
+	{
+		alignas(16) uint8_t masks[3][3][16];
+
+		DeinterleaveMasks()
+		{
+			for (int component = 0; component < 3; component++)
+			{
+				for (int source = 0; source < 3; source++)
+				{
+					for (int lane = 0; lane < 8; lane++)
+					{
+						int element = 3 * lane + component;
+						bool inSource = element / 8 == source;
+						uint8_t byte = static_cast<uint8_t>(2 * (element % 8));
+
+						masks[component][source][2 * lane] = inSource ? byte : 0x80;
+						masks[component][source][2 * lane + 1] = inSource ? byte + 1 : 0x80;
+					}
+				}
+			}
+		}
+	};
+
+	/// <summary>
+	/// For every 8 bit survivor mask, the permutation that moves the surviving lanes to the front
+	/// </summary>
+	struct CompressTable
+	{
+		alignas(32) int32_t permutations[256][8];
+
+		CompressTable()
+		{
+			for (int mask = 0; mask < 256; mask++)
+			{
+				int j = 0;
+
+				for (int lane = 0; lane < 8; lane++)
+				{
+					if (mask & (1 << lane))
+						permutations[mask][j++] = lane;
+				}
+
+				while (j < 8)
+					permutations[mask][j++] = 0;
+			}
+		}
+	};
+
+	const DeinterleaveMasks deinterleaveMasks;
+	const CompressTable compressTable;
+
+	inline bool CullPoint(const int16_t* point, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s& outVertex)
+	{
+		//Invalid vertices always have a Z-Value of 0, which is below minDepth
+		if (point[2] < minDepth || point[2] > maxDepth)
+			return false;
+
+		float x = point[0];
+		float y = point[1];
+		float z = point[2];
+
+		//Same order of operations as Matrix4x4 * Point3f, so that all kernels give bit-identical results
+		float worldX = toWorld.mat[0][0] * x + toWorld.mat[0][1] * y + toWorld.mat[0][2] * z + toWorld.mat[0][3];
+		float worldY = toWorld.mat[1][0] * x + toWorld.mat[1][1] * y + toWorld.mat[1][2] * z + toWorld.mat[1][3];
+		float worldZ = toWorld.mat[2][0] * x + toWorld.mat[2][1] * y + toWorld.mat[2][2] * z + toWorld.mat[2][3];
+
+		if (worldX < bounds[0] || worldX > bounds[3]
+			|| worldY < bounds[1] || worldY > bounds[4]
+			|| worldZ < bounds[2] || worldZ > bounds[5])
+			return false;
+
+		//meters to milimeters, same as the Point3s(Point3f&) conversion
+		outVertex.X = static_cast<short>(1000 * worldX);
+		outVertex.Y = static_cast<short>(1000 * worldY);
+		outVertex.Z = static_cast<short>(1000 * worldZ);
+		return true;
+	}
+
+	inline void GatherColor(const uint8_t* colorBGRA, RGBA& outColor)
+	{
+		//The first byte of the BGRA image goes into the red channel. This is how the clients always sent it, the server expects it this way
+		outColor.red = colorBGRA[0];
+		outColor.green = colorBGRA[1];
+		outColor.blue = colorBGRA[2];
+		outColor.alpha = 1;
+	}
+
+	CULL_TARGET_AVX2 inline __m256 TransformRow(const Matrix4x4& toWorld, int row, __m256 x, __m256 y, __m256 z)
+	{
+		__m256 result = _mm256_mul_ps(_mm256_set1_ps(toWorld.mat[row][0]), x);
+		result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(toWorld.mat[row][1]), y));
+		result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_set1_ps(toWorld.mat[row][2]), z));
+		return _mm256_add_ps(result, _mm256_set1_ps(toWorld.mat[row][3]));
+	}
+
+	CULL_TARGET_AVX2 inline __m256 DeinterleaveComponent(int component, __m128i v0, __m128i v1, __m128i v2)
+	{
+		const uint8_t(*masks)[16] = deinterleaveMasks.masks[component];
+
+		__m128i result = _mm_shuffle_epi8(v0, _mm_load_si128((const __m128i*)masks[0]));
+		result = _mm_or_si128(result, _mm_shuffle_epi8(v1, _mm_load_si128((const __m128i*)masks[1])));
+		result = _mm_or_si128(result, _mm_shuffle_epi8(v2, _mm_load_si128((const __m128i*)masks[2])));
+
+		return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(result));
+	}
+
+	/// <summary>
+	/// The implementation StoreFrame() used before the fused kernels: Transform everything into a full-size Point3f array,
+	/// then compact in a second pass. Only kept as baseline for the benchmark
+	/// </summary>
+	int CullPointcloudTwoPass(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, Point3f* allVertices, Point3s* outVertices, RGBA* outColors)
+	{
+		Point3f invalidPoint = Point3f(0, 0, 0, true);
+		Point3f temp = Point3f(0, 0, 0);
+
+		for (int i = 0; i < pointCount; i++)
+		{
+			if (pointcloud[3 * i + 2] >= 0.0001)
+			{
+				temp.X = pointcloud[3 * i + 0];
+				temp.Y = pointcloud[3 * i + 1];
+				temp.Z = pointcloud[3 * i + 2];
+
+				temp = toWorld * temp;
+
+				if (temp.X < bounds[0] || temp.X > bounds[3]
+					|| temp.Y < bounds[1] || temp.Y > bounds[4]
+					|| temp.Z < bounds[2] || temp.Z > bounds[5])
+				{
+					allVertices[i] = invalidPoint;
+					continue;
+				}
+
+				allVertices[i] = temp;
+			}
+
+			else
+				allVertices[i] = invalidPoint;
+		}
+
+		int j = 0;
+		for (int i = 0; i < pointCount; i++)
+		{
+			if (!allVertices[i].Invalid)
+			{
+				RGBA color;
+				color.red = colorBGRA[i * 4];
+				color.green = colorBGRA[(i * 4) + 1];
+				color.blue = colorBGRA[(i * 4) + 2];
+
+				outVertices[j] = allVertices[i];
+				outColors[j] = color;
+				j++;
+			}
+		}
+
+		return j;
+	}
+}
+
+bool CullKernelAVX2Supported()
+{
+#ifdef _MSC_VER
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 1);
+
+	bool osUsesXSave = (cpuInfo[2] & (1 << 27)) != 0;
+	bool cpuHasAVX = (cpuInfo[2] & (1 << 28)) != 0;
+
+	if (!osUsesXSave || !cpuHasAVX)
+		return false;
+
+	//Check that the OS saves the AVX registers on context switches
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(cpuInfo, 7, 0);
+	return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+/// <summary>
+/// Uses the fastest kernel the CPU supports
+/// </summary>
+/// <returns>The amount of points that survived the culling</returns>
+int CullPointcloud(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s* outVertices, RGBA* outColors)
+{
+	static const bool useAVX2 = CullKernelAVX2Supported();
+
+	if (useAVX2)
+		return CullPointcloudAVX2(pointcloud, colorBGRA, pointCount, toWorld, bounds, minDepth, maxDepth, outVertices, outColors);
+
+	return CullPointcloudScalar(pointcloud, colorBGRA, pointCount, toWorld, bounds, minDepth, maxDepth, outVertices, outColors);
+}
+
+int CullPointcloudScalar(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s* outVertices, RGBA* outColors)
+{
+	int goodVerticesCount = 0;
+
+	for (int i = 0; i < pointCount; i++)
+	{
+		if (CullPoint(pointcloud + 3 * i, toWorld, bounds, minDepth, maxDepth, outVertices[goodVerticesCount]))
+		{
+			GatherColor(colorBGRA + 4 * i, outColors[goodVerticesCount]);
+			goodVerticesCount++;
+		}
+	}
+
+	return goodVerticesCount;
+}
+
+/// <summary>
+/// Processes 8 points per iteration. The survivors of each batch are moved to the front of the registers with a
+/// permutation from the compress table and then stored, which gives the same order as the scalar kernel
+/// </summary>
+CULL_TARGET_AVX2 int CullPointcloudAVX2(const int16_t* pointcloud, const uint8_t* colorBGRA, int pointCount, const Matrix4x4& toWorld, const float* bounds, float minDepth, float maxDepth, Point3s* outVertices, RGBA* outColors)
+{
+	const __m256 depthMin = _mm256_set1_ps(minDepth);
+	const __m256 depthMax = _mm256_set1_ps(maxDepth);
+	const __m256 boundsMinX = _mm256_set1_ps(bounds[0]);
+	const __m256 boundsMinY = _mm256_set1_ps(bounds[1]);
+	const __m256 boundsMinZ = _mm256_set1_ps(bounds[2]);
+	const __m256 boundsMaxX = _mm256_set1_ps(bounds[3]);
+	const __m256 boundsMaxY = _mm256_set1_ps(bounds[4]);
+	const __m256 boundsMaxZ = _mm256_set1_ps(bounds[5]);
+	const __m256 metersToMilimeters = _mm256_set1_ps(1000.0f);
+
+	//BGRA -> first byte into red, as in GatherColor(), and alpha = 1
+	const __m256i colorShuffle = _mm256_setr_epi8(
+		2, 1, 0, -128, 6, 5, 4, -128, 10, 9, 8, -128, 14, 13, 12, -128,
+		2, 1, 0, -128, 6, 5, 4, -128, 10, 9, 8, -128, 14, 13, 12, -128);
+	const __m256i alpha = _mm256_set1_epi32(0x01000000);
+
+	alignas(32) int32_t survivorsX[8];
+	alignas(32) int32_t survivorsY[8];
+	alignas(32) int32_t survivorsZ[8];
+
+	int goodVerticesCount = 0;
+	int i = 0;
+
+	for (; i + 8 <= pointCount; i += 8)
+	{
+		const int16_t* points = pointcloud + 3 * i;
+		__m128i v0 = _mm_loadu_si128((const __m128i*)(points + 0));
+		__m128i v1 = _mm_loadu_si128((const __m128i*)(points + 8));
+		__m128i v2 = _mm_loadu_si128((const __m128i*)(points + 16));
+
+		__m256 x = DeinterleaveComponent(0, v0, v1, v2);
+		__m256 y = DeinterleaveComponent(1, v0, v1, v2);
+		__m256 z = DeinterleaveComponent(2, v0, v1, v2);
+
+		__m256 valid = _mm256_and_ps(_mm256_cmp_ps(z, depthMin, _CMP_GE_OQ), _mm256_cmp_ps(z, depthMax, _CMP_LE_OQ));
+
+		//Skip the whole batch if none of the points has depth in range, very common around the edges of the image and for the background
+		if (_mm256_movemask_ps(valid) == 0)
+			continue;
+
+		__m256 worldX = TransformRow(toWorld, 0, x, y, z);
+		__m256 worldY = TransformRow(toWorld, 1, x, y, z);
+		__m256 worldZ = TransformRow(toWorld, 2, x, y, z);
+
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(worldX, boundsMinX, _CMP_GE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(worldX, boundsMaxX, _CMP_LE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(worldY, boundsMinY, _CMP_GE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(worldY, boundsMaxY, _CMP_LE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(worldZ, boundsMinZ, _CMP_GE_OQ));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(worldZ, boundsMaxZ, _CMP_LE_OQ));
+
+		int mask = _mm256_movemask_ps(valid);
+
+		if (mask == 0)
+			continue;
+
+		int survivors = _mm_popcnt_u32(mask);
+		__m256i permutation = _mm256_load_si256((const __m256i*)compressTable.permutations[mask]);
+
+		__m256i colors = _mm256_loadu_si256((const __m256i*)(colorBGRA + 4 * i));
+		colors = _mm256_or_si256(_mm256_shuffle_epi8(colors, colorShuffle), alpha);
+		colors = _mm256_permutevar8x32_epi32(colors, permutation);
+
+		_mm256_store_si256((__m256i*)survivorsX, _mm256_permutevar8x32_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(worldX, metersToMilimeters)), permutation));
+		_mm256_store_si256((__m256i*)survivorsY, _mm256_permutevar8x32_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(worldY, metersToMilimeters)), permutation));
+		_mm256_store_si256((__m256i*)survivorsZ, _mm256_permutevar8x32_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(worldZ, metersToMilimeters)), permutation));
+
+		//The output might not have room for a full register, so we only copy the survivors
+		alignas(32) RGBA survivorColors[8];
+		_mm256_store_si256((__m256i*)survivorColors, colors);
+		memcpy(outColors + goodVerticesCount, survivorColors, survivors * sizeof(RGBA));
+
+		for (int k = 0; k < survivors; k++)
+		{
+			outVertices[goodVerticesCount + k].X = static_cast<short>(survivorsX[k]);
+			outVertices[goodVerticesCount + k].Y = static_cast<short>(survivorsY[k]);
+			outVertices[goodVerticesCount + k].Z = static_cast<short>(survivorsZ[k]);
+		}
+
+		goodVerticesCount += survivors;
+	}
+
+	//Remaining points that don't fill a whole register
+	goodVerticesCount += CullPointcloudScalar(pointcloud + 3 * i, colorBGRA + 4 * i, pointCount - i, toWorld, bounds, minDepth, maxDepth, outVertices + goodVerticesCount, outColors + goodVerticesCount);
+
+	return goodVerticesCount;
+}
+
+static void ClampROI(int width, int height, const CullROI& roi, int& left, int& right, int& top, int& bottom)
+{
+	left = roi.left < 0 ? 0 : (roi.left > width ? width : roi.left);
+	right = roi.right < left ? left : (roi.right > width ? width : roi.right);
+	top = roi.top < 0 ? 0 : (roi.top > height ? height : roi.top);
+	bottom = roi.bottom < top ? top : (roi.bottom > height ? height : roi.bottom);
+}
+
+int GetCullROIPointCount(int width, int height, const CullROI& roi)
+{
+	int left, right, top, bottom;
+	ClampROI(width, height, roi, left, right, top, bottom);
+
+	return (right - left) * (bottom - top);
+}
+
+int CullPointcloudTiled(const int16_t* pointcloud, const uint8_t* colorBGRA, int width, int height, const Matrix4x4& toWorld, const float* bounds, const CullROI& roi,
+	Point3s* scratchVertices, RGBA* scratchColors, Point3s* outVertices, RGBA* outColors)
+{
+	int left, right, top, bottom;
+	ClampROI(width, height, roi, left, right, top, bottom);
+
+	int roiWidth = right - left;
+	int roiHeight = bottom - top;
+
+	if (roiWidth == 0 || roiHeight == 0)
+		return 0;
+
+	//Culls rows of the ROI into the output. If the ROI spans the whole width, the rows are contiguous and can be culled in one go
+	auto cullRows = [&](int firstRow, int rows, Point3s* rowVertices, RGBA* rowColors)
+	{
+		if (roiWidth == width)
+		{
+			int firstPoint = firstRow * width;
+			return CullPointcloud(pointcloud + 3 * firstPoint, colorBGRA + 4 * firstPoint, rows * width, toWorld, bounds, roi.minDepth, roi.maxDepth, rowVertices, rowColors);
+		}
+
+		int survivors = 0;
+
+		for (int row = firstRow; row < firstRow + rows; row++)
+		{
+			int firstPoint = row * width + left;
+			survivors += CullPointcloud(pointcloud + 3 * firstPoint, colorBGRA + 4 * firstPoint, roiWidth, toWorld, bounds, roi.minDepth, roi.maxDepth, rowVertices + survivors, rowColors + survivors);
+		}
+
+		return survivors;
+	};
+
+	int tileCount = (roiHeight + cullTileRows - 1) / cullTileRows;
+
+	if (tileCount <= 1)
+		return cullRows(top, roiHeight, outVertices, outColors);
+
+	std::vector<int> tileSurvivors(tileCount);
+	std::vector<int> tileOffsets(tileCount);
+	int goodVerticesCount = 0;
+
+#pragma omp parallel
+	{
+		//Each tile culls into the scratch region of its own size, it can't have more survivors than pixels, so tiles never overlap
+#pragma omp for schedule(dynamic)
+		for (int tile = 0; tile < tileCount; tile++)
+		{
+			int firstRow = top + tile * cullTileRows;
+			int rows = bottom - firstRow < cullTileRows ? bottom - firstRow : cullTileRows;
+			int scratchOffset = tile * cullTileRows * roiWidth;
+
+			tileSurvivors[tile] = cullRows(firstRow, rows, scratchVertices + scratchOffset, scratchColors + scratchOffset);
+		}
+
+		//Exclusive prefix sum over the survivor counts gives each tile its offset in the output
+#pragma omp single
+		{
+			for (int tile = 0; tile < tileCount; tile++)
+			{
+				tileOffsets[tile] = goodVerticesCount;
+				goodVerticesCount += tileSurvivors[tile];
+			}
+		}
+
+#pragma omp for schedule(dynamic)
+		for (int tile = 0; tile < tileCount; tile++)
+		{
+			int scratchOffset = tile * cullTileRows * roiWidth;
+
+			memcpy(outVertices + tileOffsets[tile], scratchVertices + scratchOffset, tileSurvivors[tile] * sizeof(Point3s));
+			memcpy(outColors + tileOffsets[tile], scratchColors + scratchOffset, tileSurvivors[tile] * sizeof(RGBA));
+		}
+	}
+
+	return goodVerticesCount;
+}
+
+std::string BenchmarkPointcloudCull(int width, int height, int iterations)
+{
+	int pointCount = width * height;
+
+	std::vector<int16_t> pointcloud(3 * pointCount);
+	std::vector<uint8_t> color(4 * pointCount);
+
+	//Synthetic frame: a noisy surface about 1.5m in front of the camera, with roughly 15% of the pixels without depth
+	uint32_t random = 12345;
+	for (int i = 0; i < pointCount; i++)
+	{
+		random = random * 1664525u + 1013904223u;
+
+		int column = i % width;
+		int row = i / width;
+
+		pointcloud[3 * i + 0] = static_cast<int16_t>((column - width / 2) * 2);
+		pointcloud[3 * i + 1] = static_cast<int16_t>((row - height / 2) * 2);
+		pointcloud[3 * i + 2] = (random >> 24) < 38 ? 0 : static_cast<int16_t>(1000 + (random >> 16) % 1000);
+
+		color[4 * i + 0] = static_cast<uint8_t>(random);
+		color[4 * i + 1] = static_cast<uint8_t>(random >> 8);
+		color[4 * i + 2] = static_cast<uint8_t>(random >> 16);
+		color[4 * i + 3] = 255;
+	}
+
+	Matrix4x4 toWorld = Matrix4x4(
+		0.001f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.001f, 0.0f, 0.0f,
+		0.0f, 0.0f, -0.001f, 2.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+
+	float bounds[6] = { -1.0f, -1.0f, -0.2f, 1.0f, 1.0f, 0.8f };
+
+	std::vector<Point3f> allVertices(pointCount);
+	std::vector<Point3s> referenceVertices(pointCount), vertices(pointCount);
+	std::vector<RGBA> referenceColors(pointCount), colors(pointCount);
+
+	auto timeKernel = [&](auto kernel, int& outCount)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < iterations; i++)
+			outCount = kernel();
+
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+	};
+
+	auto matchesReference = [&](int count, int referenceCount)
+	{
+		if (count != referenceCount)
+			return false;
+
+		for (int i = 0; i < count; i++)
+		{
+			if (vertices[i].X != referenceVertices[i].X || vertices[i].Y != referenceVertices[i].Y || vertices[i].Z != referenceVertices[i].Z
+				|| memcmp(&colors[i], &referenceColors[i], sizeof(RGBA)) != 0)
+				return false;
+		}
+
+		return true;
+	};
+
+	int referenceCount = 0;
+	double referenceTime = timeKernel([&]() { return CullPointcloudTwoPass(pointcloud.data(), color.data(), pointCount, toWorld, bounds, allVertices.data(), referenceVertices.data(), referenceColors.data()); }, referenceCount);
+
+	std::string result = "Pointcloud cull " + std::to_string(width) + "x" + std::to_string(height) + ", " + std::to_string(referenceCount) + " survivors\n";
+	result += "Two pass (previous): " + std::to_string(referenceTime) + " ms\n";
+
+	CullROI fullFrame;
+
+	int count = 0;
+	double scalarTime = timeKernel([&]() { return CullPointcloudScalar(pointcloud.data(), color.data(), pointCount, toWorld, bounds, fullFrame.minDepth, fullFrame.maxDepth, vertices.data(), colors.data()); }, count);
+	result += "Fused scalar: " + std::to_string(scalarTime) + " ms" + (matchesReference(count, referenceCount) ? "" : " OUTPUT MISMATCH") + "\n";
+
+	if (CullKernelAVX2Supported())
+	{
+		double avxTime = timeKernel([&]() { return CullPointcloudAVX2(pointcloud.data(), color.data(), pointCount, toWorld, bounds, fullFrame.minDepth, fullFrame.maxDepth, vertices.data(), colors.data()); }, count);
+		result += "Fused AVX2: " + std::to_string(avxTime) + " ms" + (matchesReference(count, referenceCount) ? "" : " OUTPUT MISMATCH") + "\n";
+	}
+
+	else
+		result += "Fused AVX2: not supported by this CPU\n";
+
+	std::vector<Point3s> scratchVertices(pointCount);
+	std::vector<RGBA> scratchColors(pointCount);
+	double tiledTime = timeKernel([&]() { return CullPointcloudTiled(pointcloud.data(), color.data(), width, height, toWorld, bounds, fullFrame, scratchVertices.data(), scratchColors.data(), vertices.data(), colors.data()); }, count);
+	result += "Fused, row tiled: " + std::to_string(tiledTime) + " ms" + (matchesReference(count, referenceCount) ? "" : " OUTPUT MISMATCH") + "\n";
+
+	//The bounds cover the columns and rows within 500 pixels of the center, and a camera Z between 1200 and 2200mm. Padded like a projected ROI
+	CullROI roi;
+	roi.left = width / 2 - 504;
+	roi.right = width / 2 + 504;
+	roi.top = height / 2 - 504;
+	roi.bottom = height / 2 + 504;
+	roi.minDepth = 1190;
+	roi.maxDepth = 2210;
+
+	double roiTime = timeKernel([&]() { return CullPointcloudTiled(pointcloud.data(), color.data(), width, height, toWorld, bounds, roi, scratchVertices.data(), scratchColors.data(), vertices.data(), colors.data()); }, count);
+	result += "Fused, row tiled with ROI: " + std::to_string(roiTime) + " ms" + (matchesReference(count, referenceCount) ? "" : " OUTPUT MISMATCH") + "\n";
+
+	return result;
+}
@@ -0,0 +1,406 @@
+#include "rawRecordingFile.h"
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+namespace
+{
+	//Depth images are small next to the color images, the fastest level keeps up with 30 fps on a single core
+	const int depthCompressionLevel = 1;
+
+	/// <summary>
+	/// Turns each depth value into the difference to the one left of it, which is small on surfaces, and splits the differences
+	/// into a plane of the low bytes followed by a plane of the high bytes, so that zstd sees long runs of similar bytes
+	/// </summary>
+	void ShuffleDepth(const uint16_t* depth, int width, int height, size_t strideBytes, uint8_t* outPlanes)
+	{
+		size_t pixels = (size_t)width * height;
+		uint8_t* lowBytes = outPlanes;
+		uint8_t* highBytes = outPlanes + pixels;
+
+		for (int y = 0; y < height; y++)
+		{
+			const uint16_t* row = (const uint16_t*)((const char*)depth + y * strideBytes);
+			size_t rowStart = (size_t)y * width;
+			uint16_t previous = 0;
+
+			for (int x = 0; x < width; x++)
+			{
+				uint16_t delta = (uint16_t)(row[x] - previous);
+				previous = row[x];
+
+				lowBytes[rowStart + x] = (uint8_t)delta;
+				highBytes[rowStart + x] = (uint8_t)(delta >> 8);
+			}
+		}
+	}
+
+	void UnshuffleDepth(const uint8_t* planes, int width, int height, uint16_t* outDepth)
+	{
+		size_t pixels = (size_t)width * height;
+		const uint8_t* lowBytes = planes;
+		const uint8_t* highBytes = planes + pixels;
+
+		for (int y = 0; y < height; y++)
+		{
+			size_t rowStart = (size_t)y * width;
+			uint16_t value = 0;
+
+			for (int x = 0; x < width; x++)
+			{
+				value += (uint16_t)(lowBytes[rowStart + x] | (highBytes[rowStart + x] << 8));
+				outDepth[rowStart + x] = value;
+			}
+		}
+	}
+}
+
+RawRecordingFile::RawRecordingFile() : m_pFile(NULL), m_nIndexOffset(0), m_nFileSize(0), m_bIndexRebuilt(false)
+{
+}
+
+RawRecordingFile::~RawRecordingFile()
+{
+	Close();
+}
+
+/// <summary>
+/// Creates the file for writing and writes its header. An existing file is overwritten
+/// </summary>
+/// <param name="preallocateBytes">Space that is reserved on the disk right away, 0 lets the file grow as it is written</param>
+/// <param name="unbuffered">Writes past the page cache of the OS</param>
+bool RawRecordingFile::Create(const std::string& path, int deviceIndex, uint64_t preallocateBytes, bool unbuffered)
+{
+	Close();
+
+	if (!m_Writer.Open(path, preallocateBytes, unbuffered))
+		return false;
+
+	m_sPath = path;
+
+	RawFileHeader header = { rawFileMagic, rawFileVersion, sizeof(RawFileHeader), sizeof(RawChunkHeader), deviceIndex, 0 };
+	return m_Writer.Write(&header, sizeof(header));
+}
+
+/// <summary>
+/// Appends a frame as a chunk. The color image is stored as it is, the depth image is compressed
+/// </summary>
+/// <param name="depthStrideBytes">Bytes from the start of one row of the depth image to the next</param>
+/// <returns>False if the file isn't open for writing, or writing to the disk failed</returns>
+bool RawRecordingFile::WriteFrame(const void* colorMJPG, size_t colorSize, const uint16_t* depth, int depthWidth, int depthHeight, size_t depthStrideBytes, int frameIndex, uint64_t timestamp)
+{
+	if (!m_Writer.IsOpen() || colorSize > UINT32_MAX || depthWidth < 0 || depthHeight < 0 || depthWidth > UINT16_MAX || depthHeight > UINT16_MAX)
+		return false;
+
+	size_t planesSize = (size_t)depthWidth * depthHeight * sizeof(uint16_t);
+
+	if (m_vDepthPlanes.size() < planesSize)
+		m_vDepthPlanes.resize(planesSize);
+
+	ShuffleDepth(depth, depthWidth, depthHeight, depthStrideBytes, (uint8_t*)m_vDepthPlanes.data());
+
+	RawChunkHeader header;
+	header.magic = rawChunkMagic;
+	header.frameIndex = frameIndex;
+	header.timestamp = timestamp;
+	header.colorSize = (uint32_t)colorSize;
+	header.depthWidth = (uint16_t)depthWidth;
+	header.depthHeight = (uint16_t)depthHeight;
+	header.depthCompression = RD_ZSTD_DELTA;
+
+	const char* depthData;
+	int compressedSize = m_Compressor.Compress(m_vDepthPlanes.data(), (int)planesSize, depthCompressionLevel);
+
+	//Should never happen, but the frame is still better stored uncompressed than lost
+	if (compressedSize < 0)
+	{
+		for (int y = 0; y < depthHeight; y++)
+			memcpy(m_vDepthPlanes.data() + (size_t)y * depthWidth * sizeof(uint16_t), (const char*)depth + y * depthStrideBytes, depthWidth * sizeof(uint16_t));
+
+		header.depthCompression = RD_NONE;
+		depthData = m_vDepthPlanes.data();
+		compressedSize = (int)planesSize;
+	}
+
+	else
+		depthData = m_Compressor.GetCompressed();
+
+	header.depthSize = (uint32_t)compressedSize;
+
+	RawIndexEntry entry = { m_Writer.GetPosition(), frameIndex, 0 };
+
+	if (!m_Writer.Write(&header, sizeof(header)) || !m_Writer.Write(colorMJPG, colorSize) || !m_Writer.Write(depthData, header.depthSize))
+		return false;
+
+	m_vIndex.push_back(entry);
+	return true;
+}
+
+/// <summary>
+/// Opens an existing file for reading and reads its index
+/// </summary>
+/// <returns>False if the file can't be opened or isn't a raw recording this client can read</returns>
+bool RawRecordingFile::Open(const std::string& path)
+{
+	Close();
+
+	std::error_code error;
+	m_nFileSize = std::filesystem::file_size(path, error);
+	m_pFile = fopen(path.c_str(), "rb");
+
+	if (error || m_pFile == NULL || !ReadIndex())
+	{
+		Close();
+		return false;
+	}
+
+	m_sPath = path;
+	return true;
+}
+
+bool RawRecordingFile::Seek(uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(m_pFile, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(m_pFile, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool RawRecordingFile::ReadIndex()
+{
+	RawFileHeader header;
+
+	if (fread(&header, sizeof(header), 1, m_pFile) != 1 || header.magic != rawFileMagic || header.version != rawFileVersion ||
+		header.chunkHeaderSize != sizeof(RawChunkHeader) || header.headerSize > m_nFileSize)
+		return false;
+
+	RawFileFooter footer;
+
+	if (m_nFileSize >= header.headerSize + sizeof(footer) && Seek(m_nFileSize - sizeof(footer)) && fread(&footer, sizeof(footer), 1, m_pFile) == 1 &&
+		footer.magic == rawFileMagic && footer.indexOffset <= m_nFileSize &&
+		footer.indexOffset + (uint64_t)footer.entryCount * sizeof(RawIndexEntry) + sizeof(footer) == m_nFileSize)
+	{
+		m_vIndex.resize(footer.entryCount);
+		m_nIndexOffset = footer.indexOffset;
+
+		return footer.entryCount == 0 || (Seek(footer.indexOffset) && fread(m_vIndex.data(), sizeof(RawIndexEntry), footer.entryCount, m_pFile) == footer.entryCount);
+	}
+
+	//Not closed properly, for example because the client crashed while recording
+	RebuildIndex(header.headerSize);
+	m_bIndexRebuilt = true;
+	return true;
+}
+
+/// <summary>
+/// Collects the chunks by jumping from one chunk header to the next. Stops at the first chunk that isn't complete
+/// </summary>
+void RawRecordingFile::RebuildIndex(uint64_t firstChunkOffset)
+{
+	uint64_t offset = firstChunkOffset;
+	RawChunkHeader header;
+
+	while (offset + sizeof(header) <= m_nFileSize && Seek(offset) && fread(&header, sizeof(header), 1, m_pFile) == 1 && header.magic == rawChunkMagic)
+	{
+		uint64_t chunkEnd = offset + sizeof(header) + header.colorSize + header.depthSize;
+
+		if (chunkEnd > m_nFileSize)
+			break;
+
+		RawIndexEntry entry = { offset, header.frameIndex, 0 };
+		m_vIndex.push_back(entry);
+		offset = chunkEnd;
+	}
+
+	m_nIndexOffset = offset;
+}
+
+/// <summary>
+/// Reads the frame of an entry of the index, and decompresses its depth image
+/// </summary>
+/// <returns>False if there is no such entry, or its chunk is damaged</returns>
+bool RawRecordingFile::ReadFrame(int entry, RawFrameData& outFrame)
+{
+	if (m_pFile == NULL || entry < 0 || entry >= (int)m_vIndex.size())
+		return false;
+
+	const RawIndexEntry& indexEntry = m_vIndex[entry];
+	RawChunkHeader header;
+
+	if (!Seek(indexEntry.chunkOffset) || fread(&header, sizeof(header), 1, m_pFile) != 1 || header.magic != rawChunkMagic ||
+		indexEntry.chunkOffset + sizeof(header) + header.colorSize + header.depthSize > m_nIndexOffset)
+		return false;
+
+	outFrame.frameIndex = indexEntry.frameIndex;
+	outFrame.synced = (indexEntry.flags & RI_SYNCED) != 0;
+	outFrame.timestamp = header.timestamp;
+	outFrame.depthWidth = header.depthWidth;
+	outFrame.depthHeight = header.depthHeight;
+
+	size_t pixels = (size_t)header.depthWidth * header.depthHeight;
+	outFrame.colorMJPG.resize(header.colorSize);
+	outFrame.depth.resize(pixels);
+
+	if (header.colorSize > 0 && fread(outFrame.colorMJPG.data(), header.colorSize, 1, m_pFile) != 1)
+		return false;
+
+	if (header.depthCompression == RD_NONE)
+		return header.depthSize == pixels * sizeof(uint16_t) && (pixels == 0 || fread(outFrame.depth.data(), header.depthSize, 1, m_pFile) == 1);
+
+	if (header.depthCompression != RD_ZSTD_DELTA)
+		return false;
+
+	if (m_vDepthCompressed.size() < header.depthSize)
+		m_vDepthCompressed.resize(header.depthSize);
+
+	if (m_vDepthPlanes.size() < pixels * sizeof(uint16_t))
+		m_vDepthPlanes.resize(pixels * sizeof(uint16_t));
+
+	if (header.depthSize > 0 && fread(m_vDepthCompressed.data(), header.depthSize, 1, m_pFile) != 1)
+		return false;
+
+	size_t planesSize = ZSTD_decompress(m_vDepthPlanes.data(), pixels * sizeof(uint16_t), m_vDepthCompressed.data(), header.depthSize);
+
+	if (ZSTD_isError(planesSize) || planesSize != pixels * sizeof(uint16_t))
+		return false;
+
+	UnshuffleDepth((const uint8_t*)m_vDepthPlanes.data(), header.depthWidth, header.depthHeight, outFrame.depth.data());
+	return true;
+}
+
+/// <summary>
+/// Replaces the index of the file that is open for reading with the post synced one. The chunks stay where they are,
+/// only the index at the end of the file is rewritten. Frames that aren't part of the synced list keep their recorded index
+/// </summary>
+/// <param name="frameIDs">The recorded frame that belongs to each synced frame, -1 if this device has no frame for it</param>
+/// <param name="syncedFrameIDs">The index each synced frame gets</param>
+/// <param name="emptyColorMJPG">Is stored once, together with an empty depth image, for all synced frames this device has no frame for</param>
+/// <returns>False if a recorded frame is missing from the file or the index couldn't be written. The file is reopened for reading either way</returns>
+bool RawRecordingFile::PostSync(const std::vector<int>& frameIDs, const std::vector<int>& syncedFrameIDs, const std::vector<unsigned char>& emptyColorMJPG)
+{
+	if (m_pFile == NULL || frameIDs.size() != syncedFrameIDs.size())
+		return false;
+
+	bool success = true;
+
+	//Frames that have been post synced before keep their place
+	std::unordered_map<int, size_t> entryOfFrame;
+
+	for (size_t i = 0; i < m_vIndex.size(); i++)
+	{
+		if ((m_vIndex[i].flags & RI_SYNCED) == 0)
+			entryOfFrame[m_vIndex[i].frameIndex] = i;
+	}
+
+	//The empty frame is appended as a chunk of its own right after the recorded ones, in place of the old index
+	std::vector<char> emptyChunk;
+	uint64_t emptyChunkOffset = m_nIndexOffset;
+	uint16_t emptyDepth = 0;
+
+	for (size_t i = 0; i < frameIDs.size() && emptyChunk.empty(); i++)
+	{
+		if (frameIDs[i] != -1)
+			continue;
+
+		RawChunkHeader header = { rawChunkMagic, -1, 0, (uint32_t)emptyColorMJPG.size(), sizeof(emptyDepth), 1, 1, RD_NONE };
+		emptyChunk.insert(emptyChunk.end(), (const char*)&header, (const char*)&header + sizeof(header));
+		emptyChunk.insert(emptyChunk.end(), emptyColorMJPG.begin(), emptyColorMJPG.end());
+		emptyChunk.insert(emptyChunk.end(), (const char*)&emptyDepth, (const char*)&emptyDepth + sizeof(emptyDepth));
+	}
+
+	std::vector<RawIndexEntry> index;
+	std::vector<bool> entrySynced(m_vIndex.size(), false);
+
+	for (size_t i = 0; i < frameIDs.size(); i++)
+	{
+		if (frameIDs[i] == -1)
+		{
+			RawIndexEntry entry = { emptyChunkOffset, syncedFrameIDs[i], RI_SYNCED };
+			index.push_back(entry);
+			continue;
+		}
+
+		std::unordered_map<int, size_t>::iterator recorded = entryOfFrame.find(frameIDs[i]);
+
+		if (recorded == entryOfFrame.end())
+		{
+			success = false;
+			continue;
+		}
+
+		RawIndexEntry entry = { m_vIndex[recorded->second].chunkOffset, syncedFrameIDs[i], RI_SYNCED };
+		index.push_back(entry);
+		entrySynced[recorded->second] = true;
+	}
+
+	for (size_t i = 0; i < m_vIndex.size(); i++)
+	{
+		if (!entrySynced[i])
+			index.push_back(m_vIndex[i]);
+	}
+
+	RawFileFooter footer;
+	footer.indexOffset = m_nIndexOffset + emptyChunk.size();
+	footer.entryCount = (uint32_t)index.size();
+	footer.magic = rawFileMagic;
+
+	std::string path = m_sPath;
+	uint64_t indexOffset = m_nIndexOffset;
+	Close();
+
+	FILE* file = fopen(path.c_str(), "r+b");
+
+	if (file == NULL)
+	{
+		Open(path);
+		return false;
+	}
+
+	m_pFile = file;
+	bool written = Seek(indexOffset) &&
+		(emptyChunk.empty() || fwrite(emptyChunk.data(), emptyChunk.size(), 1, file) == 1) &&
+		(index.empty() || fwrite(index.data(), sizeof(RawIndexEntry) * index.size(), 1, file) == 1) &&
+		fwrite(&footer, sizeof(footer), 1, file) == 1;
+
+	written = fclose(file) == 0 && written;
+	m_pFile = NULL;
+
+	//In case the new index is shorter than the old one
+	std::error_code error;
+	std::filesystem::resize_file(path, footer.indexOffset + sizeof(RawIndexEntry) * index.size() + sizeof(footer), error);
+
+	return Open(path) && written && !error && success;
+}
+
+/// <summary>
+/// Ends a file that is written with its index, or closes a file that is read
+/// </summary>
+/// <returns>False if any of the writes failed</returns>
+bool RawRecordingFile::Close()
+{
+	bool success = true;
+
+	if (m_Writer.IsOpen())
+	{
+		RawFileFooter footer;
+		footer.indexOffset = m_Writer.GetPosition();
+		footer.entryCount = (uint32_t)m_vIndex.size();
+		footer.magic = rawFileMagic;
+
+		m_Writer.Write(m_vIndex.data(), m_vIndex.size() * sizeof(RawIndexEntry));
+		m_Writer.Write(&footer, sizeof(footer));
+		success = m_Writer.Close();
+	}
+
+	if (m_pFile != NULL)
+		fclose(m_pFile);
+
+	m_pFile = NULL;
+	m_sPath = "";
+	m_vIndex.clear();
+	m_nIndexOffset = 0;
+	m_nFileSize = 0;
+	m_bIndexRebuilt = false;
+	return success;
+}
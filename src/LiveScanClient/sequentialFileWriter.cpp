@@ -0,0 +1,239 @@
+#include "sequentialFileWriter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	//Big enough that the disk spends its time writing instead of seeking, small enough that not too much is lost when the client crashes
+	const size_t writeChunkSize = 8 * 1024 * 1024;
+
+	//Unbuffered writes have to be aligned to the sectors of the disk. 4096 bytes fit disks with 512 byte sectors as well as those with 4K sectors
+	const size_t sectorSize = 4096;
+}
+
+SequentialFileWriter::SequentialFileWriter() : m_bOpen(false), m_bUnbuffered(false), m_bFailed(false), m_pBuffer(NULL), m_nBufferFill(0), m_nFileOffset(0),
+	m_hFile(NULL), m_nFileDescriptor(-1)
+{
+}
+
+SequentialFileWriter::~SequentialFileWriter()
+{
+	Close();
+
+#ifdef _WIN32
+	_aligned_free(m_pBuffer);
+#else
+	free(m_pBuffer);
+#endif
+}
+
+/// <summary>
+/// Creates the file, or empties it if it already exists
+/// </summary>
+/// <param name="preallocateBytes">Space that is reserved on the disk right away, 0 lets the file grow as it is written</param>
+/// <param name="unbuffered">Writes past the page cache of the OS. Falls back to buffered writes where the file system doesn't support it</param>
+bool SequentialFileWriter::Open(const std::string& path, uint64_t preallocateBytes, bool unbuffered)
+{
+	Close();
+
+	if (m_pBuffer == NULL)
+	{
+#ifdef _WIN32
+		m_pBuffer = (char*)_aligned_malloc(writeChunkSize, sectorSize);
+#else
+		void* buffer = NULL;
+
+		if (posix_memalign(&buffer, sectorSize, writeChunkSize) == 0)
+			m_pBuffer = (char*)buffer;
+#endif
+
+		if (m_pBuffer == NULL)
+			return false;
+	}
+
+	m_bUnbuffered = unbuffered;
+	m_bFailed = false;
+	m_nBufferFill = 0;
+	m_nFileOffset = 0;
+
+#ifdef _WIN32
+	DWORD flags = FILE_FLAG_SEQUENTIAL_SCAN;
+
+	if (unbuffered)
+		flags |= FILE_FLAG_NO_BUFFERING;
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, flags, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	m_hFile = file;
+
+	//Only reserves the clusters, the size of the file stays at what has been written
+	if (preallocateBytes > 0)
+	{
+		FILE_ALLOCATION_INFO allocation;
+		allocation.AllocationSize.QuadPart = (LONGLONG)preallocateBytes;
+		SetFileInformationByHandle(file, FileAllocationInfo, &allocation, sizeof(allocation));
+	}
+#else
+	int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+#ifdef O_DIRECT
+	if (unbuffered)
+		m_nFileDescriptor = open(path.c_str(), flags | O_DIRECT, 0644);
+#endif
+
+	if (m_nFileDescriptor < 0)
+	{
+		m_bUnbuffered = false;
+		m_nFileDescriptor = open(path.c_str(), flags, 0644);
+	}
+
+	if (m_nFileDescriptor < 0)
+		return false;
+
+	//Only reserves the blocks like on Windows. Growing the file as well would leave zeros after the last frame if the client crashes
+#ifdef FALLOC_FL_KEEP_SIZE
+	if (preallocateBytes > 0)
+		fallocate(m_nFileDescriptor, FALLOC_FL_KEEP_SIZE, 0, (off_t)preallocateBytes);
+#endif
+#endif
+
+	m_bOpen = true;
+	return true;
+}
+
+/// <summary>
+/// Appends the data to the staging buffer. It only goes to the disk once the buffer is full, or when the file is closed
+/// </summary>
+/// <returns>False if writing to the disk failed, now or earlier</returns>
+bool SequentialFileWriter::Write(const void* data, size_t size)
+{
+	if (!m_bOpen || m_bFailed)
+		return false;
+
+	const char* source = (const char*)data;
+
+	while (size > 0)
+	{
+		size_t copySize = (std::min)(size, writeChunkSize - m_nBufferFill);
+		memcpy(m_pBuffer + m_nBufferFill, source, copySize);
+		m_nBufferFill += copySize;
+		source += copySize;
+		size -= copySize;
+
+		if (m_nBufferFill == writeChunkSize && !WriteBuffer(writeChunkSize))
+			return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Writes the staging buffer to the disk
+/// </summary>
+/// <param name="size">How much of the buffer to write. Has to be a multiple of the sector size for unbuffered files, and can be more than the buffer holds then</param>
+bool SequentialFileWriter::WriteBuffer(size_t size)
+{
+	const char* current = m_pBuffer;
+	size_t remaining = size;
+
+	while (remaining > 0)
+	{
+#ifdef _WIN32
+		DWORD written = 0;
+
+		if (!WriteFile((HANDLE)m_hFile, current, (DWORD)remaining, &written, NULL) || written == 0)
+		{
+			m_bFailed = true;
+			return false;
+		}
+#else
+		ssize_t written = write(m_nFileDescriptor, current, remaining);
+
+		if (written < 0 && errno == EINTR)
+			continue;
+
+		if (written <= 0)
+		{
+			m_bFailed = true;
+			return false;
+		}
+#endif
+
+		current += written;
+		remaining -= written;
+	}
+
+	m_nFileOffset += m_nBufferFill;
+	m_nBufferFill = 0;
+	return true;
+}
+
+/// <summary>
+/// Writes what is left in the staging buffer and cuts the file to the size that was appended, which also frees the unused preallocated space
+/// </summary>
+/// <returns>False if any of the writes failed. The file then ends after the last chunk that made it to the disk</returns>
+bool SequentialFileWriter::Close()
+{
+	if (!m_bOpen)
+		return true;
+
+	bool success = !m_bFailed;
+
+	if (success && m_nBufferFill > 0)
+	{
+		size_t size = m_nBufferFill;
+
+		//The padding is cut off again below
+		if (m_bUnbuffered)
+		{
+			size = (size + sectorSize - 1) / sectorSize * sectorSize;
+			memset(m_pBuffer + m_nBufferFill, 0, size - m_nBufferFill);
+		}
+
+		success = WriteBuffer(size);
+	}
+
+#ifdef _WIN32
+	FILE_END_OF_FILE_INFO endOfFile;
+	endOfFile.EndOfFile.QuadPart = (LONGLONG)m_nFileOffset;
+	SetFileInformationByHandle((HANDLE)m_hFile, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile));
+#else
+	if (ftruncate(m_nFileDescriptor, (off_t)m_nFileOffset) != 0)
+		success = false;
+#endif
+
+	CloseFile();
+	return success;
+}
+
+void SequentialFileWriter::CloseFile()
+{
+#ifdef _WIN32
+	if (m_hFile != NULL)
+		CloseHandle((HANDLE)m_hFile);
+#else
+	if (m_nFileDescriptor >= 0)
+		close(m_nFileDescriptor);
+#endif
+
+	m_hFile = NULL;
+	m_nFileDescriptor = -1;
+	m_bOpen = false;
+	m_nBufferFill = 0;
+}
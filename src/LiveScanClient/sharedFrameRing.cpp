@@ -0,0 +1,306 @@
+#include "sharedFrameRing.h"
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SharedFrameRing::SharedFrameRing() : m_pMemory(NULL), m_nMappedSize(0), m_bOwner(false), m_hMapping(NULL), m_nFileDescriptor(-1),
+	m_nSlotCount(0), m_nSlotSize(0), m_nNextFrame(0), m_nDroppedFrames(0)
+{
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+	Close();
+}
+
+/// <summary>
+/// A name that no other client on this host uses, also not the other clients running in this process
+/// </summary>
+std::string SharedFrameRing::MakeUniqueName()
+{
+	static std::atomic<int> ringCounter(0);
+
+#ifdef _WIN32
+	return "Local\\LiveScan3D_Frames_" + std::to_string(GetCurrentProcessId()) + "_" + std::to_string(ringCounter++);
+#else
+	return "/LiveScan3D_Frames_" + std::to_string(getpid()) + "_" + std::to_string(ringCounter++);
+#endif
+}
+
+/// <summary>
+/// Creates the shared memory as the writer of the ring. It's removed again when the ring is closed
+/// </summary>
+bool SharedFrameRing::Create(const std::string& name, int slotCount, int slotSize)
+{
+	Close();
+
+	if (slotCount <= 0 || slotSize <= (int)sizeof(SharedFrameSlotHeader))
+		return false;
+
+	size_t size = sizeof(SharedFrameRingHeader) + (size_t)slotCount * slotSize;
+
+#ifdef _WIN32
+	m_hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, name.c_str());
+
+	if (m_hMapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		Close();
+		return false;
+	}
+
+	m_bOwner = true;
+	m_sName = name;
+#else
+	m_nFileDescriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+	if (m_nFileDescriptor < 0)
+		return false;
+
+	//Set first, so that closing removes the name again if anything below fails
+	m_bOwner = true;
+	m_sName = name;
+
+	if (ftruncate(m_nFileDescriptor, size) != 0)
+	{
+		Close();
+		return false;
+	}
+#endif
+
+	if (!Map(size, true))
+	{
+		Close();
+		return false;
+	}
+
+	//Fresh shared memory is zeroed, so only the fields that aren't zero need to be set
+	SharedFrameRingHeader* header = GetHeader();
+	header->version = sharedFrameRingVersion;
+	header->slotCount = slotCount;
+	header->slotSize = slotSize;
+	header->published.store(0);
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = sharedFrameRingMagic;
+
+	m_nSlotCount = slotCount;
+	m_nSlotSize = slotSize;
+
+	return true;
+}
+
+/// <summary>
+/// Opens the ring of a writer on the same host to read from it. Reading starts with the next frame that is written
+/// </summary>
+bool SharedFrameRing::Open(const std::string& name)
+{
+	Close();
+
+	size_t size;
+
+#ifdef _WIN32
+	m_hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+
+	if (m_hMapping == NULL)
+		return false;
+
+	//Windows has no way to ask a mapping for its size, so the header is read first to find out
+	m_pMemory = (char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, sizeof(SharedFrameRingHeader));
+
+	if (m_pMemory == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	size = sizeof(SharedFrameRingHeader) + (size_t)GetHeader()->slotCount * GetHeader()->slotSize;
+	UnmapViewOfFile(m_pMemory);
+	m_pMemory = NULL;
+#else
+	m_nFileDescriptor = shm_open(name.c_str(), O_RDONLY, 0);
+
+	if (m_nFileDescriptor < 0)
+		return false;
+
+	struct stat status;
+
+	if (fstat(m_nFileDescriptor, &status) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	size = status.st_size;
+#endif
+
+	m_sName = name;
+
+	if (size < sizeof(SharedFrameRingHeader) || !Map(size, false))
+	{
+		Close();
+		return false;
+	}
+
+	SharedFrameRingHeader* header = GetHeader();
+
+	if (header->magic != sharedFrameRingMagic || header->version != sharedFrameRingVersion || header->slotCount <= 0 ||
+		header->slotSize <= (int)sizeof(SharedFrameSlotHeader) || size < sizeof(SharedFrameRingHeader) + (size_t)header->slotCount * header->slotSize)
+	{
+		Close();
+		return false;
+	}
+
+	m_nSlotCount = header->slotCount;
+	m_nSlotSize = header->slotSize;
+	m_nNextFrame = header->published.load(std::memory_order_acquire);
+	m_nDroppedFrames = 0;
+
+	return true;
+}
+
+bool SharedFrameRing::Map(size_t size, bool writable)
+{
+#ifdef _WIN32
+	m_pMemory = (char*)MapViewOfFile(m_hMapping, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, size);
+#else
+	void* memory = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_nFileDescriptor, 0);
+	m_pMemory = memory == MAP_FAILED ? NULL : (char*)memory;
+#endif
+
+	if (m_pMemory == NULL)
+		return false;
+
+	m_nMappedSize = size;
+	return true;
+}
+
+void SharedFrameRing::Close()
+{
+#ifdef _WIN32
+	if (m_pMemory != NULL)
+		UnmapViewOfFile(m_pMemory);
+
+	if (m_hMapping != NULL)
+		CloseHandle(m_hMapping);
+#else
+	if (m_pMemory != NULL)
+		munmap(m_pMemory, m_nMappedSize);
+
+	if (m_nFileDescriptor >= 0)
+		close(m_nFileDescriptor);
+
+	//Readers that still have it mapped keep their mapping, the name is gone though
+	if (m_bOwner)
+		shm_unlink(m_sName.c_str());
+#endif
+
+	m_pMemory = NULL;
+	m_hMapping = NULL;
+	m_nFileDescriptor = -1;
+	m_nMappedSize = 0;
+	m_bOwner = false;
+	m_sName.clear();
+	m_nSlotCount = 0;
+	m_nSlotSize = 0;
+	m_nNextFrame = 0;
+	m_nDroppedFrames = 0;
+}
+
+SharedFrameSlotHeader* SharedFrameRing::GetSlot(uint64_t frame) const
+{
+	return (SharedFrameSlotHeader*)(m_pMemory + sizeof(SharedFrameRingHeader) + (frame % m_nSlotCount) * m_nSlotSize);
+}
+
+/// <summary>
+/// Puts a frame into the next slot, overwriting the oldest frame. Never waits on the readers
+/// </summary>
+/// <param name="header">The frame header as it would be sent over the socket</param>
+/// <returns>False if the frame doesn't fit into a slot, it has to be sent over the socket then</returns>
+bool SharedFrameRing::Write(int messageType, const FrameHeader& header, const char* payload, int payloadSize)
+{
+	if (!m_bOwner || m_pMemory == NULL || payloadSize < 0 || payloadSize > GetMaxFrameSize() - (int)sizeof(FrameHeader))
+		return false;
+
+	SharedFrameRingHeader* ringHeader = GetHeader();
+	uint64_t frame = ringHeader->published.load(std::memory_order_relaxed);
+	SharedFrameSlotHeader* slot = GetSlot(frame);
+
+	slot->sequence.store(2 * frame + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	char* data = (char*)(slot + 1);
+	memcpy(data, &header, sizeof(FrameHeader));
+	memcpy(data + sizeof(FrameHeader), payload, payloadSize);
+	slot->messageType = messageType;
+	slot->size = sizeof(FrameHeader) + payloadSize;
+
+	slot->sequence.store(2 * frame + 2, std::memory_order_release);
+	ringHeader->published.store(frame + 1, std::memory_order_release);
+
+	return true;
+}
+
+/// <summary>
+/// Copies the next frame out of the ring, without waiting for one
+/// </summary>
+/// <param name="frame">Receives the frame header and the payload</param>
+/// <returns>False if there is no new frame. Frames that were overwritten before they could be read are skipped and counted as dropped</returns>
+bool SharedFrameRing::Read(int& messageType, std::vector<char>& frame)
+{
+	if (m_bOwner || m_pMemory == NULL)
+		return false;
+
+	uint64_t published = GetHeader()->published.load(std::memory_order_acquire);
+
+	//Everything older than the number of slots is already overwritten
+	if (published - m_nNextFrame > (uint64_t)m_nSlotCount)
+	{
+		m_nDroppedFrames += published - m_nSlotCount - m_nNextFrame;
+		m_nNextFrame = published - m_nSlotCount;
+	}
+
+	while (m_nNextFrame < published)
+	{
+		uint64_t current = m_nNextFrame++;
+		SharedFrameSlotHeader* slot = GetSlot(current);
+		uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+
+		if (sequence != 2 * current + 2)
+		{
+			m_nDroppedFrames++;
+			continue;
+		}
+
+		int type = slot->messageType;
+		int size = slot->size;
+
+		if (size >= 0 && size <= GetMaxFrameSize())
+		{
+			frame.resize(size);
+			memcpy(frame.data(), slot + 1, size);
+		}
+
+		//If the writer came around while we were copying, the copy is torn
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (slot->sequence.load(std::memory_order_relaxed) != sequence || size < 0 || size > GetMaxFrameSize())
+		{
+			m_nDroppedFrames++;
+			continue;
+		}
+
+		messageType = type;
+		return true;
+	}
+
+	return false;
+}
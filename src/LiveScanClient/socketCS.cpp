@@ -1,23 +1,29 @@
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 
-#include "SocketCS.h"
+#include "socketCS.h"
+#ifdef _WIN32
+#include <mswsock.h>
+#include <io.h>
 #pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "mswsock.lib")
+#else
+#include <sys/sendfile.h>
+#endif
 
 
-int Socket::nofSockets_= 0;
-
 void Socket::Start() {
-  if (!nofSockets_) {
-    WSADATA info;
-    if (WSAStartup(MAKEWORD(2,0), &info)) {
-      throw "Could not start WSA";
-    }
+#ifdef _WIN32
+  WSADATA info;
+  if (WSAStartup(MAKEWORD(2,0), &info)) {
+    throw "Could not start WSA";
   }
-  ++nofSockets_;
+#endif
 }
 
 void Socket::End() {
+#ifdef _WIN32
   WSACleanup();
+#endif
 }
 
 Socket::Socket() : s_(0) {
@@ -26,6 +32,7 @@ Socket::Socket() : s_(0) {
   s_ = socket(AF_INET,SOCK_STREAM,0);
 
   if (s_ == INVALID_SOCKET) {
+    End();
     throw "INVALID_SOCKET";
   }
 
@@ -41,18 +48,14 @@ Socket::~Socket() {
   if (! --(*refCounter_)) {
     Close();
     delete refCounter_;
+    End();
   }
-
-  --nofSockets_;
-  if (!nofSockets_) End();
 }
 
 Socket::Socket(const Socket& o) {
   refCounter_=o.refCounter_;
   (*refCounter_)++;
   s_         =o.s_;
-
-  nofSockets_++;
 }
 
 Socket& Socket::operator=(Socket& o) {
@@ -61,8 +64,6 @@ Socket& Socket::operator=(Socket& o) {
   refCounter_=o.refCounter_;
   s_         =o.s_;
 
-  nofSockets_++;
-
   return *this;
 }
 
@@ -96,6 +97,50 @@ std::string Socket::ReceiveBytes() {
   return ret;
 }
 
+// select() on Windows, poll() everywhere else. We only ever wait
+// on the one socket to the server, so epoll wouldn't gain anything.
+bool Socket::WaitReadable(int timeoutMs) {
+  return WaitReadable(s_, timeoutMs);
+}
+
+bool Socket::WaitReadable(SOCKET s, int timeoutMs) {
+#ifdef _WIN32
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(s, &fds);
+
+  TIMEVAL tval;
+  tval.tv_sec  = timeoutMs / 1000;
+  tval.tv_usec = (timeoutMs % 1000) * 1000;
+
+  // Errors count as readable, so that the next receive notices them
+  return select(0, &fds, (fd_set*) 0, (fd_set*) 0, &tval) != 0;
+#else
+  pollfd fd;
+  fd.fd = s;
+  fd.events = POLLIN;
+  fd.revents = 0;
+
+  return poll(&fd, 1, timeoutMs) != 0;
+#endif
+}
+
+int Socket::ReceiveAvailable(char *buf, int len) {
+  u_long arg = 0;
+  if (ioctlsocket(s_, FIONREAD, &arg) != 0)
+    return -1;
+
+  if (arg == 0)
+    return 0;
+
+  if (arg > (u_long)len) arg = len;
+
+  int rv = recv (s_, buf, arg, 0);
+  if (rv <= 0) return -1;
+
+  return rv;
+}
+
 std::string Socket::ReceiveLine() {
   std::string ret;
   while (1) {
@@ -127,8 +172,62 @@ void Socket::SendLine(std::string s) {
   send(s_,s.c_str(),s.length(),0);
 }
 
-void Socket::SendBytes(const char *buf, int len) {
-  send(s_,buf,len,0);
+bool Socket::SendBytes(const char *buf, int len) {
+  while (len > 0) {
+    int sent = send(s_,buf,len,0);
+
+    if (sent <= 0)
+      return false;
+
+    buf += sent;
+    len -= sent;
+  }
+
+  return true;
+}
+
+int Socket::SendFileRange(FILE *file, long long offset, int len) {
+  if (file == NULL)
+    return 0;
+
+#ifdef _WIN32
+  HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+  LARGE_INTEGER position;
+  position.QuadPart = offset;
+
+  // TransmitFile reads from the current position of the file
+  if (handle == INVALID_HANDLE_VALUE || !SetFilePointerEx(handle, position, NULL, FILE_BEGIN))
+    return 0;
+
+  // It doesn't tell how much went out before it failed, so sending
+  // the rest from memory could send some bytes twice
+  return TransmitFile(s_, handle, len, 0, NULL, NULL, 0) != FALSE ? len : -1;
+#else
+  off_t position = offset;
+  int total = 0;
+
+  while (total < len) {
+    ssize_t sent = sendfile(s_, fileno(file), &position, len - total);
+
+    if (sent < 0 && errno == EINTR)
+      continue;
+
+    // A file sendfile can't read from fails before anything is sent
+    if (sent < 0 && total == 0 && (errno == EINVAL || errno == ENOSYS))
+      return 0;
+
+    if (sent < 0)
+      return -1;
+
+    // The file ended early, the rest can still come from memory
+    if (sent == 0)
+      break;
+
+    total += (int)sent;
+  }
+
+  return total;
+#endif
 }
 
 SocketServer::SocketServer(int port, int connections, TypeSocket type) {
@@ -213,7 +312,9 @@ SocketSelect::SocketSelect(Socket const * const s1, Socket const * const s2, Typ
     ptval = 0;
   }
 
-  if (select (0, &fds_, (fd_set*) 0, (fd_set*) 0, ptval) == SOCKET_ERROR) 
+  SOCKET highest = s2 && s2->s_ > s1->s_ ? s2->s_ : s1->s_;
+
+  if (select ((int)highest + 1, &fds_, (fd_set*) 0, (fd_set*) 0, ptval) == SOCKET_ERROR) 
     throw "Error in select";
 }
 
@@ -0,0 +1,274 @@
+#include "yuvColor.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	/// <summary>
+	/// Fixed point YCbCr -> RGB tables, built the same way as in libjpeg (jdcolor.c), so that we get the exact same colors
+	/// as a BGRA decode by TurboJpeg
+	/// </summary>
+	struct YCbCrTables
+	{
+		int crToRed[256];
+		int cbToBlue[256];
+		int crToGreen[256];
+		int cbToGreen[256];
+
+		//Clamps Y + chroma offset to 0-255 without branches, index with the value + clampOffset
+		static const int clampOffset = 256;
+		uint8_t clamp[3 * 256];
+
+		YCbCrTables()
+		{
+			const int scaleBits = 16;
+			const int oneHalf = 1 << (scaleBits - 1);
+
+			for (int i = 0; i < 256; i++)
+			{
+				int x = i - 128;
+				crToRed[i] = ((int)(1.40200 * (1 << scaleBits) + 0.5) * x + oneHalf) >> scaleBits;
+				cbToBlue[i] = ((int)(1.77200 * (1 << scaleBits) + 0.5) * x + oneHalf) >> scaleBits;
+				crToGreen[i] = -(int)(0.71414 * (1 << scaleBits) + 0.5) * x;
+				cbToGreen[i] = -(int)(0.34414 * (1 << scaleBits) + 0.5) * x + oneHalf;
+			}
+
+			for (int i = 0; i < 3 * 256; i++)
+			{
+				int value = i - clampOffset;
+				clamp[i] = (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+			}
+		}
+	};
+
+	const YCbCrTables ycbcrTables;
+
+	inline int SubsamplingShift(int mcuSize)
+	{
+		//The MCU is 8 pixels per sample, so 16 means 2x and 32 means 4x subsampling
+		return mcuSize >= 32 ? 2 : (mcuSize >= 16 ? 1 : 0);
+	}
+}
+
+/// <summary>
+/// Decompresses a JPEG image into its Y, Cb and Cr planes. This skips the upsampling and colorspace conversion of a full BGRA decode
+/// </summary>
+/// <param name="scale">Decodes at 1/scale of the resolution, same as the color decode scale</param>
+/// <returns>Returns false if the JPEG could not be decoded</returns>
+bool DecodeJPEGToYUV(tjhandle turboJpeg, const uint8_t* jpeg, unsigned long jpegSize, int scale, YUVImage& outImage)
+{
+	int fullWidth, fullHeight, subsampling, colorspace;
+
+	if (tjDecompressHeader3(turboJpeg, jpeg, jpegSize, &fullWidth, &fullHeight, &subsampling, &colorspace) != 0)
+		return false;
+
+	tjscalingfactor scalingFactor = { 1, scale };
+	int width = TJSCALED(fullWidth, scalingFactor);
+	int height = TJSCALED(fullHeight, scalingFactor);
+
+	outImage.width = width;
+	outImage.height = height;
+	outImage.grayscale = subsampling == TJSAMP_GRAY;
+	outImage.chromaShiftX = SubsamplingShift(tjMCUWidth[subsampling]);
+	outImage.chromaShiftY = SubsamplingShift(tjMCUHeight[subsampling]);
+
+	unsigned char* planes[3] = { NULL, NULL, NULL };
+	int strides[3] = { 0, 0, 0 };
+	int planeCount = outImage.grayscale ? 1 : 3;
+
+	for (int i = 0; i < planeCount; i++)
+	{
+		int planeWidth = tjPlaneWidth(i, width, subsampling);
+		int planeHeight = tjPlaneHeight(i, height, subsampling);
+
+		if (outImage.planes[i].cols != planeWidth || outImage.planes[i].rows != planeHeight)
+			outImage.planes[i] = cv::Mat(planeHeight, planeWidth, CV_8UC1);
+
+		planes[i] = outImage.planes[i].data;
+		strides[i] = planeWidth;
+	}
+
+	return tjDecompressToYUVPlanes(turboJpeg, jpeg, jpegSize, planes, width, strides, height, TJFLAG_FASTDCT) == 0;
+}
+
+/// <summary>
+/// Creates an image in which every pixel holds its own coordinates, packed as described at PixelCoordinatesAsColor()
+/// </summary>
+void CreatePixelCoordinateImage(cv::Mat& coordinateImage, int width, int height)
+{
+	if (coordinateImage.cols == width && coordinateImage.rows == height)
+		return;
+
+	coordinateImage = cv::Mat(height, width, CV_8UC4);
+	uint32_t* coordinates = (uint32_t*)coordinateImage.data;
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			coordinates[x + y * width] = PixelCoordinatesAsColor(x, y);
+	}
+}
+
+/// <summary>
+/// Replaces the pixel coordinates in the colors with the color of that pixel in the YUV image.
+/// Chroma is sampled from the nearest sample, same as the fast upsampling we use for BGRA decoding.
+/// Like the cull kernels, the first byte of BGR goes into the red channel
+/// </summary>
+void SampleYUVColors(const YUVImage& image, RGBA* colors, int count)
+{
+	const uint8_t* luma = image.planes[0].data;
+	int lumaStride = image.planes[0].cols;
+	const uint8_t* cb = image.grayscale ? NULL : image.planes[1].data;
+	const uint8_t* cr = image.grayscale ? NULL : image.planes[2].data;
+	int chromaStride = image.grayscale ? 0 : image.planes[1].cols;
+
+	if (image.grayscale)
+	{
+		#pragma omp parallel for
+		for (int i = 0; i < count; i++)
+		{
+			int x, y;
+			PixelCoordinatesFromColor(colors[i], x, y);
+
+			uint8_t Y = luma[x + y * lumaStride];
+			colors[i].red = Y;
+			colors[i].green = Y;
+			colors[i].blue = Y;
+			colors[i].alpha = 1;
+		}
+
+		return;
+	}
+
+	const uint8_t* clamp = ycbcrTables.clamp + YCbCrTables::clampOffset;
+
+	#pragma omp parallel for
+	for (int i = 0; i < count; i++)
+	{
+		int x, y;
+		PixelCoordinatesFromColor(colors[i], x, y);
+
+		int Y = luma[x + y * lumaStride];
+		int chromaIndex = (x >> image.chromaShiftX) + (y >> image.chromaShiftY) * chromaStride;
+		int Cb = cb[chromaIndex];
+		int Cr = cr[chromaIndex];
+
+		RGBA& color = colors[i];
+		color.red = clamp[Y + ycbcrTables.cbToBlue[Cb]];
+		color.green = clamp[Y + ((ycbcrTables.cbToGreen[Cb] + ycbcrTables.crToGreen[Cr]) >> 16)];
+		color.blue = clamp[Y + ycbcrTables.crToRed[Cr]];
+		color.alpha = 1;
+	}
+}
+
+std::string BenchmarkColorDecode(const std::string& jpegPath, float survivingRatio, int iterations)
+{
+	std::ifstream jpegFile(jpegPath, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!jpegFile.is_open())
+		return "Could not open " + jpegPath + "\n";
+
+	std::vector<uint8_t> jpeg((size_t)jpegFile.tellg());
+	jpegFile.seekg(0, std::ios::beg);
+	jpegFile.read((char*)jpeg.data(), jpeg.size());
+	jpegFile.close();
+
+	tjhandle turboJpeg = tjInitDecompress();
+
+	int width, height, subsampling, colorspace;
+	if (tjDecompressHeader3(turboJpeg, jpeg.data(), (unsigned long)jpeg.size(), &width, &height, &subsampling, &colorspace) != 0)
+	{
+		tjDestroy(turboJpeg);
+		return "Could not read the JPEG header of " + jpegPath + "\n";
+	}
+
+	//The subject usually stands in the middle of the capture volume, so the survivors are a centered box
+	std::vector<int> survivors;
+	float boxScale = sqrtf(survivingRatio);
+	int boxWidth = (int)(width * boxScale);
+	int boxHeight = (int)(height * boxScale);
+
+	for (int y = (height - boxHeight) / 2; y < (height + boxHeight) / 2; y++)
+	{
+		for (int x = (width - boxWidth) / 2; x < (width + boxWidth) / 2; x++)
+			survivors.push_back(x + y * width);
+	}
+
+	cv::Mat colorBGR(height, width, CV_8UC4);
+	cv::Mat pixelCoordinates;
+	YUVImage colorYUV;
+
+	CreatePixelCoordinateImage(pixelCoordinates, width, height);
+	std::vector<RGBA> colorsBGRA(survivors.size());
+	std::vector<RGBA> colorsYUV(survivors.size());
+
+	double bgraMs = 0;
+	double yuvMs = 0;
+	bool decodeFailed = false;
+
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		decodeFailed |= tjDecompress2(turboJpeg, jpeg.data(), (unsigned long)jpeg.size(), colorBGR.data, width, 0, height, TJPF_BGRA, TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE) != 0;
+
+		for (size_t i = 0; i < survivors.size(); i++)
+		{
+			const uint8_t* pixel = colorBGR.data + 4 * survivors[i];
+			colorsBGRA[i].red = pixel[0];
+			colorsBGRA[i].green = pixel[1];
+			colorsBGRA[i].blue = pixel[2];
+			colorsBGRA[i].alpha = 1;
+		}
+
+		std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+		decodeFailed |= !DecodeJPEGToYUV(turboJpeg, jpeg.data(), (unsigned long)jpeg.size(), 1, colorYUV);
+
+		//Gathers the coordinates of the survivors just like the cull kernels gather their colors
+		for (size_t i = 0; i < survivors.size(); i++)
+		{
+			const uint8_t* pixel = pixelCoordinates.data + 4 * survivors[i];
+			colorsYUV[i].red = pixel[0];
+			colorsYUV[i].green = pixel[1];
+			colorsYUV[i].blue = pixel[2];
+		}
+
+		SampleYUVColors(colorYUV, colorsYUV.data(), (int)colorsYUV.size());
+
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		bgraMs += std::chrono::duration<double, std::milli>(middle - start).count();
+		yuvMs += std::chrono::duration<double, std::milli>(end - middle).count();
+	}
+
+	tjDestroy(turboJpeg);
+
+	int mismatches = 0;
+	int maxDifference = 0;
+
+	for (size_t i = 0; i < survivors.size(); i++)
+	{
+		int difference = abs(colorsBGRA[i].red - colorsYUV[i].red);
+		difference = (std::max)(difference, abs(colorsBGRA[i].green - colorsYUV[i].green));
+		difference = (std::max)(difference, abs(colorsBGRA[i].blue - colorsYUV[i].blue));
+
+		if (difference > 0)
+			mismatches++;
+
+		maxDifference = (std::max)(maxDifference, difference);
+	}
+
+	std::string result = jpegPath + " (" + std::to_string(width) + "x" + std::to_string(height) + ", " +
+		std::to_string(survivors.size()) + " surviving pixels)\n";
+	result += "BGRA decode + gather: " + std::to_string(bgraMs / iterations) + " ms\n";
+	result += "YUV decode + sample survivors: " + std::to_string(yuvMs / iterations) + " ms\n";
+	result += "Mismatching colors: " + std::to_string(mismatches) + ", max difference: " + std::to_string(maxDifference) + "\n";
+
+	if (decodeFailed)
+		result += "Warning: TurboJpeg reported errors while decoding\n";
+
+	return result;
+}
@@ -0,0 +1,202 @@
+//Receives server messages over loopback from a fake server, the same way LiveScanClient::ReceiveMessages() does:
+//Wait until the socket is readable, read whatever is available into the MessageFramer and hand out the complete messages.
+//The fake server cuts its stream into random pieces, so that messages are split across reads at every possible position.
+//Builds on Linux without the camera SDKs, from the root of the repository:
+//  g++ -std=c++17 -O1 -Iinclude -Iinclude/LiveScanClient tests/LiveScanClient/messageFramerLoopbackTest.cpp src/LiveScanClient/messageFramer.cpp src/LiveScanClient/socketCS.cpp -lpthread -o messageFramerLoopbackTest
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include "socketCS.h"
+#include "messageFramer.h"
+
+namespace
+{
+	//The first of these ports that is free is used, one of an earlier run might still be in TIME_WAIT
+	const int firstTestPort = 48101;
+	const int testPortCount = 100;
+	const int messageCount = 2000;
+	const int maxPayloadSize = 5000;
+	const int maxPieceSize = 3000;
+
+	/// <summary>
+	/// The payload of message i can be recomputed by the receiver, so that every byte of it can be checked
+	/// </summary>
+	void MakeMessage(int i, std::mt19937& random, std::vector<char>& outStream)
+	{
+		char type = (char)(random() % MSG_INCOMING_COUNT);
+		int size = random() % (maxPayloadSize + 1);
+
+		outStream.push_back(type);
+		outStream.insert(outStream.end(), (char*)&size, (char*)&size + sizeof(size));
+
+		for (int k = 0; k < size; k++)
+			outStream.push_back((char)(i * 31 + k));
+	}
+
+	bool CheckMessage(int i, std::mt19937& random, const ServerMessage& message)
+	{
+		INCOMING_MESSAGE_TYPE type = (INCOMING_MESSAGE_TYPE)(random() % MSG_INCOMING_COUNT);
+		int size = random() % (maxPayloadSize + 1);
+
+		if (message.type != type || message.size != size)
+			return false;
+
+		for (int k = 0; k < size; k++)
+		{
+			if (message.payload[k] != (char)(i * 31 + k))
+				return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// Sends all messages in random pieces with short pauses in between, then closes the connection
+	/// </summary>
+	void FakeServer(SocketServer* server)
+	{
+		Socket* connection = server->Accept();
+
+		std::mt19937 random(1234);
+		std::vector<char> stream;
+
+		for (int i = 0; i < messageCount; i++)
+			MakeMessage(i, random, stream);
+
+		std::mt19937 pieces(5678);
+		size_t sent = 0;
+
+		while (sent < stream.size())
+		{
+			int piece = (int)(std::min)((size_t)(1 + pieces() % maxPieceSize), stream.size() - sent);
+			connection->SendBytes(stream.data() + sent, piece);
+			sent += piece;
+
+			if (pieces() % 8 == 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+
+		connection->Close();
+		delete connection;
+	}
+
+	/// <summary>
+	/// The framer must stop at a corrupted header, instead of reading whatever follows as new messages
+	/// </summary>
+	bool TestCorruptedHeader()
+	{
+		MessageFramer framer;
+		std::vector<char> stream;
+		std::mt19937 random(1);
+
+		MakeMessage(0, random, stream);
+
+		//A payload size that no message can have, followed by what looks like a valid message
+		stream.push_back((char)MSG_CALIBRATE);
+		int badSize = -5;
+		stream.insert(stream.end(), (char*)&badSize, (char*)&badSize + sizeof(badSize));
+		MakeMessage(1, random, stream);
+
+		char* destination = framer.GetWriteBuffer((int)stream.size());
+		memcpy(destination, stream.data(), stream.size());
+		framer.CommitWrite((int)stream.size());
+
+		ServerMessage message;
+		int messages = 0;
+
+		while (framer.NextMessage(message))
+			messages++;
+
+		return messages == 1 && framer.HasError() && !framer.NextMessage(message);
+	}
+}
+
+int main()
+{
+	SocketServer* server = NULL;
+	int port = firstTestPort;
+
+	for (; port < firstTestPort + testPortCount; port++)
+	{
+		try
+		{
+			server = new SocketServer(port, 1);
+			break;
+		}
+
+		catch (...)
+		{
+		}
+	}
+
+	if (server == NULL)
+	{
+		printf("Could not listen on any of the test ports\n");
+		return 1;
+	}
+
+	std::thread serverThread(FakeServer, server);
+
+	SocketClient client("127.0.0.1", port);
+	MessageFramer framer;
+	std::mt19937 random(1234);
+
+	int received = 0;
+	int corrupted = 0;
+	bool closed = false;
+	const int receiveSize = 64 * 1024;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	while (!closed && std::chrono::steady_clock::now() - start < std::chrono::seconds(30))
+	{
+		bool readable = client.WaitReadable(100);
+		int totalReceived = 0;
+
+		while (true)
+		{
+			char* destination = framer.GetWriteBuffer(receiveSize);
+			int bytes = client.ReceiveAvailable(destination, framer.GetWriteBufferSize());
+
+			if (bytes <= 0)
+			{
+				//Readable, but nothing to read, is how the close of the connection shows
+				if (bytes < 0 || (readable && totalReceived == 0))
+					closed = true;
+
+				break;
+			}
+
+			framer.CommitWrite(bytes);
+			totalReceived += bytes;
+		}
+
+		ServerMessage message;
+
+		while (framer.NextMessage(message))
+		{
+			if (!CheckMessage(received, random, message))
+				corrupted++;
+
+			received++;
+		}
+
+		if (framer.HasError())
+			break;
+	}
+
+	serverThread.join();
+	delete server;
+
+	bool corruptedHeaderDetected = TestCorruptedHeader();
+	bool passed = received == messageCount && corrupted == 0 && closed && !framer.HasError() && corruptedHeaderDetected;
+
+	printf("Received %d of %d messages, %d corrupted, close %s, corrupted header %s\n", received, messageCount, corrupted,
+		closed ? "detected" : "missed", corruptedHeaderDetected ? "detected" : "missed");
+	printf(passed ? "PASSED\n" : "FAILED\n");
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+//Reads frames from a SharedFrameRing the same way ClientSocket.ReceiveSharedFrames() on the server does, and checks that every
+//frame the writer published is either read back intact or counted as dropped by the reader.
+//Without arguments, a writer thread fills a ring of its own, once with a reader that reads as fast as it can, once with one that falls further behind
+//and once with one that only starts after the writer lapped it.
+//With the name of the ring a running client announced, it stands in for the server and checks the client's frames instead.
+//Builds on Linux without the camera SDKs, from the root of the repository:
+//  g++ -std=c++17 -O1 -Iinclude -Iinclude/LiveScanClient tests/LiveScanClient/sharedFrameRingConsumerTest.cpp src/LiveScanClient/sharedFrameRing.cpp src/LiveScanClient/frameHeader.cpp -lpthread -lrt -o sharedFrameRingConsumerTest
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "sharedFrameRing.h"
+#include "utils.h"
+
+namespace
+{
+	const int testSlotCount = 2;
+	const int testSlotSize = 1024 * 1024;
+	const int frameCount = 20000;
+	const int payloadCount = 16; //Frame i carries payload i % payloadCount, a frame that was overwritten while it was read has parts of two
+
+	struct ConsumerResult
+	{
+		int received;
+		int corrupted;
+		int skipped; //Frames missing between two received ones
+		uint64_t dropped;
+	};
+
+	std::vector<std::vector<char>> testPayloads;
+	std::vector<FrameHeader> testHeaders;
+
+	/// <summary>
+	/// Every payload is different, its checksum covers it just like for a real frame.
+	/// Large and small payloads take turns, so that the writer can overwrite a large frame while the reader still copies it
+	/// </summary>
+	void MakePayloads()
+	{
+		std::mt19937 random(1234);
+		testPayloads.resize(payloadCount);
+		testHeaders.resize(payloadCount);
+
+		for (int i = 0; i < payloadCount; i++)
+		{
+			int size = 1 + random() % (testSlotSize - (int)sizeof(SharedFrameSlotHeader) - (int)sizeof(FrameHeader));
+			size = i % 3 == 0 ? size : size / 64;
+
+			testPayloads[i].resize(size);
+
+			for (int k = 0; k < size; k++)
+				testPayloads[i][k] = (char)(i * 31 + k);
+
+			memset(&testHeaders[i], 0, sizeof(FrameHeader));
+			testHeaders[i].payloadSize = size;
+			testHeaders[i].compression = FC_NONE;
+			testHeaders[i].checksum = XXHash32(testPayloads[i].data(), size, 0);
+			testHeaders[i].flags = FHF_CHECKSUM;
+		}
+	}
+
+	int MessageTypeOf(int i)
+	{
+		return i % 2 == 0 ? MSG_PUSHED_LIVE_FRAME : MSG_LAST_FRAME;
+	}
+
+	/// <summary>
+	/// Checks a frame like AcceptFrame() on the server. The frames of the test's own writer are compared to the payload that was written instead,
+	/// which is quicker than the checksum, so that the reader reads often enough to be overwritten while copying
+	/// </summary>
+	bool CheckFrame(int messageType, const std::vector<char>& frame, bool ownWriter, int& frameIndex)
+	{
+		if (frame.size() < sizeof(FrameHeader))
+			return false;
+
+		FrameHeader header;
+		memcpy(&header, frame.data(), sizeof(FrameHeader));
+		frameIndex = header.frameIndex;
+
+		const char* payload = frame.data() + sizeof(FrameHeader);
+		int size = (int)frame.size() - (int)sizeof(FrameHeader);
+
+		if (header.payloadSize != size || header.compression != FC_NONE)
+			return false;
+
+		if (!ownWriter)
+			return !(header.flags & FHF_CHECKSUM) || header.checksum == XXHash32(payload, size, 0);
+
+		if (header.frameIndex < 0 || messageType != MessageTypeOf(header.frameIndex))
+			return false;
+
+		const std::vector<char>& written = testPayloads[header.frameIndex % payloadCount];
+
+		return header.checksum == testHeaders[header.frameIndex % payloadCount].checksum && size == (int)written.size() &&
+			memcmp(payload, written.data(), size) == 0;
+	}
+
+	/// <summary>
+	/// Reads until the writer is done and the ring is empty, or until the time is up
+	/// </summary>
+	ConsumerResult Consume(SharedFrameRing& reader, const std::atomic<bool>& writerDone, bool ownWriter, int readerDelayMicroseconds, int seconds)
+	{
+		ConsumerResult result = {};
+		std::vector<char> frame;
+		int messageType;
+		int lastIndex = -1;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		while (std::chrono::steady_clock::now() - start < std::chrono::seconds(seconds))
+		{
+			bool done = writerDone;
+
+			if (!reader.Read(messageType, frame))
+			{
+				if (done)
+					break;
+
+				std::this_thread::yield();
+				continue;
+			}
+
+			int frameIndex;
+
+			if (!CheckFrame(messageType, frame, ownWriter, frameIndex))
+				result.corrupted++;
+
+			else
+			{
+				//The test's own writer starts at frame 0, a client might have written any number of frames already
+				if ((ownWriter || lastIndex >= 0) && frameIndex > lastIndex + 1)
+					result.skipped += frameIndex - lastIndex - 1;
+
+				lastIndex = frameIndex;
+			}
+
+			result.received++;
+
+			if (readerDelayMicroseconds > 0)
+				std::this_thread::sleep_for(std::chrono::microseconds(readerDelayMicroseconds));
+		}
+
+		result.dropped = reader.GetDroppedFrames();
+		return result;
+	}
+
+	void Writer(SharedFrameRing* ring, std::atomic<bool>* writerDone)
+	{
+		for (int i = 0; i < frameCount; i++)
+		{
+			FrameHeader header = testHeaders[i % payloadCount];
+			header.frameIndex = i;
+			ring->Write(MessageTypeOf(i), header, testPayloads[i % payloadCount].data(), header.payloadSize);
+		}
+
+		*writerDone = true;
+	}
+
+	bool TestOwnWriter(const char* name, int readerDelayMicroseconds)
+	{
+		SharedFrameRing writer, reader;
+		std::string ringName = SharedFrameRing::MakeUniqueName();
+
+		if (!writer.Create(ringName, testSlotCount, testSlotSize) || !reader.Open(ringName))
+		{
+			printf("%s: Could not create the ring\n", name);
+			return false;
+		}
+
+		std::atomic<bool> writerDone(false);
+		std::thread writerThread(Writer, &writer, &writerDone);
+		ConsumerResult result = Consume(reader, writerDone, true, readerDelayMicroseconds, 60);
+		writerThread.join();
+
+		reader.Close();
+		writer.Close();
+
+		//Every frame is accounted for exactly once, and every gap between the frames the reader got was counted as dropped
+		bool passed = result.corrupted == 0 && (uint64_t)result.received + result.dropped == frameCount &&
+			(uint64_t)result.skipped == result.dropped;
+
+		printf("%s: Received %d of %d frames, %d corrupted, %llu dropped, %d skipped: %s\n", name, result.received, frameCount,
+			result.corrupted, (unsigned long long)result.dropped, result.skipped, passed ? "PASSED" : "FAILED");
+
+		return passed;
+	}
+
+	/// <summary>
+	/// Without a second core, the writer hardly ever laps the reader while it copies. Here it always has, before the reader starts
+	/// </summary>
+	bool TestLappedReader()
+	{
+		SharedFrameRing writer, reader;
+		std::string ringName = SharedFrameRing::MakeUniqueName();
+
+		if (!writer.Create(ringName, testSlotCount, testSlotSize) || !reader.Open(ringName))
+		{
+			printf("Lapped reader: Could not create the ring\n");
+			return false;
+		}
+
+		const int written = testSlotCount + 3;
+
+		for (int i = 0; i < written; i++)
+		{
+			FrameHeader header = testHeaders[i % payloadCount];
+			header.frameIndex = i;
+			writer.Write(MessageTypeOf(i), header, testPayloads[i % payloadCount].data(), header.payloadSize);
+		}
+
+		std::atomic<bool> writerDone(true);
+		ConsumerResult result = Consume(reader, writerDone, true, 0, 10);
+
+		reader.Close();
+		writer.Close();
+
+		bool passed = result.corrupted == 0 && result.received == testSlotCount && result.dropped == written - testSlotCount &&
+			(uint64_t)result.skipped == result.dropped;
+
+		printf("Lapped reader: Received %d of %d frames, %d corrupted, %llu dropped: %s\n", result.received, written, result.corrupted,
+			(unsigned long long)result.dropped, passed ? "PASSED" : "FAILED");
+
+		return passed;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		SharedFrameRing reader;
+
+		if (!reader.Open(argv[1]))
+		{
+			printf("Could not open the ring %s\n", argv[1]);
+			return 1;
+		}
+
+		std::atomic<bool> never(false);
+		ConsumerResult result = Consume(reader, never, false, 0, 10);
+
+		printf("Received %d frames, %d corrupted, %llu dropped, %d skipped\n", result.received, result.corrupted,
+			(unsigned long long)result.dropped, result.skipped);
+
+		return result.corrupted == 0 ? 0 : 1;
+	}
+
+	MakePayloads();
+
+	bool withoutPauses = TestOwnWriter("Reader without pauses", 0);
+	bool pausing = TestOwnWriter("Reader pausing after every frame", 50);
+
+	bool lapped = TestLappedReader();
+
+	return withoutPauses && pausing && lapped ? 0 : 1;
+}